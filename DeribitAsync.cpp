@@ -0,0 +1,78 @@
+#include "DeribitAsync.hpp"
+
+DeribitPending::DeribitPending() : state(std::make_shared<State>()) {}
+
+ResponseCallback DeribitPending::completer() const {
+    std::shared_ptr<State> shared = state;
+    return [shared](const json& response, int64_t latency_us) {
+        DeribitPending pending;
+        pending.state = shared;
+        pending.complete(response, latency_us);
+    };
+}
+
+void DeribitPending::complete(const json& response, int64_t latency_us) const {
+    finish(response, latency_us, false);
+}
+
+void DeribitPending::fail(const std::string& message) const {
+    finish(DeribitRequestTable::makeErrorResponse(0, message), 0, true);
+}
+
+void DeribitPending::finish(const json& response, int64_t latency_us, bool local) const {
+    ResponseCallback continuation;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->done) {
+            return;
+        }
+        state->response.message = response;
+        state->response.latency_us = latency_us;
+        state->response.local = local;
+        state->done = true;
+        continuation.swap(state->continuation);
+    }
+    state->done_signal.notify_all();
+    // Outside the lock: the continuation may resume a coroutine that reads this state
+    if (continuation) {
+        continuation(state->response.message, latency_us);
+    }
+}
+
+bool DeribitPending::ready() const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->done;
+}
+
+bool DeribitPending::waitFor(std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    return state->done_signal.wait_for(lock, timeout, [this]() { return state->done; });
+}
+
+const DeribitResponse& DeribitPending::get() const {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done_signal.wait(lock, [this]() { return state->done; });
+    return state->response;
+}
+
+void DeribitPending::then(ResponseCallback callback) const {
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (!state->done) {
+            state->continuation = std::move(callback);
+            return;
+        }
+    }
+    callback(state->response.message, state->response.latency_us);
+}
+
+#ifdef DERIBIT_HAS_COROUTINES
+bool DeribitPending::await_suspend(std::coroutine_handle<> handle) const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->done) {
+        return false;
+    }
+    state->continuation = [handle](const json&, int64_t) { handle.resume(); };
+    return true;
+}
+#endif
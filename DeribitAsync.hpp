@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "DeribitRequestTable.hpp"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#include <exception>
+#define DERIBIT_HAS_COROUTINES 1
+#endif
+
+// One JSON-RPC reply, as a ResponseCallback receives it
+struct DeribitResponse {
+    json message;                   // Contains "result" or "error"
+    int64_t latency_us = 0;         // Send -> reply
+    bool local = false;             // Completed by DeribitPending::fail(); never sent
+
+    bool ok() const { return message.contains("result"); }
+};
+
+/**
+ * @class DeribitPending
+ * @brief Completion of one asynchronous request
+ *
+ * A cheap, copyable handle to state shared with the request's
+ * ResponseCallback (see completer()), which the io thread runs when the
+ * reply is matched in the request table, or when the request times out or
+ * the connection drops. A request that never leaves the client (refused by
+ * the risk gate, rate limit queue full) completes at once with an error
+ * reply, so every DeribitPending completes exactly once.
+ *
+ * The caller may block on get() / waitFor(), attach a continuation with
+ * then(), or, when built as C++20, co_await it. Continuations and resumed
+ * coroutines run on the io thread that completed the request, like any
+ * other response handler, so they must not block.
+ */
+class DeribitPending {
+public:
+    DeribitPending();
+
+    // A ResponseCallback that completes this; later completions are ignored
+    ResponseCallback completer() const;
+    void complete(const json& response, int64_t latency_us) const;
+    // Completes with a JSON-RPC style error reply, for requests that were never sent
+    void fail(const std::string& message) const;
+
+    bool ready() const;
+    // false if the timeout passed first
+    bool waitFor(std::chrono::milliseconds timeout) const;
+    // Blocks until complete
+    const DeribitResponse& get() const;
+
+    // Runs callback on the completing thread, or at once if already complete. One per request.
+    void then(ResponseCallback callback) const;
+
+#ifdef DERIBIT_HAS_COROUTINES
+    bool await_ready() const { return ready(); }
+    // false resumes the caller at once: the reply arrived before it could suspend
+    bool await_suspend(std::coroutine_handle<> handle) const;
+    DeribitResponse await_resume() const { return get(); }
+#endif
+
+private:
+    void finish(const json& response, int64_t latency_us, bool local) const;
+
+    struct State {
+        std::mutex mutex;
+        std::condition_variable done_signal;
+        bool done = false;
+        DeribitResponse response;
+        ResponseCallback continuation;
+    };
+
+    std::shared_ptr<State> state;
+};
+
+#ifdef DERIBIT_HAS_COROUTINES
+/**
+ * @brief Return type of a fire-and-forget strategy coroutine
+ *
+ *     DeribitTask quote(DeribitAuth& client, OrderParams params) {
+ *         DeribitResponse ack = co_await client.buy(params);
+ *         if (ack.ok()) { ... }
+ *     }
+ *
+ * The coroutine starts at once on the calling thread and continues on the
+ * io thread after each co_await; its frame frees itself when it returns.
+ */
+struct DeribitTask {
+    struct promise_type {
+        DeribitTask get_return_object() { return DeribitTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        // An exception would otherwise escape onto the io thread
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+#endif
@@ -1,8 +1,95 @@
 #include "DeribitAuth.hpp"
-#include <iostream>
+#include "DeribitLogger.hpp"
 #include <thread>
 #include <chrono>
+#include <cstring>
+#include <algorithm>
 #include <functional>
+#include <limits>
+
+namespace {
+
+bool isOrderMethod(const char* method) {
+    return std::strcmp(method, "private/buy") == 0 || std::strcmp(method, "private/sell") == 0 ||
+           std::strcmp(method, "private/edit") == 0 || std::strcmp(method, "private/cancel") == 0;
+}
+
+// buy/sell/edit results are {"order": {...}, "trades": [...]}; cancel returns the order itself
+bool decodeOrderResult(std::string_view result, OrderEvent& order, std::vector<TradeEvent>& trades) {
+    trades.clear();
+    JsonCursor cursor(result);
+    if (!cursor.beginObject()) {
+        return false;
+    }
+    bool has_order = false;
+    std::string_view key;
+    std::string_view value;
+    while (cursor.nextKey(key)) {
+        if (key == "order" && cursor.readRaw(value)) {
+            has_order = DeribitMessageDecoder::decodeOrder(value, order);
+        } else if (key == "trades" && cursor.readRaw(value)) {
+            DeribitMessageDecoder::decodeTrades(value, trades);
+        } else {
+            cursor.skipValue();
+        }
+    }
+    return has_order || DeribitMessageDecoder::decodeOrder(result, order);
+}
+
+// error.code of an error response, or 0
+int32_t decodeErrorCode(std::string_view payload) {
+    JsonCursor cursor(payload);
+    std::string_view key;
+    if (!cursor.beginObject()) {
+        return 0;
+    }
+    while (cursor.nextKey(key)) {
+        if (key != "error") {
+            cursor.skipValue();
+            continue;
+        }
+        if (!cursor.beginObject()) {
+            return 0;
+        }
+        while (cursor.nextKey(key)) {
+            int64_t code = 0;
+            if (key == "code" && cursor.readInt(code)) {
+                return static_cast<int32_t>(code);
+            }
+            cursor.skipValue();
+        }
+        return 0;
+    }
+    return 0;
+}
+
+// Deribit's error code for a request over the rate limit
+const int32_t ERROR_TOO_MANY_REQUESTS = 10028;
+
+// Tokens are renewed this long before they expire, or halfway for short-lived ones
+const int64_t TOKEN_REFRESH_MARGIN_S = 60;
+
+long refreshDelayMs(int64_t expires_in_s) {
+    return static_cast<long>(std::max(expires_in_s - TOKEN_REFRESH_MARGIN_S, expires_in_s / 2) * 1000);
+}
+
+bool sameConnection(const websocketpp::connection_hdl& a, const websocketpp::connection_hdl& b) {
+    return !a.owner_before(b) && !b.owner_before(a);
+}
+
+// Requests the kill switch stops even after they passed the risk gate
+bool addsExposure(const char* method) {
+    return std::strcmp(method, "private/buy") == 0 || std::strcmp(method, "private/sell") == 0 ||
+           std::strcmp(method, "private/edit") == 0 || std::strcmp(method, "private/accept_block_rfq") == 0;
+}
+
+// The encoder's buffer is reused for every frame, so each sending thread gets its own.
+DeribitOrderEncoder& orderEncoder() {
+    static thread_local DeribitOrderEncoder encoder;
+    return encoder;
+}
+
+}  // namespace
 
 // Constructor: initialize client credentials and connection flags.
 DeribitAuth::DeribitAuth(const std::string& client_id, const std::string& client_secret)
@@ -10,14 +97,63 @@ DeribitAuth::DeribitAuth(const std::string& client_id, const std::string& client
 client_secret(client_secret), 
 connected(false), 
 authenticated(false),
-subscription_handler(ws_client, connection_hdl, authenticated) {
-std::cout << "DeribitAuth object created with client_id: " << client_id << std::endl;
+io_cpu(-1),
+heartbeat(ws_client, "Order connection"),
+dispatch_due_ns(0),
+order_tracking(false),
+position_tracking(false),
+risk_gate(instrument_registry),
+subscription_handler(ws_client, connection_hdl, authenticated, pending_requests, latency_stats),
+reconnect_backoff(reconnect_policy),
+standby_backoff(reconnect_policy),
+session_established(false),
+stopping(false),
+sweep_running(false),
+auth_generation(0),
+standby_active(false),
+standby_open(false),
+standby_authenticated(false),
+standby_generation(0) {
+subscription_handler.setEventBus(&event_bus, ORDER_CONNECTION_SOURCE);
+subscription_handler.setConnectionMutex(&session_mutex);
+subscription_handler.setPositionBook(&position_book);
+subscription_handler.setRiskGate(&risk_gate);
+subscription_handler.setTradeAggregator(&trade_aggregator);
+subscription_handler.setOptionBook(&option_book);
+subscription_handler.setBlockRfqBook(&block_rfq_book);
+subscription_handler.setClock(&heartbeat.clock());
+subscription_handler.setRequestSender([this](const char* method, const json& params, ResponseCallback callback) {
+    return sendRequest(method, params, std::move(callback), "subscription") != 0;
+});
+LOG_INFO("DeribitAuth object created with client_id: ", client_id);
+}
+
+// Stops reconnecting and joins the io thread, so no callback outlives the object.
+DeribitAuth::~DeribitAuth() {
+    stopping = true;
+    if (market_data_pool) {
+        market_data_pool->close();
+    }
+    if (io_thread.joinable()) {
+        ws_client.stop();
+        io_thread.join();
+    }
+}
+
+void DeribitAuth::setReconnectPolicy(const ReconnectPolicy& policy) {
+    reconnect_policy = policy;
+    reconnect_backoff = DeribitBackoff(policy);
+    standby_backoff = DeribitBackoff(policy);
 }
 
-// TLS initialization callback
+// TLS initialization callback; one context serves every connection so a
+// reconnect can resume the previous session.
 websocketpp::lib::shared_ptr<websocketpp::lib::asio::ssl::context>
 DeribitAuth::on_tls_init() {
-    std::cout << "Initializing TLS..." << std::endl;
+    if (tls_context) {
+        return tls_context;
+    }
+    LOG_INFO("Initializing TLS...");
     auto ctx = websocketpp::lib::make_shared<websocketpp::lib::asio::ssl::context>(
         websocketpp::lib::asio::ssl::context::sslv23);
     try {
@@ -26,15 +162,46 @@ DeribitAuth::on_tls_init() {
                          websocketpp::lib::asio::ssl::context::no_sslv3 |
                          websocketpp::lib::asio::ssl::context::single_dh_use);
     } catch (std::exception& e) {
-        std::cerr << "Error in TLS initialization: " << e.what() << std::endl;
+        LOG_ERROR("Error in TLS initialization: ", e.what());
     }
+    tls_context = ctx;
     return ctx;
 }
 
-// Connect to Deribit's test WebSocket endpoint.
-bool DeribitAuth::connect() {
-    std::cout << "Connecting to Deribit WebSocket..." << std::endl;
-    std::string uri = "wss://test.deribit.com/ws/api/v2";
+// Runs before each TLS handshake: offer the last session for resumption.
+void DeribitAuth::on_socket_init(websocketpp::connection_hdl, ssl_socket& socket) {
+    tls_sessions.apply(socket.native_handle());
+}
+
+// Connect to a Deribit WebSocket endpoint (the test network by default).
+// Returns as soon as the socket opens rather than on a polling interval.
+bool DeribitAuth::connect(const std::string& uri) {
+    DeribitPending opened = connectAsync(uri);
+    if (!opened.waitFor(std::chrono::milliseconds(CONNECT_TIMEOUT_MS))) {
+        LOG_ERROR("Failed to connect within timeout period.");
+        return false;
+    }
+    if (!opened.get().ok()) {
+        return false;
+    }
+    LOG_INFO("Connection established successfully in ", opened.get().latency_us, " microseconds.");
+
+    if (market_data_pool) {
+        return market_data_pool->connect(uri);
+    }
+    return true;
+}
+
+DeribitPending DeribitAuth::connectAsync(const std::string& uri) {
+    if (io_thread.joinable()) {
+        LOG_ERROR("Already connected; create a new DeribitAuth to connect again.");
+        DeribitPending refused;
+        refused.fail("already connected");
+        return refused;
+    }
+    LOG_INFO("Connecting to Deribit WebSocket at ", uri, "...");
+    endpoint_uri = uri;
+    connect_started = std::chrono::steady_clock::now();
 
     // Disable logging for clarity (enable if you need to debug)
     ws_client.clear_access_channels(websocketpp::log::alevel::all);
@@ -43,408 +210,1410 @@ bool DeribitAuth::connect() {
     // Initialize ASIO and set handlers.
     ws_client.init_asio();
     ws_client.set_tls_init_handler(std::bind(&DeribitAuth::on_tls_init, this));
+    ws_client.set_socket_init_handler(std::bind(&DeribitAuth::on_socket_init, this, _1, _2));
     ws_client.set_open_handler(std::bind(&DeribitAuth::on_open, this, _1));
     ws_client.set_message_handler(std::bind(&DeribitAuth::on_message, this, _1, _2));
     ws_client.set_close_handler(std::bind(&DeribitAuth::on_close, this, _1));
     ws_client.set_fail_handler(std::bind(&DeribitAuth::on_error, this, _1));
 
-    // Create connection.
+    if (!openConnection(false)) {
+        connect_pending.fail("connection creation failed");
+        return connect_pending;
+    }
+
+    // Run the ASIO event loop in a background thread.
+    io_thread = std::thread([this]() {
+        if (io_cpu >= 0 && !DeribitMarketDataPool::pinCurrentThread(io_cpu)) {
+            LOG_WARN("Unable to pin io thread to CPU ", io_cpu);
+        }
+        ws_client.run();
+    });
+    return connect_pending;
+}
+
+// Starts a connection to endpoint_uri, as the main connection or the standby.
+bool DeribitAuth::openConnection(bool standby) {
     websocketpp::lib::error_code ec;
-    auto con = ws_client.get_connection(uri, ec);
+    auto con = ws_client.get_connection(endpoint_uri, ec);
     if (ec) {
-        std::cerr << "Connection creation failed: " << ec.message() << std::endl;
+        LOG_ERROR("Connection creation failed: ", ec.message());
         return false;
     }
-    connection_hdl = con->get_handle();
+    {
+        std::lock_guard<std::mutex> lock(session_mutex);
+        (standby ? standby_hdl : connection_hdl) = con->get_handle();
+    }
+    if (standby) {
+        standby_active = true;
+    }
     ws_client.connect(con);
+    return true;
+}
 
-    // Run the ASIO event loop in a background thread.
-    std::thread([this]() { ws_client.run(); }).detach();
+websocketpp::connection_hdl DeribitAuth::currentConnection() const {
+    std::lock_guard<std::mutex> lock(session_mutex);
+    return connection_hdl;
+}
 
-    // Wait until the connection is established (with a timeout).
-    int timeout = 10;
-    while (!connected && timeout--) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-    }
-    if (!connected) {
-        std::cerr << "Failed to connect within timeout period." << std::endl;
-    } else {
-        std::cout << "Connection established successfully." << std::endl;
-    }
-    return connected;
+bool DeribitAuth::isStandby(websocketpp::connection_hdl hdl) const {
+    std::lock_guard<std::mutex> lock(session_mutex);
+    return standby_active && sameConnection(hdl, standby_hdl);
 }
 
 // Handler for when the connection is opened.
 void DeribitAuth::on_open(websocketpp::connection_hdl hdl) {
-    connected = true;
-    std::cout << "Connected to Deribit WebSocket." << std::endl;
-}
-
+    websocketpp::lib::error_code ec;
+    auto con = ws_client.get_con_from_hdl(hdl, ec);
+    SSL* ssl = !ec && con ? con->get_socket().native_handle() : nullptr;
+    tls_sessions.save(ssl);
+    const char* handshake = DeribitTlsSessionCache::resumed(ssl) ? " (TLS session resumed)." : ".";
 
+    if (isStandby(hdl)) {
+        standby_open = true;
+        standby_backoff.reset();
+        LOG_INFO("Standby connection open", handshake);
+        if (session_established) {
+            authenticateStandby();
+        }
+        return;
+    }
 
-// Message handler: parse authentication response.
+    connected = true;
+    LOG_INFO("Connected to Deribit WebSocket", handshake);
+    connect_pending.complete({{"jsonrpc", "2.0"}, {"result", "connected"}},
+                             std::chrono::duration_cast<std::chrono::microseconds>(
+                                 std::chrono::steady_clock::now() - connect_started).count());
+    publishConnectionState();
+    startHeartbeat();
+    if (!sweep_running) {
+        sweep_running = true;
+        scheduleRequestSweep();
+    }
+    if (recovery.active()) {
+        recovery.markConnected();
+        reconnect_backoff.reset();
+        resumeSession();
+    }
+    if (reconnect_policy.warm_standby && !standby_active && !stopping) {
+        openConnection(true);
+    }
+}
+// Message handler: route subscription notifications and match responses to requests.
+// Only the top level of the message is scanned here; subscription data is decoded
+// by the subscription handler and responses are parsed only if someone consumes them.
 void DeribitAuth::on_message(websocketpp::connection_hdl hdl, client::message_ptr msg) {
+    auto received_at = std::chrono::steady_clock::now();
+    int64_t received_wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
     try {
-        auto j = json::parse(msg->get_payload());
-        // Check if the response contains the "result" field.
-        if (j.contains("result")) {
-            auto result = j["result"];
-            if (result.contains("access_token")) {
-                access_token = result["access_token"];
-                refresh_token = result["refresh_token"];
-                authenticated = true;
-                std::cout << "Authenticated successfully." << std::endl;
-                std::cout << "Access Token: " << access_token << std::endl;
-                
-            }
-            else if (result.contains("order") && j["id"] == 5275) {
-                auto order = result["order"];
-                auto order_end_time = std::chrono::high_resolution_clock::now();
-                auto order_latency = std::chrono::duration_cast<std::chrono::microseconds>(
-                    order_end_time - order_start_time).count();
-                auto loop_latency = std::chrono::duration_cast<std::chrono::microseconds>(
-                    order_end_time - trading_loop_start).count();
-                std::cout << "Order Placement Latency: " << order_latency << " microseconds" << std::endl;
-                std::cout << "Order placed successfully:" << std::endl;
-                std::cout << "Order ID: " << order["order_id"] << std::endl;
-                std::cout << "Amount: " << order["amount"] << std::endl;
-                std::cout << "Average Price: " << order["average_price"] << std::endl;
-                std::cout << "State: " << order["order_state"] << std::endl;
-            }
-            else if (result.contains("order_id")) {
-                std::cout << "Order cancelled successfully:" << std::endl;
-                std::cout << "Order ID: " << result["order_id"] << std::endl;
-                std::cout << "State: " << result["order_state"] << std::endl;
-            }
-            else if (result.contains("order")) {
-                auto order = result["order"];
-                std::cout << "Order updated successfully:" << std::endl;
-                std::cout << "Order ID: " << order["order_id"] << std::endl;
-                std::cout << "Amount: " << order["amount"] << std::endl;
-                std::cout << "Price: " << order["price"] << std::endl;
-                if (order.contains("advanced")) {
-                    std::cout << "Advanced: " << order["advanced"] << std::endl;
-                }
-                std::cout << "State: " << order["order_state"] << std::endl;
-            }
-            else if (j["id"] == 1953) {  // Get open orders response
-                auto result = j["result"];
-                if (result.empty()) {
-                    std::cout << "No open orders found." << std::endl;
-                    return;
-                }
-                
-                std::cout << "\n=== Open Orders ===" << std::endl;
-                for (const auto& order : result) {
-                    std::cout << "Order ID: " << order["order_id"] << std::endl;
-                    std::cout << "Instrument: " << order["instrument_name"] << std::endl;
-                    std::cout << "Type: " << order["order_type"] << std::endl;
-                    std::cout << "Direction: " << order["direction"] << std::endl;
-                    std::cout << "Amount: " << order["amount"] << std::endl;
-                    std::cout << "Filled Amount: " << order["filled_amount"] << std::endl;
-                    std::cout << "Price: " << order["price"] << std::endl;
-                    std::cout << "State: " << order["order_state"] << std::endl;
-                    std::cout << "Time in Force: " << order["time_in_force"] << std::endl;
-                    std::cout << "Created: " << order["creation_timestamp"] << std::endl;
-                    std::cout << "Last Update: " << order["last_update_timestamp"] << std::endl;
-                    
-                    if (order.contains("label") && !order["label"].empty()) {
-                        std::cout << "Label: " << order["label"] << std::endl;
-                    }
-                    
-                    std::cout << "Reduce Only: " << (order["reduce_only"].get<bool>() ? "Yes" : "No") << std::endl;
-                    std::cout << "Post Only: " << (order["post_only"].get<bool>() ? "Yes" : "No") << std::endl;
-                    
-                    if (order.contains("trigger_price")) {
-                        std::cout << "Trigger Price: " << order["trigger_price"] << std::endl;
-                    }
-                    
-                    std::cout << "---------------------" << std::endl;
-                }
-                std::cout << "===================" << std::endl;
-            }
-            else if (result.contains("instrument_name") && result.contains("bids") && result.contains("asks")) {
-                std::cout << "Order book for " << result["instrument_name"].get<std::string>() << ":" << std::endl;
-                std::cout << "Mark Price: " << result["mark_price"].get<double>() << std::endl;
-                std::cout << "Last Price: " << result["last_price"].get<double>() << std::endl;
-                
-                std::cout << "\nBids:" << std::endl;
-                for (const auto& bid : result["bids"]) {
-                    std::cout << "Price: " << bid[0].get<double>() 
-                              << ", Amount: " << bid[1].get<double>() << std::endl;
-                }
-                
-                std::cout << "\nAsks:" << std::endl;
-                for (const auto& ask : result["asks"]) {
-                    std::cout << "Price: " << ask[0].get<double>() 
-                              << ", Amount: " << ask[1].get<double>() << std::endl;
-                }
+        const std::string& payload = msg->get_payload();
+
+        // Standby frames (its auth reply) are not the main feed: the journal and the
+        // main connection's stall and clock tracking must not see them
+        bool from_standby = reconnect_policy.warm_standby && isStandby(hdl);
+        if (!from_standby) {
+            if (journal) {
+                journal->append(JournalRecordType::Frame, received_wall_ns, payload);
             }
-           // Handle position response
-         else if (result.contains("instrument_name") && result.contains("size")) {
-               std::cout << "\nPosition Details for " << result["instrument_name"].get<std::string>() << ":" << std::endl;
-               std::cout << "Size: " << result["size"].get<double>() << std::endl;
-               std::cout << "Direction: " << result["direction"].get<std::string>() << std::endl;
-               std::cout << "Average Price: " << result["average_price"].get<double>() << std::endl;
-               std::cout << "Floating P/L: " << result["floating_profit_loss"].get<double>() << std::endl;
-               std::cout << "Realized P/L: " << result["realized_profit_loss"].get<double>() << std::endl;
-               std::cout << "Total P/L: " << result["total_profit_loss"].get<double>() << std::endl;
-               std::cout << "Leverage: " << result["leverage"].get<int>() << std::endl;
-               
-               if (result["estimated_liquidation_price"].get<double>() > 0) {
-                   std::cout << "Est. Liquidation Price: " << result["estimated_liquidation_price"].get<double>() << std::endl;
-               }
-           }
-             // Handle subscription messages
+            heartbeat.onFrame(received_at, received_wall_ns / 1000);
+        }
+
+        MessageEnvelope envelope;
+        if (!DeribitMessageDecoder::decodeEnvelope(payload, envelope)) {
+            LOG_ERROR("Error decoding message: ", payload);
+            return;
+        }
+
         // Route subscription messages to subscription handler
-       else if ((j.contains("method") && j["method"] == "subscription") ||
-            (j.contains("result") && j["id"] == 42)) {  // ID 42 is used for subscriptions
-            subscription_handler.handleSubscriptionMessage(j);
+        if (envelope.method == "subscription") {
+            subscription_handler.handleSubscriptionPayload(payload, envelope, received_at,
+                                                           received_wall_ns / 1000);
+            return;
+        }
+        if (envelope.method == "heartbeat") {
+            heartbeat.onHeartbeat(payload);
+            return;
+        }
+
+        if (!envelope.has_id) {
             return;
         }
-        } else if (j.contains("error")) {
-            std::cerr << "Authentication error: " << j["error"].dump() << std::endl;
+
+        PendingRequest request;
+        if (!pending_requests.complete(envelope.id, request)) {
+            LOG_ERROR("Received response for unknown or expired request ID ", envelope.id);
+            return;
+        }
+
+        auto latency = received_at - request.sent_at;
+        auto latency_us = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+        latency_stats.record(LatencyKind::RequestAck, request.method,
+                             std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+
+        if (isOrderMethod(request.method)) {
+            handleOrderResponse(request, &envelope, payload,
+                                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    received_at.time_since_epoch()).count());
+        }
+
+        if (!request.callback && !envelope.has_error) {
+            return;
+        }
+
+        auto j = json::parse(payload);
+        if (envelope.has_error && decodeErrorCode(payload) == ERROR_TOO_MANY_REQUESTS) {
+            // The local credit model ran ahead of the exchange's; start it again from empty
+            request_scheduler.onThrottled(DeribitRequestScheduler::classify(request.method));
+            LOG_WARN("Request ", envelope.id, " (", request.method, ") throttled by the exchange: ",
+                     j["error"].dump());
+        } else if (envelope.has_error) {
+            LOG_ERROR("Request ", envelope.id, " (", request.method, ") failed: ",
+                      j["error"].dump());
+        }
+
+        if (request.callback) {
+            request.callback(j, latency_us);
         }
     } catch (std::exception& e) {
-        std::cerr << "Error parsing JSON message: " << e.what() << std::endl;
+        LOG_ERROR("Error parsing JSON message: ", e.what());
     }
 }
 
 // Handler for connection close events.
 void DeribitAuth::on_close(websocketpp::connection_hdl hdl) {
+    if (isStandby(hdl)) {
+        LOG_WARN("Standby connection closed.");
+        standbyLost();
+        return;
+    }
+    if (!sameConnection(hdl, currentConnection())) {
+        return;
+    }
     connected = false;
-    std::cout << "Connection closed." << std::endl;
+    authenticated = false;
+    heartbeat.stop();
+    LOG_INFO("Connection closed.");
+    publishConnectionState();
+
+    // Nothing in flight can be answered any more
+    std::vector<PendingRequest> orphaned;
+    pending_requests.drain(orphaned);
+    failRequests(orphaned, "connection closed");
+    std::vector<QueuedRequest> unsent;
+    request_scheduler.drain(unsent);
+    failQueued(unsent, "connection closed");
+
+    subscription_handler.onDisconnected();
+    if (stopping || !reconnect_policy.enabled) {
+        return;
+    }
+    recovery.begin(session_established);
+    if (standby_open) {
+        promoteStandby();
+    } else {
+        scheduleReconnect();
+    }
 }
 
 // Handler for connection failures.
 void DeribitAuth::on_error(websocketpp::connection_hdl hdl) {
-    std::cerr << "Connection error encountered." << std::endl;
+    if (isStandby(hdl)) {
+        LOG_WARN("Standby connection failed.");
+        standbyLost();
+        return;
+    }
+    LOG_ERROR("Connection error encountered.");
+    if (!connected) {
+        connect_pending.fail("connection failed");
+    }
+    if (recovery.active() && !stopping) {
+        scheduleReconnect();
+    }
 }
 
-// Send an authentication request using client_credentials.
-bool DeribitAuth::authenticate() {
-    if (!connected) {
-        std::cerr << "Not connected to Deribit server." << std::endl;
-        return false;
+void DeribitAuth::scheduleReconnect() {
+    if (reconnect_backoff.exhausted()) {
+        LOG_ERROR("Giving up after ", reconnect_backoff.attempts(), " reconnect attempts.");
+        recovery.finish();
+        return;
+    }
+    int delay_ms = reconnect_backoff.nextDelayMs();
+    LOG_WARN("Reconnecting in ", delay_ms, " ms (attempt ", reconnect_backoff.attempts(), ")...");
+    ws_client.set_timer(delay_ms, [this](const websocketpp::lib::error_code& ec) {
+        if (ec || stopping) {
+            return;
+        }
+        if (!openConnection(false)) {
+            scheduleReconnect();
+        }
+    });
+}
+
+// Restores a reopened connection: public channels at once, then the session
+// and, once it is authenticated, private channels (see handleAuthResponse).
+void DeribitAuth::resumeSession() {
+    resubscribe(false);
+    if (session_established && !refreshToken()) {
+        LOG_ERROR("Unable to re-authenticate after reconnecting.");
+    }
+}
+
+void DeribitAuth::resubscribe(bool private_channels) {
+    auto done = [this, private_channels]() {
+        if (!connected) {
+            return;         // Dropped again; the next recovery resubscribes
+        }
+        recovery.markResubscribed(private_channels);
+        checkRecovered();
+    };
+    if (subscription_handler.resubscribe(private_channels, done) == 0) {
+        done();
+    }
+}
+
+void DeribitAuth::checkRecovered() {
+    if (!recovery.isComplete()) {
+        return;
+    }
+    std::string phases = recovery.summary();
+    int64_t elapsed_ns = recovery.finish();
+    latency_stats.record(LatencyKind::Recovery, "order connection", elapsed_ns);
+    LOG_INFO("Connection recovered in ", elapsed_ns / 1000000, " ms (", phases, ").");
+}
+
+// The standby becomes the main connection; a new standby is opened behind it.
+void DeribitAuth::promoteStandby() {
+    {
+        std::lock_guard<std::mutex> lock(session_mutex);
+        connection_hdl = standby_hdl;
+        standby_hdl.reset();
+    }
+    bool standby_was_authenticated = standby_authenticated;
+    json auth_response = std::move(standby_auth);
+    standby_active = standby_open = standby_authenticated = false;
+    ++standby_generation;
+    LOG_WARN("Switching to the standby connection.");
+
+    connected = true;
+    publishConnectionState();
+    startHeartbeat();
+    recovery.markConnected();
+    resubscribe(false);
+    if (standby_was_authenticated) {
+        // Count the token's lifetime from when the standby obtained it
+        auto age_s = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now() - standby_authenticated_at).count();
+        json& result = auth_response["result"];
+        result["expires_in"] = std::max<int64_t>(0, result.value("expires_in", int64_t(0)) - age_s);
+        handleAuthResponse(auth_response);
+    } else if (session_established && !refreshToken()) {
+        LOG_ERROR("Unable to authenticate the standby connection.");
+    }
+    if (reconnect_policy.warm_standby && !stopping) {
+        openConnection(true);
+    }
+}
+
+// Keepalive for the main connection, which just opened or took over from the standby.
+void DeribitAuth::startHeartbeat() {
+    heartbeat.start(currentConnection(),
+        [this](const char* method, const json& params, ResponseCallback callback) {
+            return sendRequest(method, params, std::move(callback), nullptr) != 0;
+        },
+        [this](int64_t rtt_us) {
+            latency_stats.record(LatencyKind::NetworkRtt, "order connection", rtt_us * 1000);
+        });
+}
+
+// Authenticates the standby with the client credentials (a refresh would
+// rotate the main session's refresh token), and again before that token expires.
+void DeribitAuth::authenticateStandby() {
+    websocketpp::connection_hdl target;
+    {
+        std::lock_guard<std::mutex> lock(session_mutex);
+        target = standby_hdl;
     }
+    uint64_t generation = standby_generation;
+    sendCredentials(&target, [this, generation](const json& response, int64_t) {
+        if (generation != standby_generation || !standby_open) {
+            return;
+        }
+        if (!response.contains("result")) {
+            LOG_WARN("Standby authentication failed: ", response.dump());
+            return;
+        }
+        standby_auth = response;
+        standby_authenticated = true;
+        standby_authenticated_at = std::chrono::steady_clock::now();
+        LOG_INFO("Standby connection authenticated.");
+
+        int64_t expires_in_s = response["result"].value("expires_in", int64_t(0));
+        if (expires_in_s > 0) {
+            ws_client.set_timer(refreshDelayMs(expires_in_s), [this, generation](const websocketpp::lib::error_code& ec) {
+                if (!ec && !stopping && generation == standby_generation && standby_open) {
+                    authenticateStandby();
+                }
+            });
+        }
+    });
+}
+
+void DeribitAuth::standbyLost() {
+    {
+        std::lock_guard<std::mutex> lock(session_mutex);
+        standby_hdl.reset();
+    }
+    standby_active = standby_open = standby_authenticated = false;
+    ++standby_generation;
+    if (stopping || !reconnect_policy.warm_standby || !connected) {
+        return;
+    }
+
+    // A main connection that reconnects opens its own standby
+    int delay_ms = standby_backoff.nextDelayMs();
+    ws_client.set_timer(delay_ms, [this](const websocketpp::lib::error_code& ec) {
+        if (!ec && !stopping && connected && !standby_active) {
+            openConnection(true);
+        }
+    });
+}
+
+// Sends a JSON-RPC request with a fresh id and tracks it until answered or timed out.
+uint64_t DeribitAuth::sendRequest(const char* method, const json& params,
+                                  ResponseCallback callback, const char* description,
+                                  const websocketpp::connection_hdl* target) {
+    // A query identical to one still waiting for credits rides along with it
+    std::string coalesce_key;
+    if (target == nullptr && DeribitRequestScheduler::classify(method) == RequestPriority::Query) {
+        coalesce_key = std::string(method) + params.dump();
+        uint64_t waiting_id = request_scheduler.coalesce(coalesce_key, callback);
+        if (waiting_id != 0) {
+            return waiting_id;
+        }
+    }
+
+    uint64_t id = pending_requests.nextId();
 
-    // Create JSON-RPC authentication message.
     json j;
     j["jsonrpc"] = "2.0";
-    j["id"] = 1; // Request identifier.
-    j["method"] = "public/auth";
-    j["params"] = {
-        {"grant_type", "client_credentials"},
-        {"client_id", client_id},
-        {"client_secret", client_secret}
-    };
+    j["id"] = id;
+    j["method"] = method;
+    j["params"] = params;
 
     std::string payload = j.dump();
+    return sendPayload(id, method, payload, std::move(callback), description, target, std::move(coalesce_key));
+}
+
+uint64_t DeribitAuth::sendPayload(uint64_t id, const char* method, std::string_view payload,
+                                  ResponseCallback callback, const char* description,
+                                  const websocketpp::connection_hdl* target, std::string coalesce_key) {
+    if (payload.empty()) {
+        LOG_ERROR("Unable to encode ", method, " request.");
+        return 0;
+    }
+
+    // Requests on a standby connection are rare (one auth) and are not paced
+    RequestPriority priority = DeribitRequestScheduler::classify(method);
+    if (target != nullptr || !connected || request_scheduler.admit(priority)) {
+        return transmit(id, method, payload, std::move(callback), description, target);
+    }
+
+    QueuedRequest request;
+    request.id = id;
+    request.method = method;
+    request.description = description;
+    request.priority = priority;
+    request.payload.assign(payload.data(), payload.size());
+    request.coalesce_key = std::move(coalesce_key);
+    request.callback = std::move(callback);
+    request.queued_at = std::chrono::steady_clock::now();
+    if (!request_scheduler.enqueue(std::move(request))) {
+        LOG_ERROR("Rate limit queue is full; dropping ", method, " request.");
+        return 0;
+    }
+    LOG_INFO("Rate limit: ", (description ? description : method), " request ", id, " queued (",
+             DeribitRequestScheduler::priorityName(priority), ").");
+    scheduleDispatch(request_scheduler.nextReadyMs());
+    return id;
+}
+
+uint64_t DeribitAuth::transmit(uint64_t id, const char* method, std::string_view payload,
+                               ResponseCallback callback, const char* description,
+                               const websocketpp::connection_hdl* target) {
+    if (description != nullptr) {
+        LOG_INFO("Sending ", description, " request: ", payload);
+    }
+
+    // Register before sending so a fast response cannot race the insert
+    if (!pending_requests.insert(id, method, std::move(callback),
+                                 std::chrono::milliseconds(REQUEST_TIMEOUT_MS))) {
+        LOG_ERROR("Too many requests in flight; dropping ", method, " request.");
+        return 0;
+    }
+
     websocketpp::lib::error_code ec;
-    ws_client.send(connection_hdl, payload, websocketpp::frame::opcode::text, ec);
+    ws_client.send(target != nullptr ? *target : currentConnection(), payload.data(), payload.size(),
+                   websocketpp::frame::opcode::text, ec);
+
     if (ec) {
-        std::cerr << "Error sending authentication request: " << ec.message() << std::endl;
+        LOG_ERROR("Error sending ", (description ? description : method), " request: ",
+                  ec.message());
+        PendingRequest unused;
+        pending_requests.complete(id, unused);
+        return 0;
+    }
+
+    return id;
+}
+
+// Arms a timer for the next queued request. A later, earlier deadline arms its
+// own timer; a timer that fires early finds nothing ready and re-arms.
+void DeribitAuth::scheduleDispatch(int64_t delay_ms) {
+    if (delay_ms < 0) {
+        return;
+    }
+    int64_t due = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count() + delay_ms * 1000000;
+    int64_t current = dispatch_due_ns.load(std::memory_order_acquire);
+    do {
+        if (current != 0 && current <= due) {
+            return;
+        }
+    } while (!dispatch_due_ns.compare_exchange_weak(current, due, std::memory_order_acq_rel));
+
+    ws_client.set_timer(static_cast<long>(delay_ms), [this, due](const websocketpp::lib::error_code& ec) {
+        int64_t expected = due;
+        dispatch_due_ns.compare_exchange_strong(expected, 0, std::memory_order_acq_rel);
+        if (ec || stopping) {
+            return;
+        }
+        dispatchQueued();
+    });
+}
+
+// Sends every queued request the credits allow, highest priority first; runs on the io thread.
+void DeribitAuth::dispatchQueued() {
+    QueuedRequest request;
+    while (connected && request_scheduler.next(request)) {
+        // Queued before the kill switch and dispatched while it was being engaged
+        if (addsExposure(request.method) && risk_gate.killSwitchEngaged()) {
+            std::vector<QueuedRequest> refused(1);
+            refused[0] = std::move(request);
+            failQueued(refused, "kill switch");
+            continue;
+        }
+        auto now = std::chrono::steady_clock::now();
+        latency_stats.record(LatencyKind::QueueDelay, request.method,
+                             std::chrono::duration_cast<std::chrono::nanoseconds>(now - request.queued_at).count());
+        ResponseCallback callback = request.callback;
+        if (transmit(request.id, request.method, request.payload, std::move(request.callback),
+                     request.description, nullptr) == 0 && callback) {
+            callback(DeribitRequestTable::makeErrorResponse(request.id, "send failed"), 0);
+        }
+    }
+    if (connected) {
+        scheduleDispatch(request_scheduler.nextReadyMs());
+    }
+}
+
+// Completes queued requests that will never be sent, like failRequests().
+void DeribitAuth::failQueued(std::vector<QueuedRequest>& requests, const std::string& reason) {
+    std::vector<PendingRequest> failed;
+    failed.reserve(requests.size());
+    for (auto& request : requests) {
+        PendingRequest pending;
+        pending.id = request.id;
+        pending.method = request.method;
+        pending.sent_at = request.queued_at;
+        pending.callback = std::move(request.callback);
+        failed.push_back(std::move(pending));
+    }
+    failRequests(failed, reason);
+}
+
+// Periodically time out requests that never received a response.
+void DeribitAuth::scheduleRequestSweep() {
+    ws_client.set_timer(REQUEST_SWEEP_INTERVAL_MS, [this](const websocketpp::lib::error_code& ec) {
+        if (ec || !connected) {
+            sweep_running = false;
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        std::vector<PendingRequest> expired;
+        if (pending_requests.expire(now, expired) > 0) {
+            failRequests(expired, "request timed out");
+        }
+        std::vector<QueuedRequest> stale;
+        if (request_scheduler.expire(now - std::chrono::milliseconds(REQUEST_TIMEOUT_MS), stale) > 0) {
+            failQueued(stale, "timed out waiting for rate limit credits");
+        }
+        block_rfq_book.expire(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        scheduleRequestSweep();
+    });
+}
+
+// Completes requests that will never be answered with a synthesized error reply.
+void DeribitAuth::failRequests(std::vector<PendingRequest>& requests, const std::string& reason) {
+    auto now = std::chrono::steady_clock::now();
+    for (auto& request : requests) {
+        auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            now - request.sent_at).count();
+        LOG_ERROR("Request ", request.id, " (", request.method, ") ", reason, " after ",
+                  elapsed_us / 1000, " ms");
+
+        if (event_bus.wants(EventType::OrderAck) && isOrderMethod(request.method)) {
+            publishOrderEvents(request, nullptr, false, std::string_view(), EventRecord::now());
+        }
+        if (request.callback) {
+            request.callback(DeribitRequestTable::makeErrorResponse(request.id, reason), elapsed_us);
+        }
+    }
+}
+
+void DeribitAuth::publishConnectionState() {
+    if (!event_bus.wants(EventType::ConnectionState)) {
+        return;
+    }
+    EventRecord event;
+    event.type = EventType::ConnectionState;
+    event.source = ORDER_CONNECTION_SOURCE;
+    event.received_ns = EventRecord::now();
+    event.instrument.assign(std::string_view());
+    event.connection.connected = connected.load(std::memory_order_acquire);
+    event.connection.authenticated = authenticated.load(std::memory_order_acquire);
+    event_bus.publish(event);
+}
+
+// Decodes the response to an order request once, for both the order cache and the event bus.
+void DeribitAuth::handleOrderResponse(const PendingRequest& request, const MessageEnvelope* envelope,
+                                      std::string_view payload, int64_t received_ns) {
+    bool tracking = order_tracking.load(std::memory_order_acquire);
+    bool publishing = event_bus.wants(EventType::OrderAck) || event_bus.wants(EventType::Fill);
+    if (!tracking && !publishing) {
+        return;
+    }
+
+    ack_fills.clear();
+    bool decoded = !envelope->has_error && decodeOrderResult(envelope->result, ack_order, ack_fills);
+    if (decoded) {
+        for (auto& trade : ack_fills) {
+            if (trade.order_id.empty()) {
+                trade.order_id = ack_order.order_id;
+            }
+        }
+    }
+    if (decoded && tracking) {
+        order_manager.applyOrder(ack_order);
+        risk_gate.onOrder(ack_order);
+        for (const auto& trade : ack_fills) {
+            applyFill(trade);
+        }
+    }
+    if (publishing) {
+        publishOrderEvents(request, envelope, decoded, payload, received_ns);
+    }
+}
+
+// Publishes the ack of an order request, and a fill for each trade it reports,
+// from ack_order and ack_fills when decoded. A null envelope means the request
+// got no response (timeout or disconnect); its ack has state Unknown.
+void DeribitAuth::publishOrderEvents(const PendingRequest& request, const MessageEnvelope* envelope, bool decoded,
+                                     std::string_view payload, int64_t received_ns) {
+    EventRecord event;
+    event.type = EventType::OrderAck;
+    event.source = ORDER_CONNECTION_SOURCE;
+    event.received_ns = received_ns;
+    event.instrument.assign(std::string_view());
+
+    OrderAckRecord& ack = event.ack;
+    ack.order_id.assign(std::string_view());
+    ack.label.assign(std::string_view());
+    ack.request_id = request.id;
+    ack.price = std::numeric_limits<double>::quiet_NaN();
+    ack.amount = ack.filled_amount = ack.average_price = 0.0;
+    ack.latency_ns = received_ns - std::chrono::duration_cast<std::chrono::nanoseconds>(
+        request.sent_at.time_since_epoch()).count();
+    ack.error_code = 0;
+    ack.state = OrderState::Unknown;
+    ack.direction = std::strcmp(request.method, "private/sell") == 0 ? OrderSide::Sell : OrderSide::Buy;
+
+    if (envelope != nullptr && envelope->has_error) {
+        ack.state = OrderState::Rejected;
+        ack.error_code = decodeErrorCode(payload);
+    } else if (decoded) {
+        event.instrument.assign(ack_order.instrument_name);
+        ack.order_id.assign(ack_order.order_id);
+        ack.label.assign(ack_order.label);
+        ack.price = ack_order.price;
+        ack.amount = ack_order.amount;
+        ack.filled_amount = ack_order.filled_amount;
+        ack.average_price = ack_order.average_price;
+        ack.state = DeribitMessageDecoder::parseOrderState(ack_order.order_state);
+        ack.direction = ack_order.direction;
+    }
+    if (event_bus.wants(EventType::OrderAck)) {
+        event_bus.publish(event);
+    }
+
+    if (!decoded || !event_bus.wants(EventType::Fill)) {
+        return;
+    }
+    for (const auto& trade : ack_fills) {
+        EventRecord fill;
+        fill.type = EventType::Fill;
+        fill.source = ORDER_CONNECTION_SOURCE;
+        fill.received_ns = received_ns;
+        fill.instrument.assign(trade.instrument_name);
+        fill.fill.order_id.assign(trade.order_id);
+        fill.fill.price = trade.price;
+        fill.fill.amount = trade.amount;
+        fill.fill.exchange_timestamp = trade.timestamp;
+        fill.fill.direction = trade.direction;
+        event_bus.publish(fill);
+    }
+}
+
+bool DeribitAuth::startRecording(const std::string& path_prefix, size_t segment_bytes) {
+    std::unique_ptr<DeribitJournalWriter> writer(new DeribitJournalWriter());
+    if (!writer->open(path_prefix, segment_bytes)) {
+        LOG_ERROR("Unable to start recording to ", path_prefix);
+        return false;
+    }
+    journal = std::move(writer);
+    journal_prefix = path_prefix;
+    journal_segment_bytes = segment_bytes;
+    LOG_INFO("Recording inbound messages to ", path_prefix);
+    // Shards write their own journals, so market data on them is not lost
+    if (market_data_pool && !market_data_pool->startRecording(path_prefix, segment_bytes)) {
         return false;
     }
+    return true;
+}
 
-    // Wait for authentication to complete (with a timeout).
-    int waitTime = 10;
-    while (!authenticated && waitTime--) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+bool DeribitAuth::enableMarketDataPool(const MarketDataPoolConfig& config) {
+    if (connected) {
+        LOG_ERROR("The market data pool must be enabled before connecting.");
+        return false;
     }
-    if (!authenticated) {
-        std::cerr << "Authentication timed out." << std::endl;
+    size_t shards = config.shards > 0 ? config.shards : 1;
+    if (!event_bus.setProducerCount(1 + shards)) {
+        return false;
     }
-    return authenticated;
+    market_data_pool.reset(new DeribitMarketDataPool(latency_stats, config, &event_bus));
+    market_data_pool->setPositionBook(&position_book);
+    market_data_pool->setRiskGate(&risk_gate);
+    market_data_pool->setTradeAggregator(&trade_aggregator);
+    market_data_pool->setOptionBook(&option_book);
+    if (journal && !market_data_pool->startRecording(journal_prefix, journal_segment_bytes)) {
+        market_data_pool.reset();
+        event_bus.setProducerCount(1);
+        return false;
+    }
+    LOG_INFO("Public market data will use ", market_data_pool->shardCount(), " connections.");
+    return true;
 }
 
+bool DeribitAuth::subscribePublic(const std::vector<std::string>& channels) {
+    if (market_data_pool) {
+        return market_data_pool->subscribe(channels);
+    }
+    return subscription_handler.subscribePublic(channels);
+}
 
-bool DeribitAuth::placeBuyOrder(const std::string& instrument_name, double amount,
-    const std::string& type, const std::string& label) {
-if (!authenticated) {
-std::cerr << "Not authenticated. Please authenticate first." << std::endl;
-return false;
+bool DeribitAuth::unsubscribe(const std::vector<std::string>& channels) {
+    if (!market_data_pool) {
+        return subscription_handler.unsubscribe(channels);
+    }
+
+    std::vector<std::string> pooled;
+    std::vector<std::string> local;
+    for (const auto& channel : channels) {
+        (market_data_pool->owns(channel) ? pooled : local).push_back(channel);
+    }
+    bool ok = true;
+    if (!pooled.empty()) {
+        ok = market_data_pool->unsubscribe(pooled) && ok;
+    }
+    if (!local.empty()) {
+        ok = subscription_handler.unsubscribe(local) && ok;
+    }
+    return ok;
+}
+
+void DeribitAuth::printLatencyReport() const {
+    LOG_INFO(latency_stats.report());
+    SchedulerStats stats = request_scheduler.stats();
+    LOG_INFO("Rate limiter: ", stats.sent_immediately, " sent at once, ", stats.queued, " queued (",
+             stats.waiting, " waiting), ", stats.coalesced, " coalesced, ", stats.throttled,
+             " throttled by the exchange; credits ", static_cast<int64_t>(stats.matching_credits),
+             " matching, ", static_cast<int64_t>(stats.non_matching_credits), " non-matching");
+    const DeribitClockEstimator& clock = heartbeat.clock();
+    if (clock.hasEstimate()) {
+        LOG_INFO("Exchange clock: ", clock.offsetUs(), " us ahead of ours (+/- ", clock.errorBoundUs(),
+                 " us), network rtt ", clock.rttUs(), " us (best ", clock.minRttUs(), " us) over ",
+                 clock.samples(), " probes");
+    }
 }
 
-    // Record order start time
-    order_start_time = std::chrono::high_resolution_clock::now();
+// Send an authentication request using client_credentials and wait for the reply.
+bool DeribitAuth::authenticate() {
+    DeribitPending reply = authenticateAsync();
+    if (!reply.waitFor(std::chrono::milliseconds(CONNECT_TIMEOUT_MS))) {
+        LOG_ERROR("Authentication timed out.");
+        return false;
+    }
+    return reply.get().ok() && authenticated;
+}
 
-// Create JSON-RPC buy order message
-json j;
-j["jsonrpc"] = "2.0";
-j["id"] = 5275;  // Request identifier
-j["method"] = "private/buy";
-j["params"] = {
-{"instrument_name", instrument_name},
-{"amount", amount},
-{"type", type}
-};
+DeribitPending DeribitAuth::authenticateAsync() {
+    DeribitPending reply;
+    if (!connected) {
+        LOG_ERROR("Not connected to Deribit server.");
+        reply.fail("not connected");
+        return reply;
+    }
 
-// Add label if provided
-if (!label.empty()) {
-j["params"]["label"] = label;
+    // The session is set up before the reply completes, so a waiter sees authenticated
+    ResponseCallback complete = reply.completer();
+    auto on_auth = [this, complete](const json& response, int64_t latency_us) {
+        handleAuthResponse(response);
+        complete(response, latency_us);
+    };
+    if (!sendCredentials(nullptr, on_auth)) {
+        LOG_ERROR("Error sending authentication request.");
+        reply.fail("authentication request not sent");
+    }
+    return reply;
 }
 
-std::string payload = j.dump();
-std::cout << "Sending buy order: " << payload << std::endl;
+// Sends public/auth with the client credentials; the payload is never logged.
+bool DeribitAuth::sendCredentials(const websocketpp::connection_hdl* target, ResponseCallback callback) {
+    json params = {
+        {"grant_type", "client_credentials"},
+        {"client_id", client_id},
+        {"client_secret", client_secret}
+    };
+    return sendRequest("public/auth", params, std::move(callback), nullptr, target) != 0;
+}
 
-websocketpp::lib::error_code ec;
-ws_client.send(connection_hdl, payload, websocketpp::frame::opcode::text, ec);
+bool DeribitAuth::refreshToken() {
+    std::string token;
+    {
+        std::lock_guard<std::mutex> lock(session_mutex);
+        token = refresh_token;
+    }
+    auto on_auth = [this](const json& response, int64_t) { handleAuthResponse(response); };
+    if (token.empty()) {
+        return sendCredentials(nullptr, on_auth);
+    }
 
-if (ec) {
-std::cerr << "Error sending buy order request: " << ec.message() << std::endl;
-return false;
+    json params = {
+        {"grant_type", "refresh_token"},
+        {"refresh_token", token}
+    };
+    return sendRequest("public/auth", params, [this, on_auth](const json& response, int64_t) {
+        if (response.contains("result")) {
+            handleAuthResponse(response);
+            return;
+        }
+        if (connected) {
+            LOG_WARN("Token refresh failed; authenticating with client credentials.");
+            sendCredentials(nullptr, on_auth);
+        }
+    }, nullptr) != 0;
 }
 
-return true;
+void DeribitAuth::handleAuthResponse(const json& response) {
+    if (!response.contains("result")) {
+        LOG_ERROR("Authentication failed: ", response["error"].dump());
+        return;
+    }
+
+    auto result = response["result"];
+    {
+        std::lock_guard<std::mutex> lock(session_mutex);
+        access_token = result["access_token"];
+        refresh_token = result["refresh_token"];
+    }
+    bool renewed = authenticated.exchange(true);
+    session_established = true;
+    scheduleTokenRefresh(result.value("expires_in", int64_t(0)));
+    if (renewed) {
+        LOG_INFO("Access token refreshed.");
+    } else {
+        LOG_INFO("Authenticated successfully.");
+        publishConnectionState();
+        LOG_INFO("Access Token: ", result["access_token"].get<std::string>());
+    }
+
+    if (recovery.active()) {
+        recovery.markAuthenticated();
+        resubscribe(true);
+    }
+    if (standby_open && !standby_authenticated) {
+        authenticateStandby();
+    }
 }
 
-bool DeribitAuth::editOrder(const std::string& order_id, double amount, 
-    double price, const std::string& advanced) {
-        if (!authenticated) {
-            std::cerr << "Not authenticated. Please authenticate first." << std::endl;
-            return false;
+void DeribitAuth::scheduleTokenRefresh(int64_t expires_in_s) {
+    uint64_t generation = ++auth_generation;
+    if (expires_in_s <= 0) {
+        return;
+    }
+    ws_client.set_timer(refreshDelayMs(expires_in_s), [this, generation](const websocketpp::lib::error_code& ec) {
+        if (ec || stopping || generation != auth_generation || !authenticated) {
+            return;
         }
+        LOG_INFO("Refreshing access token before it expires.");
+        refreshToken();
+    });
+}
 
-        // Create JSON-RPC edit order message
-        json j;
-        j["jsonrpc"] = "2.0";
-        j["id"] = 3725;  // Request identifier
-        j["method"] = "private/edit";
-        j["params"] = {
-            {"order_id", order_id},
-            {"amount", amount},
-            {"price", price}
-        };
+bool DeribitAuth::placeBuyOrder(const std::string& instrument_name, double amount,
+                                const std::string& type, const std::string& label,
+                                ResponseCallback callback) {
+    OrderParams params;
+    params.instrument_name = instrument_name;
+    params.amount = amount;
+    params.type = type;
+    params.label = label;
+    return placeOrder(OrderSide::Buy, params, callback);
+}
+
+bool DeribitAuth::placeSellOrder(const std::string& instrument_name, double amount,
+                                 const std::string& type, const std::string& label,
+                                 ResponseCallback callback) {
+    OrderParams params;
+    params.instrument_name = instrument_name;
+    params.amount = amount;
+    params.type = type;
+    params.label = label;
+    return placeOrder(OrderSide::Sell, params, callback);
+}
+
+bool DeribitAuth::placeOrder(OrderSide side, const OrderParams& params, ResponseCallback callback) {
+    if (!authenticated) {
+        LOG_ERROR("Not authenticated. Please authenticate first.");
+        return false;
+    }
+
+    std::string reason;
+    InstrumentId instrument = INVALID_INSTRUMENT;
+    if (!instrument_registry.checkOrder(params.instrument_name, params.amount, params.price, reason, &instrument)) {
+        LOG_ERROR("Order rejected locally for ", params.instrument_name, ": ", reason);
+        return false;
+    }
+    RiskTicket ticket;
+    RiskCheck verdict = risk_gate.check(instrument, side, params.amount, params.price, ticket);
+    if (verdict != RiskCheck::Passed) {
+        LOG_ERROR("Order rejected by risk gate for ", params.instrument_name, ": ",
+                  DeribitRiskGate::describe(verdict));
+        return false;
+    }
+
+    // Encode the JSON-RPC frame straight into the reusable order buffer
+    uint64_t id = pending_requests.nextId();
+    std::string_view payload = orderEncoder().encodeOrder(id, side, params);
+
+    bool is_buy = side == OrderSide::Buy;
+    ResponseCallback printer = [this](const json& response, int64_t latency_us) {
+        printOrderResponse(response, latency_us);
+    };
+    // The reply turns the ticket's reservation into the order's open amount, or releases it
+    ResponseCallback respond = orDefault(callback, printer);
+    ResponseCallback settle = [this, ticket, respond](const json& response, int64_t latency_us) {
+        risk_gate.onResponse(ticket, response);
+        respond(response, latency_us);
+    };
+    if (sendPayload(id, is_buy ? "private/buy" : "private/sell", payload, settle,
+                    is_buy ? "buy order" : "sell order") == 0) {
+        risk_gate.release(ticket);
+        return false;
+    }
+    return true;
+}
+
+DeribitPending DeribitAuth::buy(const OrderParams& params) {
+    DeribitPending reply;
+    if (!placeOrder(OrderSide::Buy, params, reply.completer())) {
+        reply.fail("buy order not sent");
+    }
+    return reply;
+}
+
+DeribitPending DeribitAuth::sell(const OrderParams& params) {
+    DeribitPending reply;
+    if (!placeOrder(OrderSide::Sell, params, reply.completer())) {
+        reply.fail("sell order not sent");
+    }
+    return reply;
+}
+
+bool DeribitAuth::killSwitch(ResponseCallback callback) {
+    risk_gate.engageKillSwitch();
+    LOG_WARN("Kill switch engaged: new orders are blocked, cancelling all open orders.");
+    if (!authenticated) {
+        LOG_ERROR("Not authenticated; open orders were not cancelled.");
+        return false;
+    }
+
+    // Orders that passed the gate but still wait for credits never go out; failing
+    // them runs their settle callbacks, which release the risk reservations
+    std::vector<QueuedRequest> queued;
+    if (request_scheduler.drain(RequestPriority::Order, queued) > 0) {
+        LOG_WARN("Kill switch: dropping ", queued.size(), " queued order requests.");
+        failQueued(queued, "kill switch");
+    }
 
-        // Add advanced parameter if provided
-        if (!advanced.empty()) {
-            j["params"]["advanced"] = advanced;
+    ResponseCallback printer = [](const json& response, int64_t latency_us) {
+        if (response.contains("result")) {
+            LOG_INFO("Cancelled ", response["result"].dump(), " orders (", latency_us, " microseconds).");
         }
+    };
+
+    // Sent ahead of anything else waiting for matching engine credits
+    uint64_t id = pending_requests.nextId();
+    json request = {
+        {"jsonrpc", "2.0"},
+        {"id", id},
+        {"method", "private/cancel_all"},
+        {"params", json::object()}
+    };
+    request_scheduler.charge(RequestPriority::Order);
+    return transmit(id, "private/cancel_all", request.dump(), orDefault(callback, printer), "cancel all",
+                    nullptr) != 0;
+}
+
+void DeribitAuth::resumeTrading() {
+    risk_gate.releaseKillSwitch();
+    LOG_INFO("Kill switch released: orders are accepted again.");
+}
+
+bool DeribitAuth::editOrder(const std::string& order_id, double amount,
+                            double price, const std::string& advanced,
+                            ResponseCallback callback) {
+    if (!authenticated) {
+        LOG_ERROR("Not authenticated. Please authenticate first.");
+        return false;
+    }
+
+    // The cache knows the order's instrument; an order it has not seen is checked against the defaults
+    OrderRecord existing;
+    InstrumentId instrument = INVALID_INSTRUMENT;
+    if (order_manager.getOrder(order_id, existing)) {
+        instrument = instrument_registry.find(existing.instrument_name);
+    }
+    RiskTicket ticket;
+    RiskCheck verdict = risk_gate.checkEdit(order_id, instrument, amount, price, ticket);
+    if (verdict != RiskCheck::Passed) {
+        LOG_ERROR("Edit rejected by risk gate for ", order_id, ": ", DeribitRiskGate::describe(verdict));
+        return false;
+    }
+
+    uint64_t id = pending_requests.nextId();
+    std::string_view payload = orderEncoder().encodeEdit(id, order_id, amount, price, advanced);
+
+    ResponseCallback printer = [this](const json& response, int64_t latency_us) {
+        printEditResponse(response, latency_us);
+    };
+    // The reply releases whatever the edit reserved, whether or not it succeeded
+    ResponseCallback respond = orDefault(callback, printer);
+    ResponseCallback settle = [this, ticket, respond](const json& response, int64_t latency_us) {
+        risk_gate.onResponse(ticket, response);
+        respond(response, latency_us);
+    };
+    if (sendPayload(id, "private/edit", payload, settle, "edit order") == 0) {
+        risk_gate.release(ticket);
+        return false;
+    }
+    return true;
+}
+
+bool DeribitAuth::cancelOrder(const std::string& order_id, ResponseCallback callback) {
+    if (!authenticated) {
+        LOG_ERROR("Not authenticated. Please authenticate first.");
+        return false;
+    }
+
+    uint64_t id = pending_requests.nextId();
+    std::string_view payload = orderEncoder().encodeCancel(id, order_id);
+
+    ResponseCallback printer = [this](const json& response, int64_t latency_us) {
+        printCancelResponse(response, latency_us);
+    };
+    return sendPayload(id, "private/cancel", payload, orDefault(callback, printer), "cancel order") != 0;
+}
 
-        std::string payload = j.dump();
-        std::cout << "Sending edit order request: " << payload << std::endl;
+DeribitPending DeribitAuth::edit(const std::string& order_id, double amount, double price,
+                                const std::string& advanced) {
+    DeribitPending reply;
+    if (!editOrder(order_id, amount, price, advanced, reply.completer())) {
+        reply.fail("edit not sent");
+    }
+    return reply;
+}
 
-        websocketpp::lib::error_code ec;
-        ws_client.send(connection_hdl, payload, websocketpp::frame::opcode::text, ec);
+DeribitPending DeribitAuth::cancel(const std::string& order_id) {
+    DeribitPending reply;
+    if (!cancelOrder(order_id, reply.completer())) {
+        reply.fail("cancel not sent");
+    }
+    return reply;
+}
 
-        if (ec) {
-            std::cerr << "Error sending edit order request: " << ec.message() << std::endl;
-            return false;
+bool DeribitAuth::acceptBlockRfq(int64_t block_rfq_id, OrderSide direction, double price, double amount,
+                                 const std::string& time_in_force, ResponseCallback callback) {
+    if (!authenticated) {
+        LOG_ERROR("Not authenticated. Please authenticate first.");
+        return false;
+    }
+    if (risk_gate.killSwitchEngaged()) {
+        LOG_ERROR("Block RFQ ", block_rfq_id, " not accepted: kill switch engaged");
+        return false;
+    }
+    BlockRfq rfq;
+    if (!block_rfq_book.rfq(block_rfq_id, rfq) || rfq.legs.empty()) {
+        LOG_ERROR("Block RFQ ", block_rfq_id, " is not open or has no legs");
+        return false;
+    }
+
+    json legs = json::array();
+    for (const auto& leg : rfq.legs) {
+        legs.push_back({
+            {"instrument_name", leg.instrument_name},
+            {"ratio", leg.ratio},
+            {"direction", leg.direction == OrderSide::Buy ? "buy" : "sell"}
+        });
+    }
+    json params = {
+        {"block_rfq_id", block_rfq_id},
+        {"legs", legs},
+        {"direction", direction == OrderSide::Buy ? "buy" : "sell"},
+        {"price", price},
+        {"amount", amount},
+        {"time_in_force", time_in_force}
+    };
+    ResponseCallback printer = [block_rfq_id](const json& response, int64_t latency_us) {
+        if (response.contains("result")) {
+            LOG_INFO("Block RFQ ", block_rfq_id, " accepted (", latency_us, " microseconds): ",
+                     response["result"].dump());
         }
-    
+    };
+    return sendRequest("private/accept_block_rfq", params, orDefault(callback, printer), "accept block RFQ") != 0;
+}
+
+bool DeribitAuth::getOrderBook(const std::string& instrument_name, int depth,
+                               ResponseCallback callback) {
+    // Create JSON-RPC get orderbook message
+    json params = {
+        {"instrument_name", instrument_name},
+        {"depth", depth}
+    };
+
+    ResponseCallback printer = [this](const json& response, int64_t latency_us) {
+        printOrderBookResponse(response, latency_us);
+    };
+    return sendRequest("public/get_order_book", params, orDefault(callback, printer), "get orderbook") != 0;
+}
+
+bool DeribitAuth::getPosition(const std::string& instrument_name, ResponseCallback callback) {
+    if (!authenticated) {
+        LOG_ERROR("Not authenticated. Please authenticate first.");
+        return false;
+    }
+
+    // Create JSON-RPC get position message
+    json params = {
+        {"instrument_name", instrument_name}
+    };
+
+    ResponseCallback printer = [this](const json& response, int64_t latency_us) {
+        printPositionResponse(response, latency_us);
+    };
+    return sendRequest("private/get_position", params, orDefault(callback, printer), "get position") != 0;
+}
+
+bool DeribitAuth::getOpenOrders(ResponseCallback callback) {
+    if (!authenticated) {
+        LOG_ERROR("Not authenticated. Please authenticate first.");
+        return false;
+    }
+
+    // Create JSON-RPC get open orders message (empty params)
+    ResponseCallback printer = [this](const json& response, int64_t latency_us) {
+        printOpenOrdersResponse(response, latency_us);
+    };
+    return sendRequest("private/get_open_orders", json::object(),
+                       orDefault(callback, printer), "get open orders") != 0;
+}
+
+bool DeribitAuth::startOrderTracking() {
+    if (!authenticated) {
+        LOG_ERROR("Not authenticated. Please authenticate first.");
+        return false;
+    }
+    if (order_tracking) {
         return true;
     }
 
-    bool DeribitAuth::cancelOrder(const std::string& order_id) {
-        if (!authenticated) {
-            std::cerr << "Not authenticated. Please authenticate first." << std::endl;
-            return false;
+    static const char* ORDERS_CHANNEL = "user.orders.any.any.raw";
+    static const char* TRADES_CHANNEL = "user.trades.any.any.raw";
+    subscription_handler.onOrders(ORDERS_CHANNEL, [this](const OrderEvent& order) {
+        order_manager.applyOrder(order);
+        risk_gate.onOrder(order);
+    });
+    subscription_handler.onTrades(TRADES_CHANNEL, [this](const TradeEvent& trade) {
+        applyFill(trade);
+    });
+
+    // Updates are applied from here on; the seed cannot overwrite anything newer
+    order_tracking = true;
+    if (!subscription_handler.subscribePrivate({ ORDERS_CHANNEL, TRADES_CHANNEL })) {
+        order_tracking = false;
+        return false;
+    }
+    return getOpenOrders([this](const json& response, int64_t latency_us) {
+        if (order_manager.seed(response)) {
+            LOG_INFO("Order tracking started (", latency_us, " us to seed).");
+            seedRiskGate();
         }
-    
-        // Create JSON-RPC cancel order message
-        json j;
-        j["jsonrpc"] = "2.0";
-        j["id"] = 4214;  // Request identifier
-        j["method"] = "private/cancel";
-        j["params"] = {
-            {"order_id", order_id}
-        };
-    
-        std::string payload = j.dump();
-        std::cout << "Sending cancel order request: " << payload << std::endl;
-    
-        websocketpp::lib::error_code ec;
-        ws_client.send(connection_hdl, payload, websocketpp::frame::opcode::text, ec);
-    
-        if (ec) {
-            std::cerr << "Error sending cancel order request: " << ec.message() << std::endl;
-            return false;
-        }
-    
-        return true;
+    });
+}
+
+// Each trade reaches us twice (order response and user.trades); the order
+// cache records it once, and only then does it move the position.
+void DeribitAuth::applyFill(const TradeEvent& trade) {
+    if (!order_manager.applyFill(trade)) {
+        return;
     }
+    risk_gate.onFill(trade);
+    if (position_tracking.load(std::memory_order_acquire)) {
+        position_book.applyFill(trade);
+    }
+}
 
-    bool DeribitAuth::getOrderBook(const std::string& instrument_name, int depth) {
-        // Create JSON-RPC get orderbook message
-        json j;
-        j["jsonrpc"] = "2.0";
-        j["id"] = 8772;  // Request identifier
-        j["method"] = "public/get_order_book";
-        j["params"] = {
-            {"instrument_name", instrument_name},
-            {"depth", depth}
-        };
-    
-        std::string payload = j.dump();
-        std::cout << "Sending get orderbook request: " << payload << std::endl;
-    
-        websocketpp::lib::error_code ec;
-        ws_client.send(connection_hdl, payload, websocketpp::frame::opcode::text, ec);
-    
-        if (ec) {
-            std::cerr << "Error sending get orderbook request: " << ec.message() << std::endl;
-            return false;
-        }
-    
+// Orders that were open before tracking started count against the limits too
+void DeribitAuth::seedRiskGate() {
+    std::vector<OrderRecord> open;
+    order_manager.openOrders(open);
+    for (const auto& record : open) {
+        OrderEvent order;
+        order.order_id = record.order_id;
+        order.instrument_name = record.instrument_name;
+        order.order_state = record.state == OrderState::Untriggered ? "untriggered" : "open";
+        order.direction = record.direction;
+        order.amount = record.amount;
+        order.filled_amount = record.filled_amount;
+        order.last_update_timestamp = record.last_update_timestamp;
+        risk_gate.onOrder(order);
+    }
+}
+
+bool DeribitAuth::getPositions(const std::string& currency, ResponseCallback callback) {
+    if (!authenticated) {
+        LOG_ERROR("Not authenticated. Please authenticate first.");
+        return false;
+    }
+
+    json params = {
+        {"currency", currency}
+    };
+    ResponseCallback printer = [this](const json& response, int64_t latency_us) {
+        if (!response.contains("result") || !response["result"].is_array()) {
+            return;
+        }
+        for (const auto& position : response["result"]) {
+            printPositionResponse(json{{"result", position}}, latency_us);
+        }
+    };
+    return sendRequest("private/get_positions", params, orDefault(callback, printer), "get positions") != 0;
+}
+
+bool DeribitAuth::startPositionTracking() {
+    if (!startOrderTracking()) {
+        return false;
+    }
+    if (position_tracking) {
         return true;
     }
+    position_tracking = true;
+    return reconcilePositions();
+}
+
+// Fills executed after the exchange takes this snapshot but received before
+// the response are overwritten; the next reconciliation restores them.
+bool DeribitAuth::reconcilePositions() {
+    return getPositions("any", [this](const json& response, int64_t) {
+        position_book.reconcile(response);
+        risk_gate.reconcile(response);
+    });
+}
 
-    bool DeribitAuth::getPosition(const std::string& instrument_name) {
-        if (!authenticated) {
-            std::cerr << "Not authenticated. Please authenticate first." << std::endl;
-            return false;
+size_t DeribitAuth::evaluateRisk(std::vector<CurrencyRisk>& out) {
+    portfolio_risk.load(position_book, option_book);
+    return portfolio_risk.evaluate(out);
+}
+
+bool DeribitAuth::loadInstruments(const std::vector<std::string>& currencies, const std::string& snapshot_path) {
+    if (!snapshot_path.empty()) {
+        instrument_registry.loadSnapshot(snapshot_path);
+    }
+
+    // Responses arrive in any order; whichever comes last writes the snapshot
+    auto outstanding = std::make_shared<std::atomic<size_t>>(currencies.size());
+    auto finish = [this, outstanding, snapshot_path]() {
+        if (outstanding->fetch_sub(1, std::memory_order_acq_rel) == 1 && !snapshot_path.empty()) {
+            instrument_registry.saveSnapshot(snapshot_path);
         }
-    
-        // Create JSON-RPC get position message
-        json j;
-        j["jsonrpc"] = "2.0";
-        j["id"] = 404;  // Request identifier
-        j["method"] = "private/get_position";
-        j["params"] = {
-            {"instrument_name", instrument_name}
+    };
+
+    bool sent = false;
+    for (const auto& currency : currencies) {
+        json params = {
+            {"currency", currency},
+            {"expired", false}
         };
-    
-        std::string payload = j.dump();
-        std::cout << "Sending get position request: " << payload << std::endl;
-    
-        websocketpp::lib::error_code ec;
-        ws_client.send(connection_hdl, payload, websocketpp::frame::opcode::text, ec);
-    
-        if (ec) {
-            std::cerr << "Error sending get position request: " << ec.message() << std::endl;
-            return false;
-        }
-    
-        return true;
+        ResponseCallback callback = [this, finish, currency](const json& response, int64_t) {
+            instrument_registry.load(response, currency);
+            finish();
+        };
+        if (sendRequest("public/get_instruments", params, callback, nullptr) != 0) {
+            sent = true;
+        } else {
+            finish();
+        }
+    }
+    return sent;
+}
+
+void DeribitAuth::printOrderResponse(const json& response, int64_t latency_us) {
+    if (!response.contains("result")) {
+        return;
     }
 
-    bool DeribitAuth::getOpenOrders() {
-        if (!authenticated) {
-            std::cerr << "Not authenticated. Please authenticate first." << std::endl;
-            return false;
-        }
-    
-        // Create JSON-RPC get open orders message
-        json j;
-        j["jsonrpc"] = "2.0";
-        j["id"] = 1953;  // Request identifier
-        j["method"] = "private/get_open_orders";
-        j["params"] = json::object();  // Empty params object
-    
-        std::string payload = j.dump();
-        std::cout << "Sending get open orders request: " << payload << std::endl;
-    
-        websocketpp::lib::error_code ec;
-        ws_client.send(connection_hdl, payload, websocketpp::frame::opcode::text, ec);
-    
-        if (ec) {
-            std::cerr << "Error sending get open orders request: " << ec.message() << std::endl;
-            return false;
-        }
-    
-        return true;
+    auto result = response["result"];
+    auto order = result["order"];
+    auto loop_latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - trading_loop_start).count();
+    LOG_INFO("Order Placement Latency: ", latency_us, " microseconds");
+    LOG_INFO("Trading Loop Latency: ", loop_latency, " microseconds");
+    LOG_INFO("Order placed successfully:");
+    LOG_INFO("Order ID: ", order["order_id"]);
+    LOG_INFO("Amount: ", order["amount"]);
+    LOG_INFO("Average Price: ", order["average_price"]);
+    LOG_INFO("State: ", order["order_state"]);
+}
+
+void DeribitAuth::printEditResponse(const json& response, int64_t latency_us) {
+    if (!response.contains("result")) {
+        return;
+    }
+
+    auto result = response["result"];
+    auto order = result["order"];
+    LOG_INFO("Order updated successfully (", latency_us, " microseconds):");
+    LOG_INFO("Order ID: ", order["order_id"]);
+    LOG_INFO("Amount: ", order["amount"]);
+    LOG_INFO("Price: ", order["price"]);
+    if (order.contains("advanced")) {
+        LOG_INFO("Advanced: ", order["advanced"]);
+    }
+    LOG_INFO("State: ", order["order_state"]);
+}
+
+void DeribitAuth::printCancelResponse(const json& response, int64_t latency_us) {
+    if (!response.contains("result")) {
+        return;
+    }
+
+    auto result = response["result"];
+    LOG_INFO("Order cancelled successfully (", latency_us, " microseconds):");
+    LOG_INFO("Order ID: ", result["order_id"]);
+    LOG_INFO("State: ", result["order_state"]);
+}
+
+void DeribitAuth::printOpenOrdersResponse(const json& response, int64_t latency_us) {
+    if (!response.contains("result")) {
+        return;
     }
 
+    auto result = response["result"];
+    if (result.empty()) {
+        LOG_INFO("No open orders found (", latency_us, " microseconds).");
+        return;
+    }
 
+    LOG_INFO("\n=== Open Orders (", result.size(), ", ", latency_us, " microseconds) ===");
+    for (const auto& order : result) {
+        LOG_INFO("Order ID: ", order["order_id"]);
+        LOG_INFO("Instrument: ", order["instrument_name"]);
+        LOG_INFO("Type: ", order["order_type"]);
+        LOG_INFO("Direction: ", order["direction"]);
+        LOG_INFO("Amount: ", order["amount"]);
+        LOG_INFO("Filled Amount: ", order["filled_amount"]);
+        LOG_INFO("Price: ", order["price"]);
+        LOG_INFO("State: ", order["order_state"]);
+        LOG_INFO("Time in Force: ", order["time_in_force"]);
+        LOG_INFO("Created: ", order["creation_timestamp"]);
+        LOG_INFO("Last Update: ", order["last_update_timestamp"]);
 
+        if (order.contains("label") && !order["label"].empty()) {
+            LOG_INFO("Label: ", order["label"]);
+        }
+
+        LOG_INFO("Reduce Only: ", (order["reduce_only"].get<bool>() ? "Yes" : "No"));
+        LOG_INFO("Post Only: ", (order["post_only"].get<bool>() ? "Yes" : "No"));
+
+        if (order.contains("trigger_price")) {
+            LOG_INFO("Trigger Price: ", order["trigger_price"]);
+        }
+
+        LOG_INFO("---------------------");
+    }
+    LOG_INFO("===================");
+}
+
+void DeribitAuth::printOrderBookResponse(const json& response, int64_t latency_us) {
+    if (!response.contains("result")) {
+        return;
+    }
+
+    auto result = response["result"];
+    LOG_INFO("Order book for ", result["instrument_name"].get<std::string>(), " (", latency_us,
+             " microseconds):");
+    LOG_INFO("Mark Price: ", result["mark_price"].get<double>());
+    LOG_INFO("Last Price: ", result["last_price"].get<double>());
+
+    LOG_INFO("\nBids:");
+    for (const auto& bid : result["bids"]) {
+        LOG_INFO("Price: ", bid[0].get<double>(), ", Amount: ", bid[1].get<double>());
+    }
+
+    LOG_INFO("\nAsks:");
+    for (const auto& ask : result["asks"]) {
+        LOG_INFO("Price: ", ask[0].get<double>(), ", Amount: ", ask[1].get<double>());
+    }
+}
+
+void DeribitAuth::printPositionResponse(const json& response, int64_t latency_us) {
+    if (!response.contains("result")) {
+        return;
+    }
+
+    auto result = response["result"];
+    LOG_INFO("\nPosition Details for ", result["instrument_name"].get<std::string>(), " (", latency_us,
+             " microseconds):");
+    LOG_INFO("Size: ", result["size"].get<double>());
+    LOG_INFO("Direction: ", result["direction"].get<std::string>());
+    LOG_INFO("Average Price: ", result["average_price"].get<double>());
+    LOG_INFO("Floating P/L: ", result["floating_profit_loss"].get<double>());
+    LOG_INFO("Realized P/L: ", result["realized_profit_loss"].get<double>());
+    LOG_INFO("Total P/L: ", result["total_profit_loss"].get<double>());
+    LOG_INFO("Leverage: ", result["leverage"].get<int>());
+
+    if (result["estimated_liquidation_price"].get<double>() > 0) {
+        LOG_INFO("Est. Liquidation Price: ", result["estimated_liquidation_price"].get<double>());
+    }
+}
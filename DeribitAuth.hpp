@@ -3,9 +3,27 @@
 #include <websocketpp/client.hpp>
 #include <websocketpp/config/asio_client.hpp>
 #include <nlohmann/json.hpp>
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <memory>
+#include <thread>
+#include "DeribitAsync.hpp"
+#include "DeribitEventBus.hpp"
+#include "DeribitHeartbeat.hpp"
 #include "DeribitSubscription.hpp"
+#include "DeribitRequestTable.hpp"
+#include "DeribitRequestScheduler.hpp"
+#include "DeribitLatencyStats.hpp"
+#include "DeribitOrderEncoder.hpp"
+#include "DeribitJournal.hpp"
+#include "DeribitMarketDataPool.hpp"
+#include "DeribitOrderManager.hpp"
+#include "DeribitPositionBook.hpp"
+#include "DeribitInstrumentRegistry.hpp"
+#include "DeribitRiskGate.hpp"
+#include "DeribitPortfolioRisk.hpp"
+#include "DeribitReconnect.hpp"
 
 // For convenience and readability
 using json = nlohmann::json;
@@ -18,6 +36,31 @@ using websocketpp::lib::placeholders::_2;
  * 
  * This class manages WebSocket connections, API authentication, order management,
  * and market data operations with the Deribit cryptocurrency exchange.
+ *
+ * Every request is tagged with a unique JSON-RPC id and tracked in a
+ * DeribitRequestTable until its response arrives, so any number of requests
+ * can be in flight at once. Request methods take an optional callback that
+ * receives the response and its latency; when omitted the response is printed.
+ * Every response's send-to-ack latency is also recorded in a per-method
+ * histogram; see printLatencyReport().
+ *
+ * Public market data can be moved off this connection onto a
+ * DeribitMarketDataPool (see enableMarketDataPool()), leaving it to carry
+ * only authentication, order and private traffic.
+ *
+ * Consumers that should not run on the io threads attach a
+ * DeribitEventQueue to getEventBus(); see DeribitEventBus.
+ *
+ * A dropped connection is re-established automatically; see
+ * setReconnectPolicy().
+ *
+ * Every new order and edit passes getRiskGate() before it is encoded.
+ * Requests on this connection are paced by a local model of Deribit's
+ * request credits; see setRateLimits().
+ *
+ * A heartbeat keeps the connection alive, measures the network round trip
+ * and the exchange's clock offset, and closes a connection that has stalled;
+ * see setHeartbeat().
  */
 class DeribitAuth {
 public:
@@ -27,14 +70,54 @@ public:
      * @param client_secret The Deribit API client secret
      */
     DeribitAuth(const std::string& client_id, const std::string& client_secret);
+    ~DeribitAuth();
+
+    // Production test network endpoint
+    static constexpr const char* DEFAULT_URI = "wss://test.deribit.com/ws/api/v2";
 
     // Connection and Authentication Methods
-    bool connect();                                  // Establishes WebSocket connection to Deribit
+    bool connect(const std::string& uri = DEFAULT_URI); // Establishes WebSocket connection to Deribit
     bool authenticate();                             // Authenticates using provided credentials
+
+    /**
+     * @brief Starts connecting and returns at once
+     *
+     * Completes on the io thread when the socket opens (a "result" reply) or
+     * fails. connect() waits on it and then connects the market data pool,
+     * which this does not.
+     */
+    DeribitPending connectAsync(const std::string& uri = DEFAULT_URI);
+    // Sends public/auth; completes with its reply once the session is set up
+    DeribitPending authenticateAsync();
     std::string getAccessToken() const { 
+        std::lock_guard<std::mutex> lock(session_mutex);
         return access_token; 
     }
 
+    /**
+     * @brief Sets how a dropped connection is re-established; call before connect()
+     *
+     * The connection is reopened with jittered exponential backoff, resuming
+     * the previous TLS session where the server allows. Public subscriptions
+     * are restored in batches as soon as the socket opens; the session is then
+     * re-authenticated with the refresh token and private subscriptions
+     * follow. Order books resync from the snapshots that start each
+     * subscription. The time from the drop to the restored feed is logged and
+     * recorded as a "drop->feed" latency. With warm_standby a second
+     * authenticated connection is kept open and takes over without a
+     * reconnect. The market data pool gets the same policy (without standby)
+     * through MarketDataPoolConfig.
+     */
+    void setReconnectPolicy(const ReconnectPolicy& policy);
+
+    /**
+     * @brief Renews the session with the refresh token, falling back to the
+     *        client credentials if that fails
+     *
+     * Runs automatically shortly before the access token expires.
+     */
+    bool refreshToken();
+
     // Trading Operations
     /**
      * @brief Places a buy order on the exchange
@@ -42,16 +125,71 @@ public:
      * @param amount Order size/quantity
      * @param type Order type (market/limit)
      * @param label Optional order identifier
+     * @param callback Optional response handler (defaults to printing the result)
      */
     bool placeBuyOrder(const std::string& instrument_name, double amount, 
                       const std::string& type = "market", 
-                      const std::string& label = "");
+                      const std::string& label = "",
+                      ResponseCallback callback = nullptr);
+
+    /**
+     * @brief Places a sell order on the exchange
+     * @see placeBuyOrder
+     */
+    bool placeSellOrder(const std::string& instrument_name, double amount,
+                       const std::string& type = "market",
+                       const std::string& label = "",
+                       ResponseCallback callback = nullptr);
+
+    /**
+     * @brief Places an order with the full set of order parameters
+     * @param side Buy or sell
+     * @param params Instrument, amount, type, price, post_only, reduce_only,
+     *               time_in_force and label
+     * @param callback Optional response handler
+     */
+    bool placeOrder(OrderSide side, const OrderParams& params, ResponseCallback callback = nullptr);
+
+    /**
+     * @brief Asynchronous order entry: each completes with the exchange's reply
+     *
+     * Same checks and encoding as placeOrder(), editOrder() and cancelOrder().
+     * A request refused locally completes at once with an error reply; the
+     * reason is logged. From a C++20 coroutine: co_await client.buy(params).
+     */
+    DeribitPending buy(const OrderParams& params);
+    DeribitPending sell(const OrderParams& params);
+    DeribitPending edit(const std::string& order_id, double amount, double price,
+                        const std::string& advanced = "");
+    DeribitPending cancel(const std::string& order_id);
+
+    /**
+     * @brief Pre-trade limits checked on the caller's thread before an order
+     *        or edit is sent
+     *
+     * Configure it before trading. Open amounts and positions follow order
+     * responses, user.orders notifications and fills, so keep order tracking
+     * running (see startPositionTracking()).
+     */
+    DeribitRiskGate& getRiskGate() { return risk_gate; }
+
+    /**
+     * @brief Engages the kill switch and cancels every open order with
+     *        private/cancel_all
+     *
+     * New orders and edits are refused locally until resumeTrading(); cancels
+     * still go through. Orders still queued for rate limit credits are failed
+     * and never sent, and the cancel_all goes out ahead of the queue.
+     */
+    bool killSwitch(ResponseCallback callback = nullptr);
+    void resumeTrading();
 
     /**
      * @brief Cancels an existing order
      * @param order_id The ID of the order to cancel
+     * @param callback Optional response handler
      */
-    bool cancelOrder(const std::string& order_id);
+    bool cancelOrder(const std::string& order_id, ResponseCallback callback = nullptr);
 
     /**
      * @brief Modifies parameters of an existing order
@@ -59,14 +197,195 @@ public:
      * @param amount New order amount
      * @param price New order price
      * @param advanced Optional advanced order parameters
+     * @param callback Optional response handler
      */
     bool editOrder(const std::string& order_id, double amount, 
-                  double price, const std::string& advanced = "");
+                  double price, const std::string& advanced = "",
+                  ResponseCallback callback = nullptr);
 
     // Market Data Operations
-    bool getOrderBook(const std::string& instrument_name, int depth = 5);  // Retrieves order book data
-    bool getPosition(const std::string& instrument_name);                   // Gets current position info
-    bool getOpenOrders();                                                  // Lists all open orders
+    bool getOrderBook(const std::string& instrument_name, int depth = 5,
+                      ResponseCallback callback = nullptr);                // Retrieves order book data
+    bool getPosition(const std::string& instrument_name,
+                     ResponseCallback callback = nullptr);                 // Gets current position info
+    bool getOpenOrders(ResponseCallback callback = nullptr);               // Lists all open orders
+    bool getPositions(const std::string& currency = "any",
+                      ResponseCallback callback = nullptr);                 // Lists positions in a currency
+
+    // Number of requests currently awaiting a response
+    size_t pendingRequestCount() const { return pending_requests.size(); }
+
+    /**
+     * @brief Sets the request credit model; call before connect()
+     *
+     * Requests that would exceed the credits wait in a queue per priority
+     * (orders and cancels, then authentication and subscriptions, then
+     * queries) and are sent from the io thread as credits refill, so the
+     * exchange never has to answer too_many_requests. An identical query
+     * that is still waiting answers both callers. Time spent waiting is
+     * recorded as "queued->sent" latency; see getSchedulerStats() for the
+     * counters. Disable it for a server without rate limits.
+     */
+    void setRateLimits(const RateLimitConfig& config) { request_scheduler.configure(config); }
+    SchedulerStats getSchedulerStats() const { return request_scheduler.stats(); }
+
+    /**
+     * @brief Sets keepalive and stall detection; call before connect()
+     *
+     * Every open connection asks for exchange heartbeats and answers them,
+     * and probes with public/test every probe_interval_ms. The probes'
+     * round trips are recorded as "network rtt" latency, and their
+     * usIn/usOut estimate the offset between the exchange's clock and ours,
+     * which is taken out of every "exchange->recv" latency. A connection
+     * that receives nothing for stall_timeout_ms is closed and reconnects.
+     * The market data pool gets the same settings through
+     * MarketDataPoolConfig.
+     */
+    void setHeartbeat(const HeartbeatConfig& config) { heartbeat.configure(config); }
+    const DeribitClockEstimator& getClock() const { return heartbeat.clock(); }
+
+    // Latency histograms per JSON-RPC method and per subscription channel
+    DeribitLatencyStats& getLatencyStats() { return latency_stats; }
+    void printLatencyReport() const;
+
+    /**
+     * @brief Records every inbound frame with its receive time to a journal
+     *
+     * Call before connect(); the journal is written on the WebSocket thread.
+     * Replay it with DeribitJournalReader::replay(). With a market data pool
+     * each shard records its own frames; see
+     * DeribitMarketDataPool::startRecording().
+     * @param path_prefix Segments are written to <path_prefix>.NNNNNN.journal
+     */
+    bool startRecording(const std::string& path_prefix,
+                        size_t segment_bytes = DeribitJournalWriter::DEFAULT_SEGMENT_BYTES);
+
+    /**
+     * @brief Pins the io thread of this connection to one CPU
+     *
+     * Call before connect(); -1 (the default) leaves it unpinned.
+     */
+    void setIoThreadCpu(int cpu) { io_cpu = cpu; }
+
+    /**
+     * @brief Routes public subscriptions through a pool of market data
+     *        connections instead of this one
+     *
+     * Call before connect(), which then also connects the pool to the same
+     * endpoint. Private channels and all requests stay on this connection,
+     * so a heavy book feed cannot delay an order ack.
+     */
+    bool enableMarketDataPool(const MarketDataPoolConfig& config);
+    DeribitMarketDataPool* getMarketDataPool() { return market_data_pool.get(); }
+
+    // Subscribes to public channels on the market data pool if one is
+    // enabled, otherwise on this connection
+    bool subscribePublic(const std::vector<std::string>& channels);
+
+    // Unsubscribes each channel from the connection it was subscribed on
+    bool unsubscribe(const std::vector<std::string>& channels);
+
+    /**
+     * @brief Bus on which the io threads publish book, trade, order ack, fill
+     *        and connection events as fixed-size records
+     *
+     * Attach queues before connect(). Order acks and fills come from this
+     * connection only; book, trade and connection events also come from the
+     * market data pool, whose queues must then be QueueProducers::Multiple.
+     */
+    DeribitEventBus& getEventBus() { return event_bus; }
+
+    /**
+     * @brief Keeps getOrderManager() current with our orders and fills
+     *
+     * Subscribes to user.orders.any.any.raw and user.trades.any.any.raw and
+     * seeds the cache once from private/get_open_orders. Responses to our own
+     * order requests are applied as well. Requires authentication.
+     */
+    bool startOrderTracking();
+    bool isTrackingOrders() const { return order_tracking.load(std::memory_order_acquire); }
+    const DeribitOrderManager& getOrderManager() const { return order_manager; }
+
+    /**
+     * @brief Keeps getPositionBook() current from fills, mark and index prices
+     *
+     * Starts order tracking for the fills, and reconciles positions once from
+     * private/get_positions. Mark and index prices come from whatever ticker.*,
+     * trades.* and deribit_price_index.* channels are subscribed. Call
+     * reconcilePositions() now and then to correct any drift.
+     */
+    bool startPositionTracking();
+    bool reconcilePositions();
+    bool isTrackingPositions() const { return position_tracking.load(std::memory_order_acquire); }
+    const DeribitPositionBook& getPositionBook() const { return position_book; }
+
+    /**
+     * @brief Bars, VWAP, trade imbalance and realized volatility of every
+     *        instrument with a subscribed trades.* channel
+     *
+     * Fed from this connection and the market data pool, and from journal
+     * replays through getSubscriptionHandler(). Configure it before
+     * subscribing; configure() drops what was aggregated.
+     */
+    DeribitTradeAggregator& getTradeAggregator() { return trade_aggregator; }
+
+    /**
+     * @brief Greeks of every option with a subscribed ticker.* or trades.*
+     *        channel, and per-expiry volatility smiles
+     *
+     * A chain is repriced on each tick of its deribit_price_index.* channel
+     * (btc_usd for BTC options), so subscribe to that too.
+     */
+    DeribitOptionBook& getOptionBook() { return option_book; }
+
+    /**
+     * @brief Net greeks and scenario PnL of every tracked position, per
+     *        underlying currency
+     *
+     * Reloads getPositionBook() with option greeks from getOptionBook() and
+     * evaluates the scenario grid; cheap enough to call on every index tick.
+     * Needs startPositionTracking(), and option tickers for the options held.
+     */
+    size_t evaluateRisk(std::vector<CurrencyRisk>& out);
+    DeribitPortfolioRisk& getPortfolioRisk() { return portfolio_risk; }
+
+    /**
+     * @brief Open block RFQs from subscribed block_rfq.* channels, with the
+     *        best bid and ask across makers of each
+     *
+     * Its best quote handler runs on the io thread as soon as a best quote
+     * changes, and may call acceptBlockRfq() directly. RFQs are dropped when
+     * they close or expire.
+     */
+    DeribitBlockRfqBook& getBlockRfqBook() { return block_rfq_book; }
+
+    /**
+     * @brief Trades against the quotes on a block RFQ we requested, with
+     *        private/accept_block_rfq
+     *
+     * The legs come from getBlockRfqBook(), so the RFQ must still be open there.
+     * @param direction Buy takes the asks, sell hits the bids
+     * @param price Limit for the whole structure, e.g. BlockRfqBest::ask_price
+     * @param time_in_force fill_or_kill or good_til_cancelled
+     */
+    bool acceptBlockRfq(int64_t block_rfq_id, OrderSide direction, double price, double amount,
+                        const std::string& time_in_force = "fill_or_kill",
+                        ResponseCallback callback = nullptr);
+
+    /**
+     * @brief Fills getInstruments() from public/get_instruments, one request
+     *        per currency
+     *
+     * If snapshot_path names a readable snapshot it is loaded first, so
+     * instrument metadata is available immediately; the requests then refresh
+     * it in the background and the last response to arrive saves a new
+     * snapshot. Does not require authentication.
+     */
+    bool loadInstruments(const std::vector<std::string>& currencies, const std::string& snapshot_path = "");
+    const DeribitInstrumentRegistry& getInstruments() const { return instrument_registry; }
+
+    bool isConnected() const { return connected.load(std::memory_order_acquire); }
+    bool isAuthenticated() const { return authenticated.load(std::memory_order_acquire); }
 
     // Subscription and Timing Management
     DeribitSubscription& getSubscriptionHandler() { 
@@ -81,10 +400,80 @@ private:
     // WebSocket client type definitions
     typedef websocketpp::client<websocketpp::config::asio_tls_client> client;
     typedef websocketpp::lib::shared_ptr<websocketpp::lib::asio::ssl::context> context_ptr;
+    typedef websocketpp::lib::asio::ssl::stream<websocketpp::lib::asio::ip::tcp::socket> ssl_socket;
 
     // Performance measurement points
     std::chrono::high_resolution_clock::time_point trading_loop_start;    // Start of trading loop
-    std::chrono::high_resolution_clock::time_point order_start_time;      // Order placement timing
+
+    // Request tracking
+    static const int REQUEST_TIMEOUT_MS = 10000;                          // Per-request response deadline
+    static const int REQUEST_SWEEP_INTERVAL_MS = 100;                     // Timeout check period
+    static const int CONNECT_TIMEOUT_MS = 10000;                          // connect() and authenticate()
+
+    /**
+     * @brief Sends a JSON-RPC request and registers it in the pending table
+     * @param method Static method name, e.g. "private/buy"
+     * @param description Used in log lines ("buy order"); nullptr suppresses the payload echo
+     * @return The request id, or 0 if the request could not be sent
+     */
+    uint64_t sendRequest(const char* method, const json& params, ResponseCallback callback,
+                         const char* description, const websocketpp::connection_hdl* target = nullptr);
+
+    /**
+     * @brief Registers and sends an already encoded request frame
+     * @param id The JSON-RPC id written into payload
+     * @param target Connection to send on; nullptr for the main one
+     * @return id, or 0 if the request could not be sent
+     */
+    uint64_t sendPayload(uint64_t id, const char* method, std::string_view payload,
+                         ResponseCallback callback, const char* description,
+                         const websocketpp::connection_hdl* target = nullptr,
+                         std::string coalesce_key = std::string());
+    // Registers and writes a frame that the scheduler has admitted
+    uint64_t transmit(uint64_t id, const char* method, std::string_view payload,
+                      ResponseCallback callback, const char* description,
+                      const websocketpp::connection_hdl* target);
+    void scheduleDispatch(int64_t delay_ms);
+    void dispatchQueued();
+    void failQueued(std::vector<QueuedRequest>& requests, const std::string& reason);
+    bool sendCredentials(const websocketpp::connection_hdl* target, ResponseCallback callback);
+    void scheduleRequestSweep();
+    void failRequests(std::vector<PendingRequest>& requests, const std::string& reason);
+
+    // Reconnection; everything here runs on the io thread
+    bool openConnection(bool standby);
+    websocketpp::connection_hdl currentConnection() const;
+    bool isStandby(websocketpp::connection_hdl hdl) const;
+    void scheduleReconnect();
+    void resumeSession();
+    void resubscribe(bool private_channels);
+    void checkRecovered();
+    void scheduleTokenRefresh(int64_t expires_in_s);
+    void promoteStandby();
+    void authenticateStandby();
+    void standbyLost();
+    void startHeartbeat();
+
+    // Event bus producers; run on the io thread
+    void publishConnectionState();
+    void applyFill(const TradeEvent& trade);
+    void seedRiskGate();
+    void handleOrderResponse(const PendingRequest& request, const MessageEnvelope* envelope,
+                             std::string_view payload, int64_t received_ns);
+    void publishOrderEvents(const PendingRequest& request, const MessageEnvelope* envelope, bool decoded,
+                            std::string_view payload, int64_t received_ns);
+
+    // Default response handlers
+    static ResponseCallback orDefault(ResponseCallback callback, ResponseCallback printer) {
+        return callback ? callback : printer;
+    }
+    void handleAuthResponse(const json& response);
+    void printOrderResponse(const json& response, int64_t latency_us);
+    void printEditResponse(const json& response, int64_t latency_us);
+    void printCancelResponse(const json& response, int64_t latency_us);
+    void printOrderBookResponse(const json& response, int64_t latency_us);
+    void printPositionResponse(const json& response, int64_t latency_us);
+    void printOpenOrdersResponse(const json& response, int64_t latency_us);
 
     // WebSocket Event Handlers
     void on_message(websocketpp::connection_hdl hdl, client::message_ptr msg);
@@ -92,6 +481,7 @@ private:
     void on_close(websocketpp::connection_hdl hdl);
     void on_error(websocketpp::connection_hdl hdl);
     context_ptr on_tls_init();
+    void on_socket_init(websocketpp::connection_hdl hdl, ssl_socket& socket);
 
     // Member variables
     client ws_client;                               // WebSocket client instance
@@ -100,7 +490,56 @@ private:
     std::string client_secret;                     // Deribit API client secret
     std::string access_token;                      // Current session access token
     std::string refresh_token;                     // Token for refreshing session
-    bool connected;                                // WebSocket connection status
-    bool authenticated;                            // API authentication status
+    std::atomic<bool> connected;                   // WebSocket connection status
+    std::atomic<bool> authenticated;               // API authentication status
+    int io_cpu;                                    // CPU the io thread is pinned to, -1 for none
+    DeribitPending connect_pending;                // Completed by the first open or failure
+    std::chrono::steady_clock::time_point connect_started;
+    DeribitRequestTable pending_requests;          // In-flight requests keyed by JSON-RPC id
+    DeribitRequestScheduler request_scheduler;     // Requests waiting for rate limit credits
+    DeribitHeartbeat heartbeat;                    // Keepalive, RTT and clock offset of the main connection
+    std::atomic<int64_t> dispatch_due_ns;          // When the next dispatch timer fires; 0 if none
+    DeribitLatencyStats latency_stats;             // Request and market data latency histograms
+    DeribitEventBus event_bus;                     // Typed events for consumer threads
+    OrderEvent ack_order;                          // Scratch space for decoding order acks
+    std::vector<TradeEvent> ack_fills;
+    DeribitOrderManager order_manager;             // Local cache of our orders
+    std::atomic<bool> order_tracking;              // order_manager is being kept current
+    DeribitPositionBook position_book;             // Local positions and PnL
+    std::atomic<bool> position_tracking;           // Fills are applied to position_book
+    DeribitInstrumentRegistry instrument_registry; // Instrument metadata; orders are checked against it
+    DeribitRiskGate risk_gate;                     // Pre-trade limits and exposure, by instrument id
+    DeribitTradeAggregator trade_aggregator;       // Bars and rolling statistics of the public tape
+    DeribitOptionBook option_book;                 // Option greeks and volatility smiles
+    DeribitPortfolioRisk portfolio_risk;           // Greeks and scenarios over position_book
+    DeribitBlockRfqBook block_rfq_book;            // Open block RFQs and their best quotes
     DeribitSubscription subscription_handler;      // Market data subscription manager
+    std::unique_ptr<DeribitJournalWriter> journal; // Inbound frame recorder, if enabled
+    std::string journal_prefix;                    // Shards of a later market data pool record here too
+    size_t journal_segment_bytes = DeribitJournalWriter::DEFAULT_SEGMENT_BYTES;
+    std::unique_ptr<DeribitMarketDataPool> market_data_pool; // Public market data connections, if enabled
+
+    // Reconnection state. session_mutex guards connection_hdl, standby_hdl and
+    // the tokens, which the io thread replaces while other threads send; the
+    // plain fields below are only touched on the io thread.
+    mutable std::mutex session_mutex;
+    std::string endpoint_uri;                      // Reused by every reconnect
+    ReconnectPolicy reconnect_policy;
+    DeribitBackoff reconnect_backoff;
+    DeribitBackoff standby_backoff;
+    DeribitTlsSessionCache tls_sessions;           // Last TLS session, offered on the next handshake
+    context_ptr tls_context;                       // Shared by every connection
+    DeribitRecoveryClock recovery;
+    std::atomic<bool> session_established;         // Credentials were accepted once; reconnects re-authenticate
+    std::atomic<bool> stopping;
+    bool sweep_running;
+    uint64_t auth_generation;                      // Cancels token refresh timers of older sessions
+    websocketpp::connection_hdl standby_hdl;       // Warm standby connection, if any
+    bool standby_active;                           // Connecting or open
+    bool standby_open;
+    bool standby_authenticated;
+    uint64_t standby_generation;                   // Cancels callbacks of replaced standbys
+    json standby_auth;                             // Standby's auth response, adopted on promotion
+    std::chrono::steady_clock::time_point standby_authenticated_at;
+    std::thread io_thread;
 };
@@ -0,0 +1,587 @@
+#include "DeribitBlockRfq.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+std::string stringOr(const json& data, const char* field) {
+    auto it = data.find(field);
+    if (it == data.end() || it->is_null()) {
+        return std::string();
+    }
+    return it->is_string() ? it->get<std::string>() : it->dump();
+}
+
+double numberOr(const json& data, const char* field, double fallback) {
+    auto it = data.find(field);
+    return it != data.end() && it->is_number() ? it->get<double>() : fallback;
+}
+
+int64_t integerOr(const json& data, const char* field) {
+    auto it = data.find(field);
+    return it != data.end() && it->is_number() ? it->get<int64_t>() : 0;
+}
+
+OrderSide sideOf(const json& data, const char* field) {
+    auto it = data.find(field);
+    return it != data.end() && it->is_string() && it->get_ref<const std::string&>() == "sell"
+        ? OrderSide::Sell : OrderSide::Buy;
+}
+
+void decodeLegs(const json& data, std::vector<BlockRfqLeg>& out) {
+    out.clear();
+    auto legs = data.find("legs");
+    if (legs == data.end() || !legs->is_array()) {
+        return;
+    }
+    for (const auto& leg : *legs) {
+        BlockRfqLeg decoded;
+        decoded.instrument_name = stringOr(leg, "instrument_name");
+        decoded.direction = sideOf(leg, "direction");
+        decoded.ratio = numberOr(leg, "ratio", 1.0);
+        decoded.price = numberOr(leg, "price", std::numeric_limits<double>::quiet_NaN());
+        out.push_back(std::move(decoded));
+    }
+}
+
+// The taker's view names makers as strings; joined they key a maker's quote
+std::string joinMakers(const json& quote) {
+    std::string out;
+    auto makers = quote.find("makers");
+    if (makers == quote.end() || !makers->is_array()) {
+        return out;
+    }
+    for (const auto& maker : *makers) {
+        if (!out.empty()) {
+            out += ',';
+        }
+        out += maker.is_string() ? maker.get<std::string>() : maker.dump();
+    }
+    return out;
+}
+
+// Quotes that close are timed against the local wall clock, like expire()
+int64_t wallClockMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool isOpen(const std::string& state) {
+    return state.empty() || state == "open";
+}
+
+}  // namespace
+
+DeribitBlockRfqBook::DeribitBlockRfqBook()
+    : lifetime_total_ms(0.0) {}
+
+void DeribitBlockRfqBook::setBestQuoteHandler(BestQuoteHandler new_handler) {
+    std::lock_guard<std::mutex> lock(mutex);
+    handler = std::move(new_handler);
+}
+
+bool DeribitBlockRfqBook::decodeRfq(const json& data, BlockRfq& out) {
+    if (!data.is_object() || !data.contains("block_rfq_id")) {
+        return false;
+    }
+    out.block_rfq_id = integerOr(data, "block_rfq_id");
+    out.state = stringOr(data, "state");
+    out.role = stringOr(data, "role");
+    out.amount = numberOr(data, "amount", 0.0);
+    out.min_trade_amount = numberOr(data, "min_trade_amount", 0.0);
+    out.creation_timestamp = integerOr(data, "creation_timestamp");
+    out.expiration_timestamp = integerOr(data, "expiration_timestamp");
+    out.combo_id = stringOr(data, "combo_id");
+    out.label = stringOr(data, "label");
+    auto disclosed = data.find("disclosed");
+    out.disclosed = disclosed != data.end() && disclosed->is_boolean() && disclosed->get<bool>();
+    decodeLegs(data, out.legs);
+    return true;
+}
+
+bool DeribitBlockRfqBook::decodeQuote(const json& data, BlockRfqQuote& out) {
+    if (!data.is_object() || !data.contains("block_rfq_id")) {
+        return false;
+    }
+    out.block_rfq_quote_id = integerOr(data, "block_rfq_quote_id");
+    out.block_rfq_id = integerOr(data, "block_rfq_id");
+    out.direction = sideOf(data, "direction");
+    out.price = numberOr(data, "price", std::numeric_limits<double>::quiet_NaN());
+    out.amount = numberOr(data, "amount", 0.0);
+    out.filled_amount = numberOr(data, "filled_amount", 0.0);
+    out.state = stringOr(data, "quote_state");
+    out.makers.clear();
+    out.execution_instruction = stringOr(data, "execution_instruction");
+    out.label = stringOr(data, "label");
+    out.creation_timestamp = integerOr(data, "creation_timestamp");
+    out.last_update_timestamp = integerOr(data, "last_update_timestamp");
+    auto replaced = data.find("replaced");
+    out.replaced = replaced != data.end() && replaced->is_boolean() && replaced->get<bool>();
+    decodeLegs(data, out.legs);
+    return true;
+}
+
+void DeribitBlockRfqBook::onMakerRfq(const json& data, int64_t received_ns) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!decodeRfq(data, scratch_rfq)) {
+            return;
+        }
+        ++counters.updates;
+        bool open = isOpen(scratch_rfq.state);
+        uint32_t slot = rfqSlot(scratch_rfq.block_rfq_id, open);
+        if (slot != NO_SLOT) {
+            std::swap(rfq_pool[slot].rfq, scratch_rfq);
+            if (!open) {
+                noteBest(slot, received_ns, true);
+                releaseRfq(slot, wallClockMs(), false);
+            }
+        }
+    }
+    flushReports();
+}
+
+void DeribitBlockRfqBook::onMakerQuotes(const json& data, int64_t received_ns) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!data.is_array()) {
+            return;
+        }
+        ++counters.updates;
+        stale.clear();
+        for (const auto& entry : data) {
+            if (!decodeQuote(entry, scratch_quote) || scratch_quote.block_rfq_quote_id == 0) {
+                continue;
+            }
+            auto known = quote_ids.find(scratch_quote.block_rfq_quote_id);
+            uint32_t touched;
+            if (!isOpen(scratch_quote.state)) {
+                if (known == quote_ids.end()) {
+                    continue;
+                }
+                touched = quote_pool[known->second].rfq;
+                removeQuote(known->second, wallClockMs(), false);
+            } else {
+                if (std::isnan(scratch_quote.price)) {
+                    continue;
+                }
+                touched = rfqSlot(scratch_quote.block_rfq_id, true);
+                std::string key = "q" + std::to_string(scratch_quote.block_rfq_quote_id);
+                uint32_t quote = upsertQuote(touched, key, scratch_quote);
+                quote_ids[scratch_quote.block_rfq_quote_id] = quote;
+            }
+            if (std::find(stale.begin(), stale.end(), touched) == stale.end()) {
+                stale.push_back(touched);
+            }
+        }
+        for (uint32_t slot : stale) {
+            noteBest(slot, received_ns, false);
+        }
+    }
+    flushReports();
+}
+
+void DeribitBlockRfqBook::onTakerRfq(const json& data, int64_t received_ns) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!decodeRfq(data, scratch_rfq)) {
+            return;
+        }
+        ++counters.updates;
+        bool open = isOpen(scratch_rfq.state);
+        uint32_t slot = rfqSlot(scratch_rfq.block_rfq_id, open);
+        if (slot == NO_SLOT) {
+            return;
+        }
+        std::swap(rfq_pool[slot].rfq, scratch_rfq);
+        if (!open) {
+            noteBest(slot, received_ns, true);
+            releaseRfq(slot, wallClockMs(), false);
+        } else {
+            // bids and asks list every live quote; whatever is not listed again is gone
+            uint64_t generation = ++rfq_pool[slot].generation;
+            const char* sides[] = { "bids", "asks" };
+            for (int s = 0; s < 2; ++s) {
+                auto quotes = data.find(sides[s]);
+                if (quotes == data.end() || !quotes->is_array()) {
+                    continue;
+                }
+                for (const auto& entry : *quotes) {
+                    BlockRfqQuote& quote = scratch_quote;
+                    quote.block_rfq_quote_id = 0;
+                    quote.block_rfq_id = rfq_pool[slot].rfq.block_rfq_id;
+                    quote.direction = s == 0 ? OrderSide::Buy : OrderSide::Sell;
+                    quote.price = numberOr(entry, "price", std::numeric_limits<double>::quiet_NaN());
+                    quote.amount = numberOr(entry, "amount", 0.0);
+                    quote.filled_amount = 0.0;
+                    quote.state = "open";
+                    quote.makers = joinMakers(entry);
+                    quote.execution_instruction = stringOr(entry, "execution_instruction");
+                    quote.label.clear();
+                    quote.last_update_timestamp = integerOr(entry, "last_update_timestamp");
+                    quote.creation_timestamp = quote.last_update_timestamp;
+                    quote.replaced = false;
+                    quote.legs.clear();
+                    if (std::isnan(quote.price)) {
+                        continue;
+                    }
+                    std::string key(1, s == 0 ? 'b' : 'a');
+                    key += quote.execution_instruction;
+                    key += ':';
+                    key += quote.makers;
+                    uint32_t updated = upsertQuote(slot, key, quote);
+                    quote_pool[updated].generation = generation;
+                }
+            }
+
+            stale.clear();
+            for (const auto& entry : rfq_pool[slot].quote_keys) {
+                if (quote_pool[entry.second].generation != generation) {
+                    stale.push_back(entry.second);
+                }
+            }
+            int64_t now_ms = wallClockMs();
+            for (uint32_t quote : stale) {
+                removeQuote(quote, now_ms, false);
+            }
+            noteBest(slot, received_ns, false);
+        }
+    }
+    flushReports();
+}
+
+size_t DeribitBlockRfqBook::expire(int64_t now_ms) {
+    size_t expired = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (uint32_t slot = 0; slot < rfq_pool.size(); ++slot) {
+            RfqSlot& rfq = rfq_pool[slot];
+            if (rfq.live && rfq.rfq.expiration_timestamp > 0 && rfq.rfq.expiration_timestamp <= now_ms) {
+                rfq.rfq.state = "expired";
+                noteBest(slot, 0, true);
+                releaseRfq(slot, now_ms, true);
+                ++expired;
+            }
+        }
+    }
+    flushReports();
+    return expired;
+}
+
+uint32_t DeribitBlockRfqBook::rfqSlot(int64_t block_rfq_id, bool create) {
+    auto it = rfq_ids.find(block_rfq_id);
+    if (it != rfq_ids.end()) {
+        return it->second;
+    }
+    if (!create) {
+        return NO_SLOT;
+    }
+    uint32_t slot;
+    if (!free_rfqs.empty()) {
+        slot = free_rfqs.back();
+        free_rfqs.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(rfq_pool.size());
+        rfq_pool.emplace_back();
+    }
+    RfqSlot& rfq = rfq_pool[slot];
+    rfq.live = true;
+    rfq.rfq.block_rfq_id = block_rfq_id;
+    rfq.reported = BlockRfqBest();
+    rfq.reported.block_rfq_id = block_rfq_id;
+    rfq_ids[block_rfq_id] = slot;
+    ++counters.rfqs;
+    return slot;
+}
+
+void DeribitBlockRfqBook::releaseRfq(uint32_t slot, int64_t now_ms, bool expired) {
+    RfqSlot& rfq = rfq_pool[slot];
+    while (!rfq.bids.empty()) {
+        removeQuote(rfq.bids.back(), now_ms, expired);
+    }
+    while (!rfq.asks.empty()) {
+        removeQuote(rfq.asks.back(), now_ms, expired);
+    }
+    rfq_ids.erase(rfq.rfq.block_rfq_id);
+    rfq.live = false;
+    rfq.quote_keys.clear();
+    free_rfqs.push_back(slot);
+    --counters.rfqs;
+}
+
+uint32_t DeribitBlockRfqBook::upsertQuote(uint32_t rfq_slot, const std::string& key, const BlockRfqQuote& quote) {
+    RfqSlot& rfq = rfq_pool[rfq_slot];
+    auto known = rfq.quote_keys.find(key);
+    if (known != rfq.quote_keys.end()) {
+        QuoteSlot& slot = quote_pool[known->second];
+        std::vector<uint32_t>& old_heap = heapOf(rfq, slot.quote.direction);
+        int64_t created = slot.quote.creation_timestamp;
+        bool side_changed = slot.quote.direction != quote.direction;
+        if (side_changed) {
+            // A maker quote never changes side, but keep the heaps consistent if one
+            // does; it is the same live quote, so nothing is counted as closed
+            eraseFromHeap(old_heap, known->second);
+        }
+        slot.quote = quote;
+        if (created != 0) {
+            slot.quote.creation_timestamp = created;
+        }
+        if (side_changed) {
+            std::vector<uint32_t>& heap = heapOf(rfq, quote.direction);
+            slot.heap_index = static_cast<uint32_t>(heap.size());
+            heap.push_back(known->second);
+            siftUp(heap, slot.heap_index);
+        } else {
+            fixHeap(old_heap, slot.heap_index);
+        }
+        return known->second;
+    }
+
+    uint32_t index;
+    if (!free_quotes.empty()) {
+        index = free_quotes.back();
+        free_quotes.pop_back();
+    } else {
+        index = static_cast<uint32_t>(quote_pool.size());
+        quote_pool.emplace_back();
+    }
+    QuoteSlot& slot = quote_pool[index];
+    slot.quote = quote;
+    slot.key = key;
+    slot.rfq = rfq_slot;
+    slot.generation = rfq.generation;
+    rfq.quote_keys.emplace(key, index);
+    std::vector<uint32_t>& heap = heapOf(rfq, quote.direction);
+    slot.heap_index = static_cast<uint32_t>(heap.size());
+    heap.push_back(index);
+    siftUp(heap, slot.heap_index);
+    ++counters.quotes;
+    return index;
+}
+
+void DeribitBlockRfqBook::removeQuote(uint32_t index, int64_t now_ms, bool expired) {
+    QuoteSlot& slot = quote_pool[index];
+    RfqSlot& rfq = rfq_pool[slot.rfq];
+    eraseFromHeap(heapOf(rfq, slot.quote.direction), index);
+
+    if (now_ms > 0 && slot.quote.creation_timestamp > 0 && now_ms >= slot.quote.creation_timestamp) {
+        lifetime_total_ms += static_cast<double>(now_ms - slot.quote.creation_timestamp);
+    }
+    ++counters.quotes_closed;
+    if (expired) {
+        ++counters.quotes_expired;
+    }
+    --counters.quotes;
+
+    if (slot.quote.block_rfq_quote_id != 0) {
+        quote_ids.erase(slot.quote.block_rfq_quote_id);
+    }
+    rfq.quote_keys.erase(slot.key);
+    slot.rfq = NO_SLOT;
+    free_quotes.push_back(index);
+}
+
+// Moves the last entry into the quote's hole and restores the heap around it
+void DeribitBlockRfqBook::eraseFromHeap(std::vector<uint32_t>& heap, uint32_t index) {
+    size_t hole = quote_pool[index].heap_index;
+    uint32_t last = heap.back();
+    heap.pop_back();
+    if (last != index) {
+        heap[hole] = last;
+        quote_pool[last].heap_index = static_cast<uint32_t>(hole);
+        fixHeap(heap, hole);
+    }
+}
+
+std::vector<uint32_t>& DeribitBlockRfqBook::heapOf(RfqSlot& rfq, OrderSide side) {
+    return side == OrderSide::Buy ? rfq.bids : rfq.asks;
+}
+
+// Higher bids and lower asks first; at the same price the older update wins
+bool DeribitBlockRfqBook::better(uint32_t a, uint32_t b) const {
+    const BlockRfqQuote& x = quote_pool[a].quote;
+    const BlockRfqQuote& y = quote_pool[b].quote;
+    if (x.price != y.price) {
+        return x.direction == OrderSide::Buy ? x.price > y.price : x.price < y.price;
+    }
+    return x.last_update_timestamp < y.last_update_timestamp;
+}
+
+void DeribitBlockRfqBook::siftUp(std::vector<uint32_t>& heap, size_t index) {
+    uint32_t moving = heap[index];
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+        if (!better(moving, heap[parent])) {
+            break;
+        }
+        heap[index] = heap[parent];
+        quote_pool[heap[index]].heap_index = static_cast<uint32_t>(index);
+        index = parent;
+    }
+    heap[index] = moving;
+    quote_pool[moving].heap_index = static_cast<uint32_t>(index);
+}
+
+void DeribitBlockRfqBook::siftDown(std::vector<uint32_t>& heap, size_t index) {
+    uint32_t moving = heap[index];
+    size_t size = heap.size();
+    while (true) {
+        size_t child = 2 * index + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && better(heap[child + 1], heap[child])) {
+            ++child;
+        }
+        if (!better(heap[child], moving)) {
+            break;
+        }
+        heap[index] = heap[child];
+        quote_pool[heap[index]].heap_index = static_cast<uint32_t>(index);
+        index = child;
+    }
+    heap[index] = moving;
+    quote_pool[moving].heap_index = static_cast<uint32_t>(index);
+}
+
+void DeribitBlockRfqBook::fixHeap(std::vector<uint32_t>& heap, size_t index) {
+    if (index > 0 && better(heap[index], heap[(index - 1) / 2])) {
+        siftUp(heap, index);
+    } else {
+        siftDown(heap, index);
+    }
+}
+
+void DeribitBlockRfqBook::fillBest(const RfqSlot& rfq, BlockRfqBest& out) const {
+    out = BlockRfqBest();
+    out.block_rfq_id = rfq.rfq.block_rfq_id;
+    out.expiration_timestamp = rfq.rfq.expiration_timestamp;
+    out.bids = rfq.bids.size();
+    out.asks = rfq.asks.size();
+    if (!rfq.bids.empty()) {
+        const BlockRfqQuote& bid = quote_pool[rfq.bids.front()].quote;
+        out.bid_price = bid.price;
+        out.bid_amount = bid.amount;
+        out.bid_makers = bid.makers;
+    }
+    if (!rfq.asks.empty()) {
+        const BlockRfqQuote& ask = quote_pool[rfq.asks.front()].quote;
+        out.ask_price = ask.price;
+        out.ask_amount = ask.amount;
+        out.ask_makers = ask.makers;
+    }
+}
+
+void DeribitBlockRfqBook::noteBest(uint32_t slot, int64_t received_ns, bool closed) {
+    RfqSlot& rfq = rfq_pool[slot];
+    BlockRfqBest current;
+    fillBest(rfq, current);
+    if (closed) {
+        current = BlockRfqBest();
+        current.block_rfq_id = rfq.rfq.block_rfq_id;
+        current.expiration_timestamp = rfq.rfq.expiration_timestamp;
+        current.closed = true;
+    }
+    const BlockRfqBest& last = rfq.reported;
+    auto same = [](double a, double b) { return a == b || (std::isnan(a) && std::isnan(b)); };
+    if (!closed && same(current.bid_price, last.bid_price) && current.bid_amount == last.bid_amount &&
+        same(current.ask_price, last.ask_price) && current.ask_amount == last.ask_amount) {
+        return;
+    }
+    current.received_ns = received_ns;
+    rfq.reported = current;
+    ++counters.best_changes;
+    if (handler) {
+        reports.push_back(current);
+    }
+}
+
+// Runs the handler outside the lock, so it may query the book or accept a quote
+void DeribitBlockRfqBook::flushReports() {
+    std::vector<BlockRfqBest> ready;
+    BestQuoteHandler current;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (reports.empty()) {
+            return;
+        }
+        ready.swap(reports);
+        current = handler;
+    }
+    for (const auto& best : ready) {
+        current(best);
+    }
+}
+
+bool DeribitBlockRfqBook::best(int64_t block_rfq_id, BlockRfqBest& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = rfq_ids.find(block_rfq_id);
+    if (it == rfq_ids.end()) {
+        return false;
+    }
+    fillBest(rfq_pool[it->second], out);
+    return true;
+}
+
+bool DeribitBlockRfqBook::rfq(int64_t block_rfq_id, BlockRfq& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = rfq_ids.find(block_rfq_id);
+    if (it == rfq_ids.end()) {
+        return false;
+    }
+    out = rfq_pool[it->second].rfq;
+    return true;
+}
+
+size_t DeribitBlockRfqBook::quotes(int64_t block_rfq_id, std::vector<BlockRfqQuote>& out) const {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = rfq_ids.find(block_rfq_id);
+    if (it == rfq_ids.end()) {
+        return 0;
+    }
+    const RfqSlot& rfq = rfq_pool[it->second];
+    for (const std::vector<uint32_t>* heap : { &rfq.bids, &rfq.asks }) {
+        std::vector<uint32_t> ordered(*heap);
+        std::sort(ordered.begin(), ordered.end(), [this](uint32_t a, uint32_t b) { return better(a, b); });
+        for (uint32_t quote : ordered) {
+            out.push_back(quote_pool[quote].quote);
+        }
+    }
+    return out.size();
+}
+
+size_t DeribitBlockRfqBook::rfqs(std::vector<BlockRfq>& out) const {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& slot : rfq_pool) {
+        if (slot.live) {
+            out.push_back(slot.rfq);
+        }
+    }
+    std::sort(out.begin(), out.end(), [](const BlockRfq& a, const BlockRfq& b) {
+        return a.block_rfq_id < b.block_rfq_id;
+    });
+    return out.size();
+}
+
+BlockRfqStats DeribitBlockRfqBook::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    BlockRfqStats out = counters;
+    out.mean_quote_lifetime_ms = counters.quotes_closed > 0 ? lifetime_total_ms / counters.quotes_closed : 0.0;
+    return out;
+}
+
+void DeribitBlockRfqBook::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    rfq_pool.clear();
+    free_rfqs.clear();
+    quote_pool.clear();
+    free_quotes.clear();
+    rfq_ids.clear();
+    quote_ids.clear();
+    counters = BlockRfqStats();
+    lifetime_total_ms = 0.0;
+    reports.clear();
+}
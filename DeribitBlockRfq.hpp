@@ -0,0 +1,195 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DeribitMessageDecoder.hpp"
+
+using json = nlohmann::json;
+
+struct BlockRfqLeg {
+    std::string instrument_name;
+    OrderSide direction = OrderSide::Buy;
+    double ratio = 1.0;
+    double price = std::numeric_limits<double>::quiet_NaN();   // Quoted legs only
+};
+
+// One block RFQ as block_rfq.maker.* or block_rfq.taker.* last described it
+struct BlockRfq {
+    int64_t block_rfq_id = 0;
+    std::string state;                  // open, filled, cancelled or expired
+    std::string role;                   // maker or taker
+    double amount = 0.0;
+    double min_trade_amount = 0.0;
+    int64_t creation_timestamp = 0;     // ms since the epoch
+    int64_t expiration_timestamp = 0;
+    std::string combo_id;
+    std::string label;
+    bool disclosed = false;
+    std::vector<BlockRfqLeg> legs;
+};
+
+/**
+ * @brief One quote on a block RFQ
+ *
+ * Makers see their own quotes (block_rfq.maker.quotes.*) with ids; the taker
+ * sees bids and asks per maker (block_rfq.taker.*) without them.
+ */
+struct BlockRfqQuote {
+    int64_t block_rfq_quote_id = 0;     // 0 in the taker's view
+    int64_t block_rfq_id = 0;
+    OrderSide direction = OrderSide::Buy;   // Buy is a bid
+    double price = std::numeric_limits<double>::quiet_NaN();
+    double amount = 0.0;
+    double filled_amount = 0.0;
+    std::string state;                  // open, filled, cancelled or expired
+    std::string makers;                 // Comma-separated; taker's view only
+    std::string execution_instruction;  // all_or_none or any_part_of
+    std::string label;
+    int64_t creation_timestamp = 0;     // First seen, when the view has no creation time
+    int64_t last_update_timestamp = 0;
+    bool replaced = false;
+    std::vector<BlockRfqLeg> legs;
+};
+
+// Best bid and ask across every maker quoting one RFQ
+struct BlockRfqBest {
+    int64_t block_rfq_id = 0;
+    double bid_price = std::numeric_limits<double>::quiet_NaN();
+    double bid_amount = 0.0;
+    std::string bid_makers;
+    double ask_price = std::numeric_limits<double>::quiet_NaN();
+    double ask_amount = 0.0;
+    std::string ask_makers;
+    size_t bids = 0;
+    size_t asks = 0;
+    int64_t expiration_timestamp = 0;
+    bool closed = false;                // The RFQ ended; this is its last report
+    int64_t received_ns = 0;            // EventRecord::now() receive time of the update behind it
+};
+
+struct BlockRfqStats {
+    size_t rfqs = 0;                    // Open RFQs
+    size_t quotes = 0;                  // Live quotes across them
+    uint64_t updates = 0;               // Notifications applied
+    uint64_t best_changes = 0;
+    uint64_t quotes_closed = 0;         // Filled, cancelled, replaced or expired
+    uint64_t quotes_expired = 0;        // Of those, removed because their RFQ expired
+    double mean_quote_lifetime_ms = 0.0;
+};
+
+/**
+ * @class DeribitBlockRfqBook
+ * @brief Open block RFQs and the live quotes on each, with the best bid and
+ *        ask across makers
+ *
+ * block_rfq.* notifications are decoded into BlockRfq and BlockRfqQuote
+ * structs held in pools of slots that are recycled through free lists, so
+ * a steady stream of RFQs reuses the same strings and vectors. Each RFQ
+ * keeps its bids and asks in two indexed binary heaps (best price first,
+ * then oldest update), so adding, repricing or removing a quote costs
+ * O(log n) and the best quote is always at the top. Maker quotes are keyed
+ * by block_rfq_quote_id; the taker's bids and asks by side, makers and
+ * execution instruction, and each taker notification replaces the RFQ's
+ * whole quote set.
+ *
+ * Whenever the best bid or ask of an RFQ changes, the BestQuoteHandler runs
+ * on the io thread straight after the notification is applied, outside the
+ * lock, so it may query the book and send DeribitAuth::acceptBlockRfq()
+ * from there. RFQs that close or pass their expiration_timestamp (see
+ * expire()) are dropped with their quotes, and the time each quote lived
+ * is averaged into stats().
+ */
+class DeribitBlockRfqBook {
+public:
+    typedef std::function<void(const BlockRfqBest& best)> BestQuoteHandler;
+
+    DeribitBlockRfqBook();
+
+    // Set before subscribing; runs on the io thread
+    void setBestQuoteHandler(BestQuoteHandler handler);
+
+    // Update side (io thread); received_ns is stamped on the BlockRfqBest reports
+    void onMakerRfq(const json& data, int64_t received_ns);       // block_rfq.maker.{currency}
+    void onMakerQuotes(const json& data, int64_t received_ns);    // block_rfq.maker.quotes.{currency}
+    void onTakerRfq(const json& data, int64_t received_ns);       // block_rfq.taker.{currency}
+
+    // Drops RFQs whose expiration_timestamp is at or before now_ms; returns how many
+    size_t expire(int64_t now_ms);
+
+    // Query side (any thread)
+    bool best(int64_t block_rfq_id, BlockRfqBest& out) const;
+    bool rfq(int64_t block_rfq_id, BlockRfq& out) const;
+    // Bids best first, then asks best first
+    size_t quotes(int64_t block_rfq_id, std::vector<BlockRfqQuote>& out) const;
+    size_t rfqs(std::vector<BlockRfq>& out) const;
+    BlockRfqStats stats() const;
+    void clear();
+
+    // Decoders; false if data is not an object with the ids
+    static bool decodeRfq(const json& data, BlockRfq& out);
+    static bool decodeQuote(const json& data, BlockRfqQuote& out);
+
+private:
+    static constexpr uint32_t NO_SLOT = 0xffffffff;
+
+    struct QuoteSlot {
+        BlockRfqQuote quote;
+        std::string key;
+        uint32_t rfq = NO_SLOT;
+        uint32_t heap_index = 0;
+        uint64_t generation = 0;        // Taker snapshot that last listed it
+    };
+
+    struct RfqSlot {
+        BlockRfq rfq;
+        bool live = false;
+        std::vector<uint32_t> bids;     // Heaps of quote slots
+        std::vector<uint32_t> asks;
+        std::unordered_map<std::string, uint32_t> quote_keys;
+        uint64_t generation = 0;
+        BlockRfqBest reported;          // Last best handed to the handler
+    };
+
+    uint32_t rfqSlot(int64_t block_rfq_id, bool create);
+    void releaseRfq(uint32_t slot, int64_t now_ms, bool expired);
+    uint32_t upsertQuote(uint32_t rfq_slot, const std::string& key, const BlockRfqQuote& quote);
+    void removeQuote(uint32_t quote_slot, int64_t now_ms, bool expired);
+
+    std::vector<uint32_t>& heapOf(RfqSlot& rfq, OrderSide side);
+    bool better(uint32_t a, uint32_t b) const;
+    void siftUp(std::vector<uint32_t>& heap, size_t index);
+    void siftDown(std::vector<uint32_t>& heap, size_t index);
+    void fixHeap(std::vector<uint32_t>& heap, size_t index);
+    void eraseFromHeap(std::vector<uint32_t>& heap, uint32_t quote_slot);
+
+    void fillBest(const RfqSlot& rfq, BlockRfqBest& out) const;
+    // Queues a report for the handler if the top of the RFQ moved
+    void noteBest(uint32_t rfq_slot, int64_t received_ns, bool closed);
+    void flushReports();
+
+    std::vector<RfqSlot> rfq_pool;
+    std::vector<uint32_t> free_rfqs;
+    std::vector<QuoteSlot> quote_pool;
+    std::vector<uint32_t> free_quotes;
+    std::unordered_map<int64_t, uint32_t> rfq_ids;
+    std::unordered_map<int64_t, uint32_t> quote_ids;    // Maker quotes by block_rfq_quote_id
+
+    BlockRfqStats counters;
+    double lifetime_total_ms;
+
+    // Scratch space for one notification
+    BlockRfq scratch_rfq;
+    BlockRfqQuote scratch_quote;
+    std::vector<uint32_t> stale;
+    std::vector<BlockRfqBest> reports;
+
+    BestQuoteHandler handler;
+    mutable std::mutex mutex;
+};
@@ -0,0 +1,66 @@
+#include "DeribitChannelRegistry.hpp"
+
+namespace {
+
+struct ChannelPrefix {
+    std::string_view prefix;
+    ChannelKind kind;
+};
+
+// Longer prefixes first where one is a prefix of another
+const ChannelPrefix CHANNEL_PREFIXES[] = {
+    { "book.", ChannelKind::Book },
+    { "trades.", ChannelKind::Trades },
+    { "ticker.", ChannelKind::Ticker },
+    { "user.orders.", ChannelKind::UserOrders },
+    { "user.trades.", ChannelKind::UserTrades },
+    { "block_rfq.maker.quotes.", ChannelKind::BlockRfqMakerQuotes },
+    { "block_rfq.maker.", ChannelKind::BlockRfqMaker },
+    { "block_rfq.taker.", ChannelKind::BlockRfqTaker },
+    { "instrument.state.", ChannelKind::InstrumentState },
+    { "deribit_price_index.", ChannelKind::PriceIndex },
+};
+
+}  // namespace
+
+DeribitChannelRegistry::DeribitChannelRegistry() : last_hit(INVALID_CHANNEL) {}
+
+ChannelKind DeribitChannelRegistry::classify(std::string_view name) {
+    if (name == "announcements") {
+        return ChannelKind::Announcements;
+    }
+    for (const auto& entry : CHANNEL_PREFIXES) {
+        if (name.compare(0, entry.prefix.size(), entry.prefix) == 0) {
+            return entry.kind;
+        }
+    }
+    return ChannelKind::Unknown;
+}
+
+ChannelId DeribitChannelRegistry::find(std::string_view name) const {
+    return names.find(name);
+}
+
+ChannelId DeribitChannelRegistry::intern(std::string_view name) {
+    if (last_hit != INVALID_CHANNEL && names.key(last_hit) == name) {
+        return last_hit;
+    }
+
+    ChannelId id = names.intern(name);
+    if (id == kinds.size()) {
+        kinds.push_back(classify(name));
+        subscribed.push_back(0);
+    }
+    last_hit = id;
+    return id;
+}
+
+std::vector<std::string> DeribitChannelRegistry::subscribedChannels() const {
+    std::vector<std::string> channels;
+    for (ChannelId id = 0; id < names.size(); ++id) {
+        if (subscribed[id] != 0) {
+            channels.push_back(names.key(id));
+        }
+    }
+    return channels;
+}
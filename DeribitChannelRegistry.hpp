@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DeribitKeyIndex.hpp"
+
+typedef uint32_t ChannelId;
+static const ChannelId INVALID_CHANNEL = 0xffffffff;
+
+// What a channel carries, derived once from its name when it is interned
+enum class ChannelKind : uint8_t {
+    Unknown,
+    Announcements,          // announcements
+    Book,                   // book.{instrument_name}...
+    Trades,                 // trades.{instrument_name|kind.currency}.{interval}
+    Ticker,                 // ticker.{instrument_name}.{interval}
+    UserOrders,             // user.orders.{...}
+    UserTrades,             // user.trades.{...}
+    BlockRfqMaker,          // block_rfq.maker.{currency}
+    BlockRfqMakerQuotes,    // block_rfq.maker.quotes.{currency}
+    BlockRfqTaker,          // block_rfq.taker.{currency}
+    InstrumentState,        // instrument.state.{kind}.{currency}
+    PriceIndex              // deribit_price_index.{index_name}
+};
+
+/**
+ * @class DeribitChannelRegistry
+ * @brief Interns subscription channel names into small integer ids
+ *
+ * Each distinct channel name is classified once and assigned a dense id, so
+ * per-channel state can live in plain vectors indexed by ChannelId. Names are
+ * interned through a DeribitKeyIndex, so lookups by string_view never
+ * allocate and a ChannelId is the name's key id. Channels are never removed,
+ * so ids stay valid for the lifetime of the registry.
+ */
+class DeribitChannelRegistry {
+public:
+    DeribitChannelRegistry();
+
+    // Returns the id for name, assigning a new one on first use
+    ChannelId intern(std::string_view name);
+
+    // Returns INVALID_CHANNEL if name has never been interned
+    ChannelId find(std::string_view name) const;
+
+    const std::string& name(ChannelId id) const { return names.key(id); }
+    ChannelKind kind(ChannelId id) const { return kinds[id]; }
+
+    // Tracks whether the server has confirmed a subscription to the channel
+    bool isSubscribed(ChannelId id) const { return subscribed[id] != 0; }
+    void setSubscribed(ChannelId id, bool on) { subscribed[id] = on ? 1 : 0; }
+    std::vector<std::string> subscribedChannels() const;
+
+    size_t size() const { return names.size(); }
+
+    static ChannelKind classify(std::string_view name);
+
+private:
+    static_assert(INVALID_CHANNEL == DeribitKeyIndex::NO_KEY, "ChannelId is a DeribitKeyIndex id");
+
+    DeribitKeyIndex names;
+    std::vector<ChannelKind> kinds;     // By ChannelId
+    std::vector<uint8_t> subscribed;
+    ChannelId last_hit;                 // Consecutive messages usually share a channel
+};
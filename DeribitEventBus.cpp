@@ -0,0 +1,344 @@
+#include "DeribitEventBus.hpp"
+#include "DeribitLogger.hpp"
+#include <algorithm>
+#include <thread>
+
+namespace {
+
+// Polls before a Yield consumer starts giving up its time slice
+const int SPIN_POLLS = 128;
+
+// Upper bound on one Blocking sleep, in case a wakeup is missed
+const std::chrono::milliseconds MAX_SLEEP(1);
+
+// Market data shards publish these as well as the order connection, so a
+// queue that takes them needs a multi-producer ring once a pool is enabled
+bool needsMultipleProducers(const DeribitEventQueue& queue) {
+    return queue.producers() == QueueProducers::Single &&
+           (queue.accepts(EventType::BookUpdate) || queue.accepts(EventType::Trade) ||
+            queue.accepts(EventType::ConnectionState) || queue.accepts(EventType::Ticker));
+}
+
+// FNV-1a over the event type and instrument name
+uint64_t conflationHash(EventType type, std::string_view instrument) {
+    uint64_t hash = 1469598103934665603ULL ^ static_cast<uint8_t>(type);
+    hash *= 1099511628211ULL;
+    for (char c : instrument) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+}  // namespace
+
+DeribitEventQueue::DeribitEventQueue(size_t capacity, QueueProducers producers, WaitStrategy wait,
+                                     uint32_t type_mask)
+    : producer_mode(producers), wait_strategy(wait), type_mask(type_mask), dropped(0),
+      stop_requested(false), consumer_sleeping(false) {
+    if (producers == QueueProducers::Single) {
+        spsc.reset(new DeribitSpscRing<EventRecord>(capacity));
+    } else {
+        mpsc.reset(new DeribitMpscRing<EventRecord>(capacity));
+    }
+}
+
+bool DeribitEventQueue::push(const EventRecord& event) {
+    bool pushed = spsc ? spsc->tryPush(event) : mpsc->tryPush(event);
+    if (!pushed) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (wait_strategy == WaitStrategy::Blocking) {
+        // Orders the ring write before the sleeping check; pairs with the fence in waitForEvent
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (consumer_sleeping.load(std::memory_order_relaxed)) {
+            wakeConsumer();
+        }
+    }
+    return true;
+}
+
+bool DeribitEventQueue::tryPop(EventRecord& out) {
+    return spsc ? spsc->tryPop(out) : mpsc->tryPop(out);
+}
+
+size_t DeribitEventQueue::size() const {
+    return spsc ? spsc->size() : mpsc->size();
+}
+
+bool DeribitEventQueue::pop(EventRecord& out, std::chrono::nanoseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        if (tryPop(out)) {
+            return true;
+        }
+        if (stopped() || !waitForEvent(deadline)) {
+            return tryPop(out);
+        }
+    }
+}
+
+// Returns once an event may be available, or false at the deadline or on stop().
+bool DeribitEventQueue::waitForEvent(std::chrono::steady_clock::time_point deadline) {
+    switch (wait_strategy) {
+        case WaitStrategy::BusySpin:
+            while (size() == 0) {
+                if (stopped() || std::chrono::steady_clock::now() >= deadline) {
+                    return false;
+                }
+                cpuRelax();
+            }
+            return true;
+
+        case WaitStrategy::Yield:
+            for (int polls = 0; size() == 0; ++polls) {
+                if (stopped() || std::chrono::steady_clock::now() >= deadline) {
+                    return false;
+                }
+                if (polls < SPIN_POLLS) {
+                    cpuRelax();
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            return true;
+
+        case WaitStrategy::Blocking: {
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            consumer_sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (size() == 0 && !stopped()) {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= deadline) {
+                    break;
+                }
+                wakeup.wait_until(lock, std::min(deadline, now + MAX_SLEEP));
+            }
+            consumer_sleeping.store(false, std::memory_order_relaxed);
+            return size() != 0;
+        }
+    }
+    return false;
+}
+
+void DeribitEventQueue::wakeConsumer() {
+    // Taking the lock means the consumer is either not yet waiting (and will
+    // see the event when it re-checks) or is waiting and gets the notify
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    wakeup.notify_one();
+}
+
+void DeribitEventQueue::stop() {
+    stop_requested.store(true, std::memory_order_release);
+    wakeConsumer();
+}
+
+DeribitConflatedView::DeribitConflatedView(size_t capacity, uint32_t type_mask)
+    : type_mask(type_mask & CONFLATABLE_EVENTS), key_capacity(capacity), dirty_slots(capacity),
+      keys(0), updates(0), rejected(0), delivered(0), conflated(0), last_lag_ns(0), max_lag_ns(0),
+      stop_requested(false) {
+    // At most half full, so probes stay short
+    size_t size = 2;
+    while (size < capacity * 2) {
+        size <<= 1;
+    }
+    mask = size - 1;
+    slots.reset(new Slot[size]);
+}
+
+uint32_t DeribitConflatedView::slotFor(const EventRecord& event) {
+    std::string_view instrument = event.instrument.view();
+    for (size_t probe = conflationHash(event.type, instrument) & mask;; probe = (probe + 1) & mask) {
+        Slot& slot = slots[probe];
+        uint32_t state = slot.state.load(std::memory_order_acquire);
+        if (state == SLOT_EMPTY) {
+            if (keys.fetch_add(1, std::memory_order_relaxed) >= key_capacity) {
+                keys.fetch_sub(1, std::memory_order_relaxed);
+                return NO_SLOT;
+            }
+            if (slot.state.compare_exchange_strong(state, SLOT_CLAIMING, std::memory_order_acquire)) {
+                slot.type = event.type;
+                slot.key = event.instrument;
+                slot.state.store(SLOT_READY, std::memory_order_release);
+                return static_cast<uint32_t>(probe);
+            }
+            // Another io thread claimed it first; it may be claiming this very key
+            keys.fetch_sub(1, std::memory_order_relaxed);
+        }
+        while (state != SLOT_READY) {
+            cpuRelax();
+            state = slot.state.load(std::memory_order_acquire);
+        }
+        if (slot.type == event.type && slot.key.view() == instrument) {
+            return static_cast<uint32_t>(probe);
+        }
+    }
+}
+
+void DeribitConflatedView::update(const EventRecord& event) {
+    uint32_t index = slotFor(event);
+    if (index == NO_SLOT) {
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Slot& slot = slots[index];
+
+    // An odd sequence doubles as the writer lock, in case two io threads publish one key
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    while ((sequence & 1) != 0 ||
+           !slot.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire)) {
+        cpuRelax();
+        sequence = slot.sequence.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.record = event;
+    slot.writes.store(slot.writes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    updates.fetch_add(1, std::memory_order_relaxed);
+
+    // Only the update that dirties the slot queues it, so the ring never holds a slot twice
+    if (!slot.dirty.exchange(true, std::memory_order_acq_rel)) {
+        dirty_slots.tryPush(index);
+    }
+}
+
+bool DeribitConflatedView::tryPop(EventRecord& out) {
+    uint32_t index;
+    while (dirty_slots.tryPop(index)) {
+        Slot& slot = slots[index];
+        // Cleared before reading, so an update racing with the read queues the slot again
+        slot.dirty.exchange(false, std::memory_order_acq_rel);
+
+        uint64_t writes;
+        while (true) {
+            uint64_t before = slot.sequence.load(std::memory_order_acquire);
+            if ((before & 1) != 0) {
+                cpuRelax();
+                continue;
+            }
+            out = slot.record;
+            writes = slot.writes.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == before) {
+                break;
+            }
+        }
+        if (writes == slot.read_writes) {
+            continue;   // Already read when an earlier entry for the slot was popped
+        }
+        conflated.fetch_add(writes - slot.read_writes - 1, std::memory_order_relaxed);
+        slot.read_writes = writes;
+        delivered.fetch_add(1, std::memory_order_relaxed);
+
+        int64_t lag = EventRecord::now() - out.published_ns;
+        last_lag_ns.store(lag, std::memory_order_relaxed);
+        if (lag > max_lag_ns.load(std::memory_order_relaxed)) {
+            max_lag_ns.store(lag, std::memory_order_relaxed);
+        }
+        return true;
+    }
+    return false;
+}
+
+bool DeribitConflatedView::pop(EventRecord& out, std::chrono::nanoseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (int polls = 0;; ++polls) {
+        if (tryPop(out)) {
+            return true;
+        }
+        if (stopped() || std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        if (polls < SPIN_POLLS) {
+            cpuRelax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void DeribitConflatedView::stop() {
+    stop_requested.store(true, std::memory_order_release);
+}
+
+ConflationStats DeribitConflatedView::stats() const {
+    ConflationStats out;
+    out.updates = updates.load(std::memory_order_relaxed);
+    out.delivered = delivered.load(std::memory_order_relaxed);
+    out.conflated = conflated.load(std::memory_order_relaxed);
+    out.rejected = rejected.load(std::memory_order_relaxed);
+    out.keys = keys.load(std::memory_order_relaxed);
+    out.pending = dirty_slots.size();
+    out.last_lag_ns = last_lag_ns.load(std::memory_order_relaxed);
+    out.max_lag_ns = max_lag_ns.load(std::memory_order_relaxed);
+    return out;
+}
+
+DeribitEventBus::DeribitEventBus() : wanted_mask(0), producer_count(1) {}
+
+bool DeribitEventBus::attach(std::shared_ptr<DeribitEventQueue> queue) {
+    if (!queue) {
+        return false;
+    }
+    if (producer_count > 1 && needsMultipleProducers(*queue)) {
+        LOG_ERROR("Event queue has a single producer but ", producer_count, " io threads publish to it");
+        return false;
+    }
+    for (uint32_t type = 0; type <= static_cast<uint32_t>(EventType::Ticker); ++type) {
+        if (queue->accepts(static_cast<EventType>(type))) {
+            wanted_mask |= eventBit(static_cast<EventType>(type));
+        }
+    }
+    queues.push_back(std::move(queue));
+    return true;
+}
+
+bool DeribitEventBus::attach(std::shared_ptr<DeribitConflatedView> view) {
+    if (!view) {
+        return false;
+    }
+    for (uint32_t type = 0; type <= static_cast<uint32_t>(EventType::Ticker); ++type) {
+        if (view->accepts(static_cast<EventType>(type))) {
+            wanted_mask |= eventBit(static_cast<EventType>(type));
+        }
+    }
+    views.push_back(std::move(view));
+    return true;
+}
+
+bool DeribitEventBus::setProducerCount(size_t count) {
+    if (count > 1) {
+        for (const auto& queue : queues) {
+            if (needsMultipleProducers(*queue)) {
+                LOG_ERROR("An attached event queue has a single producer; ", count,
+                          " io threads would publish to it");
+                return false;
+            }
+        }
+    }
+    producer_count = count;
+    return true;
+}
+
+void DeribitEventBus::publish(EventRecord& event) {
+    event.published_ns = EventRecord::now();
+    for (const auto& queue : queues) {
+        if (queue->accepts(event.type)) {
+            queue->push(event);
+        }
+    }
+    for (const auto& view : views) {
+        if (view->accepts(event.type)) {
+            view->update(event);
+        }
+    }
+}
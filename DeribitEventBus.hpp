@@ -0,0 +1,340 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+#include "DeribitMpscRing.hpp"
+#include "DeribitOrderEncoder.hpp"
+#include "DeribitSpscRing.hpp"
+
+enum class EventType : uint8_t {
+    BookUpdate = 0,                 // Top of book after a book.* update was applied
+    Trade,                          // One public trade from trades.*
+    OrderAck,                       // Response to private/buy, sell, edit or cancel
+    Fill,                           // One of our trades, from an order response or user.trades.*
+    ConnectionState,                // A connection opened, closed or authenticated
+    Ticker                          // One ticker.* update
+};
+
+// Bit masks of EventType for DeribitEventQueue filters
+inline uint32_t eventBit(EventType type) { return 1u << static_cast<uint32_t>(type); }
+static const uint32_t ALL_EVENTS = 0xffffffff;
+
+// Where an event came from
+static const uint8_t ORDER_CONNECTION_SOURCE = 0;                 // The DeribitAuth connection
+inline uint8_t marketDataSource(size_t shard) { return static_cast<uint8_t>(1 + shard); }
+
+// Fixed-capacity string stored inline, so event records can be copied with memcpy.
+// Longer text is truncated.
+template <size_t N>
+struct EventText {
+    char text[N];
+    uint8_t length;
+
+    void assign(std::string_view value) {
+        length = static_cast<uint8_t>(value.size() < N ? value.size() : N);
+        std::memcpy(text, value.data(), length);
+    }
+    std::string_view view() const { return std::string_view(text, length); }
+};
+
+struct BookTopRecord {
+    double best_bid_price;          // NaN when the side is empty
+    double best_bid_amount;
+    double best_ask_price;
+    double best_ask_amount;
+    int64_t change_id;
+    int64_t exchange_timestamp;     // ms since the epoch
+    bool synced;                    // false while the book waits for a resync snapshot
+};
+
+struct TradeRecord {
+    double price;
+    double amount;
+    int64_t trade_seq;
+    int64_t exchange_timestamp;
+    OrderSide direction;
+};
+
+struct OrderAckRecord {
+    EventText<32> order_id;         // Empty if the request failed
+    EventText<32> label;
+    uint64_t request_id;
+    double price;                   // NaN for market orders
+    double amount;
+    double filled_amount;
+    double average_price;
+    int64_t latency_ns;             // Request sent -> response received
+    int32_t error_code;             // JSON-RPC error code when state is Rejected, else 0
+    OrderState state;
+    OrderSide direction;
+};
+
+struct FillRecord {
+    EventText<32> order_id;
+    double price;
+    double amount;
+    int64_t exchange_timestamp;
+    OrderSide direction;
+};
+
+struct ConnectionRecord {
+    bool connected;
+    bool authenticated;
+};
+
+struct TickerRecord {
+    double best_bid_price;          // NaN when not quoted
+    double best_bid_amount;
+    double best_ask_price;
+    double best_ask_amount;
+    double last_price;
+    double mark_price;
+    double index_price;
+    double mark_iv;                 // Options only
+    int64_t exchange_timestamp;
+};
+
+/**
+ * @struct EventRecord
+ * @brief One fixed-size event handed from an io thread to a consumer thread
+ *
+ * Trivially copyable and a whole number of cache lines, so a ring slot holds
+ * exactly one event and publishing is a plain copy. The payload member is
+ * selected by type.
+ */
+struct alignas(64) EventRecord {
+    EventType type;
+    uint8_t source;                 // ORDER_CONNECTION_SOURCE or marketDataSource(shard)
+    int64_t received_ns;            // Steady clock: message taken off the socket
+    int64_t published_ns;           // Steady clock: pushed to the queue
+    EventText<32> instrument;       // Empty for connection events
+    union {
+        BookTopRecord book;
+        TradeRecord trade;
+        OrderAckRecord ack;
+        FillRecord fill;
+        ConnectionRecord connection;
+        TickerRecord ticker;
+    };
+
+    // Nanoseconds on the steady clock; the timebase of received_ns and published_ns
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+static_assert(sizeof(EventRecord) % 64 == 0, "EventRecord must fill whole cache lines");
+
+enum class WaitStrategy : uint8_t {
+    BusySpin,                       // Poll continuously; lowest latency, burns a core
+    Yield,                          // Spin briefly, then yield the CPU between polls
+    Blocking                        // Sleep on a condition variable until an event arrives
+};
+
+enum class QueueProducers : uint8_t {
+    Single,                         // One io thread publishes (lock-free SPSC ring)
+    Multiple                        // Several io threads publish, e.g. market data shards (MPSC ring)
+};
+
+/**
+ * @class DeribitEventQueue
+ * @brief Bounded lock-free queue of EventRecords read by one consumer thread
+ *
+ * Producers never block: when the queue is full the event is dropped and
+ * counted, so a stalled consumer cannot back up the io thread. The consumer
+ * waits with the configured strategy. With WaitStrategy::Blocking, producers
+ * notify only while the consumer is actually asleep, so publishing stays a
+ * ring write plus one load otherwise.
+ */
+class DeribitEventQueue {
+public:
+    /**
+     * @param capacity Slots, rounded up to a power of two
+     * @param producers Single only if exactly one thread ever publishes
+     * @param wait How pop() waits for the next event
+     * @param type_mask eventBit()s of the events this queue receives
+     */
+    DeribitEventQueue(size_t capacity, QueueProducers producers, WaitStrategy wait,
+                      uint32_t type_mask = ALL_EVENTS);
+    DeribitEventQueue(const DeribitEventQueue&) = delete;
+    DeribitEventQueue& operator=(const DeribitEventQueue&) = delete;
+
+    bool accepts(EventType type) const { return (type_mask & eventBit(type)) != 0; }
+    QueueProducers producers() const { return producer_mode; }
+
+    // Producer side; false (and counted as dropped) if the queue is full
+    bool push(const EventRecord& event);
+
+    // Consumer side
+    bool tryPop(EventRecord& out);
+
+    /**
+     * @brief Waits up to timeout for an event using the wait strategy
+     * @return false on timeout or after stop()
+     */
+    bool pop(EventRecord& out, std::chrono::nanoseconds timeout);
+
+    // Wakes a consumer blocked in pop(); later pops return false once empty
+    void stop();
+    bool stopped() const { return stop_requested.load(std::memory_order_acquire); }
+
+    uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+    size_t size() const;
+
+private:
+    bool waitForEvent(std::chrono::steady_clock::time_point deadline);
+    void wakeConsumer();
+
+    QueueProducers producer_mode;
+    WaitStrategy wait_strategy;
+    uint32_t type_mask;
+    std::unique_ptr<DeribitSpscRing<EventRecord>> spsc;
+    std::unique_ptr<DeribitMpscRing<EventRecord>> mpsc;
+
+    std::atomic<uint64_t> dropped;
+    std::atomic<bool> stop_requested;
+    std::atomic<bool> consumer_sleeping;
+    std::mutex sleep_mutex;
+    std::condition_variable wakeup;
+};
+
+// Event types that describe the latest state of an instrument, so only the newest matters
+static const uint32_t CONFLATABLE_EVENTS = (1u << static_cast<uint32_t>(EventType::BookUpdate)) |
+                                           (1u << static_cast<uint32_t>(EventType::Ticker));
+
+struct ConflationStats {
+    uint64_t updates = 0;           // Events written into the table
+    uint64_t delivered = 0;         // Snapshots handed to the consumer
+    uint64_t conflated = 0;         // Intermediate updates overwritten before the consumer read them
+    uint64_t rejected = 0;          // Updates for new keys after the table filled up
+    size_t keys = 0;                // Instruments (per event type) seen
+    size_t pending = 0;             // Keys with an update the consumer has not read
+    int64_t last_lag_ns = 0;        // Published -> read, of the latest snapshot read
+    int64_t max_lag_ns = 0;
+};
+
+/**
+ * @class DeribitConflatedView
+ * @brief Latest book top and ticker per instrument for a consumer that may
+ *        fall behind
+ *
+ * A DeribitEventQueue hands a slow consumer every update in order, so during
+ * a burst it works through ever staler state (or drops events once full).
+ * This view keeps one slot per instrument and event type instead: producers
+ * overwrite the slot under a seqlock and flag it dirty, and the first update
+ * to dirty a slot puts its index on an MPSC ring. The consumer pops dirty
+ * slots and reads their newest record, so its lag is bounded by the number
+ * of instruments rather than the number of updates. Updates it never saw
+ * are counted as conflated; the io threads still apply every delta to the
+ * order books before publishing.
+ *
+ * Only BookUpdate and Ticker events can be conflated. Any number of io
+ * threads may publish; one thread consumes. The table has a fixed number
+ * of keys, and updates for new keys beyond it are rejected and counted.
+ */
+class DeribitConflatedView {
+public:
+    /**
+     * @param capacity Instruments (per event type) the table holds
+     * @param type_mask eventBit()s to keep; limited to CONFLATABLE_EVENTS
+     */
+    explicit DeribitConflatedView(size_t capacity = 4096, uint32_t type_mask = CONFLATABLE_EVENTS);
+    DeribitConflatedView(const DeribitConflatedView&) = delete;
+    DeribitConflatedView& operator=(const DeribitConflatedView&) = delete;
+
+    bool accepts(EventType type) const { return (type_mask & eventBit(type)) != 0; }
+
+    // Producer side; any io thread
+    void update(const EventRecord& event);
+
+    // Consumer side: the newest record of the next instrument that changed
+    bool tryPop(EventRecord& out);
+
+    // Spins, then yields, until a snapshot is ready; false on timeout or after stop()
+    bool pop(EventRecord& out, std::chrono::nanoseconds timeout);
+
+    void stop();
+    bool stopped() const { return stop_requested.load(std::memory_order_acquire); }
+
+    ConflationStats stats() const;
+
+private:
+    enum : uint32_t { SLOT_EMPTY = 0, SLOT_CLAIMING = 1, SLOT_READY = 2 };
+
+    struct alignas(64) Slot {
+        std::atomic<uint32_t> state{SLOT_EMPTY};
+        std::atomic<uint64_t> sequence{0};      // Odd while a producer writes the record
+        std::atomic<uint64_t> writes{0};
+        std::atomic<bool> dirty{false};
+        EventType type = EventType::BookUpdate;
+        EventText<32> key;
+        EventRecord record;
+        uint64_t read_writes = 0;               // Consumer only: writes when last read
+    };
+
+    // Finds or claims the slot of the event's type and instrument; NO_SLOT if full
+    uint32_t slotFor(const EventRecord& event);
+
+    static constexpr uint32_t NO_SLOT = 0xffffffff;
+
+    uint32_t type_mask;
+    size_t key_capacity;
+    size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    DeribitMpscRing<uint32_t> dirty_slots;
+
+    std::atomic<size_t> keys;
+    std::atomic<uint64_t> updates;
+    std::atomic<uint64_t> rejected;
+    std::atomic<uint64_t> delivered;            // Written by the consumer only
+    std::atomic<uint64_t> conflated;
+    std::atomic<int64_t> last_lag_ns;
+    std::atomic<int64_t> max_lag_ns;
+    std::atomic<bool> stop_requested;
+};
+
+/**
+ * @class DeribitEventBus
+ * @brief Fans events published by the io threads out to DeribitEventQueues
+ *
+ * Attach queues before connecting; the list of queues is read without locks
+ * by the io threads. Producers check wants() first so that no record is
+ * built, and nothing extra is decoded, for event types nobody consumes.
+ */
+class DeribitEventBus {
+public:
+    DeribitEventBus();
+
+    /**
+     * @brief Adds a consumer queue
+     * @return false if a Single-producer queue would receive events from
+     *         more than one io thread
+     */
+    bool attach(std::shared_ptr<DeribitEventQueue> queue);
+
+    // Adds a conflating consumer; safe with any number of io threads
+    bool attach(std::shared_ptr<DeribitConflatedView> view);
+
+    // Number of io threads that publish; set when a market data pool is enabled
+    bool setProducerCount(size_t count);
+
+    bool wants(EventType type) const { return (wanted_mask & eventBit(type)) != 0; }
+
+    // Stamps published_ns and pushes to every queue and view that accepts the type
+    void publish(EventRecord& event);
+
+private:
+    std::vector<std::shared_ptr<DeribitEventQueue>> queues;
+    std::vector<std::shared_ptr<DeribitConflatedView>> views;
+    uint32_t wanted_mask;
+    size_t producer_count;
+};
@@ -0,0 +1,163 @@
+#include "DeribitHeartbeat.hpp"
+#include "DeribitLogger.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// A sample further from the estimate than its own error bound plus this means a clock stepped
+const int64_t CLOCK_STEP_US = 1000000;
+
+int64_t wallClockUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+DeribitClockEstimator::DeribitClockEstimator()
+    : next(0), filled(0), offset_us(0), rtt_us(0), min_rtt_us(0), sample_count(0) {}
+
+bool DeribitClockEstimator::addSample(int64_t sent_us, int64_t exchange_in_us, int64_t exchange_out_us,
+                                      int64_t received_us) {
+    Sample sample;
+    sample.rtt_us = (received_us - sent_us) - (exchange_out_us - exchange_in_us);
+    sample.offset_us = ((exchange_in_us - sent_us) + (exchange_out_us - received_us)) / 2;
+    if (sample.rtt_us < 0 || exchange_out_us < exchange_in_us) {
+        return false;
+    }
+
+    bool first = !hasEstimate();
+    if (!first && std::llabs(sample.offset_us - offsetUs()) > sample.rtt_us / 2 + CLOCK_STEP_US) {
+        // Older samples describe the clocks before the step
+        next = filled = 0;
+        first = true;
+    }
+    window[next] = sample;
+    next = (next + 1) % WINDOW;
+    filled = std::min(filled + 1, WINDOW);
+
+    const Sample* best = &window[0];
+    for (size_t i = 1; i < filled; ++i) {
+        if (window[i].rtt_us < best->rtt_us) {
+            best = &window[i];
+        }
+    }
+    // Until the window is full the best sample so far is the estimate
+    int64_t offset = best->offset_us;
+    if (!first && filled == WINDOW) {
+        int64_t error = best->offset_us - offsetUs();
+        offset = offsetUs() + (error / 4 != 0 ? error / 4 : error);
+    }
+
+    offset_us.store(offset, std::memory_order_release);
+    rtt_us.store(sample.rtt_us, std::memory_order_release);
+    min_rtt_us.store(best->rtt_us, std::memory_order_release);
+    sample_count.fetch_add(1, std::memory_order_acq_rel);
+    return true;
+}
+
+DeribitHeartbeat::DeribitHeartbeat(client& ws_client, std::string name)
+    : ws_client(ws_client), name(std::move(name)), running(false), generation(0), last_frame_ns(0),
+      frame_wall_us(0) {}
+
+void DeribitHeartbeat::start(websocketpp::connection_hdl hdl, Sender sender, RttHandler on_rtt) {
+    stop();
+    if (!config.enabled) {
+        return;
+    }
+    connection = hdl;
+    this->sender = std::move(sender);
+    this->on_rtt = std::move(on_rtt);
+    running = true;
+    last_frame_ns.store(steadyNs(), std::memory_order_release);
+
+    this->sender("public/set_heartbeat", {{"interval", std::max(config.server_interval_s, 10)}},
+        [this](const json& response, int64_t) {
+            if (!response.contains("result")) {
+                LOG_WARN(name, ": public/set_heartbeat failed: ", response.dump());
+            }
+        });
+    probe(generation);
+}
+
+void DeribitHeartbeat::stop() {
+    running = false;
+    ++generation;
+}
+
+void DeribitHeartbeat::onHeartbeat(std::string_view payload) {
+    if (!running) {
+        return;
+    }
+    try {
+        json message = json::parse(payload);
+        if (message["params"].value("type", "") == "test_request") {
+            sender("public/test", json::object(), nullptr);
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR(name, ": error parsing heartbeat: ", e.what());
+    }
+}
+
+int64_t DeribitHeartbeat::silenceMs() const {
+    return (steadyNs() - last_frame_ns.load(std::memory_order_acquire)) / 1000000;
+}
+
+void DeribitHeartbeat::schedule(uint64_t scheduled_generation) {
+    ws_client.set_timer(config.probe_interval_ms, [this, scheduled_generation](const websocketpp::lib::error_code& ec) {
+        if (ec || !running || scheduled_generation != generation) {
+            return;
+        }
+        int64_t silent_ms = silenceMs();
+        if (silent_ms >= config.stall_timeout_ms) {
+            closeStalled(silent_ms);
+            return;
+        }
+        probe(scheduled_generation);
+    });
+}
+
+void DeribitHeartbeat::closeStalled(int64_t silent_ms) {
+    LOG_WARN(name, ": nothing received for ", silent_ms, " ms; closing the stalled connection.");
+    stop();
+    websocketpp::lib::error_code ec;
+    auto con = ws_client.get_con_from_hdl(connection, ec);
+    if (ec || !con) {
+        return;
+    }
+    con->set_close_handshake_timeout(STALL_CLOSE_TIMEOUT_MS);
+    ws_client.close(connection, websocketpp::close::status::going_away, "connection stalled", ec);
+    if (ec) {
+        LOG_ERROR(name, ": unable to close the stalled connection: ", ec.message());
+    }
+}
+
+void DeribitHeartbeat::probe(uint64_t probe_generation) {
+    sender("public/test", json::object(), [this](const json& response, int64_t latency_us) {
+        handleProbe(response, latency_us);
+    });
+    schedule(probe_generation);
+}
+
+// Runs on the io thread while the reply's frame is handled, so the arrival
+// time onFrame() recorded is the reply's, taken before decoding and dispatch;
+// less the measured latency it is when the probe went out.
+void DeribitHeartbeat::handleProbe(const json& response, int64_t latency_us) {
+    if (!response.contains("usIn") || !response.contains("usOut") || !response.contains("result")) {
+        return;
+    }
+    int64_t received_us = frame_wall_us != 0 ? frame_wall_us : wallClockUs();
+    if (!estimator.addSample(received_us - latency_us, response["usIn"].get<int64_t>(),
+                             response["usOut"].get<int64_t>(), received_us)) {
+        return;
+    }
+    if (on_rtt) {
+        on_rtt(estimator.rttUs());
+    }
+}
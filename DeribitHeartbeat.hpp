@@ -0,0 +1,161 @@
+#pragma once
+
+#include <websocketpp/client.hpp>
+#include <websocketpp/config/asio_client.hpp>
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include "DeribitRequestTable.hpp"
+
+using json = nlohmann::json;
+
+/**
+ * @struct HeartbeatConfig
+ * @brief Keepalive and stall detection of one connection
+ */
+struct HeartbeatConfig {
+    bool enabled = true;
+    int server_interval_s = 10;         // public/set_heartbeat interval; Deribit's minimum is 10
+    int probe_interval_ms = 1000;       // public/test round trips that measure RTT and clock offset
+    int stall_timeout_ms = 5000;        // A connection silent this long is closed and reconnected
+};
+
+/**
+ * @class DeribitClockEstimator
+ * @brief Offset between the exchange's clock and ours, and the network round
+ *        trip, from timed request/response pairs
+ *
+ * Each sample is a request sent at local time t0, received by the exchange at
+ * usIn, answered at usOut and received back at local time t3 (all in
+ * microseconds since the epoch). As in NTP, the offset is
+ * ((usIn - t0) + (usOut - t3)) / 2 and the round trip, less the time the
+ * exchange spent on the request, is (t3 - t0) - (usOut - usIn). The offset of
+ * a sample is wrong by at most half its round trip, so of the last WINDOW
+ * samples only the one with the smallest round trip counts. Once the window
+ * is full the estimate moves a quarter of the way towards that sample's
+ * offset each time, so no single sample can jump it; a step of the local
+ * clock empties the window and starts over.
+ *
+ * addSample() runs on one thread (the connection's io thread); the estimate
+ * may be read from any thread.
+ */
+class DeribitClockEstimator {
+public:
+    static constexpr size_t WINDOW = 8;
+
+    DeribitClockEstimator();
+
+    // false if the sample is inconsistent (e.g. the local clock stepped) and was ignored
+    bool addSample(int64_t sent_us, int64_t exchange_in_us, int64_t exchange_out_us, int64_t received_us);
+
+    bool hasEstimate() const { return sample_count.load(std::memory_order_acquire) > 0; }
+    uint64_t samples() const { return sample_count.load(std::memory_order_acquire); }
+
+    int64_t offsetUs() const { return offset_us.load(std::memory_order_acquire); }     // Exchange clock minus ours
+    int64_t rttUs() const { return rtt_us.load(std::memory_order_acquire); }           // Latest sample
+    int64_t minRttUs() const { return min_rtt_us.load(std::memory_order_acquire); }    // Best in the window
+    int64_t errorBoundUs() const { return minRttUs() / 2; }
+
+    /**
+     * @brief Microseconds from an exchange timestamp to a local receive time,
+     *        with the clock offset taken out
+     *
+     * Without an estimate yet the raw difference is returned.
+     */
+    int64_t oneWayUs(int64_t exchange_us, int64_t received_us) const {
+        return received_us - exchange_us + offsetUs();
+    }
+
+private:
+    struct Sample {
+        int64_t rtt_us;
+        int64_t offset_us;
+    };
+
+    Sample window[WINDOW];
+    size_t next;
+    size_t filled;
+    std::atomic<int64_t> offset_us;
+    std::atomic<int64_t> rtt_us;
+    std::atomic<int64_t> min_rtt_us;
+    std::atomic<uint64_t> sample_count;
+};
+
+/**
+ * @class DeribitHeartbeat
+ * @brief Keeps one connection alive and notices when it stops delivering
+ *
+ * start() asks the exchange for heartbeats with public/set_heartbeat; its
+ * test_request heartbeats are answered with public/test, as Deribit requires
+ * to keep the connection open. Independently a public/test probe goes out
+ * every probe_interval_ms, and its usIn/usOut feed a DeribitClockEstimator.
+ * Every inbound frame counts as a sign of life; a connection that has been
+ * silent for stall_timeout_ms (several probes unanswered) looks open to the
+ * socket but is not, so it is closed with a short close handshake and the
+ * owner's on_close and reconnect path takes over.
+ *
+ * Everything except the estimate and silenceMs() runs on the connection's
+ * io thread.
+ */
+class DeribitHeartbeat {
+public:
+    typedef websocketpp::client<websocketpp::config::asio_tls_client> client;
+    typedef std::function<bool(const char* method, const json& params, ResponseCallback callback)> Sender;
+    typedef std::function<void(int64_t rtt_us)> RttHandler;
+
+    DeribitHeartbeat(client& ws_client, std::string name);
+
+    void configure(const HeartbeatConfig& config) { this->config = config; }     // Before connecting
+    const HeartbeatConfig& getConfig() const { return config; }
+
+    /**
+     * @brief Starts keepalive on a connection that just opened
+     * @param hdl The connection, closed if it stalls
+     * @param sender Sends a request on that connection
+     * @param on_rtt Called with each probe's round trip; may be empty
+     */
+    void start(websocketpp::connection_hdl hdl, Sender sender, RttHandler on_rtt);
+
+    // On close; timers and probes of the old connection lapse
+    void stop();
+
+    // Every inbound frame, before anything else; received_wall_us stamps a probe reply in that frame
+    void onFrame(std::chrono::steady_clock::time_point received_at, int64_t received_wall_us) {
+        last_frame_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            received_at.time_since_epoch()).count(), std::memory_order_release);
+        frame_wall_us = received_wall_us;
+    }
+
+    // A "heartbeat" notification; answers test_request
+    void onHeartbeat(std::string_view payload);
+
+    // Milliseconds since the last inbound frame
+    int64_t silenceMs() const;
+
+    const DeribitClockEstimator& clock() const { return estimator; }
+
+private:
+    void schedule(uint64_t generation);
+    void probe(uint64_t generation);
+    void handleProbe(const json& response, int64_t latency_us);
+    void closeStalled(int64_t silent_ms);
+
+    static const int STALL_CLOSE_TIMEOUT_MS = 1000;     // The peer will not answer the close frame
+
+    client& ws_client;
+    std::string name;                   // For log lines, e.g. "market data shard 1"
+    HeartbeatConfig config;
+    websocketpp::connection_hdl connection;
+    Sender sender;
+    RttHandler on_rtt;
+    bool running;
+    uint64_t generation;                // Cancels timers of older connections
+    std::atomic<int64_t> last_frame_ns; // Steady clock
+    int64_t frame_wall_us;              // Wall-clock arrival of the frame being handled
+    DeribitClockEstimator estimator;
+};
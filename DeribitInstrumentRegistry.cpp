@@ -0,0 +1,446 @@
+#include "DeribitInstrumentRegistry.hpp"
+#include "DeribitLogger.hpp"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = { 'D', 'R', 'B', 'I', 'N', 'S', 'T', '1' };
+
+// One instrument in a snapshot; strings are (offset, length) into the string table
+struct InstrumentSnapshotRecord {
+    double tick_size;
+    double contract_size;
+    double min_trade_amount;
+    double strike;
+    double maker_commission;
+    double taker_commission;
+    int64_t expiration_timestamp;
+    uint32_t name_offset;
+    uint32_t base_offset;
+    uint32_t quote_offset;
+    uint32_t settlement_offset;
+    uint32_t index_offset;
+    uint32_t listing_offset;
+    uint16_t name_length;
+    uint16_t base_length;
+    uint16_t quote_length;
+    uint16_t settlement_length;
+    uint16_t index_length;
+    uint16_t listing_length;
+    uint8_t kind;
+    uint8_t option_type;
+    uint8_t active;
+    uint8_t reserved[1];
+};
+
+static_assert(sizeof(InstrumentSnapshotRecord) == 96, "Snapshot record layout changed; bump SNAPSHOT_VERSION");
+static_assert(sizeof(InstrumentSnapshotHeader) == 64, "Snapshot header layout changed; bump SNAPSHOT_VERSION");
+
+uint64_t checksum(const char* data, size_t length) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+int64_t wallClockMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+InstrumentKind parseKind(std::string_view kind) {
+    if (kind == "future") return InstrumentKind::Future;
+    if (kind == "option") return InstrumentKind::Option;
+    if (kind == "spot") return InstrumentKind::Spot;
+    if (kind == "future_combo") return InstrumentKind::FutureCombo;
+    if (kind == "option_combo") return InstrumentKind::OptionCombo;
+    return InstrumentKind::Unknown;
+}
+
+std::string textOr(const json& object, const char* key) {
+    auto it = object.find(key);
+    return it != object.end() && it->is_string() ? it->get<std::string>() : std::string();
+}
+
+double numberOr(const json& object, const char* key) {
+    auto it = object.find(key);
+    return it != object.end() && it->is_number() ? it->get<double>() : 0.0;
+}
+
+// True if value is a whole multiple of step, allowing for decimal rounding
+bool isMultiple(double value, double step) {
+    if (step <= 0.0) {
+        return true;
+    }
+    double steps = value / step;
+    return std::fabs(steps - std::round(steps)) < 1e-6;
+}
+
+}  // namespace
+
+DeribitInstrumentRegistry::DeribitInstrumentRegistry() : updated_ms(0) {}
+
+// Caller holds the mutex.
+InstrumentId DeribitInstrumentRegistry::store(const InstrumentInfo& info) {
+    InstrumentId id = names.intern(info.instrument_name);
+    if (id == kind.size()) {
+        base_currency.push_back(0);
+        quote_currency.push_back(0);
+        settlement_currency.push_back(0);
+        price_index.push_back(0);
+        kind.push_back(InstrumentKind::Unknown);
+        option_type.push_back(OptionType::None);
+        tick_size.push_back(0.0);
+        contract_size.push_back(0.0);
+        min_trade_amount.push_back(0.0);
+        strike.push_back(0.0);
+        maker_commission.push_back(0.0);
+        taker_commission.push_back(0.0);
+        expiration_timestamp.push_back(0);
+        active.push_back(0);
+        listing_currency.push_back(DeribitKeyIndex::NO_KEY);
+    }
+    base_currency[id] = strings.intern(info.base_currency);
+    quote_currency[id] = strings.intern(info.quote_currency);
+    settlement_currency[id] = strings.intern(info.settlement_currency);
+    price_index[id] = strings.intern(info.price_index);
+    kind[id] = info.kind;
+    option_type[id] = info.option_type;
+    tick_size[id] = info.tick_size;
+    contract_size[id] = info.contract_size;
+    min_trade_amount[id] = info.min_trade_amount;
+    strike[id] = info.strike;
+    maker_commission[id] = info.maker_commission;
+    taker_commission[id] = info.taker_commission;
+    expiration_timestamp[id] = info.expiration_timestamp;
+    active[id] = info.active ? 1 : 0;
+    if (!info.listing_currency.empty()) {
+        listing_currency[id] = strings.intern(info.listing_currency);
+    }
+    return id;
+}
+
+// Caller holds the mutex. Expiry 0 means the exchange gave none.
+bool DeribitInstrumentRegistry::isLive(InstrumentId id, int64_t now_ms) const {
+    return active[id] != 0 && (expiration_timestamp[id] == 0 || expiration_timestamp[id] > now_ms);
+}
+
+bool DeribitInstrumentRegistry::load(const json& response, const std::string& currency) {
+    if (!response.contains("result") || !response["result"].is_array()) {
+        LOG_WARN("No instruments in response: ", response.dump());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t before = kind.size();
+    std::vector<uint8_t> listed(before, 0);
+    for (const auto& instrument : response["result"]) {
+        InstrumentInfo info;
+        info.instrument_name = textOr(instrument, "instrument_name");
+        if (info.instrument_name.empty()) {
+            continue;
+        }
+        info.base_currency = textOr(instrument, "base_currency");
+        info.quote_currency = textOr(instrument, "quote_currency");
+        info.settlement_currency = textOr(instrument, "settlement_currency");
+        info.price_index = textOr(instrument, "price_index");
+        info.kind = parseKind(textOr(instrument, "kind"));
+        std::string option = textOr(instrument, "option_type");
+        info.option_type = option == "call" ? OptionType::Call : option == "put" ? OptionType::Put : OptionType::None;
+        info.tick_size = numberOr(instrument, "tick_size");
+        info.contract_size = numberOr(instrument, "contract_size");
+        info.min_trade_amount = numberOr(instrument, "min_trade_amount");
+        info.strike = numberOr(instrument, "strike");
+        info.maker_commission = numberOr(instrument, "maker_commission");
+        info.taker_commission = numberOr(instrument, "taker_commission");
+        info.expiration_timestamp = static_cast<int64_t>(numberOr(instrument, "expiration_timestamp"));
+        info.active = instrument.value("is_active", true);
+        info.listing_currency = currency;
+        InstrumentId id = store(info);
+        if (id < listed.size()) {
+            listed[id] = 1;
+        }
+    }
+
+    // Whatever this currency listed before and no longer does has expired or been delisted
+    size_t delisted = 0;
+    uint32_t source = currency.empty() ? DeribitKeyIndex::NO_KEY : strings.find(currency);
+    if (source != DeribitKeyIndex::NO_KEY) {
+        for (InstrumentId id = 0; id < before; ++id) {
+            if (!listed[id] && active[id] && listing_currency[id] == source) {
+                active[id] = 0;
+                ++delisted;
+            }
+        }
+    }
+    updated_ms = wallClockMs();
+    LOG_INFO("Loaded ", response["result"].size(), " instruments (", kind.size() - before, " new, ",
+             delisted, " no longer listed).");
+    return true;
+}
+
+bool DeribitInstrumentRegistry::saveSnapshot(const std::string& path) const {
+    std::string body;
+    InstrumentSnapshotHeader header;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Only live instruments are saved, so expired ones drop out of the next run
+        int64_t now_ms = wallClockMs();
+        std::vector<InstrumentId> live;
+        for (InstrumentId id = 0; id < kind.size(); ++id) {
+            if (isLive(id, now_ms)) {
+                live.push_back(id);
+            }
+        }
+
+        // String table: every saved instrument name, then every currency and index name
+        std::string table;
+        std::vector<uint32_t> name_offsets(names.size());
+        for (InstrumentId id : live) {
+            name_offsets[id] = static_cast<uint32_t>(table.size());
+            table += names.key(id);
+        }
+        std::vector<uint32_t> string_offsets(strings.size());
+        for (uint32_t id = 0; id < strings.size(); ++id) {
+            string_offsets[id] = static_cast<uint32_t>(table.size());
+            table += strings.key(id);
+        }
+
+        body.resize(live.size() * sizeof(InstrumentSnapshotRecord));
+        for (size_t i = 0; i < live.size(); ++i) {
+            InstrumentId id = live[i];
+            InstrumentSnapshotRecord record;
+            std::memset(&record, 0, sizeof(record));
+            record.tick_size = tick_size[id];
+            record.contract_size = contract_size[id];
+            record.min_trade_amount = min_trade_amount[id];
+            record.strike = strike[id];
+            record.maker_commission = maker_commission[id];
+            record.taker_commission = taker_commission[id];
+            record.expiration_timestamp = expiration_timestamp[id];
+            record.name_offset = name_offsets[id];
+            record.name_length = static_cast<uint16_t>(names.key(id).size());
+            record.base_offset = string_offsets[base_currency[id]];
+            record.base_length = static_cast<uint16_t>(strings.key(base_currency[id]).size());
+            record.quote_offset = string_offsets[quote_currency[id]];
+            record.quote_length = static_cast<uint16_t>(strings.key(quote_currency[id]).size());
+            record.settlement_offset = string_offsets[settlement_currency[id]];
+            record.settlement_length = static_cast<uint16_t>(strings.key(settlement_currency[id]).size());
+            record.index_offset = string_offsets[price_index[id]];
+            record.index_length = static_cast<uint16_t>(strings.key(price_index[id]).size());
+            if (listing_currency[id] != DeribitKeyIndex::NO_KEY) {
+                record.listing_offset = string_offsets[listing_currency[id]];
+                record.listing_length = static_cast<uint16_t>(strings.key(listing_currency[id]).size());
+            }
+            record.kind = static_cast<uint8_t>(kind[id]);
+            record.option_type = static_cast<uint8_t>(option_type[id]);
+            record.active = active[id];
+            std::memcpy(&body[i * sizeof(record)], &record, sizeof(record));
+        }
+        body += table;
+
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version = SNAPSHOT_VERSION;
+        header.header_size = sizeof(header);
+        header.record_count = static_cast<uint32_t>(live.size());
+        header.record_size = sizeof(InstrumentSnapshotRecord);
+        header.string_bytes = table.size();
+        header.saved_ms = updated_ms;
+    }
+    header.checksum = checksum(body.data(), body.size());
+
+    // Write a temporary file and rename it over the old one, so a crash
+    // mid-write never leaves a torn snapshot behind
+    std::string temporary = path + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Unable to create instrument snapshot ", temporary, ": ", std::strerror(errno));
+        return false;
+    }
+    bool written = ::write(fd, &header, sizeof(header)) == static_cast<ssize_t>(sizeof(header)) &&
+                   ::write(fd, body.data(), body.size()) == static_cast<ssize_t>(body.size());
+    ::close(fd);
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        LOG_ERROR("Unable to write instrument snapshot ", path, ": ", std::strerror(errno));
+        ::unlink(temporary.c_str());
+        return false;
+    }
+    LOG_INFO("Saved ", header.record_count, " instruments to ", path);
+    return true;
+}
+
+bool DeribitInstrumentRegistry::loadSnapshot(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG_INFO("No instrument snapshot at ", path);
+        return false;
+    }
+    struct stat info;
+    std::string data;
+    if (::fstat(fd, &info) == 0) {
+        data.resize(static_cast<size_t>(info.st_size));
+    }
+    bool read = !data.empty() && ::read(fd, &data[0], data.size()) == static_cast<ssize_t>(data.size());
+    ::close(fd);
+
+    InstrumentSnapshotHeader header;
+    if (!read || data.size() < sizeof(header)) {
+        LOG_WARN("Instrument snapshot ", path, " is truncated");
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+        header.version != SNAPSHOT_VERSION || header.header_size != sizeof(header) ||
+        header.record_size != sizeof(InstrumentSnapshotRecord)) {
+        LOG_WARN("Ignoring instrument snapshot ", path, ": unknown format or version");
+        return false;
+    }
+    size_t records_bytes = static_cast<size_t>(header.record_count) * sizeof(InstrumentSnapshotRecord);
+    if (data.size() != sizeof(header) + records_bytes + header.string_bytes ||
+        checksum(data.data() + sizeof(header), data.size() - sizeof(header)) != header.checksum) {
+        LOG_WARN("Ignoring instrument snapshot ", path, ": checksum mismatch");
+        return false;
+    }
+
+    const char* records = data.data() + sizeof(header);
+    std::string_view table(records + records_bytes, header.string_bytes);
+    auto text = [&table](uint32_t offset, uint16_t length) {
+        return offset + length <= table.size() ? std::string(table.substr(offset, length)) : std::string();
+    };
+
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t now_ms = wallClockMs();
+    size_t expired = 0;
+    for (uint32_t i = 0; i < header.record_count; ++i) {
+        InstrumentSnapshotRecord record;
+        std::memcpy(&record, records + i * sizeof(record), sizeof(record));
+        if (record.expiration_timestamp != 0 && record.expiration_timestamp <= now_ms) {
+            ++expired;
+            continue;
+        }
+        InstrumentInfo instrument;
+        instrument.instrument_name = text(record.name_offset, record.name_length);
+        instrument.base_currency = text(record.base_offset, record.base_length);
+        instrument.quote_currency = text(record.quote_offset, record.quote_length);
+        instrument.settlement_currency = text(record.settlement_offset, record.settlement_length);
+        instrument.price_index = text(record.index_offset, record.index_length);
+        instrument.kind = static_cast<InstrumentKind>(record.kind);
+        instrument.option_type = static_cast<OptionType>(record.option_type);
+        instrument.tick_size = record.tick_size;
+        instrument.contract_size = record.contract_size;
+        instrument.min_trade_amount = record.min_trade_amount;
+        instrument.strike = record.strike;
+        instrument.maker_commission = record.maker_commission;
+        instrument.taker_commission = record.taker_commission;
+        instrument.expiration_timestamp = record.expiration_timestamp;
+        instrument.active = record.active != 0;
+        instrument.listing_currency = text(record.listing_offset, record.listing_length);
+        store(instrument);
+    }
+    updated_ms = header.saved_ms;
+    LOG_INFO("Loaded ", header.record_count - expired, " instruments from ", path, " (saved ",
+             (now_ms - header.saved_ms) / 1000, " s ago, ", expired, " expired since)");
+    return true;
+}
+
+InstrumentId DeribitInstrumentRegistry::find(std::string_view instrument_name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return names.find(instrument_name);
+}
+
+bool DeribitInstrumentRegistry::get(InstrumentId id, InstrumentInfo& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (id >= kind.size()) {
+        return false;
+    }
+    out.instrument_name = names.key(id);
+    out.base_currency = strings.key(base_currency[id]);
+    out.quote_currency = strings.key(quote_currency[id]);
+    out.settlement_currency = strings.key(settlement_currency[id]);
+    out.price_index = strings.key(price_index[id]);
+    out.kind = kind[id];
+    out.option_type = option_type[id];
+    out.tick_size = tick_size[id];
+    out.contract_size = contract_size[id];
+    out.min_trade_amount = min_trade_amount[id];
+    out.strike = strike[id];
+    out.maker_commission = maker_commission[id];
+    out.taker_commission = taker_commission[id];
+    out.expiration_timestamp = expiration_timestamp[id];
+    out.active = isLive(id, wallClockMs());
+    out.listing_currency = listing_currency[id] != DeribitKeyIndex::NO_KEY ? strings.key(listing_currency[id])
+                                                                          : std::string();
+    return true;
+}
+
+bool DeribitInstrumentRegistry::get(std::string_view instrument_name, InstrumentInfo& out) const {
+    return get(find(instrument_name), out);
+}
+
+size_t DeribitInstrumentRegistry::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return kind.size();
+}
+
+int64_t DeribitInstrumentRegistry::updatedMs() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return updated_ms;
+}
+
+bool DeribitInstrumentRegistry::checkOrder(std::string_view instrument_name, double amount, double price,
+                                           std::string& reason, InstrumentId* id_out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    InstrumentId id = names.find(instrument_name);
+    if (id_out != nullptr) {
+        *id_out = id;
+    }
+    if (id == INVALID_INSTRUMENT) {
+        return true;
+    }
+    if (!isLive(id, wallClockMs())) {
+        reason = active[id] ? "instrument has expired" : "instrument is not active";
+        return false;
+    }
+    if (amount < min_trade_amount[id] || !isMultiple(amount, min_trade_amount[id])) {
+        reason = "amount must be a multiple of " + std::to_string(min_trade_amount[id]);
+        return false;
+    }
+    if (!std::isnan(price) && !isMultiple(price, tick_size[id])) {
+        reason = "price must be a multiple of the tick size " + std::to_string(tick_size[id]);
+        return false;
+    }
+    return true;
+}
+
+void DeribitInstrumentRegistry::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    names.clear();
+    strings.clear();
+    base_currency.clear();
+    quote_currency.clear();
+    settlement_currency.clear();
+    price_index.clear();
+    kind.clear();
+    option_type.clear();
+    tick_size.clear();
+    contract_size.clear();
+    min_trade_amount.clear();
+    strike.clear();
+    maker_commission.clear();
+    taker_commission.clear();
+    expiration_timestamp.clear();
+    active.clear();
+    listing_currency.clear();
+    updated_ms = 0;
+}
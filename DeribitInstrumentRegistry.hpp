@@ -0,0 +1,154 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DeribitKeyIndex.hpp"
+
+using json = nlohmann::json;
+
+typedef uint32_t InstrumentId;
+static const InstrumentId INVALID_INSTRUMENT = DeribitKeyIndex::NO_KEY;
+
+enum class InstrumentKind : uint8_t {
+    Unknown = 0,
+    Future,
+    Option,
+    Spot,
+    FutureCombo,
+    OptionCombo
+};
+
+enum class OptionType : uint8_t {
+    None = 0,
+    Call,
+    Put
+};
+
+// Everything the registry knows about one instrument
+struct InstrumentInfo {
+    std::string instrument_name;
+    std::string base_currency;
+    std::string quote_currency;
+    std::string settlement_currency;
+    std::string price_index;            // e.g. btc_usd
+    InstrumentKind kind = InstrumentKind::Unknown;
+    OptionType option_type = OptionType::None;
+    double tick_size = 0.0;
+    double contract_size = 0.0;
+    double min_trade_amount = 0.0;
+    double strike = 0.0;                // Options only
+    double maker_commission = 0.0;
+    double taker_commission = 0.0;
+    int64_t expiration_timestamp = 0;   // ms since the epoch; far future for perpetuals
+    bool active = false;
+    std::string listing_currency;       // Currency of the get_instruments refresh that lists it
+};
+
+// First bytes of a snapshot file; InstrumentSnapshotRecords and then the
+// string table follow
+struct InstrumentSnapshotHeader {
+    char magic[8];                      // "DRBINST1"
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t record_count;
+    uint32_t record_size;
+    uint64_t string_bytes;
+    int64_t saved_ms;                   // Wall clock, ms since the epoch
+    uint64_t checksum;                  // FNV-1a of everything after the header
+    char reserved[16];
+};
+
+/**
+ * @class DeribitInstrumentRegistry
+ * @brief Instrument metadata from public/get_instruments, keyed by dense ids
+ *
+ * Each instrument name is interned once into an InstrumentId, assigned in
+ * order from 0; tick size, contract size, minimum amount and expiry are kept
+ * in parallel arrays indexed by that id, so other components can size their
+ * own per-instrument arrays by size() and index them directly. Ids are never
+ * removed or reused within a run; a refresh updates the instruments it lists
+ * in place and marks inactive those an earlier refresh of the same currency
+ * listed but it no longer does. Expired instruments are treated as inactive.
+ *
+ * saveSnapshot() writes a versioned binary file (fixed-size records plus a
+ * string table, checksummed) of the instruments still active, so the file
+ * and the ids of the next run do not accumulate expired ones; loadSnapshot()
+ * reads it back in one pass, skipping anything that has expired since, so a
+ * warm start has metadata before any request is answered and refreshes it in
+ * the background. A snapshot with another version or a bad checksum is
+ * ignored. Responses are applied on the io thread while other threads query,
+ * so access takes a mutex.
+ */
+class DeribitInstrumentRegistry {
+public:
+    static const uint32_t SNAPSHOT_VERSION = 2;
+
+    DeribitInstrumentRegistry();
+
+    /**
+     * @brief Adds or updates the instruments in a public/get_instruments response
+     * @param currency The request's currency; instruments an earlier refresh of
+     *                 it listed that this response lacks are marked inactive
+     * @return false if the response carries no instrument list
+     */
+    bool load(const json& response, const std::string& currency = std::string());
+
+    bool loadSnapshot(const std::string& path);
+    bool saveSnapshot(const std::string& path) const;
+
+    InstrumentId find(std::string_view instrument_name) const;   // INVALID_INSTRUMENT if unknown
+    bool get(InstrumentId id, InstrumentInfo& out) const;
+    bool get(std::string_view instrument_name, InstrumentInfo& out) const;
+    size_t size() const;
+
+    // Wall-clock time of the data: when the snapshot was saved, or of the last load()
+    int64_t updatedMs() const;
+
+    /**
+     * @brief Checks an order against the instrument's minimum amount and
+     *        tick size
+     *
+     * Unknown instruments pass, since the exchange will judge them. Only the
+     * base tick size is checked; instruments with tick_size_steps may need a
+     * coarser tick at higher prices.
+     * @param price NaN for market orders
+     * @param reason Set when the order is rejected
+     * @param id If given, receives the instrument's id (INVALID_INSTRUMENT if unknown)
+     */
+    bool checkOrder(std::string_view instrument_name, double amount, double price, std::string& reason,
+                    InstrumentId* id = nullptr) const;
+
+    void clear();
+
+private:
+    InstrumentId store(const InstrumentInfo& info);
+    bool isLive(InstrumentId id, int64_t now_ms) const;
+
+    DeribitKeyIndex names;
+    DeribitKeyIndex strings;                // Currencies and index names, stored once
+
+    // Per instrument, indexed by InstrumentId
+    std::vector<uint32_t> base_currency;    // Ids in strings
+    std::vector<uint32_t> quote_currency;
+    std::vector<uint32_t> settlement_currency;
+    std::vector<uint32_t> price_index;
+    std::vector<InstrumentKind> kind;
+    std::vector<OptionType> option_type;
+    std::vector<double> tick_size;
+    std::vector<double> contract_size;
+    std::vector<double> min_trade_amount;
+    std::vector<double> strike;
+    std::vector<double> maker_commission;
+    std::vector<double> taker_commission;
+    std::vector<int64_t> expiration_timestamp;
+    std::vector<uint8_t> active;
+    std::vector<uint32_t> listing_currency; // Ids in strings; NO_KEY if not known
+
+    int64_t updated_ms;
+    mutable std::mutex mutex;
+};
@@ -0,0 +1,269 @@
+#include "DeribitJournal.hpp"
+#include "DeribitLogger.hpp"
+#include "DeribitMessageDecoder.hpp"
+#include "DeribitSubscription.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+const char JOURNAL_MAGIC[8] = { 'D', 'R', 'B', 'J', 'R', 'N', 'L', '1' };
+const uint32_t JOURNAL_VERSION = 1;
+
+size_t padded(size_t length) {
+    return (length + 7) & ~static_cast<size_t>(7);
+}
+
+int64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+DeribitJournalWriter::DeribitJournalWriter()
+    : segment_bytes(DEFAULT_SEGMENT_BYTES), segment_index(0), fd(-1), base(nullptr),
+      offset(0), records(0), dropped(0) {}
+
+DeribitJournalWriter::~DeribitJournalWriter() {
+    close();
+}
+
+std::string DeribitJournalWriter::segmentPath(const std::string& path_prefix, uint64_t index) {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%06llu.journal", static_cast<unsigned long long>(index));
+    return path_prefix + suffix;
+}
+
+bool DeribitJournalWriter::open(const std::string& path_prefix, size_t segment_size) {
+    close();
+    prefix = path_prefix;
+    segment_bytes = std::max(padded(segment_size), padded(sizeof(JournalSegmentHeader)) + 4096);
+
+    // Continue after any segments left by an earlier run
+    uint64_t index = 0;
+    struct stat info;
+    while (::stat(segmentPath(prefix, index).c_str(), &info) == 0) {
+        ++index;
+    }
+    return openSegment(index);
+}
+
+void DeribitJournalWriter::close() {
+    closeSegment();
+}
+
+bool DeribitJournalWriter::openSegment(uint64_t index) {
+    std::string path = segmentPath(prefix, index);
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Unable to create journal segment ", path, ": ", std::strerror(errno));
+        return false;
+    }
+
+    // Reserve the blocks up front so page faults on the mapping never allocate
+    int error = ::posix_fallocate(fd, 0, static_cast<off_t>(segment_bytes));
+    if (error != 0) {
+        LOG_ERROR("Unable to allocate journal segment ", path, ": ", std::strerror(error));
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    void* mapping = ::mmap(nullptr, segment_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("Unable to map journal segment ", path, ": ", std::strerror(errno));
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    ::madvise(mapping, segment_bytes, MADV_SEQUENTIAL);
+
+    base = static_cast<char*>(mapping);
+    segment_index = index;
+
+    JournalSegmentHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    header.version = JOURNAL_VERSION;
+    header.header_size = static_cast<uint32_t>(padded(sizeof(JournalSegmentHeader)));
+    header.segment_index = index;
+    header.created_ns = wallClockNs();
+    std::memcpy(base, &header, sizeof(header));
+    offset = header.header_size;
+
+    LOG_INFO("Journal segment opened: ", path);
+    return true;
+}
+
+// Trims the segment to the bytes actually written so closed segments hold no padding.
+void DeribitJournalWriter::closeSegment() {
+    if (base == nullptr) {
+        return;
+    }
+    ::munmap(base, segment_bytes);
+    base = nullptr;
+    if (::ftruncate(fd, static_cast<off_t>(offset)) != 0) {
+        LOG_WARN("Unable to trim journal segment ", segmentPath(prefix, segment_index), ": ",
+                 std::strerror(errno));
+    }
+    ::close(fd);
+    fd = -1;
+}
+
+bool DeribitJournalWriter::append(JournalRecordType type, int64_t timestamp_ns, std::string_view payload) {
+    size_t needed = sizeof(JournalRecordHeader) + padded(payload.size());
+    if (base == nullptr || payload.empty() ||
+        needed + padded(sizeof(JournalSegmentHeader)) > segment_bytes) {
+        ++dropped;
+        return false;
+    }
+
+    if (offset + needed > segment_bytes) {
+        closeSegment();
+        if (!openSegment(segment_index + 1)) {
+            ++dropped;
+            return false;
+        }
+    }
+
+    JournalRecordHeader header;
+    header.length = static_cast<uint32_t>(payload.size());
+    header.type = static_cast<uint16_t>(type);
+    header.reserved = 0;
+    header.timestamp_ns = timestamp_ns;
+
+    // Payload first: a record interrupted by a crash still reads as the end of the data
+    std::memcpy(base + offset + sizeof(header), payload.data(), payload.size());
+    std::memcpy(base + offset, &header, sizeof(header));
+    offset += needed;
+    ++records;
+    return true;
+}
+
+DeribitJournalReader::DeribitJournalReader()
+    : segment_index(0), base(nullptr), size(0), offset(0) {}
+
+DeribitJournalReader::~DeribitJournalReader() {
+    close();
+}
+
+bool DeribitJournalReader::open(const std::string& path_prefix) {
+    close();
+    prefix = path_prefix;
+    return openSegment(0);
+}
+
+void DeribitJournalReader::close() {
+    closeSegment();
+}
+
+bool DeribitJournalReader::openSegment(uint64_t index) {
+    std::string path = DeribitJournalWriter::segmentPath(prefix, index);
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (index == 0) {
+            LOG_ERROR("Unable to open journal ", path, ": ", std::strerror(errno));
+        }
+        return false;
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(JournalSegmentHeader)) {
+        LOG_ERROR("Journal segment ", path, " is truncated");
+        ::close(fd);
+        return false;
+    }
+
+    size_t length = static_cast<size_t>(info.st_size);
+    void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("Unable to map journal segment ", path, ": ", std::strerror(errno));
+        return false;
+    }
+    ::madvise(mapping, length, MADV_SEQUENTIAL);
+
+    JournalSegmentHeader header;
+    std::memcpy(&header, mapping, sizeof(header));
+    if (std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 ||
+        header.version != JOURNAL_VERSION || header.header_size > length) {
+        LOG_ERROR("Not a journal segment: ", path);
+        ::munmap(mapping, length);
+        return false;
+    }
+
+    base = static_cast<const char*>(mapping);
+    size = length;
+    offset = header.header_size;
+    segment_index = index;
+    return true;
+}
+
+void DeribitJournalReader::closeSegment() {
+    if (base != nullptr) {
+        ::munmap(const_cast<char*>(base), size);
+        base = nullptr;
+    }
+}
+
+bool DeribitJournalReader::next(JournalRecord& out) {
+    while (base != nullptr) {
+        JournalRecordHeader header;
+        if (offset + sizeof(header) <= size) {
+            std::memcpy(&header, base + offset, sizeof(header));
+            if (header.length != 0 && offset + sizeof(header) + header.length <= size) {
+                out.type = static_cast<JournalRecordType>(header.type);
+                out.timestamp_ns = header.timestamp_ns;
+                out.payload = std::string_view(base + offset + sizeof(header), header.length);
+                offset += sizeof(header) + padded(header.length);
+                return true;
+            }
+        }
+
+        // End of this segment's data
+        uint64_t next_index = segment_index + 1;
+        closeSegment();
+        openSegment(next_index);
+    }
+    return false;
+}
+
+size_t DeribitJournalReader::replay(DeribitSubscription& subscriptions, ReplaySpeed speed) {
+    size_t dispatched = 0;
+    JournalRecord record;
+    MessageEnvelope envelope;
+    int64_t first_timestamp_ns = 0;
+    auto started = std::chrono::steady_clock::now();
+
+    while (next(record)) {
+        if (record.type != JournalRecordType::Frame) {
+            continue;
+        }
+
+        if (speed == ReplaySpeed::Recorded) {
+            if (first_timestamp_ns == 0) {
+                first_timestamp_ns = record.timestamp_ns;
+            }
+            std::this_thread::sleep_until(
+                started + std::chrono::nanoseconds(record.timestamp_ns - first_timestamp_ns));
+        }
+
+        if (!DeribitMessageDecoder::decodeEnvelope(record.payload, envelope) ||
+            envelope.method != "subscription") {
+            continue;
+        }
+        subscriptions.handleSubscriptionPayload(record.payload, envelope, std::chrono::steady_clock::now(),
+                                                record.timestamp_ns / 1000);
+        ++dispatched;
+    }
+    return dispatched;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+class DeribitSubscription;
+
+enum class JournalRecordType : uint16_t {
+    Frame = 1                       // Raw inbound WebSocket text frame
+};
+
+// Leading bytes of every record; the payload follows, padded to 8 bytes.
+// A zero length marks the end of the data in a segment.
+struct JournalRecordHeader {
+    uint32_t length;                // Payload bytes
+    uint16_t type;                  // JournalRecordType
+    uint16_t reserved;
+    int64_t timestamp_ns;           // Wall-clock receive time, ns since the epoch
+};
+
+// First bytes of every segment file
+struct JournalSegmentHeader {
+    char magic[8];                  // "DRBJRNL1"
+    uint32_t version;
+    uint32_t header_size;           // Offset of the first record
+    uint64_t segment_index;
+    int64_t created_ns;
+    char reserved[32];
+};
+
+struct JournalRecord {
+    JournalRecordType type;
+    int64_t timestamp_ns;
+    std::string_view payload;       // Points into the mapped segment
+};
+
+/**
+ * @class DeribitJournalWriter
+ * @brief Appends records to a segmented, memory-mapped journal
+ *
+ * A journal is a series of files <prefix>.000000.journal,
+ * <prefix>.000001.journal, ... each preallocated to the segment size and
+ * mapped into memory. Appending is a bounds check and two memcpys into the
+ * mapping, with no system call; the kernel writes the pages back in the
+ * background, so records survive a crash of the process. When a record does
+ * not fit, the segment is trimmed to its used size and the next one is
+ * created. Opening a prefix that already has segments continues after the
+ * last one.
+ *
+ * Not thread-safe: use one writer per thread (the WebSocket thread).
+ */
+class DeribitJournalWriter {
+public:
+    static const size_t DEFAULT_SEGMENT_BYTES = 64 << 20;
+
+    DeribitJournalWriter();
+    ~DeribitJournalWriter();
+    DeribitJournalWriter(const DeribitJournalWriter&) = delete;
+    DeribitJournalWriter& operator=(const DeribitJournalWriter&) = delete;
+
+    bool open(const std::string& path_prefix, size_t segment_bytes = DEFAULT_SEGMENT_BYTES);
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    /**
+     * @brief Appends one record
+     * @return false if the journal is closed, the payload is empty or larger
+     *         than a segment, or a new segment could not be created (counted
+     *         as dropped)
+     */
+    bool append(JournalRecordType type, int64_t timestamp_ns, std::string_view payload);
+
+    uint64_t recordCount() const { return records; }
+    uint64_t droppedCount() const { return dropped; }
+
+    static std::string segmentPath(const std::string& path_prefix, uint64_t index);
+
+private:
+    bool openSegment(uint64_t index);
+    void closeSegment();
+
+    std::string prefix;
+    size_t segment_bytes;
+    uint64_t segment_index;
+    int fd;
+    char* base;                     // Mapping of the current segment
+    size_t offset;                  // Next write position in the segment
+    uint64_t records;
+    uint64_t dropped;
+};
+
+enum class ReplaySpeed : uint8_t {
+    Recorded,                       // Keep the recorded gaps between frames
+    Maximum                         // Dispatch frames back to back
+};
+
+/**
+ * @class DeribitJournalReader
+ * @brief Reads a journal written by DeribitJournalWriter, segment by segment
+ *
+ * Segments are mapped read-only and records are returned as views into the
+ * mapping, so reading copies nothing.
+ */
+class DeribitJournalReader {
+public:
+    DeribitJournalReader();
+    ~DeribitJournalReader();
+    DeribitJournalReader(const DeribitJournalReader&) = delete;
+    DeribitJournalReader& operator=(const DeribitJournalReader&) = delete;
+
+    // Opens the first segment of the journal
+    bool open(const std::string& path_prefix);
+    void close();
+
+    /**
+     * @brief Reads the next record, moving on to the next segment as needed
+     * @return false at the end of the journal
+     * @note out.payload is valid until the following call to next()
+     */
+    bool next(JournalRecord& out);
+
+    /**
+     * @brief Feeds every recorded subscription notification back through
+     *        DeribitSubscription::handleSubscriptionPayload, the same path
+     *        live messages take
+     *
+     * Responses to requests are skipped, since nothing is waiting for them.
+     * Exchange latencies are measured against the recorded receive times.
+     * @return Number of notifications dispatched
+     */
+    size_t replay(DeribitSubscription& subscriptions, ReplaySpeed speed);
+
+private:
+    bool openSegment(uint64_t index);
+    void closeSegment();
+
+    std::string prefix;
+    uint64_t segment_index;
+    const char* base;
+    size_t size;
+    size_t offset;
+};
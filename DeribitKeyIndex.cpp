@@ -0,0 +1,71 @@
+#include "DeribitKeyIndex.hpp"
+
+namespace {
+
+// FNV-1a; keys are short, so this is a handful of multiplies
+uint64_t hashKey(std::string_view key) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : key) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+}  // namespace
+
+DeribitKeyIndex::DeribitKeyIndex() : slots(64, NO_KEY), mask(63) {}
+
+uint32_t DeribitKeyIndex::lookup(std::string_view key, uint64_t hash, size_t& slot) const {
+    size_t i = static_cast<size_t>(hash) & mask;
+    while (slots[i] != NO_KEY) {
+        uint32_t id = slots[i];
+        if (hashes[id] == hash && keys[id] == key) {
+            slot = i;
+            return id;
+        }
+        i = (i + 1) & mask;
+    }
+    slot = i;
+    return NO_KEY;
+}
+
+uint32_t DeribitKeyIndex::find(std::string_view key) const {
+    size_t slot;
+    return lookup(key, hashKey(key), slot);
+}
+
+uint32_t DeribitKeyIndex::intern(std::string_view key) {
+    uint64_t hash = hashKey(key);
+    size_t slot;
+    uint32_t id = lookup(key, hash, slot);
+    if (id == NO_KEY) {
+        id = static_cast<uint32_t>(keys.size());
+        keys.emplace_back(key);
+        hashes.push_back(hash);
+        slots[slot] = id;
+        if (keys.size() * 2 > slots.size()) {
+            grow();
+        }
+    }
+    return id;
+}
+
+void DeribitKeyIndex::grow() {
+    slots.assign(slots.size() * 2, NO_KEY);
+    mask = slots.size() - 1;
+    for (uint32_t id = 0; id < keys.size(); ++id) {
+        size_t i = static_cast<size_t>(hashes[id]) & mask;
+        while (slots[i] != NO_KEY) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = id;
+    }
+}
+
+void DeribitKeyIndex::clear() {
+    keys.clear();
+    hashes.clear();
+    slots.assign(64, NO_KEY);
+    mask = 63;
+}
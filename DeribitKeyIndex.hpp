@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class DeribitKeyIndex
+ * @brief Interns strings (order ids, labels, instruments) into dense ids
+ *
+ * Keys are looked up through an open-addressed hash table (FNV-1a, linear
+ * probing, kept at most half full) that compares the cached hash before the
+ * string; lookups by string_view never allocate. Ids are assigned in order
+ * from 0, so per-key state can live in plain vectors indexed by id.
+ * DeribitChannelRegistry interns channel names through it.
+ */
+class DeribitKeyIndex {
+public:
+    static constexpr uint32_t NO_KEY = 0xffffffff;
+
+    DeribitKeyIndex();
+
+    // Returns the id for key, assigning the next one on first use
+    uint32_t intern(std::string_view key);
+
+    // Returns NO_KEY if key has never been interned
+    uint32_t find(std::string_view key) const;
+
+    const std::string& key(uint32_t id) const { return keys[id]; }
+    size_t size() const { return keys.size(); }
+    void clear();
+
+private:
+    uint32_t lookup(std::string_view key, uint64_t hash, size_t& slot) const;
+    void grow();
+
+    std::vector<std::string> keys;
+    std::vector<uint64_t> hashes;
+    std::vector<uint32_t> slots;            // NO_KEY marks an empty slot
+    size_t mask;
+};
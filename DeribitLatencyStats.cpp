@@ -0,0 +1,190 @@
+#include "DeribitLatencyStats.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+LatencyHistogram::LatencyHistogram()
+    : buckets(new std::atomic<uint64_t>[BUCKET_COUNT]),
+      total_count(0), total_sum(0), max_value(0) {
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+// Values below LINEAR_BUCKETS map to themselves. Above that, the position of
+// the highest set bit selects a group of 32 buckets and the next five bits
+// select the bucket within it.
+int LatencyHistogram::bucketFor(uint64_t value) {
+    if (value < static_cast<uint64_t>(LINEAR_BUCKETS)) {
+        return static_cast<int>(value);
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    int sub_bucket = static_cast<int>(value >> (exponent - SUB_BUCKET_BITS)) & ((1 << SUB_BUCKET_BITS) - 1);
+    return LINEAR_BUCKETS + (exponent - SUB_BUCKET_BITS - 1) * (1 << SUB_BUCKET_BITS) + sub_bucket;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int bucket) {
+    if (bucket < LINEAR_BUCKETS) {
+        return static_cast<uint64_t>(bucket);
+    }
+    int group = (bucket - LINEAR_BUCKETS) >> SUB_BUCKET_BITS;
+    int sub_bucket = (bucket - LINEAR_BUCKETS) & ((1 << SUB_BUCKET_BITS) - 1);
+    int shift = group + 1;
+    uint64_t lower = static_cast<uint64_t>((1 << SUB_BUCKET_BITS) + sub_bucket) << shift;
+    return lower + (static_cast<uint64_t>(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(int64_t value_ns) {
+    uint64_t value = value_ns > 0 ? static_cast<uint64_t>(value_ns) : 0;
+    buckets[bucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+    total_count.fetch_add(1, std::memory_order_relaxed);
+    total_sum.fetch_add(value, std::memory_order_relaxed);
+
+    int64_t current = max_value.load(std::memory_order_relaxed);
+    while (static_cast<int64_t>(value) > current &&
+           !max_value.compare_exchange_weak(current, static_cast<int64_t>(value),
+                                            std::memory_order_relaxed)) {
+    }
+}
+
+double LatencyHistogram::mean() const {
+    uint64_t n = count();
+    return n == 0 ? 0.0 : static_cast<double>(total_sum.load(std::memory_order_relaxed)) / n;
+}
+
+int64_t LatencyHistogram::percentile(double quantile) const {
+    uint64_t n = count();
+    if (n == 0) {
+        return 0;
+    }
+
+    // Rank of the sample we are after, 1-based
+    uint64_t rank = static_cast<uint64_t>(quantile * n + 0.5);
+    rank = std::max<uint64_t>(1, std::min(rank, n));
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(static_cast<int64_t>(bucketUpperBound(i)), max());
+        }
+    }
+    return max();
+}
+
+void LatencyHistogram::reset() {
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+    total_count.store(0, std::memory_order_relaxed);
+    total_sum.store(0, std::memory_order_relaxed);
+    max_value.store(0, std::memory_order_relaxed);
+}
+
+// Constructor: round the capacity up to a power of two for masking.
+DeribitLatencyStats::DeribitLatencyStats(size_t capacity) {
+    size_t size = 16;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    series.reset(new Series[size]);
+    for (size_t i = 0; i < size; ++i) {
+        series[i].state.store(Empty, std::memory_order_relaxed);
+    }
+    mask = size - 1;
+}
+
+uint64_t DeribitLatencyStats::hashKey(LatencyKind kind, std::string_view name) {
+    uint64_t hash = 14695981039346656037ull ^ static_cast<uint8_t>(kind);
+    for (char c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+LatencyHistogram* DeribitLatencyStats::histogram(LatencyKind kind, std::string_view name) {
+    name = name.substr(0, MAX_NAME);
+    uint64_t hash = hashKey(kind, name);
+
+    size_t i = static_cast<size_t>(hash) & mask;
+    for (size_t probes = 0; probes <= mask; ++probes, i = (i + 1) & mask) {
+        Series& slot = series[i];
+        uint8_t state = slot.state.load(std::memory_order_acquire);
+
+        if (state == Empty) {
+            uint8_t expected = Empty;
+            if (slot.state.compare_exchange_strong(expected, Claimed, std::memory_order_acq_rel)) {
+                slot.hash = hash;
+                slot.kind = kind;
+                slot.name_length = static_cast<uint8_t>(name.size());
+                std::memcpy(slot.name, name.data(), name.size());
+                slot.histogram.reset(new LatencyHistogram());
+                slot.state.store(Ready, std::memory_order_release);
+                return slot.histogram.get();
+            }
+            state = expected;
+        }
+
+        // Another thread is filling this slot in; it may be the series we want
+        while (state == Claimed) {
+            std::this_thread::yield();
+            state = slot.state.load(std::memory_order_acquire);
+        }
+
+        if (slot.hash == hash && slot.kind == kind &&
+            std::string_view(slot.name, slot.name_length) == name) {
+            return slot.histogram.get();
+        }
+    }
+    return nullptr;
+}
+
+std::string DeribitLatencyStats::report() const {
+    static const char* const KIND_NAMES[] = { "send->ack", "exchange->recv", "recv->handled", "drop->feed", "queued->sent",
+                                              "network rtt" };
+
+    std::vector<const Series*> ready;
+    for (size_t i = 0; i <= mask; ++i) {
+        if (series[i].state.load(std::memory_order_acquire) == Ready && series[i].histogram->count() > 0) {
+            ready.push_back(&series[i]);
+        }
+    }
+    std::sort(ready.begin(), ready.end(), [](const Series* a, const Series* b) {
+        if (a->kind != b->kind) {
+            return a->kind < b->kind;
+        }
+        return std::string_view(a->name, a->name_length) < std::string_view(b->name, b->name_length);
+    });
+
+    std::string out = "=== Latency (microseconds) ===\n";
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-15s %-36s %8s %9s %9s %9s %9s %9s %9s\n",
+                  "measure", "series", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+    out += line;
+
+    for (const Series* s : ready) {
+        const LatencyHistogram& h = *s->histogram;
+        std::snprintf(line, sizeof(line), "%-15s %-36.*s %8llu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+                      KIND_NAMES[static_cast<int>(s->kind)], static_cast<int>(s->name_length), s->name,
+                      static_cast<unsigned long long>(h.count()), h.mean() / 1000.0,
+                      h.percentile(0.50) / 1000.0, h.percentile(0.90) / 1000.0,
+                      h.percentile(0.99) / 1000.0, h.percentile(0.999) / 1000.0, h.max() / 1000.0);
+        out += line;
+    }
+    if (ready.empty()) {
+        out += "No samples recorded.\n";
+    }
+    out += "==============================";
+    return out;
+}
+
+void DeribitLatencyStats::reset() {
+    for (size_t i = 0; i <= mask; ++i) {
+        if (series[i].state.load(std::memory_order_acquire) == Ready) {
+            series[i].histogram->reset();
+        }
+    }
+}
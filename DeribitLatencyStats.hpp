@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * @class LatencyHistogram
+ * @brief Fixed-size log-linear histogram of latencies in nanoseconds
+ *
+ * Values below 64 ns get a bucket each; above that every power of two is
+ * split into 32 sub-buckets, so any recorded value is reported within ~3% of
+ * its true value (the HDR histogram layout with two significant bits of
+ * precision). Recording is a relaxed atomic increment, so any thread may
+ * record without locks while another reads percentiles.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    // Negative values (e.g. from clock skew) are recorded as 0
+    void record(int64_t value_ns);
+
+    uint64_t count() const { return total_count.load(std::memory_order_relaxed); }
+    int64_t max() const { return max_value.load(std::memory_order_relaxed); }
+    double mean() const;
+
+    /**
+     * @brief Value at or below which the given fraction of samples fall
+     * @param quantile 0.0 - 1.0, e.g. 0.99
+     * @return Upper edge of the bucket holding that sample (at most max()), or 0 if empty
+     */
+    int64_t percentile(double quantile) const;
+
+    // Not synchronized with concurrent record() calls; samples may be lost
+    void reset();
+
+    static const int SUB_BUCKET_BITS = 5;
+    static const int LINEAR_BUCKETS = 1 << (SUB_BUCKET_BITS + 1);
+    static const int BUCKET_COUNT = LINEAR_BUCKETS + (63 - SUB_BUCKET_BITS) * (1 << SUB_BUCKET_BITS);
+
+    static int bucketFor(uint64_t value);
+    static uint64_t bucketUpperBound(int bucket);
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+    std::atomic<uint64_t> total_count;
+    std::atomic<uint64_t> total_sum;
+    std::atomic<int64_t> max_value;
+};
+
+// What a latency series measures
+enum class LatencyKind : uint8_t {
+    RequestAck,             // Request sent -> response received, per JSON-RPC method
+    ExchangeToReceive,      // Exchange timestamp -> message received, per channel
+    ReceiveToHandled,       // Message received -> handler finished, per channel
+    Recovery,               // Connection dropped -> feed restored, per connection
+    QueueDelay,             // Request queued for rate limit credits -> sent, per JSON-RPC method
+    NetworkRtt              // Heartbeat probe round trip less exchange time, per connection
+};
+
+/**
+ * @class DeribitLatencyStats
+ * @brief Named latency histograms for JSON-RPC methods and subscription channels
+ *
+ * Series are keyed by kind and name and live in a fixed-capacity, open-addressed
+ * table. Lookup and creation are lock-free (a slot is claimed with a CAS and
+ * published once its histogram exists), so hot paths can record directly, or
+ * resolve a series once and keep the LatencyHistogram pointer, which stays
+ * valid for the lifetime of the stats object.
+ */
+class DeribitLatencyStats {
+public:
+    explicit DeribitLatencyStats(size_t capacity = 256);
+
+    /**
+     * @brief Finds or creates the histogram for a series
+     * @return nullptr if the table is full
+     */
+    LatencyHistogram* histogram(LatencyKind kind, std::string_view name);
+
+    void record(LatencyKind kind, std::string_view name, int64_t value_ns) {
+        LatencyHistogram* h = histogram(kind, name);
+        if (h != nullptr) {
+            h->record(value_ns);
+        }
+    }
+
+    /**
+     * @brief Formats count, mean, p50/p90/p99/p99.9 and max (in microseconds)
+     *        for every series that has samples
+     */
+    std::string report() const;
+
+    void reset();
+
+    // Longer names are truncated
+    static const size_t MAX_NAME = 80;
+
+private:
+    enum SlotState : uint8_t { Empty, Claimed, Ready };
+
+    struct Series {
+        std::atomic<uint8_t> state;
+        uint64_t hash;
+        LatencyKind kind;
+        uint8_t name_length;
+        char name[MAX_NAME];
+        std::unique_ptr<LatencyHistogram> histogram;
+    };
+
+    static uint64_t hashKey(LatencyKind kind, std::string_view name);
+
+    std::unique_ptr<Series[]> series;
+    size_t mask;
+};
@@ -0,0 +1,276 @@
+#include "DeribitLogger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+
+std::atomic<uint8_t> DeribitLogger::threshold(static_cast<uint8_t>(LogLevel::Info));
+
+std::ostream& operator<<(std::ostream& out, const LogFixed& fixed) {
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(fixed.precision) << fixed.value;
+    out.flags(flags);
+    out.precision(precision);
+    return out;
+}
+
+namespace {
+
+// Idle backoff of the logging thread once all rings are empty
+const auto IDLE_SLEEP = std::chrono::microseconds(500);
+
+struct FormattedRecord {
+    uint64_t timestamp_ns;
+    LogLevel level;
+    size_t begin;                   // Span of the formatted text in the batch buffer
+    size_t end;
+};
+
+}  // namespace
+
+// The logger is never destroyed: the WebSocket thread may still be logging while
+// static objects are torn down. Queued records are written out at exit instead.
+DeribitLogger& DeribitLogger::instance() {
+    static DeribitLogger* logger = []() {
+        DeribitLogger* created = new DeribitLogger();
+        std::atexit([]() { instance().shutdown(); });
+        return created;
+    }();
+    return *logger;
+}
+
+DeribitLogger::DeribitLogger()
+    : producers_version(0), running(true), total_dropped(0) {
+    if (const char* level = std::getenv("DERIBIT_LOG_LEVEL")) {
+        setLevel(parseLevel(level, LogLevel::Info));
+    }
+    worker = std::thread([this]() { run(); });
+}
+
+DeribitLogger::~DeribitLogger() {
+    shutdown();
+}
+
+void DeribitLogger::shutdown() {
+    std::lock_guard<std::mutex> lock(shutdown_mutex);
+    running.store(false, std::memory_order_release);
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+LogLevel DeribitLogger::parseLevel(std::string_view name, LogLevel fallback) {
+    if (name == "debug") return LogLevel::Debug;
+    if (name == "info") return LogLevel::Info;
+    if (name == "warn") return LogLevel::Warn;
+    if (name == "error") return LogLevel::Error;
+    if (name == "off") return LogLevel::Off;
+    return fallback;
+}
+
+uint64_t DeribitLogger::nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+logdetail::Staging& DeribitLogger::localStaging() {
+    static thread_local logdetail::Staging staging = []() {
+        logdetail::Staging buffer;
+        buffer.reserve(4096);
+        return buffer;
+    }();
+    return staging;
+}
+
+DeribitLogger::ProducerHandle::ProducerHandle(DeribitLogger& logger)
+    : producer(std::make_shared<Producer>()) {
+    std::lock_guard<std::mutex> lock(logger.producers_mutex);
+    logger.producers.push_back(producer);
+    logger.producers_version.fetch_add(1, std::memory_order_release);
+}
+
+DeribitLogger::ProducerHandle::~ProducerHandle() {
+    // The logging thread drains what is left and then releases the ring
+    producer->retired.store(true, std::memory_order_release);
+}
+
+DeribitLogger::Producer& DeribitLogger::localProducer() {
+    static thread_local ProducerHandle handle(*this);
+    return *handle.producer;
+}
+
+// Splits an encoded record into chunks and commits them in one step.
+void DeribitLogger::publish(const logdetail::Staging& staging) {
+    Producer& producer = localProducer();
+    size_t chunks = (staging.size() + logdetail::LogChunk::BYTES - 1) / logdetail::LogChunk::BYTES;
+
+    if (chunks > producer.ring.capacity() || !producer.ring.canWrite(chunks)) {
+        producer.dropped.store(producer.dropped.load(std::memory_order_relaxed) + 1,
+                               std::memory_order_relaxed);
+        return;
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < chunks; ++i) {
+        logdetail::LogChunk& chunk = producer.ring.writeSlot(i);
+        size_t size = std::min(logdetail::LogChunk::BYTES, staging.size() - offset);
+        std::memcpy(chunk.bytes, staging.data() + offset, size);
+        chunk.size = static_cast<uint32_t>(size);
+        chunk.remaining = static_cast<uint32_t>(chunks - 1 - i);
+        offset += size;
+    }
+    producer.ring.commitWrite(chunks);
+}
+
+void DeribitLogger::flush() {
+    // Rings are only released by the logging thread after they have been written
+    // out, so an empty ring means everything it held has reached the stream.
+    for (;;) {
+        bool pending = false;
+        {
+            std::lock_guard<std::mutex> lock(producers_mutex);
+            for (const auto& producer : producers) {
+                if (!producer->ring.empty()) {
+                    pending = true;
+                    break;
+                }
+            }
+        }
+        if (!pending || !running.load(std::memory_order_acquire)) {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+void DeribitLogger::run() {
+    std::vector<std::shared_ptr<Producer>> snapshot;
+    uint64_t seen_version = ~0ull;
+
+    for (;;) {
+        bool stopping = !running.load(std::memory_order_acquire);
+
+        uint64_t version = producers_version.load(std::memory_order_acquire);
+        if (version != seen_version) {
+            std::lock_guard<std::mutex> lock(producers_mutex);
+            snapshot = producers;
+            seen_version = version;
+        }
+
+        bool wrote = drain(snapshot);
+
+        // Release rings of threads that have exited once they are empty
+        bool released = false;
+        {
+            std::lock_guard<std::mutex> lock(producers_mutex);
+            auto retired = [](const std::shared_ptr<Producer>& producer) {
+                return producer->retired.load(std::memory_order_acquire) && producer->ring.empty();
+            };
+            size_t before = producers.size();
+            producers.erase(std::remove_if(producers.begin(), producers.end(), retired), producers.end());
+            if (producers.size() != before) {
+                producers_version.fetch_add(1, std::memory_order_release);
+                released = true;
+            }
+        }
+        if (released) {
+            snapshot.clear();
+        }
+
+        if (stopping) {
+            // One more pass after the stop flag so nothing logged before it is lost
+            drain(snapshot);
+            return;
+        }
+        if (!wrote) {
+            std::this_thread::sleep_for(IDLE_SLEEP);
+        }
+    }
+}
+
+// Formats everything currently in the rings, writes it in timestamp order and
+// only then frees the ring space. Returns false if there was nothing to write.
+bool DeribitLogger::drain(std::vector<std::shared_ptr<Producer>>& snapshot) {
+    thread_local std::string record_bytes;
+    thread_local std::string batch;
+    thread_local std::ostringstream formatter;
+    thread_local std::vector<FormattedRecord> records;
+    thread_local std::vector<size_t> consumed;
+
+    batch.clear();
+    records.clear();
+    consumed.assign(snapshot.size(), 0);
+
+    for (size_t p = 0; p < snapshot.size(); ++p) {
+        DeribitSpscRing<logdetail::LogChunk>& ring = snapshot[p]->ring;
+        size_t available = ring.readAvailable();
+        size_t i = 0;
+        while (i < available) {
+            // A record's chunks are committed together, so they are all available
+            const logdetail::LogChunk& first = ring.readSlot(i);
+            size_t count = first.remaining + 1;
+            record_bytes.clear();
+            for (size_t c = 0; c < count; ++c) {
+                const logdetail::LogChunk& chunk = ring.readSlot(i + c);
+                record_bytes.append(chunk.bytes, chunk.size);
+            }
+            i += count;
+
+            logdetail::RecordHeader header;
+            std::memcpy(&header, record_bytes.data(), sizeof(header));
+
+            formatter.str(std::string());
+            formatter.clear();
+            header.format(formatter, record_bytes.data() + sizeof(header));
+            formatter << '\n';
+
+            FormattedRecord record;
+            record.timestamp_ns = header.timestamp_ns;
+            record.level = header.level;
+            record.begin = batch.size();
+            batch += formatter.str();
+            record.end = batch.size();
+            records.push_back(record);
+        }
+        consumed[p] = i;
+    }
+
+    uint64_t dropped = 0;
+    for (const auto& producer : snapshot) {
+        uint64_t total = producer->dropped.load(std::memory_order_relaxed);
+        dropped += total - producer->reported_drops;
+        producer->reported_drops = total;
+    }
+
+    if (records.empty() && dropped == 0) {
+        return false;
+    }
+
+    std::stable_sort(records.begin(), records.end(),
+        [](const FormattedRecord& a, const FormattedRecord& b) { return a.timestamp_ns < b.timestamp_ns; });
+
+    bool wrote_out = false;
+    bool wrote_err = false;
+    for (const auto& record : records) {
+        bool is_error = record.level >= LogLevel::Warn;
+        std::fwrite(batch.data() + record.begin, 1, record.end - record.begin, is_error ? stderr : stdout);
+        (is_error ? wrote_err : wrote_out) = true;
+    }
+    if (dropped > 0) {
+        std::fprintf(stderr, "Logger dropped %llu records (ring full)\n",
+                     static_cast<unsigned long long>(dropped));
+        total_dropped.fetch_add(dropped, std::memory_order_relaxed);
+        wrote_err = true;
+    }
+    if (wrote_out) std::fflush(stdout);
+    if (wrote_err) std::fflush(stderr);
+
+    for (size_t p = 0; p < snapshot.size(); ++p) {
+        if (consumed[p] > 0) {
+            snapshot[p]->ring.commitRead(consumed[p]);
+        }
+    }
+    return true;
+}
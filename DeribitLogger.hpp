@@ -0,0 +1,238 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "DeribitSpscRing.hpp"
+
+enum class LogLevel : uint8_t { Debug, Info, Warn, Error, Off };
+
+// Streams a double in fixed notation without changing the stream's state,
+// e.g. LOG_INFO("Price: ", LogFixed{price, 2})
+struct LogFixed {
+    double value;
+    int precision;
+};
+std::ostream& operator<<(std::ostream& out, const LogFixed& fixed);
+
+namespace logdetail {
+
+// Rebuilds the arguments of one record from its encoded bytes and streams them
+typedef void (*FormatFn)(std::ostream& out, const char* args);
+
+// Leading bytes of every encoded record
+struct RecordHeader {
+    uint64_t timestamp_ns;
+    FormatFn format;
+    LogLevel level;
+};
+
+// Unit of the per-thread ring. A record longer than one chunk occupies
+// consecutive chunks, which are committed together.
+struct LogChunk {
+    static const size_t BYTES = 248;
+    uint32_t size;                  // Bytes used in this chunk
+    uint32_t remaining;             // Chunks that follow in the same record
+    char bytes[BYTES];
+};
+
+typedef std::vector<char> Staging;
+
+inline void appendBytes(Staging& staging, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    staging.insert(staging.end(), p, p + size);
+}
+
+inline void appendString(Staging& staging, std::string_view text) {
+    uint32_t size = static_cast<uint32_t>(text.size());
+    appendBytes(staging, &size, sizeof(size));
+    appendBytes(staging, text.data(), text.size());
+}
+
+inline std::string_view readString(const char*& p) {
+    uint32_t size;
+    std::memcpy(&size, p, sizeof(size));
+    std::string_view text(p + sizeof(size), size);
+    p += sizeof(size) + size;
+    return text;
+}
+
+template <typename T>
+struct IsStringLike : std::integral_constant<bool,
+    std::is_same<T, std::string>::value || std::is_same<T, std::string_view>::value ||
+    std::is_same<T, const char*>::value || std::is_same<T, char*>::value> {};
+
+/**
+ * Argument codecs:
+ *  - strings are copied as length + bytes
+ *  - trivially copyable values (numbers, bool, char, LogFixed) are copied raw
+ *    and streamed on the logging thread
+ *  - anything else (e.g. json) is streamed into a string on the calling
+ *    thread, since it cannot be copied safely as bytes
+ */
+template <typename T, typename Enable = void>
+struct Codec {
+    static void encode(Staging& staging, const T& value) {
+        thread_local std::ostringstream scratch;
+        scratch.str(std::string());
+        scratch.clear();
+        scratch << value;
+        appendString(staging, scratch.str());
+    }
+    static void decode(std::ostream& out, const char*& p) { out << readString(p); }
+};
+
+template <typename T>
+struct Codec<T, typename std::enable_if<IsStringLike<T>::value>::type> {
+    static void encode(Staging& staging, std::string_view value) { appendString(staging, value); }
+    static void encode(Staging& staging, const char* value) {
+        appendString(staging, value != nullptr ? std::string_view(value) : std::string_view("(null)"));
+    }
+    static void decode(std::ostream& out, const char*& p) { out << readString(p); }
+};
+
+template <typename T>
+struct Codec<T, typename std::enable_if<!IsStringLike<T>::value &&
+                                        std::is_trivially_copyable<T>::value>::type> {
+    static void encode(Staging& staging, const T& value) { appendBytes(staging, &value, sizeof(T)); }
+    static void decode(std::ostream& out, const char*& p) {
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        out << value;
+    }
+};
+
+template <typename... Args>
+void formatRecord(std::ostream& out, const char* p) {
+    (void)out;
+    (void)p;
+    (Codec<Args>::decode(out, p), ...);
+}
+
+}  // namespace logdetail
+
+/**
+ * @class DeribitLogger
+ * @brief Asynchronous logger that keeps formatting and I/O off the hot path
+ *
+ * Each logging thread owns an SPSC ring of fixed-size chunks. A log call
+ * copies its arguments in binary form into the ring (strings as bytes,
+ * numbers raw) and returns; it never formats, locks, or blocks on the
+ * terminal. A background thread drains all rings, orders the records by
+ * timestamp, formats them, and writes Debug/Info records to stdout and
+ * Warn/Error records to stderr, flushing once per batch.
+ *
+ * If a ring is full the record is dropped and counted rather than stalling
+ * the caller; the number of dropped records is reported on stderr.
+ *
+ * The threshold level defaults to Info and can be set with setLevel() or the
+ * DERIBIT_LOG_LEVEL environment variable (debug, info, warn, error, off).
+ */
+class DeribitLogger {
+public:
+    static DeribitLogger& instance();
+
+    static bool enabled(LogLevel level) {
+        return static_cast<uint8_t>(level) >= threshold.load(std::memory_order_relaxed);
+    }
+    static void setLevel(LogLevel level) { threshold.store(static_cast<uint8_t>(level)); }
+    static LogLevel parseLevel(std::string_view name, LogLevel fallback);
+
+    template <typename... Args>
+    void log(LogLevel level, const Args&... args) {
+        logdetail::Staging& staging = localStaging();
+        staging.clear();
+
+        logdetail::RecordHeader header;
+        header.timestamp_ns = nowNs();
+        header.format = &logdetail::formatRecord<typename std::decay<Args>::type...>;
+        header.level = level;
+        logdetail::appendBytes(staging, &header, sizeof(header));
+        (logdetail::Codec<typename std::decay<Args>::type>::encode(staging, args), ...);
+
+        publish(staging);
+    }
+
+    // Blocks until every record logged so far has been written
+    void flush();
+
+    // Writes out what is queued and stops the logging thread; runs at exit.
+    // Records logged afterwards are discarded.
+    void shutdown();
+
+    // Records dropped because a ring was full, as reported so far
+    uint64_t droppedCount() const { return total_dropped.load(std::memory_order_relaxed); }
+
+    // Records per thread before further records are dropped
+    static const size_t RING_CHUNKS = 4096;
+
+private:
+    struct Producer {
+        Producer() : ring(RING_CHUNKS), dropped(0), retired(false), reported_drops(0) {}
+        DeribitSpscRing<logdetail::LogChunk> ring;
+        std::atomic<uint64_t> dropped;      // Written only by the owning thread
+        std::atomic<bool> retired;          // Owning thread has exited
+        uint64_t reported_drops;            // Logging thread only
+    };
+
+    // Keeps the calling thread's producer registered for the thread's lifetime
+    struct ProducerHandle {
+        explicit ProducerHandle(DeribitLogger& logger);
+        ~ProducerHandle();
+        std::shared_ptr<Producer> producer;
+    };
+
+    DeribitLogger();
+    ~DeribitLogger();
+    DeribitLogger(const DeribitLogger&) = delete;
+    DeribitLogger& operator=(const DeribitLogger&) = delete;
+
+    static uint64_t nowNs();
+    static logdetail::Staging& localStaging();
+    Producer& localProducer();
+    void publish(const logdetail::Staging& staging);
+    void run();
+    bool drain(std::vector<std::shared_ptr<Producer>>& producers);
+
+    static std::atomic<uint8_t> threshold;
+
+    std::mutex producers_mutex;
+    std::vector<std::shared_ptr<Producer>> producers;
+    std::atomic<uint64_t> producers_version;
+    std::atomic<bool> running;
+    std::atomic<uint64_t> total_dropped;
+    std::mutex shutdown_mutex;
+    std::thread worker;
+};
+
+#define DERIBIT_LOG(level, ...)                                                  \
+    do {                                                                         \
+        if (DeribitLogger::enabled(level)) {                                     \
+            DeribitLogger::instance().log(level, __VA_ARGS__);                   \
+        }                                                                        \
+    } while (0)
+
+#define LOG_DEBUG(...) DERIBIT_LOG(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...)  DERIBIT_LOG(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN(...)  DERIBIT_LOG(LogLevel::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) DERIBIT_LOG(LogLevel::Error, __VA_ARGS__)
+
+// Logs one in every `every` calls made from this call site on the calling thread
+#define LOG_SAMPLED(level, every, ...)                                           \
+    do {                                                                         \
+        static thread_local uint32_t deribit_log_sample_counter = 0;             \
+        if (DeribitLogger::enabled(level) &&                                     \
+            deribit_log_sample_counter++ % (every) == 0) {                       \
+            DeribitLogger::instance().log(level, __VA_ARGS__);                   \
+        }                                                                        \
+    } while (0)
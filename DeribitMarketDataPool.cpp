@@ -0,0 +1,495 @@
+#include "DeribitMarketDataPool.hpp"
+#include "DeribitLogger.hpp"
+#include "DeribitMessageDecoder.hpp"
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+using websocketpp::lib::placeholders::_1;
+using websocketpp::lib::placeholders::_2;
+
+namespace {
+
+// The instrument part of a channel name, or the whole name if it has none.
+// "book.BTC-PERPETUAL.raw" -> "BTC-PERPETUAL", "announcements" -> "announcements"
+std::string_view shardKey(std::string_view channel) {
+    size_t begin = channel.find('.');
+    if (begin == std::string_view::npos) {
+        return channel;
+    }
+    size_t end = channel.find('.', begin + 1);
+    return channel.substr(begin + 1, end == std::string_view::npos ? std::string_view::npos : end - begin - 1);
+}
+
+// FNV-1a; unlike std::hash it is the same on every platform and run
+uint64_t stableHash(std::string_view text) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : text) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+}  // namespace
+
+DeribitMarketDataPool::Shard::Shard(size_t index, int cpu, DeribitLatencyStats& latency_stats,
+                                    const ReconnectPolicy& policy, const HeartbeatConfig& heartbeat_config)
+    : index(index), cpu(cpu), authenticated(false), connected(false),
+      subscriptions(ws_client, connection_hdl, authenticated, requests, latency_stats),
+      heartbeat(ws_client, "Market data shard " + std::to_string(index)),
+      backoff(policy), sweep_running(false) {
+    subscriptions.setConnectionMutex(&connection_mutex);
+    subscriptions.setClock(&heartbeat.clock());
+    heartbeat.configure(heartbeat_config);
+}
+
+DeribitMarketDataPool::DeribitMarketDataPool(DeribitLatencyStats& latency_stats,
+                                             const MarketDataPoolConfig& config,
+                                             DeribitEventBus* event_bus)
+    : latency_stats(latency_stats), event_bus(event_bus), reconnect_policy(config.reconnect), closing(false) {
+    size_t count = config.shards > 0 ? config.shards : 1;
+    for (size_t i = 0; i < count; ++i) {
+        int cpu = config.cpus.empty() ? -1 : config.cpus[i % config.cpus.size()];
+        shards.emplace_back(new Shard(i, cpu, latency_stats, reconnect_policy, config.heartbeat));
+        shards.back()->subscriptions.setEventBus(event_bus, marketDataSource(i));
+    }
+}
+
+DeribitMarketDataPool::~DeribitMarketDataPool() {
+    close();
+}
+
+bool DeribitMarketDataPool::pinCurrentThread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+// One context per shard, reused by its reconnects so the TLS session can resume
+DeribitMarketDataPool::context_ptr DeribitMarketDataPool::on_tls_init(Shard& shard) {
+    if (shard.tls_context) {
+        return shard.tls_context;
+    }
+    auto ctx = websocketpp::lib::make_shared<websocketpp::lib::asio::ssl::context>(
+        websocketpp::lib::asio::ssl::context::sslv23);
+    try {
+        ctx->set_options(websocketpp::lib::asio::ssl::context::default_workarounds |
+                         websocketpp::lib::asio::ssl::context::no_sslv2 |
+                         websocketpp::lib::asio::ssl::context::no_sslv3 |
+                         websocketpp::lib::asio::ssl::context::single_dh_use);
+    } catch (std::exception& e) {
+        LOG_ERROR("Error in TLS initialization: ", e.what());
+    }
+    shard.tls_context = ctx;
+    return ctx;
+}
+
+bool DeribitMarketDataPool::connect(const std::string& uri) {
+    LOG_INFO("Connecting ", shards.size(), " market data connections to ", uri, "...");
+    endpoint_uri = uri;
+    for (auto& shard : shards) {
+        if (!connectShard(*shard)) {
+            return false;
+        }
+    }
+
+    // Wait until every shard is connected (with a timeout); the shards connect in parallel
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CONNECT_TIMEOUT_MS);
+    for (auto& shard : shards) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+        if (!shard->opened.waitFor(std::max(remaining, std::chrono::milliseconds(0))) ||
+            !shard->opened.get().ok()) {
+            LOG_ERROR("Market data shard ", shard->index, " failed to connect within timeout period.");
+            return false;
+        }
+    }
+    LOG_INFO("Market data connections established.");
+    return true;
+}
+
+bool DeribitMarketDataPool::startRecording(const std::string& path_prefix, size_t segment_bytes) {
+    for (auto& shard : shards) {
+        std::string prefix = shardJournalPrefix(path_prefix, shard->index);
+        std::unique_ptr<DeribitJournalWriter> writer(new DeribitJournalWriter());
+        if (!writer->open(prefix, segment_bytes)) {
+            LOG_ERROR("Market data shard ", shard->index, ": unable to start recording to ", prefix);
+            return false;
+        }
+        shard->journal = std::move(writer);
+    }
+    LOG_INFO("Recording market data shards to ", shardJournalPrefix(path_prefix, 0), " and on.");
+    return true;
+}
+
+std::string DeribitMarketDataPool::shardJournalPrefix(const std::string& path_prefix, size_t shard) {
+    return path_prefix + ".shard" + std::to_string(shard);
+}
+
+bool DeribitMarketDataPool::connectShard(Shard& shard) {
+    shard.ws_client.clear_access_channels(websocketpp::log::alevel::all);
+    shard.ws_client.clear_error_channels(websocketpp::log::elevel::all);
+
+    shard.ws_client.init_asio();
+    shard.ws_client.set_tls_init_handler(std::bind(&DeribitMarketDataPool::on_tls_init, std::ref(shard)));
+    shard.ws_client.set_socket_init_handler([&shard](websocketpp::connection_hdl, ssl_socket& socket) {
+        shard.tls_sessions.apply(socket.native_handle());
+    });
+    shard.ws_client.set_open_handler(std::bind(&DeribitMarketDataPool::on_open, this, std::ref(shard), _1));
+    shard.ws_client.set_message_handler(
+        std::bind(&DeribitMarketDataPool::on_message, this, std::ref(shard), _2));
+    shard.ws_client.set_close_handler(std::bind(&DeribitMarketDataPool::on_close, this, std::ref(shard), _1));
+    shard.ws_client.set_fail_handler(std::bind(&DeribitMarketDataPool::on_fail, this, std::ref(shard)));
+
+    if (!openConnection(shard)) {
+        return false;
+    }
+
+    shard.io_thread = std::thread([&shard]() {
+        if (shard.cpu >= 0 && !pinCurrentThread(shard.cpu)) {
+            LOG_WARN("Market data shard ", shard.index, ": unable to pin io thread to CPU ", shard.cpu);
+        }
+        shard.ws_client.run();
+    });
+    return true;
+}
+
+bool DeribitMarketDataPool::openConnection(Shard& shard) {
+    websocketpp::lib::error_code ec;
+    auto con = shard.ws_client.get_connection(endpoint_uri, ec);
+    if (ec) {
+        LOG_ERROR("Market data shard ", shard.index, ": connection creation failed: ", ec.message());
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(shard.connection_mutex);
+        shard.connection_hdl = con->get_handle();
+    }
+    shard.ws_client.connect(con);
+    return true;
+}
+
+void DeribitMarketDataPool::close() {
+    closing.store(true, std::memory_order_release);
+    for (auto& shard : shards) {
+        shard->ws_client.stop();
+        if (shard->io_thread.joinable()) {
+            shard->io_thread.join();
+        }
+        shard->connected.store(false, std::memory_order_release);
+    }
+}
+
+void DeribitMarketDataPool::on_open(Shard& shard, websocketpp::connection_hdl hdl) {
+    websocketpp::lib::error_code ec;
+    auto con = shard.ws_client.get_con_from_hdl(hdl, ec);
+    SSL* ssl = !ec && con ? con->get_socket().native_handle() : nullptr;
+    shard.tls_sessions.save(ssl);
+
+    shard.connected.store(true, std::memory_order_release);
+    LOG_INFO("Market data shard ", shard.index, " connected",
+             DeribitTlsSessionCache::resumed(ssl) ? " (TLS session resumed)." : ".");
+    shard.opened.complete({{"jsonrpc", "2.0"}, {"result", "connected"}}, 0);
+    publishConnectionState(shard);
+    shard.heartbeat.start(hdl,
+        [this, &shard](const char* method, const json& params, ResponseCallback callback) {
+            return sendRequest(shard, method, params, std::move(callback));
+        },
+        [this, &shard](int64_t rtt_us) {
+            latency_stats.record(LatencyKind::NetworkRtt, "market data shard " + std::to_string(shard.index),
+                                 rtt_us * 1000);
+        });
+    if (!shard.sweep_running) {
+        shard.sweep_running = true;
+        scheduleRequestSweep(shard);
+    }
+    if (!shard.recovery.active()) {
+        return;
+    }
+
+    shard.recovery.markConnected();
+    shard.backoff.reset();
+    auto done = [this, &shard]() {
+        if (!shard.connected.load(std::memory_order_acquire)) {
+            return;
+        }
+        shard.recovery.markResubscribed(false);
+        if (shard.recovery.isComplete()) {
+            std::string phases = shard.recovery.summary();
+            int64_t elapsed_ns = shard.recovery.finish();
+            latency_stats.record(LatencyKind::Recovery, "market data shard " + std::to_string(shard.index),
+                                 elapsed_ns);
+            LOG_INFO("Market data shard ", shard.index, " recovered in ", elapsed_ns / 1000000, " ms (",
+                     phases, ").");
+        }
+    };
+    if (shard.subscriptions.resubscribe(false, done) == 0) {
+        done();
+    }
+}
+
+void DeribitMarketDataPool::on_close(Shard& shard, websocketpp::connection_hdl hdl) {
+    {
+        std::lock_guard<std::mutex> lock(shard.connection_mutex);
+        if (shard.connection_hdl.owner_before(hdl) || hdl.owner_before(shard.connection_hdl)) {
+            return;     // Superseded by a newer connection
+        }
+    }
+    shard.connected.store(false, std::memory_order_release);
+    shard.heartbeat.stop();
+    LOG_WARN("Market data shard ", shard.index, " connection closed.");
+    publishConnectionState(shard);
+
+    std::vector<PendingRequest> orphaned;
+    shard.requests.drain(orphaned);
+    for (auto& request : orphaned) {
+        if (request.callback) {
+            request.callback(DeribitRequestTable::makeErrorResponse(request.id, "connection closed"), 0);
+        }
+    }
+
+    shard.subscriptions.onDisconnected();
+    if (closing.load(std::memory_order_acquire) || !reconnect_policy.enabled) {
+        return;
+    }
+    shard.recovery.begin(false);
+    scheduleReconnect(shard);
+}
+
+void DeribitMarketDataPool::on_fail(Shard& shard) {
+    LOG_ERROR("Market data shard ", shard.index, ": connection error encountered.");
+    if (!shard.connected.load(std::memory_order_acquire)) {
+        shard.opened.fail("connection failed");
+    }
+    if (shard.recovery.active() && !closing.load(std::memory_order_acquire)) {
+        scheduleReconnect(shard);
+    }
+}
+
+void DeribitMarketDataPool::scheduleReconnect(Shard& shard) {
+    if (shard.backoff.exhausted()) {
+        LOG_ERROR("Market data shard ", shard.index, ": giving up after ", shard.backoff.attempts(),
+                  " reconnect attempts.");
+        shard.recovery.finish();
+        return;
+    }
+    int delay_ms = shard.backoff.nextDelayMs();
+    LOG_WARN("Market data shard ", shard.index, ": reconnecting in ", delay_ms, " ms (attempt ",
+             shard.backoff.attempts(), ")...");
+    shard.ws_client.set_timer(delay_ms, [this, &shard](const websocketpp::lib::error_code& ec) {
+        if (ec || closing.load(std::memory_order_acquire)) {
+            return;
+        }
+        if (!openConnection(shard)) {
+            scheduleReconnect(shard);
+        }
+    });
+}
+
+void DeribitMarketDataPool::publishConnectionState(const Shard& shard) {
+    if (event_bus == nullptr || !event_bus->wants(EventType::ConnectionState)) {
+        return;
+    }
+    EventRecord event;
+    event.type = EventType::ConnectionState;
+    event.source = marketDataSource(shard.index);
+    event.received_ns = EventRecord::now();
+    event.instrument.assign(std::string_view());
+    event.connection.connected = shard.connected.load(std::memory_order_acquire);
+    event.connection.authenticated = false;
+    event_bus->publish(event);
+}
+
+// Same routing as DeribitAuth::on_message, minus order traffic.
+void DeribitMarketDataPool::on_message(Shard& shard, client::message_ptr msg) {
+    auto received_at = std::chrono::steady_clock::now();
+    int64_t received_wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    try {
+        const std::string& payload = msg->get_payload();
+        if (shard.journal) {
+            shard.journal->append(JournalRecordType::Frame, received_wall_ns, payload);
+        }
+        shard.heartbeat.onFrame(received_at, received_wall_ns / 1000);
+        MessageEnvelope envelope;
+        if (!DeribitMessageDecoder::decodeEnvelope(payload, envelope)) {
+            LOG_ERROR("Market data shard ", shard.index, ": error decoding message: ", payload);
+            return;
+        }
+
+        if (envelope.method == "subscription") {
+            shard.subscriptions.handleSubscriptionPayload(payload, envelope, received_at,
+                                                          received_wall_ns / 1000);
+            return;
+        }
+        if (envelope.method == "heartbeat") {
+            shard.heartbeat.onHeartbeat(payload);
+            return;
+        }
+
+        PendingRequest request;
+        if (!envelope.has_id || !shard.requests.complete(envelope.id, request)) {
+            return;
+        }
+
+        auto latency = received_at - request.sent_at;
+        latency_stats.record(LatencyKind::RequestAck, request.method,
+                             std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+
+        auto j = json::parse(payload);
+        if (envelope.has_error) {
+            LOG_ERROR("Market data shard ", shard.index, ": request ", envelope.id, " (", request.method,
+                      ") failed: ", j["error"].dump());
+        }
+        if (request.callback) {
+            request.callback(j, std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+        }
+    } catch (std::exception& e) {
+        LOG_ERROR("Market data shard ", shard.index, ": error parsing JSON message: ", e.what());
+    }
+}
+
+// Heartbeat requests; subscriptions go through the shard's DeribitSubscription
+bool DeribitMarketDataPool::sendRequest(Shard& shard, const char* method, const json& params,
+                                        ResponseCallback callback) {
+    uint64_t id = shard.requests.nextId();
+    json j;
+    j["jsonrpc"] = "2.0";
+    j["id"] = id;
+    j["method"] = method;
+    j["params"] = params;
+    std::string payload = j.dump();
+
+    if (!shard.requests.insert(id, method, std::move(callback), std::chrono::milliseconds(REQUEST_TIMEOUT_MS))) {
+        LOG_ERROR("Market data shard ", shard.index, ": too many requests in flight; dropping ", method,
+                  " request.");
+        return false;
+    }
+    websocketpp::connection_hdl hdl;
+    {
+        std::lock_guard<std::mutex> lock(shard.connection_mutex);
+        hdl = shard.connection_hdl;
+    }
+    websocketpp::lib::error_code ec;
+    shard.ws_client.send(hdl, payload, websocketpp::frame::opcode::text, ec);
+    if (ec) {
+        LOG_ERROR("Market data shard ", shard.index, ": error sending ", method, " request: ", ec.message());
+        PendingRequest unused;
+        shard.requests.complete(id, unused);
+        return false;
+    }
+    return true;
+}
+
+void DeribitMarketDataPool::scheduleRequestSweep(Shard& shard) {
+    shard.ws_client.set_timer(REQUEST_SWEEP_INTERVAL_MS, [this, &shard](const websocketpp::lib::error_code& ec) {
+        if (ec || !shard.connected.load(std::memory_order_acquire)) {
+            shard.sweep_running = false;
+            return;
+        }
+
+        std::vector<PendingRequest> expired;
+        shard.requests.expire(std::chrono::steady_clock::now(), expired);
+        for (auto& request : expired) {
+            LOG_ERROR("Market data shard ", shard.index, ": request ", request.id, " (", request.method,
+                      ") timed out");
+            if (request.callback) {
+                request.callback(DeribitRequestTable::makeErrorResponse(request.id, "request timed out"),
+                                 REQUEST_TIMEOUT_MS * 1000);
+            }
+        }
+        scheduleRequestSweep(shard);
+    });
+}
+
+size_t DeribitMarketDataPool::shardFor(std::string_view channel) const {
+    return static_cast<size_t>(stableHash(shardKey(channel)) % shards.size());
+}
+
+std::vector<std::vector<std::string>> DeribitMarketDataPool::partition(
+    const std::vector<std::string>& channels) const {
+    std::vector<std::vector<std::string>> groups(shards.size());
+    for (const auto& channel : channels) {
+        groups[shardFor(channel)].push_back(channel);
+    }
+    return groups;
+}
+
+bool DeribitMarketDataPool::subscribe(const std::vector<std::string>& channels) {
+    bool ok = true;
+    std::vector<std::vector<std::string>> groups = partition(channels);
+    for (size_t i = 0; i < groups.size(); ++i) {
+        if (!groups[i].empty()) {
+            ok = shards[i]->subscriptions.subscribePublic(groups[i]) && ok;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(owned_mutex);
+    owned_channels.insert(channels.begin(), channels.end());
+    return ok;
+}
+
+bool DeribitMarketDataPool::unsubscribe(const std::vector<std::string>& channels) {
+    bool ok = true;
+    std::vector<std::vector<std::string>> groups = partition(channels);
+    for (size_t i = 0; i < groups.size(); ++i) {
+        if (!groups[i].empty()) {
+            ok = shards[i]->subscriptions.unsubscribe(groups[i]) && ok;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(owned_mutex);
+    for (const auto& channel : channels) {
+        owned_channels.erase(channel);
+    }
+    return ok;
+}
+
+bool DeribitMarketDataPool::owns(const std::string& channel) const {
+    std::lock_guard<std::mutex> lock(owned_mutex);
+    return owned_channels.count(channel) != 0;
+}
+
+bool DeribitMarketDataPool::onBook(const std::string& channel, DeribitSubscription::BookHandler handler) {
+    return shards[shardFor(channel)]->subscriptions.onBook(channel, std::move(handler));
+}
+
+bool DeribitMarketDataPool::onTrades(const std::string& channel, DeribitSubscription::TradeHandler handler) {
+    return shards[shardFor(channel)]->subscriptions.onTrades(channel, std::move(handler));
+}
+
+bool DeribitMarketDataPool::onTicker(const std::string& channel, DeribitSubscription::TickerHandler handler) {
+    return shards[shardFor(channel)]->subscriptions.onTicker(channel, std::move(handler));
+}
+
+bool DeribitMarketDataPool::onData(const std::string& channel, DeribitSubscription::DataHandler handler) {
+    return shards[shardFor(channel)]->subscriptions.onData(channel, std::move(handler));
+}
+
+void DeribitMarketDataPool::setPositionBook(DeribitPositionBook* book) {
+    for (auto& shard : shards) {
+        shard->subscriptions.setPositionBook(book);
+    }
+}
+
+void DeribitMarketDataPool::setTradeAggregator(DeribitTradeAggregator* aggregator) {
+    for (auto& shard : shards) {
+        shard->subscriptions.setTradeAggregator(aggregator);
+    }
+}
+
+void DeribitMarketDataPool::setOptionBook(DeribitOptionBook* book) {
+    for (auto& shard : shards) {
+        shard->subscriptions.setOptionBook(book);
+    }
+}
+
+void DeribitMarketDataPool::setRiskGate(DeribitRiskGate* gate) {
+    for (auto& shard : shards) {
+        shard->subscriptions.setRiskGate(gate);
+    }
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <websocketpp/client.hpp>
+#include <websocketpp/config/asio_client.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "DeribitAsync.hpp"
+#include "DeribitEventBus.hpp"
+#include "DeribitHeartbeat.hpp"
+#include "DeribitJournal.hpp"
+#include "DeribitLatencyStats.hpp"
+#include "DeribitReconnect.hpp"
+#include "DeribitRequestTable.hpp"
+#include "DeribitSubscription.hpp"
+
+/**
+ * @struct MarketDataPoolConfig
+ * @brief Settings of a DeribitMarketDataPool
+ */
+struct MarketDataPoolConfig {
+    size_t shards = 2;                  // Public WebSocket connections
+    std::vector<int> cpus;              // Shard i's io thread runs on cpus[i % cpus.size()]; empty leaves them unpinned
+    ReconnectPolicy reconnect;          // warm_standby does not apply to shards
+    HeartbeatConfig heartbeat;          // Per shard; each keeps its own clock estimate
+};
+
+/**
+ * @class DeribitMarketDataPool
+ * @brief Spreads public market data subscriptions over several WebSocket
+ *        connections, each with its own io thread
+ *
+ * Every shard is an independent unauthenticated connection with its own
+ * DeribitSubscription (channel registry, order books, handlers) and request
+ * table, so shards share no mutable state and decode in parallel. A channel
+ * is assigned to a shard by hashing its instrument (the second dot-separated
+ * part of the name, e.g. BTC-PERPETUAL in book.BTC-PERPETUAL.raw), so every
+ * channel of one instrument lands on the same shard and the mapping is the
+ * same on every run. Book snapshot requests after a gap go out on the shard
+ * that owns the book.
+ *
+ * A shard whose connection drops reconnects on its own with backoff, resumes
+ * its TLS session where possible and resubscribes its channels; its books
+ * resync from the subscription snapshots. Each shard runs a DeribitHeartbeat,
+ * so a shard whose feed stalls without the socket closing is closed and
+ * reconnected too.
+ *
+ * Handlers run on their shard's io thread. Register them before subscribing.
+ * Latencies are recorded into the shared DeribitLatencyStats, and events are
+ * published to the shared DeribitEventBus, if any, tagged with
+ * marketDataSource(shard).
+ */
+class DeribitMarketDataPool {
+public:
+    DeribitMarketDataPool(DeribitLatencyStats& latency_stats, const MarketDataPoolConfig& config,
+                          DeribitEventBus* event_bus = nullptr);
+    ~DeribitMarketDataPool();
+    DeribitMarketDataPool(const DeribitMarketDataPool&) = delete;
+    DeribitMarketDataPool& operator=(const DeribitMarketDataPool&) = delete;
+
+    // Opens every shard connection and waits until all are established
+    bool connect(const std::string& uri);
+
+    // Stops the io threads; open connections are dropped
+    void close();
+
+    size_t shardCount() const { return shards.size(); }
+    size_t shardFor(std::string_view channel) const;
+    DeribitSubscription& shard(size_t index) { return shards[index]->subscriptions; }
+
+    // Sends one public/subscribe (or unsubscribe) per shard for its channels
+    bool subscribe(const std::vector<std::string>& channels);
+    bool unsubscribe(const std::vector<std::string>& channels);
+
+    // Whether channel was subscribed through the pool
+    bool owns(const std::string& channel) const;
+
+    // Handler registration on the owning shard; see DeribitSubscription
+    bool onBook(const std::string& channel, DeribitSubscription::BookHandler handler);
+    bool onTrades(const std::string& channel, DeribitSubscription::TradeHandler handler);
+    bool onTicker(const std::string& channel, DeribitSubscription::TickerHandler handler);
+    bool onData(const std::string& channel, DeribitSubscription::DataHandler handler);
+
+    /**
+     * @brief Records every frame each shard receives; call before connect()
+     *
+     * Each shard writes its own journal from its own io thread, to
+     * <path_prefix>.shard<N>.NNNNNN.journal, so recording takes no lock.
+     */
+    bool startRecording(const std::string& path_prefix,
+                        size_t segment_bytes = DeribitJournalWriter::DEFAULT_SEGMENT_BYTES);
+    static std::string shardJournalPrefix(const std::string& path_prefix, size_t shard);
+
+    // Feeds mark and index prices from every shard to book; call before connect()
+    void setPositionBook(DeribitPositionBook* book);
+
+    // Feeds mark prices from every shard to gate; call before connect()
+    void setRiskGate(DeribitRiskGate* gate);
+
+    // Feeds trades from every shard to aggregator; call before connect()
+    void setTradeAggregator(DeribitTradeAggregator* aggregator);
+
+    // Feeds option tickers, trades and index ticks from every shard to book; call before connect()
+    void setOptionBook(DeribitOptionBook* book);
+
+    // Pins the calling thread to one CPU; false if the CPU is unavailable
+    static bool pinCurrentThread(int cpu);
+
+private:
+    typedef websocketpp::client<websocketpp::config::asio_tls_client> client;
+    typedef websocketpp::lib::shared_ptr<websocketpp::lib::asio::ssl::context> context_ptr;
+    typedef websocketpp::lib::asio::ssl::stream<websocketpp::lib::asio::ip::tcp::socket> ssl_socket;
+
+    static const int CONNECT_TIMEOUT_MS = 10000;
+    static const int REQUEST_TIMEOUT_MS = 10000;
+    static const int REQUEST_SWEEP_INTERVAL_MS = 100;
+
+    struct Shard {
+        Shard(size_t index, int cpu, DeribitLatencyStats& latency_stats, const ReconnectPolicy& policy,
+              const HeartbeatConfig& heartbeat_config);
+
+        size_t index;
+        int cpu;                                    // -1 leaves the io thread unpinned
+        client ws_client;
+        websocketpp::connection_hdl connection_hdl;
+        std::mutex connection_mutex;                // Guards connection_hdl, replaced on reconnect
+        std::atomic<bool> authenticated;            // Always false: shards carry public data only
+        std::atomic<bool> connected;
+        DeribitPending opened;                      // Completed by the first open or failure
+        DeribitRequestTable requests;
+        DeribitSubscription subscriptions;
+        DeribitHeartbeat heartbeat;
+        std::unique_ptr<DeribitJournalWriter> journal;  // Inbound frame recorder, if enabled
+        std::thread io_thread;
+
+        // Reconnection; io thread only
+        DeribitBackoff backoff;
+        DeribitRecoveryClock recovery;
+        DeribitTlsSessionCache tls_sessions;
+        context_ptr tls_context;
+        bool sweep_running;
+    };
+
+    bool connectShard(Shard& shard);
+    bool openConnection(Shard& shard);
+    void on_message(Shard& shard, client::message_ptr msg);
+    void on_open(Shard& shard, websocketpp::connection_hdl hdl);
+    void on_close(Shard& shard, websocketpp::connection_hdl hdl);
+    void on_fail(Shard& shard);
+    bool sendRequest(Shard& shard, const char* method, const json& params, ResponseCallback callback);
+    void scheduleReconnect(Shard& shard);
+    void scheduleRequestSweep(Shard& shard);
+    void publishConnectionState(const Shard& shard);
+    static context_ptr on_tls_init(Shard& shard);
+
+    // Channels grouped by the shard that owns them
+    std::vector<std::vector<std::string>> partition(const std::vector<std::string>& channels) const;
+
+    DeribitLatencyStats& latency_stats;
+    DeribitEventBus* event_bus;
+    ReconnectPolicy reconnect_policy;
+    std::string endpoint_uri;
+    std::atomic<bool> closing;
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    mutable std::mutex owned_mutex;
+    std::set<std::string> owned_channels;
+};
@@ -0,0 +1,544 @@
+#include "DeribitMessageDecoder.hpp"
+#include <charconv>
+#include <cmath>
+
+// ---------------------------------------------------------------------------
+// JsonCursor
+// ---------------------------------------------------------------------------
+
+char JsonCursor::peek() {
+    skipWhitespace();
+    return p < end ? *p : 0;
+}
+
+bool JsonCursor::expect(char c) {
+    skipWhitespace();
+    if (p < end && *p == c) {
+        ++p;
+        return true;
+    }
+    return fail();
+}
+
+bool JsonCursor::nextKey(std::string_view& key) {
+    if (failed) {
+        return false;     // Never spin on malformed input
+    }
+    skipWhitespace();
+    if (p < end && *p == ',') {
+        ++p;
+        skipWhitespace();
+    }
+    if (p >= end) {
+        return fail();
+    }
+    if (*p == '}') {
+        ++p;
+        return false;
+    }
+    if (!readString(key)) {
+        return false;
+    }
+    return expect(':');
+}
+
+bool JsonCursor::nextElement() {
+    if (failed) {
+        return false;     // Never spin on malformed input
+    }
+    skipWhitespace();
+    if (p < end && *p == ',') {
+        ++p;
+        skipWhitespace();
+    }
+    if (p >= end) {
+        return fail();
+    }
+    if (*p == ']') {
+        ++p;
+        return false;
+    }
+    return true;
+}
+
+bool JsonCursor::skipString() {
+    ++p;    // Opening quote
+    while (p < end) {
+        if (*p == '\\') {
+            p += 2;
+        } else if (*p == '"') {
+            ++p;
+            return true;
+        } else {
+            ++p;
+        }
+    }
+    return fail();
+}
+
+bool JsonCursor::readString(std::string_view& out) {
+    skipWhitespace();
+    if (p >= end || *p != '"') {
+        return fail();
+    }
+    const char* start = p + 1;
+    if (!skipString()) {
+        return false;
+    }
+    out = std::string_view(start, static_cast<size_t>(p - 1 - start));
+    return true;
+}
+
+bool JsonCursor::readDouble(double& out) {
+    skipWhitespace();
+    if (end - p >= 4 && p[0] == 'n' && p[1] == 'u' && p[2] == 'l' && p[3] == 'l') {
+        p += 4;
+        out = std::numeric_limits<double>::quiet_NaN();
+        return true;
+    }
+    auto result = std::from_chars(p, end, out);
+    if (result.ec != std::errc()) {
+        return fail();
+    }
+    p = result.ptr;
+    return true;
+}
+
+bool JsonCursor::readInt(int64_t& out) {
+    skipWhitespace();
+    const char* start = p;
+    auto result = std::from_chars(p, end, out);
+    if (result.ec != std::errc()) {
+        return fail();
+    }
+    p = result.ptr;
+
+    // Tolerate integral values written with a fraction or exponent (e.g. 1.0)
+    if (p < end && (*p == '.' || *p == 'e' || *p == 'E')) {
+        double value;
+        auto again = std::from_chars(start, end, value);
+        if (again.ec != std::errc()) {
+            return fail();
+        }
+        out = static_cast<int64_t>(value);
+        p = again.ptr;
+    }
+    return true;
+}
+
+bool JsonCursor::readUint(uint64_t& out) {
+    skipWhitespace();
+    auto result = std::from_chars(p, end, out);
+    if (result.ec != std::errc()) {
+        return fail();
+    }
+    p = result.ptr;
+    return true;
+}
+
+bool JsonCursor::readBool(bool& out) {
+    skipWhitespace();
+    if (end - p >= 4 && p[0] == 't' && p[1] == 'r' && p[2] == 'u' && p[3] == 'e') {
+        p += 4;
+        out = true;
+        return true;
+    }
+    if (end - p >= 5 && p[0] == 'f' && p[1] == 'a' && p[2] == 'l' && p[3] == 's' && p[4] == 'e') {
+        p += 5;
+        out = false;
+        return true;
+    }
+    return fail();
+}
+
+bool JsonCursor::skipValue() {
+    skipWhitespace();
+    if (p >= end) {
+        return fail();
+    }
+
+    if (*p == '"') {
+        return skipString();
+    }
+
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (p < end) {
+            char c = *p;
+            if (c == '"') {
+                if (!skipString()) return false;
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    ++p;
+                    return true;
+                }
+            }
+            ++p;
+        }
+        return fail();
+    }
+
+    // Number, true, false or null
+    const char* start = p;
+    while (p < end && *p != ',' && *p != '}' && *p != ']' &&
+           *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t') {
+        ++p;
+    }
+    return p != start || fail();
+}
+
+bool JsonCursor::readRaw(std::string_view& out) {
+    skipWhitespace();
+    const char* start = p;
+    if (!skipValue()) {
+        return false;
+    }
+    out = std::string_view(start, static_cast<size_t>(p - start));
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// DeribitMessageDecoder
+// ---------------------------------------------------------------------------
+
+namespace {
+
+OrderSide parseDirection(std::string_view direction) {
+    return direction == "sell" ? OrderSide::Sell : OrderSide::Buy;
+}
+
+}  // namespace
+
+bool DeribitMessageDecoder::decodeEnvelope(std::string_view payload, MessageEnvelope& out) {
+    out = MessageEnvelope();
+    JsonCursor cursor(payload);
+    if (!cursor.beginObject()) {
+        return false;
+    }
+
+    std::string_view key;
+    while (cursor.nextKey(key)) {
+        if (key == "method") {
+            cursor.readString(out.method);
+        } else if (key == "id") {
+            out.has_id = cursor.peek() != 'n' && cursor.readUint(out.id);
+            if (!out.has_id) cursor.skipValue();
+        } else if (key == "result") {
+            out.has_result = cursor.readRaw(out.result);
+        } else if (key == "error") {
+            out.has_error = cursor.skipValue();
+        } else if (key == "params" && cursor.peek() == '{') {
+            cursor.beginObject();
+            std::string_view param;
+            while (cursor.nextKey(param)) {
+                if (param == "channel") {
+                    cursor.readString(out.channel);
+                } else if (param == "data") {
+                    cursor.readRaw(out.data);
+                } else {
+                    cursor.skipValue();
+                }
+            }
+        } else {
+            cursor.skipValue();
+        }
+    }
+    return cursor.ok();
+}
+
+bool DeribitMessageDecoder::decodeBook(std::string_view data, std::string_view& instrument_name,
+                                       BookUpdate& out) {
+    out.clear();
+    bool has_type = false;
+    bool has_change_id = false;
+    JsonCursor cursor(data);
+    if (!cursor.beginObject()) {
+        return false;
+    }
+
+    std::string_view key;
+    while (cursor.nextKey(key)) {
+        if (key == "instrument_name") {
+            cursor.readString(instrument_name);
+        } else if (key == "change_id") {
+            has_change_id = cursor.readInt(out.change_id);
+        } else if (key == "prev_change_id") {
+            cursor.readInt(out.prev_change_id);
+        } else if (key == "timestamp") {
+            cursor.readInt(out.timestamp);
+        } else if (key == "type") {
+            std::string_view type;
+            cursor.readString(type);
+            has_type = true;
+            out.is_snapshot = type == "snapshot";
+        } else if (key == "bids" || key == "asks") {
+            BookSide side = key == "bids" ? BookSide::Bid : BookSide::Ask;
+            cursor.beginArray();
+            while (cursor.nextElement()) {
+                BookLevelUpdate level;
+                level.side = side;
+                level.action = BookAction::New;
+                double values[2] = { 0.0, 0.0 };
+                int count = 0;
+
+                // Raw channels send [action, price, amount]; grouped ones [price, amount]
+                cursor.beginArray();
+                while (cursor.nextElement()) {
+                    if (cursor.peek() == '"') {
+                        std::string_view action;
+                        cursor.readString(action);
+                        level.action = action == "new" ? BookAction::New
+                                     : action == "delete" ? BookAction::Delete
+                                     : BookAction::Change;
+                    } else if (count < 2) {
+                        cursor.readDouble(values[count++]);
+                    } else {
+                        cursor.skipValue();
+                    }
+                }
+                level.price = values[0];
+                level.amount = values[1];
+                out.levels.push_back(level);
+            }
+        } else {
+            cursor.skipValue();
+        }
+    }
+
+    // Grouped channels carry no type and always send the whole book
+    if (!has_type) {
+        out.is_snapshot = true;
+    }
+    return cursor.ok() && has_change_id && !instrument_name.empty();
+}
+
+namespace {
+
+bool decodeTrade(JsonCursor& cursor, TradeEvent& trade) {
+    if (!cursor.beginObject()) {
+        return false;
+    }
+    std::string_view key;
+    while (cursor.nextKey(key)) {
+        if (key == "instrument_name") {
+            cursor.readString(trade.instrument_name);
+        } else if (key == "trade_id") {
+            cursor.readString(trade.trade_id);
+        } else if (key == "order_id") {
+            cursor.readString(trade.order_id);
+        } else if (key == "trade_seq") {
+            cursor.readInt(trade.trade_seq);
+        } else if (key == "timestamp") {
+            cursor.readInt(trade.timestamp);
+        } else if (key == "direction") {
+            std::string_view direction;
+            cursor.readString(direction);
+            trade.direction = parseDirection(direction);
+        } else if (key == "price") {
+            cursor.readDouble(trade.price);
+        } else if (key == "amount") {
+            cursor.readDouble(trade.amount);
+        } else if (key == "mark_price") {
+            cursor.readDouble(trade.mark_price);
+        } else if (key == "index_price") {
+            cursor.readDouble(trade.index_price);
+        } else if (key == "iv") {
+            cursor.readDouble(trade.iv);
+        } else if (key == "tick_direction") {
+            int64_t tick = 0;
+            cursor.readInt(tick);
+            trade.tick_direction = static_cast<int>(tick);
+        } else {
+            cursor.skipValue();
+        }
+    }
+    return cursor.ok();
+}
+
+}  // namespace
+
+bool DeribitMessageDecoder::decodeTrades(std::string_view data, std::vector<TradeEvent>& out) {
+    out.clear();
+    JsonCursor cursor(data);
+    if (!cursor.beginArray()) {
+        return false;
+    }
+    while (cursor.nextElement()) {
+        out.emplace_back();
+        if (!decodeTrade(cursor, out.back())) {
+            return false;
+        }
+    }
+    return cursor.ok();
+}
+
+bool DeribitMessageDecoder::decodeTicker(std::string_view data, TickerEvent& out) {
+    out = TickerEvent();
+    JsonCursor cursor(data);
+    if (!cursor.beginObject()) {
+        return false;
+    }
+
+    std::string_view key;
+    while (cursor.nextKey(key)) {
+        if (key == "instrument_name") {
+            cursor.readString(out.instrument_name);
+        } else if (key == "timestamp") {
+            cursor.readInt(out.timestamp);
+        } else if (key == "best_bid_price") {
+            cursor.readDouble(out.best_bid_price);
+        } else if (key == "best_bid_amount") {
+            cursor.readDouble(out.best_bid_amount);
+        } else if (key == "best_ask_price") {
+            cursor.readDouble(out.best_ask_price);
+        } else if (key == "best_ask_amount") {
+            cursor.readDouble(out.best_ask_amount);
+        } else if (key == "last_price") {
+            cursor.readDouble(out.last_price);
+        } else if (key == "mark_price") {
+            cursor.readDouble(out.mark_price);
+        } else if (key == "index_price") {
+            cursor.readDouble(out.index_price);
+        } else if (key == "mark_iv") {
+            cursor.readDouble(out.mark_iv);
+        } else if (key == "underlying_price") {
+            cursor.readDouble(out.underlying_price);
+        } else if (key == "open_interest") {
+            cursor.readDouble(out.open_interest);
+        } else if (key == "current_funding") {
+            cursor.readDouble(out.current_funding);
+        } else {
+            cursor.skipValue();
+        }
+    }
+    return cursor.ok() && !out.instrument_name.empty();
+}
+
+namespace {
+
+bool decodeOrderObject(JsonCursor& cursor, OrderEvent& out) {
+    out = OrderEvent();
+    if (!cursor.beginObject()) {
+        return false;
+    }
+
+    std::string_view key;
+    while (cursor.nextKey(key)) {
+        if (key == "order_id") {
+            cursor.readString(out.order_id);
+        } else if (key == "instrument_name") {
+            cursor.readString(out.instrument_name);
+        } else if (key == "label") {
+            cursor.readString(out.label);
+        } else if (key == "order_state") {
+            cursor.readString(out.order_state);
+        } else if (key == "order_type") {
+            cursor.readString(out.order_type);
+        } else if (key == "time_in_force") {
+            cursor.readString(out.time_in_force);
+        } else if (key == "direction") {
+            std::string_view direction;
+            cursor.readString(direction);
+            out.direction = parseDirection(direction);
+        } else if (key == "price" && cursor.peek() != '"') {
+            cursor.readDouble(out.price);       // Market orders send "market_price"
+        } else if (key == "amount") {
+            cursor.readDouble(out.amount);
+        } else if (key == "filled_amount") {
+            cursor.readDouble(out.filled_amount);
+        } else if (key == "average_price") {
+            cursor.readDouble(out.average_price);
+        } else if (key == "creation_timestamp") {
+            cursor.readInt(out.creation_timestamp);
+        } else if (key == "last_update_timestamp") {
+            cursor.readInt(out.last_update_timestamp);
+        } else if (key == "post_only") {
+            cursor.readBool(out.post_only);
+        } else if (key == "reduce_only") {
+            cursor.readBool(out.reduce_only);
+        } else {
+            cursor.skipValue();
+        }
+    }
+    return cursor.ok() && !out.order_id.empty();
+}
+
+}  // namespace
+
+OrderState DeribitMessageDecoder::parseOrderState(std::string_view state) {
+    if (state == "open") return OrderState::Open;
+    if (state == "filled") return OrderState::Filled;
+    if (state == "rejected") return OrderState::Rejected;
+    if (state == "cancelled") return OrderState::Cancelled;
+    if (state == "untriggered") return OrderState::Untriggered;
+    return OrderState::Unknown;
+}
+
+bool DeribitMessageDecoder::decodeOrder(std::string_view data, OrderEvent& out) {
+    JsonCursor cursor(data);
+    return decodeOrderObject(cursor, out);
+}
+
+bool DeribitMessageDecoder::decodeOrders(std::string_view data, std::vector<OrderEvent>& out) {
+    out.clear();
+    JsonCursor cursor(data);
+    if (cursor.peek() == '{') {
+        out.emplace_back();
+        return decodeOrderObject(cursor, out.back());
+    }
+
+    if (!cursor.beginArray()) {
+        return false;
+    }
+    while (cursor.nextElement()) {
+        out.emplace_back();
+        if (!decodeOrderObject(cursor, out.back())) {
+            return false;
+        }
+    }
+    return cursor.ok();
+}
+
+bool DeribitMessageDecoder::decodePosition(std::string_view data, PositionEvent& out) {
+    out = PositionEvent();
+    JsonCursor cursor(data);
+    if (!cursor.beginObject()) {
+        return false;
+    }
+
+    std::string_view key;
+    while (cursor.nextKey(key)) {
+        if (key == "instrument_name") {
+            cursor.readString(out.instrument_name);
+        } else if (key == "kind") {
+            cursor.readString(out.kind);
+        } else if (key == "direction") {
+            cursor.readString(out.direction);
+        } else if (key == "size") {
+            cursor.readDouble(out.size);
+        } else if (key == "average_price") {
+            cursor.readDouble(out.average_price);
+        } else if (key == "mark_price") {
+            cursor.readDouble(out.mark_price);
+        } else if (key == "index_price") {
+            cursor.readDouble(out.index_price);
+        } else if (key == "floating_profit_loss") {
+            cursor.readDouble(out.floating_profit_loss);
+        } else if (key == "realized_profit_loss") {
+            cursor.readDouble(out.realized_profit_loss);
+        } else if (key == "total_profit_loss") {
+            cursor.readDouble(out.total_profit_loss);
+        } else if (key == "estimated_liquidation_price") {
+            cursor.readDouble(out.estimated_liquidation_price);
+        } else if (key == "leverage") {
+            cursor.readDouble(out.leverage);
+        } else {
+            cursor.skipValue();
+        }
+    }
+    return cursor.ok() && !out.instrument_name.empty();
+}
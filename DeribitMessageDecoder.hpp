@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <vector>
+#include "DeribitOrderBook.hpp"
+#include "DeribitOrderEncoder.hpp"
+
+/**
+ * Typed views of inbound messages.
+ *
+ * String fields point into the original payload and are only valid while it
+ * is alive (i.e. for the duration of the message handler). They hold the raw
+ * JSON text, so a string containing escape sequences is not unescaped.
+ * Numeric fields that are absent or null are NaN (doubles) or 0 (integers).
+ */
+
+// Top-level routing information of a JSON-RPC message
+struct MessageEnvelope {
+    std::string_view method;        // "subscription", "heartbeat", or empty for responses
+    uint64_t id = 0;
+    bool has_id = false;
+    bool has_result = false;
+    bool has_error = false;
+    std::string_view channel;       // params.channel of a subscription notification
+    std::string_view data;          // Raw JSON text of params.data
+    std::string_view result;        // Raw JSON text of result
+};
+
+struct TradeEvent {
+    std::string_view instrument_name;
+    std::string_view trade_id;
+    std::string_view order_id;      // user.trades.* and order responses only
+    int64_t trade_seq = 0;
+    int64_t timestamp = 0;
+    OrderSide direction = OrderSide::Buy;
+    double price = 0.0;
+    double amount = 0.0;
+    double mark_price = std::numeric_limits<double>::quiet_NaN();
+    double index_price = std::numeric_limits<double>::quiet_NaN();
+    double iv = std::numeric_limits<double>::quiet_NaN();   // Options only
+    int tick_direction = 0;
+};
+
+struct TickerEvent {
+    std::string_view instrument_name;
+    int64_t timestamp = 0;
+    double best_bid_price = std::numeric_limits<double>::quiet_NaN();
+    double best_bid_amount = std::numeric_limits<double>::quiet_NaN();
+    double best_ask_price = std::numeric_limits<double>::quiet_NaN();
+    double best_ask_amount = std::numeric_limits<double>::quiet_NaN();
+    double last_price = std::numeric_limits<double>::quiet_NaN();
+    double mark_price = std::numeric_limits<double>::quiet_NaN();
+    double index_price = std::numeric_limits<double>::quiet_NaN();
+    double mark_iv = std::numeric_limits<double>::quiet_NaN();     // Options only
+    double underlying_price = std::numeric_limits<double>::quiet_NaN();    // Options only: the expiry's forward
+    double open_interest = std::numeric_limits<double>::quiet_NaN();
+    double current_funding = std::numeric_limits<double>::quiet_NaN();
+};
+
+struct OrderEvent {
+    std::string_view order_id;
+    std::string_view instrument_name;
+    std::string_view label;
+    std::string_view order_state;   // open, filled, rejected, cancelled, untriggered
+    std::string_view order_type;
+    std::string_view time_in_force;
+    OrderSide direction = OrderSide::Buy;
+    double price = std::numeric_limits<double>::quiet_NaN();    // NaN for market orders
+    double amount = 0.0;
+    double filled_amount = 0.0;
+    double average_price = 0.0;
+    int64_t creation_timestamp = 0;
+    int64_t last_update_timestamp = 0;
+    bool post_only = false;
+    bool reduce_only = false;
+};
+
+struct PositionEvent {
+    std::string_view instrument_name;
+    std::string_view kind;          // future, option, spot, ...
+    std::string_view direction;     // buy, sell or zero
+    double size = 0.0;
+    double average_price = 0.0;
+    double mark_price = std::numeric_limits<double>::quiet_NaN();
+    double index_price = std::numeric_limits<double>::quiet_NaN();
+    double floating_profit_loss = 0.0;
+    double realized_profit_loss = 0.0;
+    double total_profit_loss = 0.0;
+    double estimated_liquidation_price = std::numeric_limits<double>::quiet_NaN();
+    double leverage = 0.0;
+};
+
+/**
+ * @class DeribitMessageDecoder
+ * @brief On-demand decoder for inbound Deribit messages
+ *
+ * decodeEnvelope() makes one pass over the top level of a message to pick up
+ * method, id and channel, recording the extent of params.data without parsing
+ * it. The typed decoders then walk that span straight into the structs above.
+ * No DOM is built and, apart from caller-owned vectors growing to their
+ * high-water mark, nothing is allocated.
+ */
+class DeribitMessageDecoder {
+public:
+    static bool decodeEnvelope(std::string_view payload, MessageEnvelope& out);
+
+    // book.* data; instrument_name receives a view of data.instrument_name
+    static bool decodeBook(std::string_view data, std::string_view& instrument_name, BookUpdate& out);
+
+    // trades.* and user.trades.* data (an array); clears out first
+    static bool decodeTrades(std::string_view data, std::vector<TradeEvent>& out);
+
+    static bool decodeTicker(std::string_view data, TickerEvent& out);
+    static bool decodeOrder(std::string_view data, OrderEvent& out);
+
+    // user.orders.* data, which is a single order or an array; clears out first
+    static bool decodeOrders(std::string_view data, std::vector<OrderEvent>& out);
+
+    // private/get_position result or an entry of user.changes.* positions
+    static bool decodePosition(std::string_view data, PositionEvent& out);
+
+    // OrderEvent::order_state as an enum; Unknown for unrecognized text
+    static OrderState parseOrderState(std::string_view state);
+};
+
+/**
+ * @class JsonCursor
+ * @brief Forward-only pull reader over JSON text used by the decoders
+ *
+ * Objects are read with beginObject() followed by nextKey() until it returns
+ * false; arrays with beginArray() followed by nextElement(). After a key or
+ * element the caller must consume exactly one value (read* or skipValue()).
+ */
+class JsonCursor {
+public:
+    explicit JsonCursor(std::string_view text)
+        : p(text.data()), end(text.data() + text.size()), failed(false) {}
+
+    bool beginObject() { return expect('{'); }
+    bool beginArray() { return expect('['); }
+    bool nextKey(std::string_view& key);
+    bool nextElement();
+
+    char peek();                    // Next significant character, or 0 at end
+    bool readString(std::string_view& out);
+    bool readDouble(double& out);   // null reads as NaN
+    bool readInt(int64_t& out);
+    bool readUint(uint64_t& out);
+    bool readBool(bool& out);
+    bool skipValue();
+    bool readRaw(std::string_view& out);    // Skips a value and returns its text
+
+    bool ok() const { return !failed; }
+
+private:
+    void skipWhitespace() {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) ++p;
+    }
+    bool expect(char c);
+    bool skipString();
+    bool fail() { failed = true; return false; }
+
+    const char* p;
+    const char* end;
+    bool failed;
+};
@@ -0,0 +1,944 @@
+#include "DeribitMockServer.hpp"
+#include "DeribitLogger.hpp"
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/obj_mac.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <functional>
+
+using websocketpp::lib::placeholders::_1;
+using websocketpp::lib::placeholders::_2;
+
+namespace {
+
+// JSON-RPC and Deribit error codes
+const int ERROR_PARSE = -32700;
+const int ERROR_METHOD_NOT_FOUND = -32601;
+const int ERROR_INVALID_PARAMS = -32602;
+const int ERROR_ORDER_NOT_FOUND = 10004;
+const int ERROR_NOT_OPEN_ORDER = 11044;
+const int ERROR_INVALID_CREDENTIALS = 13004;
+const int ERROR_UNAUTHORIZED = 13009;
+
+// "book.BTC-PERPETUAL.raw" -> "BTC-PERPETUAL"
+std::string instrumentOf(const std::string& channel) {
+    size_t begin = channel.find('.');
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    size_t end = channel.find('.', begin + 1);
+    return channel.substr(begin + 1, end == std::string::npos ? std::string::npos : end - begin - 1);
+}
+
+bool startsWith(const std::string& text, const char* prefix) {
+    return text.compare(0, std::char_traits<char>::length(prefix), prefix) == 0;
+}
+
+// Amounts on the synthetic books and trades are multiples of 10
+double randomAmount(std::mt19937& rng) {
+    return 10.0 * static_cast<double>(1 + rng() % 50);
+}
+
+}  // namespace
+
+// Constructor: copy the configuration; nothing is bound until start().
+DeribitMockServer::DeribitMockServer(const MockServerConfig& config)
+    : config(config), running(false), next_order_id(1), next_trade_id(1),
+      book_rate(config.book_rate), trade_rate(config.trade_rate),
+      notifications_sent(0), requests_handled(0), rng(config.seed) {
+    out.reserve(16 * 1024);
+}
+
+DeribitMockServer::~DeribitMockServer() {
+    stop();
+}
+
+bool DeribitMockServer::start() {
+    if (running) {
+        return true;
+    }
+
+    if (config.certificate_file.empty() && !generateCertificate(certificate_pem, key_pem)) {
+        LOG_ERROR("Mock server: unable to generate a TLS certificate.");
+        return false;
+    }
+
+    ws_server.clear_access_channels(websocketpp::log::alevel::all);
+    ws_server.clear_error_channels(websocketpp::log::elevel::all);
+
+    ws_server.init_asio();
+    ws_server.set_reuse_addr(true);
+    ws_server.set_tls_init_handler(std::bind(&DeribitMockServer::on_tls_init, this, _1));
+    ws_server.set_open_handler(std::bind(&DeribitMockServer::on_open, this, _1));
+    ws_server.set_close_handler(std::bind(&DeribitMockServer::on_close, this, _1));
+    ws_server.set_message_handler(std::bind(&DeribitMockServer::on_message, this, _1, _2));
+
+    // IPv4 only, so the server also works where IPv6 is disabled
+    websocketpp::lib::error_code ec;
+    ws_server.listen(websocketpp::lib::asio::ip::tcp::v4(), config.port, ec);
+    if (ec) {
+        LOG_ERROR("Mock server: unable to listen on port ", config.port, ": ", ec.message());
+        return false;
+    }
+    ws_server.start_accept(ec);
+    if (ec) {
+        LOG_ERROR("Mock server: unable to accept connections: ", ec.message());
+        return false;
+    }
+
+    last_tick = std::chrono::steady_clock::now();
+    scheduleTick();
+
+    running = true;
+    io_thread = std::thread([this]() { ws_server.run(); });
+    LOG_INFO("Mock server listening on ", uri());
+    return true;
+}
+
+void DeribitMockServer::stop() {
+    if (!running) {
+        return;
+    }
+    running = false;
+
+    // Stopping the event loop drops open connections without a closing handshake
+    ws_server.stop();
+    if (io_thread.joinable()) {
+        io_thread.join();
+    }
+}
+
+uint64_t DeribitMockServer::requestsHandled(const std::string& method) const {
+    std::lock_guard<std::mutex> lock(counts_mutex);
+    auto it = method_counts.find(method);
+    return it == method_counts.end() ? 0 : it->second;
+}
+
+std::string DeribitMockServer::uri() const {
+    return "wss://127.0.0.1:" + std::to_string(config.port) + "/ws/api/v2";
+}
+
+void DeribitMockServer::setRates(double book_per_second, double trades_per_second) {
+    book_rate.store(book_per_second, std::memory_order_relaxed);
+    trade_rate.store(trades_per_second, std::memory_order_relaxed);
+}
+
+void DeribitMockServer::dropConnections() {
+    // Sessions belong to the server thread; close them from there
+    ws_server.set_timer(0, [this](const websocketpp::lib::error_code& ec) {
+        if (ec) {
+            return;
+        }
+        std::vector<websocketpp::connection_hdl> open;
+        for (const auto& entry : sessions) {
+            open.push_back(entry.first);
+        }
+        for (auto& hdl : open) {
+            websocketpp::lib::error_code close_ec;
+            ws_server.close(hdl, websocketpp::close::status::going_away, "dropped by mock server", close_ec);
+        }
+        LOG_INFO("Mock server: dropped ", open.size(), " connections");
+    });
+}
+
+DeribitMockServer::context_ptr DeribitMockServer::on_tls_init(websocketpp::connection_hdl) {
+    namespace ssl = websocketpp::lib::asio::ssl;
+    auto ctx = websocketpp::lib::make_shared<ssl::context>(ssl::context::sslv23);
+    try {
+        ctx->set_options(ssl::context::default_workarounds |
+                         ssl::context::no_sslv2 |
+                         ssl::context::no_sslv3 |
+                         ssl::context::single_dh_use);
+        if (!config.certificate_file.empty()) {
+            ctx->use_certificate_chain_file(config.certificate_file);
+            ctx->use_private_key_file(config.private_key_file, ssl::context::pem);
+        } else {
+            ctx->use_certificate_chain(websocketpp::lib::asio::buffer(certificate_pem));
+            ctx->use_private_key(websocketpp::lib::asio::buffer(key_pem), ssl::context::pem);
+        }
+    } catch (std::exception& e) {
+        LOG_ERROR("Mock server: TLS initialization failed: ", e.what());
+    }
+    return ctx;
+}
+
+void DeribitMockServer::on_open(websocketpp::connection_hdl hdl) {
+    sessions[hdl] = Session();
+    LOG_INFO("Mock server: client connected (", sessions.size(), " open)");
+}
+
+void DeribitMockServer::on_close(websocketpp::connection_hdl hdl) {
+    sessions.erase(hdl);
+    LOG_INFO("Mock server: client disconnected (", sessions.size(), " open)");
+}
+
+void DeribitMockServer::on_message(websocketpp::connection_hdl hdl, server::message_ptr msg) {
+    int64_t received_us = nowUs();
+    auto session_it = sessions.find(hdl);
+    if (session_it == sessions.end()) {
+        return;
+    }
+    Session& session = session_it->second;
+
+    json request = json::parse(msg->get_payload(), nullptr, false);
+    json response = {{"jsonrpc", "2.0"}, {"id", nullptr}};
+    json error;
+    json result;
+
+    if (request.is_discarded() || !request.is_object() || !request.contains("method") ||
+        !request["method"].is_string()) {
+        error = makeError(ERROR_PARSE, "Parse error");
+    } else {
+        if (request.contains("id")) {
+            response["id"] = request["id"];
+        }
+        const std::string method = request["method"].get<std::string>();
+        const json params = request.contains("params") ? request["params"] : json::object();
+        {
+            std::lock_guard<std::mutex> lock(counts_mutex);
+            ++method_counts[method];
+        }
+
+        if (startsWith(method, "private/") && !session.authenticated) {
+            error = makeError(ERROR_UNAUTHORIZED, "unauthorized");
+        } else if (method == "public/auth") {
+            result = handleAuth(session, params, error);
+        } else if (method == "private/buy" || method == "private/sell") {
+            result = handleOrder(method == "private/buy" ? "buy" : "sell", params, error);
+        } else if (method == "private/edit") {
+            result = handleEdit(params, error);
+        } else if (method == "private/cancel") {
+            result = handleCancel(params, error);
+        } else if (method == "private/cancel_all") {
+            result = handleCancelAll();
+        } else if (method == "private/get_open_orders") {
+            result = handleOpenOrders();
+        } else if (method == "private/get_position") {
+            result = handlePosition(params, error);
+        } else if (method == "private/get_positions") {
+            result = handlePositions();
+        } else if (method == "public/get_instruments") {
+            result = handleInstruments(params);
+        } else if (method == "public/get_order_book") {
+            result = handleOrderBook(session, params, error);
+        } else if (method == "public/subscribe" || method == "private/subscribe") {
+            result = handleSubscribe(session, params);
+        } else if (method == "public/unsubscribe" || method == "private/unsubscribe") {
+            result = handleUnsubscribe(session, params);
+        } else if (method == "public/set_heartbeat") {
+            result = "ok";
+        } else if (method == "public/test") {
+            result = {{"version", "mock"}};
+        } else {
+            error = makeError(ERROR_METHOD_NOT_FOUND, "Method not found");
+        }
+    }
+
+    if (!error.is_null()) {
+        response["error"] = error;
+    } else {
+        response["result"] = result;
+    }
+    int64_t sent_us = nowUs();
+    response["usIn"] = received_us;
+    response["usOut"] = sent_us;
+    response["usDiff"] = sent_us - received_us;
+    response["testnet"] = true;
+
+    send(hdl, response.dump());
+    requests_handled.fetch_add(1, std::memory_order_relaxed);
+
+    // New book subscriptions start with a snapshot, after the subscribe response
+    sendSnapshots(hdl, session);
+}
+
+json DeribitMockServer::handleAuth(Session& session, const json& params, json& error) {
+    std::string client_id = params.value("client_id", "");
+    std::string client_secret = params.value("client_secret", "");
+    if (!config.client_id.empty() &&
+        (client_id != config.client_id || client_secret != config.client_secret)) {
+        error = makeError(ERROR_INVALID_CREDENTIALS, "invalid_credentials");
+        return json();
+    }
+
+    session.authenticated = true;
+    return {
+        {"access_token", "mock-access-" + std::to_string(nowUs())},
+        {"refresh_token", "mock-refresh-" + std::to_string(nowUs())},
+        {"expires_in", 900},
+        {"scope", "connection mainaccount trade:read_write"},
+        {"token_type", "bearer"}
+    };
+}
+
+json DeribitMockServer::handleOrder(const std::string& direction, const json& params, json& error) {
+    if (!params.contains("instrument_name") || !params["instrument_name"].is_string() ||
+        !params.contains("amount") || !params["amount"].is_number() ||
+        params["amount"].get<double>() <= 0.0) {
+        error = makeError(ERROR_INVALID_PARAMS, "Invalid params");
+        return json();
+    }
+
+    MockOrder order;
+    order.order_id = "MOCK-" + std::to_string(next_order_id++);
+    order.instrument_name = params["instrument_name"].get<std::string>();
+    order.direction = direction;
+    order.order_type = params.value("type", "limit");
+    order.time_in_force = params.value("time_in_force", "good_til_cancelled");
+    order.label = params.value("label", "");
+    order.amount = params["amount"].get<double>();
+    order.post_only = params.value("post_only", false);
+    order.reduce_only = params.value("reduce_only", false);
+    order.creation_timestamp = nowMs();
+    order.last_update_timestamp = order.creation_timestamp;
+
+    bool is_buy = direction == "buy";
+    double touch = is_buy ? askPrice(0) : bidPrice(0);
+    bool fills = order.order_type == "market";
+    if (!fills) {
+        if (!params.contains("price") || !params["price"].is_number()) {
+            error = makeError(ERROR_INVALID_PARAMS, "Invalid params");
+            return json();
+        }
+        order.price = params["price"].get<double>();
+        fills = is_buy ? order.price >= touch : order.price <= touch;
+    }
+
+    json trades = json::array();
+    if (fills) {
+        order.filled_amount = order.amount;
+        order.average_price = touch;
+        order.order_state = "filled";
+        applyFill(order, order.amount, touch);
+        trades.push_back({
+            {"trade_id", "MOCK-T" + std::to_string(next_trade_id++)},
+            {"order_id", order.order_id},
+            {"instrument_name", order.instrument_name},
+            {"direction", direction},
+            {"amount", order.amount},
+            {"price", touch},
+            {"timestamp", order.creation_timestamp}
+        });
+    } else if (order.time_in_force == "immediate_or_cancel" || order.time_in_force == "fill_or_kill") {
+        order.order_state = "cancelled";
+    } else {
+        order.order_state = "open";
+        orders[order.order_id] = order;
+    }
+
+    notifyOrder(order);
+    return {{"order", orderToJson(order)}, {"trades", trades}};
+}
+
+json DeribitMockServer::handleEdit(const json& params, json& error) {
+    auto it = orders.find(params.value("order_id", ""));
+    if (it == orders.end()) {
+        error = makeError(ERROR_ORDER_NOT_FOUND, "order_not_found");
+        return json();
+    }
+
+    MockOrder& order = it->second;
+    if (params.contains("amount") && params["amount"].is_number()) {
+        order.amount = params["amount"].get<double>();
+    }
+    if (params.contains("price") && params["price"].is_number()) {
+        order.price = params["price"].get<double>();
+    }
+    order.last_update_timestamp = nowMs();
+
+    // An edit that crosses the touch fills like a new order would
+    bool is_buy = order.direction == "buy";
+    double touch = is_buy ? askPrice(0) : bidPrice(0);
+    json trades = json::array();
+    if (is_buy ? order.price >= touch : order.price <= touch) {
+        double remaining = order.amount - order.filled_amount;
+        applyFill(order, remaining, touch);
+        order.average_price = touch;
+        order.filled_amount = order.amount;
+        order.order_state = "filled";
+        trades.push_back({
+            {"trade_id", "MOCK-T" + std::to_string(next_trade_id++)},
+            {"order_id", order.order_id},
+            {"instrument_name", order.instrument_name},
+            {"direction", order.direction},
+            {"amount", remaining},
+            {"price", touch},
+            {"timestamp", order.last_update_timestamp}
+        });
+    }
+
+    notifyOrder(order);
+    json result = {{"order", orderToJson(order)}, {"trades", trades}};
+    if (order.order_state != "open") {
+        orders.erase(it);
+    }
+    return result;
+}
+
+json DeribitMockServer::handleCancel(const json& params, json& error) {
+    auto it = orders.find(params.value("order_id", ""));
+    if (it == orders.end()) {
+        error = makeError(ERROR_ORDER_NOT_FOUND, "order_not_found");
+        return json();
+    }
+    if (it->second.order_state != "open") {
+        error = makeError(ERROR_NOT_OPEN_ORDER, "not_open_order");
+        return json();
+    }
+
+    MockOrder order = it->second;
+    orders.erase(it);
+    order.order_state = "cancelled";
+    order.last_update_timestamp = nowMs();
+    notifyOrder(order);
+    return orderToJson(order);
+}
+
+// Returns the number of orders cancelled
+json DeribitMockServer::handleCancelAll() {
+    size_t cancelled = 0;
+    for (auto it = orders.begin(); it != orders.end();) {
+        if (it->second.order_state != "open") {
+            ++it;
+            continue;
+        }
+        MockOrder order = it->second;
+        it = orders.erase(it);
+        order.order_state = "cancelled";
+        order.last_update_timestamp = nowMs();
+        notifyOrder(order);
+        ++cancelled;
+    }
+    return cancelled;
+}
+
+json DeribitMockServer::handleOpenOrders() const {
+    json result = json::array();
+    for (const auto& entry : orders) {
+        result.push_back(orderToJson(entry.second));
+    }
+    return result;
+}
+
+json DeribitMockServer::handlePosition(const json& params, json& error) const {
+    if (!params.contains("instrument_name") || !params["instrument_name"].is_string()) {
+        error = makeError(ERROR_INVALID_PARAMS, "Invalid params");
+        return json();
+    }
+
+    std::string instrument_name = params["instrument_name"].get<std::string>();
+    MockPosition position;
+    auto it = positions.find(instrument_name);
+    if (it != positions.end()) {
+        position = it->second;
+    }
+    return positionToJson(instrument_name, position);
+}
+
+// Every instrument with a position, in any currency
+json DeribitMockServer::handlePositions() const {
+    json result = json::array();
+    for (const auto& entry : positions) {
+        if (entry.second.size != 0.0) {
+            result.push_back(positionToJson(entry.first, entry.second));
+        }
+    }
+    return result;
+}
+
+// A single <CURRENCY>-PERPETUAL, quoted at the synthetic books' tick size
+json DeribitMockServer::handleInstruments(const json& params) const {
+    std::string currency = params.value("currency", std::string("BTC"));
+    std::string index = currency + "_usd";
+    std::transform(index.begin(), index.end(), index.begin(), ::tolower);
+    return json::array({{
+        {"instrument_name", currency + "-PERPETUAL"},
+        {"kind", "future"},
+        {"base_currency", currency},
+        {"quote_currency", "USD"},
+        {"settlement_currency", currency},
+        {"price_index", index},
+        {"tick_size", config.tick_size},
+        {"contract_size", 1},
+        {"min_trade_amount", 1},
+        {"maker_commission", 0.0},
+        {"taker_commission", 0.0005},
+        {"expiration_timestamp", 32503708800000LL},
+        {"is_active", true}
+    }});
+}
+
+json DeribitMockServer::positionToJson(const std::string& instrument_name, const MockPosition& position) const {
+    double mark_price = config.base_price;
+    double floating = position.size * (mark_price - position.average_price);
+    return {
+        {"instrument_name", instrument_name},
+        {"kind", "future"},
+        {"direction", position.size > 0 ? "buy" : position.size < 0 ? "sell" : "zero"},
+        {"size", position.size},
+        {"average_price", position.average_price},
+        {"mark_price", mark_price},
+        {"index_price", mark_price},
+        {"floating_profit_loss", floating},
+        {"realized_profit_loss", position.realized_profit_loss},
+        {"total_profit_loss", floating + position.realized_profit_loss},
+        {"estimated_liquidation_price", 0.0},
+        {"leverage", 50}
+    };
+}
+
+// Serves the book of this connection's stream for the instrument if there is
+// one, so a client resynchronizing after a gap gets a matching change_id.
+json DeribitMockServer::handleOrderBook(Session& session, const json& params, json& error) {
+    if (!params.contains("instrument_name") || !params["instrument_name"].is_string()) {
+        error = makeError(ERROR_INVALID_PARAMS, "Invalid params");
+        return json();
+    }
+
+    std::string instrument_name = params["instrument_name"].get<std::string>();
+    int depth = params.value("depth", 5);
+
+    SyntheticBook fresh;
+    const SyntheticBook* book = nullptr;
+    for (const Stream& stream : session.streams) {
+        if (stream.kind == StreamKind::Book && stream.snapshot_sent &&
+            stream.instrument_name == instrument_name) {
+            book = &stream.book;
+            break;
+        }
+    }
+    if (book == nullptr) {
+        initBook(fresh);
+        book = &fresh;
+    }
+
+    json bids = json::array();
+    json asks = json::array();
+    for (int i = 0; i < config.book_depth && static_cast<int>(bids.size()) < depth; ++i) {
+        if (book->bid_amounts[i] > 0.0) {
+            bids.push_back({bidPrice(i), book->bid_amounts[i]});
+        }
+    }
+    for (int i = 0; i < config.book_depth && static_cast<int>(asks.size()) < depth; ++i) {
+        if (book->ask_amounts[i] > 0.0) {
+            asks.push_back({askPrice(i), book->ask_amounts[i]});
+        }
+    }
+
+    return {
+        {"instrument_name", instrument_name},
+        {"timestamp", nowMs()},
+        {"change_id", book->change_id},
+        {"state", "open"},
+        {"bids", bids},
+        {"asks", asks},
+        {"mark_price", config.base_price},
+        {"index_price", config.base_price},
+        {"last_price", config.base_price}
+    };
+}
+
+json DeribitMockServer::handleSubscribe(Session& session, const json& params) {
+    json result = json::array();
+    if (!params.contains("channels") || !params["channels"].is_array()) {
+        return result;
+    }
+
+    for (const auto& value : params["channels"]) {
+        if (!value.is_string()) {
+            continue;
+        }
+        std::string channel = value.get<std::string>();
+
+        bool known = std::any_of(session.streams.begin(), session.streams.end(),
+                                 [&](const Stream& s) { return s.channel == channel; }) ||
+                     std::find(session.order_channels.begin(), session.order_channels.end(),
+                               channel) != session.order_channels.end();
+        if (!known) {
+            if (startsWith(channel, "book.") || startsWith(channel, "trades.")) {
+                Stream stream;
+                stream.kind = startsWith(channel, "book.") ? StreamKind::Book : StreamKind::Trades;
+                stream.channel = channel;
+                stream.instrument_name = instrumentOf(channel);
+                if (stream.kind == StreamKind::Book) {
+                    initBook(stream.book);
+                }
+                session.streams.push_back(std::move(stream));
+            } else if (startsWith(channel, "user.orders.")) {
+                session.order_channels.push_back(channel);
+            }
+        }
+        // Other channels are acknowledged but stay silent
+        result.push_back(channel);
+    }
+    return result;
+}
+
+json DeribitMockServer::handleUnsubscribe(Session& session, const json& params) {
+    json result = json::array();
+    if (!params.contains("channels") || !params["channels"].is_array()) {
+        return result;
+    }
+
+    for (const auto& value : params["channels"]) {
+        if (!value.is_string()) {
+            continue;
+        }
+        std::string channel = value.get<std::string>();
+        session.streams.erase(std::remove_if(session.streams.begin(), session.streams.end(),
+                                             [&](const Stream& s) { return s.channel == channel; }),
+                              session.streams.end());
+        session.order_channels.erase(std::remove(session.order_channels.begin(),
+                                                 session.order_channels.end(), channel),
+                                     session.order_channels.end());
+        result.push_back(channel);
+    }
+    return result;
+}
+
+void DeribitMockServer::scheduleTick() {
+    ws_server.set_timer(TICK_MS, [this](const websocketpp::lib::error_code& ec) {
+        if (ec) {
+            return;
+        }
+        onTick();
+        scheduleTick();
+    });
+}
+
+// Credits every stream with the notifications that came due since the last
+// tick and sends them, capped at MAX_BURST so a stalled client cannot build
+// up an unbounded backlog.
+void DeribitMockServer::onTick() {
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - last_tick).count();
+    last_tick = now;
+
+    double rates[2] = {
+        book_rate.load(std::memory_order_relaxed),
+        trade_rate.load(std::memory_order_relaxed)
+    };
+
+    for (auto& entry : sessions) {
+        websocketpp::connection_hdl hdl = entry.first;
+        for (Stream& stream : entry.second.streams) {
+            if (!stream.snapshot_sent) {
+                continue;
+            }
+            double rate = rates[stream.kind == StreamKind::Book ? 0 : 1];
+            stream.credit = std::min(stream.credit + rate * elapsed, static_cast<double>(MAX_BURST));
+
+            while (stream.credit >= 1.0 && canStream(hdl)) {
+                if (stream.kind == StreamKind::Book) {
+                    encodeBookChange(stream);
+                } else {
+                    encodeTrade(stream);
+                }
+                send(hdl, out);
+                notifications_sent.fetch_add(1, std::memory_order_relaxed);
+                stream.credit -= 1.0;
+            }
+        }
+    }
+}
+
+void DeribitMockServer::sendSnapshots(websocketpp::connection_hdl hdl, Session& session) {
+    for (Stream& stream : session.streams) {
+        if (stream.snapshot_sent) {
+            continue;
+        }
+        stream.snapshot_sent = true;
+        if (stream.kind == StreamKind::Book) {
+            encodeBookSnapshot(stream);
+            send(hdl, out);
+            notifications_sent.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool DeribitMockServer::canStream(websocketpp::connection_hdl hdl) {
+    websocketpp::lib::error_code ec;
+    server::connection_ptr con = ws_server.get_con_from_hdl(hdl, ec);
+    return !ec && con->get_buffered_amount() < config.max_buffered_bytes;
+}
+
+void DeribitMockServer::initBook(SyntheticBook& book) {
+    book.bid_amounts.resize(config.book_depth);
+    book.ask_amounts.resize(config.book_depth);
+    for (int i = 0; i < config.book_depth; ++i) {
+        book.bid_amounts[i] = randomAmount(rng);
+        book.ask_amounts[i] = randomAmount(rng);
+    }
+    book.change_id = 1;
+}
+
+void DeribitMockServer::encodeBookSnapshot(Stream& stream) {
+    beginNotification(stream.channel);
+    out += "{\"type\":\"snapshot\",\"timestamp\":";
+    appendInt(nowMs());
+    out += ",\"instrument_name\":\"";
+    out += stream.instrument_name;
+    out += "\",\"change_id\":";
+    appendInt(stream.book.change_id);
+    out += ",\"bids\":[";
+    appendLevels(stream.book.bid_amounts, true);
+    out += "],\"asks\":[";
+    appendLevels(stream.book.ask_amounts, false);
+    out += "]}";
+    endNotification();
+}
+
+// Changes the amount at one random level. A level that empties is deleted and
+// one that was empty comes back as new, so the client sees all three actions.
+void DeribitMockServer::encodeBookChange(Stream& stream) {
+    SyntheticBook& book = stream.book;
+    bool bid = (rng() & 1) != 0;
+    int level = static_cast<int>(rng() % static_cast<uint32_t>(config.book_depth));
+    double& amount = bid ? book.bid_amounts[level] : book.ask_amounts[level];
+
+    const char* action;
+    if (amount == 0.0) {
+        amount = randomAmount(rng);
+        action = "new";
+    } else if (rng() % 8 == 0) {
+        amount = 0.0;
+        action = "delete";
+    } else {
+        amount = randomAmount(rng);
+        action = "change";
+    }
+
+    beginNotification(stream.channel);
+    out += "{\"type\":\"change\",\"timestamp\":";
+    appendInt(nowMs());
+    out += ",\"prev_change_id\":";
+    appendInt(book.change_id);
+    out += ",\"instrument_name\":\"";
+    out += stream.instrument_name;
+    out += "\",\"change_id\":";
+    appendInt(++book.change_id);
+
+    out += bid ? ",\"bids\":[[\"" : ",\"bids\":[],\"asks\":[[\"";
+    out += action;
+    out += "\",";
+    appendDouble(bid ? bidPrice(level) : askPrice(level));
+    out += ',';
+    appendDouble(amount);
+    out += bid ? "]],\"asks\":[]}" : "]]}";
+    endNotification();
+}
+
+void DeribitMockServer::encodeTrade(Stream& stream) {
+    bool buy = (rng() & 1) != 0;
+    uint64_t trade_id = next_trade_id++;
+
+    beginNotification(stream.channel);
+    out += "[{\"trade_seq\":";
+    appendInt(static_cast<int64_t>(trade_id));
+    out += ",\"trade_id\":\"MOCK-T";
+    appendInt(static_cast<int64_t>(trade_id));
+    out += "\",\"timestamp\":";
+    appendInt(nowMs());
+    out += ",\"tick_direction\":";
+    appendInt(buy ? 0 : 2);
+    out += ",\"price\":";
+    appendDouble(buy ? askPrice(0) : bidPrice(0));
+    out += ",\"mark_price\":";
+    appendDouble(config.base_price);
+    out += ",\"index_price\":";
+    appendDouble(config.base_price);
+    out += ",\"instrument_name\":\"";
+    out += stream.instrument_name;
+    out += "\",\"direction\":\"";
+    out += buy ? "buy" : "sell";
+    out += "\",\"amount\":";
+    appendDouble(randomAmount(rng));
+    out += "}]";
+    endNotification();
+}
+
+void DeribitMockServer::beginNotification(const std::string& channel) {
+    out.assign("{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"");
+    out += channel;
+    out += "\",\"data\":";
+}
+
+void DeribitMockServer::endNotification() {
+    out += "}}";
+}
+
+void DeribitMockServer::appendLevels(const std::vector<double>& amounts, bool bids) {
+    bool first = true;
+    for (int i = 0; i < static_cast<int>(amounts.size()); ++i) {
+        if (amounts[i] == 0.0) {
+            continue;
+        }
+        out += first ? "[\"new\"," : ",[\"new\",";
+        appendDouble(bids ? bidPrice(i) : askPrice(i));
+        out += ',';
+        appendDouble(amounts[i]);
+        out += ']';
+        first = false;
+    }
+}
+
+void DeribitMockServer::appendDouble(double value) {
+    char buffer[32];
+    char* end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+    out.append(buffer, static_cast<size_t>(end - buffer));
+}
+
+void DeribitMockServer::appendInt(int64_t value) {
+    char buffer[24];
+    char* end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+    out.append(buffer, static_cast<size_t>(end - buffer));
+}
+
+// Sends an order update to every user.orders.* subscriber whose channel
+// covers the order's instrument: user.orders.<instrument>.<interval>, or the
+// kind/currency form user.orders.<kind>.<currency>.<interval> (any matches all).
+void DeribitMockServer::notifyOrder(const MockOrder& order) {
+    for (auto& entry : sessions) {
+        for (const std::string& channel : entry.second.order_channels) {
+            std::string scope = instrumentOf(channel.substr(channel.find('.') + 1));
+            std::string currency = instrumentOf(channel.substr(channel.find('.', channel.find('.') + 1) + 1));
+            bool covered = scope == order.instrument_name ||
+                           (std::count(channel.begin(), channel.end(), '.') == 4 &&
+                            (currency == "any" || startsWith(order.instrument_name, (currency + "-").c_str())));
+            if (!covered) {
+                continue;
+            }
+            json notification = {
+                {"jsonrpc", "2.0"},
+                {"method", "subscription"},
+                {"params", {{"channel", channel}, {"data", orderToJson(order)}}}
+            };
+            send(entry.first, notification.dump());
+            notifications_sent.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+json DeribitMockServer::orderToJson(const MockOrder& order) const {
+    json result = {
+        {"order_id", order.order_id},
+        {"instrument_name", order.instrument_name},
+        {"direction", order.direction},
+        {"order_type", order.order_type},
+        {"order_state", order.order_state},
+        {"time_in_force", order.time_in_force},
+        {"label", order.label},
+        {"amount", order.amount},
+        {"filled_amount", order.filled_amount},
+        {"average_price", order.average_price},
+        {"post_only", order.post_only},
+        {"reduce_only", order.reduce_only},
+        {"creation_timestamp", order.creation_timestamp},
+        {"last_update_timestamp", order.last_update_timestamp},
+        {"api", true},
+        {"replaced", false}
+    };
+    if (order.order_type == "market") {
+        result["price"] = "market_price";
+    } else {
+        result["price"] = order.price;
+    }
+    return result;
+}
+
+void DeribitMockServer::applyFill(const MockOrder& order, double amount, double price) {
+    MockPosition& position = positions[order.instrument_name];
+    double signed_amount = order.direction == "buy" ? amount : -amount;
+
+    if (position.size == 0.0 || (position.size > 0) == (signed_amount > 0)) {
+        double size = std::fabs(position.size) + amount;
+        position.average_price = (std::fabs(position.size) * position.average_price + amount * price) / size;
+        position.size += signed_amount;
+        return;
+    }
+
+    // Reducing (and possibly flipping) the position realizes PnL on the closed part
+    double closed = std::min(amount, std::fabs(position.size));
+    double sign = position.size > 0 ? 1.0 : -1.0;
+    position.realized_profit_loss += closed * (price - position.average_price) * sign;
+    position.size += signed_amount;
+    if (position.size == 0.0) {
+        position.average_price = 0.0;
+    } else if ((position.size > 0) != (sign > 0)) {
+        position.average_price = price;
+    }
+}
+
+void DeribitMockServer::send(websocketpp::connection_hdl hdl, const std::string& payload) {
+    websocketpp::lib::error_code ec;
+    ws_server.send(hdl, payload, websocketpp::frame::opcode::text, ec);
+    if (ec) {
+        LOG_DEBUG("Mock server: send failed: ", ec.message());
+    }
+}
+
+int64_t DeribitMockServer::nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int64_t DeribitMockServer::nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+json DeribitMockServer::makeError(int code, const std::string& message) {
+    return {{"code", code}, {"message", message}};
+}
+
+// Creates a throwaway P-256 key and a self-signed certificate for CN=localhost.
+// The client does not verify the server certificate, so this is enough for TLS.
+bool DeribitMockServer::generateCertificate(std::string& certificate_pem, std::string& key_pem) {
+    std::unique_ptr<EVP_PKEY_CTX, decltype(&EVP_PKEY_CTX_free)> key_ctx(
+        EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr), &EVP_PKEY_CTX_free);
+    EVP_PKEY* raw_key = nullptr;
+    if (!key_ctx || EVP_PKEY_keygen_init(key_ctx.get()) <= 0 ||
+        EVP_PKEY_CTX_set_ec_paramgen_curve_nid(key_ctx.get(), NID_X9_62_prime256v1) <= 0 ||
+        EVP_PKEY_keygen(key_ctx.get(), &raw_key) <= 0) {
+        return false;
+    }
+    std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> key(raw_key, &EVP_PKEY_free);
+
+    std::unique_ptr<X509, decltype(&X509_free)> cert(X509_new(), &X509_free);
+    if (!cert) {
+        return false;
+    }
+    X509_set_version(cert.get(), 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert.get()), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert.get()), -3600);
+    X509_gmtime_adj(X509_getm_notAfter(cert.get()), 7 * 24 * 3600);
+    X509_set_pubkey(cert.get(), key.get());
+
+    X509_NAME* name = X509_get_subject_name(cert.get());
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert.get(), name);
+    if (X509_sign(cert.get(), key.get(), EVP_sha256()) <= 0) {
+        return false;
+    }
+
+    auto toPem = [](auto write, std::string& pem) {
+        std::unique_ptr<BIO, decltype(&BIO_free)> bio(BIO_new(BIO_s_mem()), &BIO_free);
+        if (!bio || !write(bio.get())) {
+            return false;
+        }
+        char* data = nullptr;
+        long size = BIO_get_mem_data(bio.get(), &data);
+        pem.assign(data, static_cast<size_t>(size));
+        return true;
+    };
+
+    return toPem([&](BIO* bio) { return PEM_write_bio_X509(bio, cert.get()) == 1; }, certificate_pem) &&
+           toPem([&](BIO* bio) {
+               return PEM_write_bio_PrivateKey(bio, key.get(), nullptr, nullptr, 0, nullptr, nullptr) == 1;
+           }, key_pem);
+}
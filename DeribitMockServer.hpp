@@ -0,0 +1,211 @@
+#pragma once
+
+#include <websocketpp/server.hpp>
+#include <websocketpp/config/asio.hpp>
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+/**
+ * @struct MockServerConfig
+ * @brief Settings of a DeribitMockServer
+ */
+struct MockServerConfig {
+    uint16_t port = 8443;
+    std::string certificate_file;       // PEM certificate chain; empty generates a self-signed one
+    std::string private_key_file;       // PEM private key matching certificate_file
+    std::string client_id;              // Credentials public/auth accepts; empty accepts any
+    std::string client_secret;
+    double book_rate = 10.0;            // book.* notifications per second per subscribed channel
+    double trade_rate = 5.0;            // trades.* notifications per second per subscribed channel
+    int book_depth = 20;                // Levels per side of the synthetic books
+    double base_price = 60000.0;        // Mid price of the synthetic books
+    double tick_size = 0.5;
+    size_t max_buffered_bytes = 8 << 20; // Stream to a connection only while its send queue is below this
+    uint32_t seed = 1;
+};
+
+/**
+ * @class DeribitMockServer
+ * @brief Local TLS WebSocket stand-in for the Deribit JSON-RPC API
+ *
+ * Speaks enough of the API for DeribitAuth to run unchanged against
+ * a loopback address: public/auth, private/buy|sell|edit|cancel|cancel_all,
+ * private/get_open_orders, private/get_position(s), public/get_order_book,
+ * public/get_instruments (one perpetual per currency) and
+ * public|private/subscribe and unsubscribe. Orders live in one in-memory
+ * account: market orders and limit orders that cross the synthetic touch
+ * fill immediately, other limit orders rest until edited or cancelled, and
+ * user.orders.* subscribers are notified of every change. Positions use
+ * linear PnL.
+ *
+ * Every subscribed book.* channel gets its own synthetic book, starting with
+ * a snapshot followed by change notifications with a consistent
+ * change_id/prev_change_id chain; trades.* channels get one trade per
+ * notification. Both are paced at the configured rates from a 1 ms timer,
+ * and a connection whose send queue grows past max_buffered_bytes is skipped
+ * until it catches up, so a slow client sees a lower rate rather than an
+ * ever-growing backlog.
+ *
+ * All protocol work happens on the server's own I/O thread.
+ */
+class DeribitMockServer {
+public:
+    explicit DeribitMockServer(const MockServerConfig& config = MockServerConfig());
+    ~DeribitMockServer();
+
+    // Starts listening and runs the server on a background thread
+    bool start();
+    void stop();
+
+    // e.g. "wss://127.0.0.1:8443/ws/api/v2"
+    std::string uri() const;
+
+    // Streaming rates may be changed while running
+    void setRates(double book_per_second, double trades_per_second);
+
+    // Closes every client connection, as a network drop or server restart would
+    void dropConnections();
+
+    uint64_t notificationsSent() const { return notifications_sent.load(std::memory_order_relaxed); }
+    uint64_t requestsHandled() const { return requests_handled.load(std::memory_order_relaxed); }
+    uint64_t requestsHandled(const std::string& method) const;     // e.g. "private/buy"
+
+private:
+    typedef websocketpp::server<websocketpp::config::asio_tls> server;
+    typedef websocketpp::lib::shared_ptr<websocketpp::lib::asio::ssl::context> context_ptr;
+
+    static const int TICK_MS = 1;
+    static const int MAX_BURST = 1000;          // Notifications per stream per tick
+
+    enum class StreamKind : uint8_t { Book, Trades };
+
+    // Synthetic book on a fixed price grid around base_price; index 0 is the touch
+    struct SyntheticBook {
+        std::vector<double> bid_amounts;
+        std::vector<double> ask_amounts;
+        int64_t change_id = 0;
+    };
+
+    struct Stream {
+        StreamKind kind;
+        std::string channel;
+        std::string instrument_name;
+        double credit = 0.0;                    // Notifications due but not yet sent
+        bool snapshot_sent = false;             // Book streams open with a snapshot
+        SyntheticBook book;
+    };
+
+    struct Session {
+        bool authenticated = false;
+        std::vector<Stream> streams;
+        std::vector<std::string> order_channels;    // user.orders.* subscriptions
+    };
+
+    struct MockOrder {
+        std::string order_id;
+        std::string instrument_name;
+        std::string direction;
+        std::string order_type;
+        std::string order_state;
+        std::string time_in_force;
+        std::string label;
+        double amount = 0.0;
+        double filled_amount = 0.0;
+        double price = 0.0;
+        double average_price = 0.0;
+        bool post_only = false;
+        bool reduce_only = false;
+        int64_t creation_timestamp = 0;
+        int64_t last_update_timestamp = 0;
+    };
+
+    struct MockPosition {
+        double size = 0.0;                          // Signed, positive is long
+        double average_price = 0.0;
+        double realized_profit_loss = 0.0;
+    };
+
+    // WebSocket event handlers
+    context_ptr on_tls_init(websocketpp::connection_hdl hdl);
+    void on_open(websocketpp::connection_hdl hdl);
+    void on_close(websocketpp::connection_hdl hdl);
+    void on_message(websocketpp::connection_hdl hdl, server::message_ptr msg);
+
+    // Request handlers; each returns the JSON-RPC result or fills error
+    json handleAuth(Session& session, const json& params, json& error);
+    json handleOrder(const std::string& direction, const json& params, json& error);
+    json handleEdit(const json& params, json& error);
+    json handleCancel(const json& params, json& error);
+    json handleCancelAll();
+    json handleOpenOrders() const;
+    json handlePosition(const json& params, json& error) const;
+    json handlePositions() const;
+    json handleInstruments(const json& params) const;
+    json handleOrderBook(Session& session, const json& params, json& error);
+    json handleSubscribe(Session& session, const json& params);
+    json handleUnsubscribe(Session& session, const json& params);
+
+    // Streaming
+    void scheduleTick();
+    void onTick();
+    void sendSnapshots(websocketpp::connection_hdl hdl, Session& session);
+    bool canStream(websocketpp::connection_hdl hdl);
+    void encodeBookSnapshot(Stream& stream);
+    void encodeBookChange(Stream& stream);
+    void encodeTrade(Stream& stream);
+    void beginNotification(const std::string& channel);
+    void endNotification();
+    void appendLevels(const std::vector<double>& amounts, bool bids);
+    void appendDouble(double value);
+    void appendInt(int64_t value);
+    void initBook(SyntheticBook& book);
+    void notifyOrder(const MockOrder& order);
+
+    json orderToJson(const MockOrder& order) const;
+    json positionToJson(const std::string& instrument_name, const MockPosition& position) const;
+    void applyFill(const MockOrder& order, double amount, double price);
+    double bidPrice(int level) const { return config.base_price - config.tick_size * (level + 1); }
+    double askPrice(int level) const { return config.base_price + config.tick_size * level; }
+
+    void send(websocketpp::connection_hdl hdl, const std::string& payload);
+    static int64_t nowMs();
+    static int64_t nowUs();
+    static json makeError(int code, const std::string& message);
+    static bool generateCertificate(std::string& certificate_pem, std::string& key_pem);
+
+    MockServerConfig config;
+    server ws_server;
+    std::thread io_thread;
+    bool running;
+    std::chrono::steady_clock::time_point last_tick;
+
+    std::string certificate_pem;
+    std::string key_pem;
+
+    std::map<websocketpp::connection_hdl, Session, std::owner_less<websocketpp::connection_hdl>> sessions;
+    std::map<std::string, MockOrder> orders;
+    std::map<std::string, MockPosition> positions;
+    uint64_t next_order_id;
+    uint64_t next_trade_id;
+
+    std::atomic<double> book_rate;
+    std::atomic<double> trade_rate;
+    std::atomic<uint64_t> notifications_sent;
+    std::atomic<uint64_t> requests_handled;
+    std::map<std::string, uint64_t> method_counts;
+    mutable std::mutex counts_mutex;
+
+    std::mt19937 rng;
+    std::string out;                            // Reused notification buffer
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @class DeribitMpscRing
+ * @brief Bounded multi-producer/single-consumer ring buffer
+ *
+ * Any number of threads may push; one thread pops. Every slot carries a
+ * sequence number that says whose turn it is: a producer claims a slot by
+ * advancing the shared write index with a compare-and-swap, fills it, and
+ * publishes it by storing the slot's sequence; the consumer reads a slot once
+ * its sequence shows it was published. Producers therefore only contend on
+ * the write index, never on each other's slots, and a slow producer delays
+ * only the slot it claimed.
+ *
+ * Use DeribitSpscRing when there is a single producer; it needs no
+ * read-modify-write on the hot path.
+ */
+template <typename T>
+class DeribitMpscRing {
+public:
+    // capacity is rounded up to a power of two
+    explicit DeribitMpscRing(size_t capacity) : write_index(0), read_index(0) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots.reset(new Slot[size]);
+        for (size_t i = 0; i < size; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        mask = size - 1;
+    }
+
+    DeribitMpscRing(const DeribitMpscRing&) = delete;
+    DeribitMpscRing& operator=(const DeribitMpscRing&) = delete;
+
+    size_t capacity() const { return mask + 1; }
+
+    // Producer side; safe from any thread
+    bool tryPush(const T& value) {
+        size_t index = write_index.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[index & mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t lag = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(index);
+            if (lag == 0) {
+                if (write_index.compare_exchange_weak(index, index + 1, std::memory_order_relaxed)) {
+                    slot.value = value;
+                    slot.sequence.store(index + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (lag < 0) {
+                return false;                       // Full: the consumer has not freed this slot yet
+            } else {
+                index = write_index.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer side
+    bool tryPop(T& out) {
+        size_t index = read_index.load(std::memory_order_relaxed);
+        Slot& slot = slots[index & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+            return false;                           // Empty, or the next slot is still being written
+        }
+        out = std::move(slot.value);
+        slot.sequence.store(index + capacity(), std::memory_order_release);
+        read_index.store(index + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Safe from any thread; only a snapshot
+    bool empty() const {
+        return read_index.load(std::memory_order_acquire) == write_index.load(std::memory_order_acquire);
+    }
+
+    size_t size() const {
+        return write_index.load(std::memory_order_acquire) - read_index.load(std::memory_order_acquire);
+    }
+
+private:
+    static const size_t CACHE_LINE = 64;
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+
+    alignas(CACHE_LINE) std::atomic<size_t> write_index;     // Claimed by producers
+    alignas(CACHE_LINE) std::atomic<size_t> read_index;      // Written by the consumer only
+    char padding[CACHE_LINE - sizeof(std::atomic<size_t>)];
+};
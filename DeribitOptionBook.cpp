@@ -0,0 +1,565 @@
+#include "DeribitOptionBook.hpp"
+#include "DeribitOptionPricer.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+const double YEAR_MS = 365.0 * 24 * 3600 * 1000;       // Deribit's option year has 365 days
+const int64_t EXPIRY_HOUR_MS = 8 * 3600 * 1000;         // Options expire at 08:00 UTC
+const double MIN_SMILE_VOL = 0.01;
+
+struct OptionTerms {
+    std::string index_name;
+    int64_t expiration_timestamp;
+    double strike;
+    bool call;
+};
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+int64_t daysFromCivil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    unsigned year_of_era = static_cast<unsigned>(year - era * 400);
+    unsigned day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + static_cast<int64_t>(day_of_era) - 719468;
+}
+
+// 27DEC24 (or 3JAN25) as 08:00 UTC on that day
+bool parseExpiry(std::string_view text, int64_t& out) {
+    static const char* MONTHS[] = {"JAN", "FEB", "MAR", "APR", "MAY", "JUN",
+                                   "JUL", "AUG", "SEP", "OCT", "NOV", "DEC"};
+    if (text.size() != 6 && text.size() != 7) {
+        return false;
+    }
+    size_t day_digits = text.size() - 5;
+    unsigned day = 0;
+    for (size_t i = 0; i < day_digits; ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(text[i]))) {
+            return false;
+        }
+        day = day * 10 + (text[i] - '0');
+    }
+    std::string_view month_text = text.substr(day_digits, 3);
+    unsigned month = 0;
+    for (unsigned m = 0; m < 12; ++m) {
+        if (month_text == MONTHS[m]) {
+            month = m + 1;
+        }
+    }
+    std::string_view year_text = text.substr(day_digits + 3);
+    if (month == 0 || day == 0 || day > 31 || !std::isdigit(static_cast<unsigned char>(year_text[0])) ||
+        !std::isdigit(static_cast<unsigned char>(year_text[1]))) {
+        return false;
+    }
+    int64_t year = 2000 + (year_text[0] - '0') * 10 + (year_text[1] - '0');
+    out = daysFromCivil(year, month, day) * 24 * 3600 * 1000 + EXPIRY_HOUR_MS;
+    return true;
+}
+
+// BTC-27DEC24-60000-C, or XRP_USDC-27DEC24-0d625-P with d for the decimal point
+bool parseOption(std::string_view name, OptionTerms& out) {
+    std::string_view parts[4];
+    size_t count = 0;
+    size_t start = 0;
+    while (count < 4) {
+        size_t dash = name.find('-', start);
+        parts[count++] = name.substr(start, dash == std::string_view::npos ? std::string_view::npos : dash - start);
+        if (dash == std::string_view::npos) {
+            break;
+        }
+        start = dash + 1;
+    }
+    if (count != 4 || name.find('-', start) != std::string_view::npos ||
+        (parts[3] != "C" && parts[3] != "P") || parts[0].empty() || parts[2].empty()) {
+        return false;
+    }
+    if (!parseExpiry(parts[1], out.expiration_timestamp)) {
+        return false;
+    }
+
+    std::string strike(parts[2]);
+    std::replace(strike.begin(), strike.end(), 'd', '.');
+    char* end = nullptr;
+    out.strike = std::strtod(strike.c_str(), &end);
+    if (end != strike.c_str() + strike.size() || !(out.strike > 0.0)) {
+        return false;
+    }
+
+    size_t underscore = parts[0].find('_');
+    std::string_view base = parts[0].substr(0, underscore);
+    std::string_view quote = underscore == std::string_view::npos ? std::string_view("usd") : parts[0].substr(underscore + 1);
+    out.index_name.clear();
+    for (char c : base) {
+        out.index_name += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    out.index_name += '_';
+    for (char c : quote) {
+        out.index_name += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    out.call = parts[3] == "C";
+    return true;
+}
+
+bool positive(double value) {
+    return std::isfinite(value) && value > 0.0;
+}
+
+int64_t wallClockMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+DeribitVolSmile::DeribitVolSmile()
+    : center(0.0), has_center(false), sums(), vol_sums(), coefficients(), x_min(0.0), x_max(0.0),
+      observed(0), updates(0), dirty(false) {}
+
+uint32_t DeribitVolSmile::addPoint(double log_strike) {
+    points_by_id.push_back(Point{log_strike, 0.0, false});
+    return static_cast<uint32_t>(points_by_id.size() - 1);
+}
+
+void DeribitVolSmile::observe(uint32_t point, double volatility) {
+    if (point >= points_by_id.size() || !positive(volatility)) {
+        return;
+    }
+    Point& p = points_by_id[point];
+    if (!has_center) {
+        center = p.x;
+        has_center = true;
+    }
+    if (p.observed) {
+        accumulate(p, -1.0);
+    } else {
+        x_min = observed == 0 ? p.x : std::min(x_min, p.x);
+        x_max = observed == 0 ? p.x : std::max(x_max, p.x);
+        ++observed;
+    }
+    p.vol = volatility;
+    p.observed = true;
+    accumulate(p, 1.0);
+    ++updates;
+    dirty = true;
+}
+
+void DeribitVolSmile::refit(double forward) {
+    if (positive(forward)) {
+        double log_forward = std::log(forward);
+        if (!has_center || std::fabs(log_forward - center) > RECENTER) {
+            center = log_forward;
+            has_center = true;
+            rebuild();
+        }
+    }
+    if (updates >= REBUILD_EVERY) {
+        rebuild();
+    }
+    if (dirty) {
+        solve();
+        dirty = false;
+    }
+}
+
+double DeribitVolSmile::volAt(double log_strike) const {
+    if (observed == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    double k = std::min(std::max(log_strike, x_min), x_max) - center;
+    double vol = coefficients[0] + k * (coefficients[1] + k * coefficients[2]);
+    return std::max(vol, MIN_SMILE_VOL);
+}
+
+void DeribitVolSmile::snapshot(double forward, SmileSnapshot& out) const {
+    out.points = observed;
+    if (observed == 0 || !positive(forward)) {
+        return;
+    }
+    double k = std::log(forward) - center;
+    out.atm_vol = volAt(std::log(forward));
+    out.skew = coefficients[1] + 2.0 * coefficients[2] * k;
+    out.curvature = coefficients[2];
+}
+
+void DeribitVolSmile::accumulate(const Point& point, double sign) {
+    double k = point.x - center;
+    double k2 = k * k;
+    sums[0] += sign;
+    sums[1] += sign * k;
+    sums[2] += sign * k2;
+    sums[3] += sign * k2 * k;
+    sums[4] += sign * k2 * k2;
+    vol_sums[0] += sign * point.vol;
+    vol_sums[1] += sign * point.vol * k;
+    vol_sums[2] += sign * point.vol * k2;
+}
+
+void DeribitVolSmile::rebuild() {
+    std::fill(std::begin(sums), std::end(sums), 0.0);
+    std::fill(std::begin(vol_sums), std::end(vol_sums), 0.0);
+    for (const auto& point : points_by_id) {
+        if (point.observed) {
+            accumulate(point, 1.0);
+        }
+    }
+    updates = 0;
+    dirty = true;
+}
+
+// Least squares through the normal equations, by Cramer's rule
+void DeribitVolSmile::solve() {
+    const double s0 = sums[0], s1 = sums[1], s2 = sums[2], s3 = sums[3], s4 = sums[4];
+    const double v0 = vol_sums[0], v1 = vol_sums[1], v2 = vol_sums[2];
+    std::fill(std::begin(coefficients), std::end(coefficients), 0.0);
+    if (observed == 0) {
+        return;
+    }
+    coefficients[0] = v0 / s0;
+    if (x_max - x_min < 1e-9) {
+        return;
+    }
+
+    double det = s0 * (s2 * s4 - s3 * s3) - s1 * (s1 * s4 - s3 * s2) + s2 * (s1 * s3 - s2 * s2);
+    if (observed >= 3 && std::fabs(det) > 1e-12 * s0 * s2 * s4) {
+        coefficients[0] = (v0 * (s2 * s4 - s3 * s3) - s1 * (v1 * s4 - s3 * v2) + s2 * (v1 * s3 - s2 * v2)) / det;
+        coefficients[1] = (s0 * (v1 * s4 - v2 * s3) - v0 * (s1 * s4 - s3 * s2) + s2 * (s1 * v2 - v1 * s2)) / det;
+        coefficients[2] = (s0 * (s2 * v2 - s3 * v1) - s1 * (s1 * v2 - v1 * s2) + v0 * (s1 * s3 - s2 * s2)) / det;
+        return;
+    }
+    double det2 = s0 * s2 - s1 * s1;
+    if (std::fabs(det2) > 1e-12 * s0 * s2) {
+        coefficients[0] = (v0 * s2 - s1 * v1) / det2;
+        coefficients[1] = (s0 * v1 - s1 * v0) / det2;
+    }
+}
+
+struct DeribitOptionBook::Expiry {
+    int64_t expiration_timestamp = 0;
+    double basis = 1.0;             // Forward over index, from the latest option ticker
+    double forward = 0.0;
+    double years = 0.0;
+    size_t options = 0;
+    DeribitVolSmile smile;
+};
+
+// One index's options as parallel arrays, in the order they were first seen
+struct DeribitOptionBook::Chain {
+    std::string index_name;
+    double index_price = 0.0;
+    int64_t index_timestamp = 0;
+    std::vector<Expiry> expiries;
+    uint64_t reprices = 0;
+    int64_t last_reprice_ns = 0;
+    size_t priced_count = 0;
+
+    std::vector<uint32_t> name;     // Ids in DeribitOptionBook::names
+    std::vector<uint32_t> expiry;   // Index into expiries
+    std::vector<uint32_t> point;    // Id in the expiry's smile
+    std::vector<double> strike;
+    std::vector<double> log_strike;
+    std::vector<double> is_call;
+    std::vector<double> market_iv;
+    std::vector<uint8_t> priced;
+
+    // Inputs and outputs of the last repricing
+    std::vector<double> forward;
+    std::vector<double> years;
+    std::vector<double> volatility;
+    std::vector<double> price;
+    std::vector<double> delta;
+    std::vector<double> gamma;
+    std::vector<double> vega;
+    std::vector<double> theta;
+
+    uint32_t add(uint32_t name_id, const OptionTerms& terms) {
+        uint32_t e = 0;
+        while (e < expiries.size() && expiries[e].expiration_timestamp != terms.expiration_timestamp) {
+            ++e;
+        }
+        if (e == expiries.size()) {
+            expiries.emplace_back();
+            expiries.back().expiration_timestamp = terms.expiration_timestamp;
+        }
+        Expiry& target = expiries[e];
+        ++target.options;
+
+        name.push_back(name_id);
+        expiry.push_back(e);
+        strike.push_back(terms.strike);
+        log_strike.push_back(std::log(terms.strike));
+        point.push_back(target.smile.addPoint(log_strike.back()));
+        is_call.push_back(terms.call ? 1.0 : 0.0);
+        market_iv.push_back(std::numeric_limits<double>::quiet_NaN());
+        priced.push_back(0);
+        for (auto* values : { &forward, &years, &volatility, &price, &delta, &gamma, &vega, &theta }) {
+            values->push_back(0.0);
+        }
+        return static_cast<uint32_t>(name.size() - 1);
+    }
+};
+
+DeribitOptionBook::DeribitOptionBook() {}
+
+DeribitOptionBook::~DeribitOptionBook() {}
+
+const DeribitOptionBook::Slot* DeribitOptionBook::slotFor(std::string_view instrument_name) {
+    uint32_t id = names.intern(instrument_name);
+    if (id == slots.size()) {
+        Slot slot{NOT_AN_OPTION, 0};
+        OptionTerms terms;
+        if (parseOption(instrument_name, terms)) {
+            chainFor(terms.index_name, true);
+            slot.chain = index_names.find(terms.index_name);
+            slot.option = chains_by_id[slot.chain]->add(id, terms);
+        }
+        slots.push_back(slot);
+    }
+    return slots[id].chain != NOT_AN_OPTION ? &slots[id] : nullptr;
+}
+
+DeribitOptionBook::Chain* DeribitOptionBook::chainFor(std::string_view index_name, bool create) {
+    uint32_t id = create ? index_names.intern(index_name) : index_names.find(index_name);
+    if (id == DeribitKeyIndex::NO_KEY) {
+        return nullptr;
+    }
+    if (id == chains_by_id.size()) {
+        chains_by_id.push_back(std::make_unique<Chain>());
+        chains_by_id.back()->index_name = std::string(index_name);
+    }
+    return chains_by_id[id].get();
+}
+
+const DeribitOptionBook::Chain* DeribitOptionBook::findChain(std::string_view index_name) const {
+    uint32_t id = index_names.find(index_name);
+    return id != DeribitKeyIndex::NO_KEY ? chains_by_id[id].get() : nullptr;
+}
+
+// Option tickers and trades carry the index too; it stands in until an index tick arrives
+void DeribitOptionBook::observeMarket(Chain& chain, double index_price, int64_t timestamp_ms) {
+    if (positive(index_price) && timestamp_ms >= chain.index_timestamp) {
+        chain.index_price = index_price;
+        chain.index_timestamp = timestamp_ms;
+    }
+}
+
+void DeribitOptionBook::onTicker(const TickerEvent& ticker) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Slot* slot = slotFor(ticker.instrument_name);
+    if (slot == nullptr) {
+        return;
+    }
+    Chain& chain = *chains_by_id[slot->chain];
+    Expiry& expiry = chain.expiries[chain.expiry[slot->option]];
+    if (positive(ticker.underlying_price) && positive(ticker.index_price)) {
+        expiry.basis = ticker.underlying_price / ticker.index_price;
+    }
+    if (positive(ticker.mark_iv)) {
+        chain.market_iv[slot->option] = ticker.mark_iv / 100.0;
+        expiry.smile.observe(chain.point[slot->option], ticker.mark_iv / 100.0);
+    }
+    observeMarket(chain, ticker.index_price, ticker.timestamp);
+}
+
+void DeribitOptionBook::onTrade(const TradeEvent& trade) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Slot* slot = slotFor(trade.instrument_name);
+    if (slot == nullptr) {
+        return;
+    }
+    Chain& chain = *chains_by_id[slot->chain];
+    uint32_t option = slot->option;
+    Expiry& expiry = chain.expiries[chain.expiry[option]];
+    observeMarket(chain, trade.index_price, trade.timestamp);
+
+    double iv = trade.iv / 100.0;
+    if (!positive(iv) && positive(chain.index_price)) {
+        // Premiums are in coin; the forward turns them into the quote currency
+        double forward = chain.index_price * expiry.basis;
+        double years = (expiry.expiration_timestamp - trade.timestamp) / YEAR_MS;
+        iv = DeribitOptionPricer::impliedVol(forward, chain.strike[option], years, trade.price * forward,
+                                             chain.is_call[option] > 0.5);
+    }
+    if (positive(iv)) {
+        chain.market_iv[option] = iv;
+        expiry.smile.observe(chain.point[option], iv);
+    }
+}
+
+void DeribitOptionBook::onIndex(std::string_view index_name, double price, int64_t timestamp_ms) {
+    if (!positive(price)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    Chain& chain = *chainFor(index_name, true);
+    chain.index_price = price;
+    chain.index_timestamp = timestamp_ms > 0 ? timestamp_ms : wallClockMs();
+    repriceLocked(chain);
+}
+
+bool DeribitOptionBook::reprice(std::string_view index_name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Chain* chain = chainFor(index_name, false);
+    return chain != nullptr && repriceLocked(*chain);
+}
+
+bool DeribitOptionBook::repriceLocked(Chain& chain) {
+    if (!positive(chain.index_price)) {
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    for (auto& expiry : chain.expiries) {
+        expiry.forward = chain.index_price * expiry.basis;
+        expiry.years = std::max(0.0, (expiry.expiration_timestamp - chain.index_timestamp) / YEAR_MS);
+        expiry.smile.refit(expiry.forward);
+    }
+    size_t count = chain.name.size();
+    chain.priced_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const Expiry& expiry = chain.expiries[chain.expiry[i]];
+        chain.forward[i] = expiry.forward;
+        chain.years[i] = expiry.years;
+        double vol = expiry.smile.volAt(chain.log_strike[i]);
+        chain.volatility[i] = std::isnan(vol) ? chain.market_iv[i] : vol;
+        chain.priced[i] = !std::isnan(chain.volatility[i]);
+        chain.priced_count += chain.priced[i];
+    }
+
+    OptionBatch batch;
+    batch.count = count;
+    batch.forward = chain.forward.data();
+    batch.strike = chain.strike.data();
+    batch.years = chain.years.data();
+    batch.volatility = chain.volatility.data();
+    batch.is_call = chain.is_call.data();
+    batch.price = chain.price.data();
+    batch.delta = chain.delta.data();
+    batch.gamma = chain.gamma.data();
+    batch.vega = chain.vega.data();
+    batch.theta = chain.theta.data();
+    DeribitOptionPricer::price(batch);
+
+    ++chain.reprices;
+    chain.last_reprice_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+void DeribitOptionBook::fill(const Chain& chain, uint32_t option, OptionGreeks& out) const {
+    const Expiry& expiry = chain.expiries[chain.expiry[option]];
+    out = OptionGreeks();
+    out.instrument_name = names.key(chain.name[option]);
+    out.expiration_timestamp = expiry.expiration_timestamp;
+    out.strike = chain.strike[option];
+    out.call = chain.is_call[option] > 0.5;
+    out.market_iv = chain.market_iv[option];
+    out.forward = chain.forward[option];
+    out.years = chain.years[option];
+    out.volatility = chain.volatility[option];
+    out.price = chain.price[option];
+    out.delta = chain.delta[option];
+    out.gamma = chain.gamma[option];
+    out.vega = chain.vega[option];
+    out.theta = chain.theta[option];
+}
+
+bool DeribitOptionBook::greeks(std::string_view instrument_name, OptionGreeks& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t id = names.find(instrument_name);
+    if (id == DeribitKeyIndex::NO_KEY || slots[id].chain == NOT_AN_OPTION) {
+        return false;
+    }
+    const Chain& chain = *chains_by_id[slots[id].chain];
+    if (!chain.priced[slots[id].option]) {
+        return false;
+    }
+    fill(chain, slots[id].option, out);
+    return true;
+}
+
+size_t DeribitOptionBook::chain(std::string_view index_name, std::vector<OptionGreeks>& out) const {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    const Chain* chain = findChain(index_name);
+    if (chain == nullptr) {
+        return 0;
+    }
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < chain->name.size(); ++i) {
+        if (chain->priced[i]) {
+            order.push_back(i);
+        }
+    }
+    std::sort(order.begin(), order.end(), [chain](uint32_t a, uint32_t b) {
+        int64_t expiry_a = chain->expiries[chain->expiry[a]].expiration_timestamp;
+        int64_t expiry_b = chain->expiries[chain->expiry[b]].expiration_timestamp;
+        if (expiry_a != expiry_b) {
+            return expiry_a < expiry_b;
+        }
+        if (chain->strike[a] != chain->strike[b]) {
+            return chain->strike[a] < chain->strike[b];
+        }
+        return chain->is_call[a] > chain->is_call[b];
+    });
+    out.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        fill(*chain, order[i], out[i]);
+    }
+    return out.size();
+}
+
+size_t DeribitOptionBook::smiles(std::string_view index_name, std::vector<SmileSnapshot>& out) const {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    const Chain* chain = findChain(index_name);
+    if (chain == nullptr) {
+        return 0;
+    }
+    for (const auto& expiry : chain->expiries) {
+        SmileSnapshot smile;
+        smile.expiration_timestamp = expiry.expiration_timestamp;
+        smile.forward = expiry.forward;
+        smile.years = expiry.years;
+        smile.options = expiry.options;
+        expiry.smile.snapshot(expiry.forward, smile);
+        out.push_back(smile);
+    }
+    std::sort(out.begin(), out.end(), [](const SmileSnapshot& a, const SmileSnapshot& b) {
+        return a.expiration_timestamp < b.expiration_timestamp;
+    });
+    return out.size();
+}
+
+size_t DeribitOptionBook::chains(std::vector<OptionChainStats>& out) const {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& chain : chains_by_id) {
+        if (chain->name.empty()) {
+            continue;
+        }
+        OptionChainStats stats;
+        stats.index_name = chain->index_name;
+        stats.index_price = chain->index_price;
+        stats.index_timestamp = chain->index_timestamp;
+        stats.options = chain->name.size();
+        stats.priced = chain->priced_count;
+        stats.expiries = chain->expiries.size();
+        stats.reprices = chain->reprices;
+        stats.last_reprice_ns = chain->last_reprice_ns;
+        out.push_back(stats);
+    }
+    return out.size();
+}
+
+void DeribitOptionBook::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    names.clear();
+    slots.clear();
+    index_names.clear();
+    chains_by_id.clear();
+}
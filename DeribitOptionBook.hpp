@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DeribitKeyIndex.hpp"
+#include "DeribitMessageDecoder.hpp"
+
+// One option as of its chain's latest repricing
+struct OptionGreeks {
+    std::string instrument_name;
+    int64_t expiration_timestamp = 0;   // ms since the epoch
+    double strike = 0.0;
+    bool call = true;
+    double forward = 0.0;
+    double years = 0.0;                 // To expiry, from the index timestamp
+    double market_iv = std::numeric_limits<double>::quiet_NaN();   // Latest mark_iv or trade iv; 0.6 for 60%
+    double volatility = 0.0;            // Priced at: the smile at this strike, else market_iv
+    double price = 0.0;                 // Quote currency (USD for BTC options) per unit of underlying
+    double delta = 0.0;
+    double gamma = 0.0;
+    double vega = 0.0;                  // Per volatility point
+    double theta = 0.0;                 // Per calendar day
+};
+
+// The fitted smile of one expiry
+struct SmileSnapshot {
+    int64_t expiration_timestamp = 0;
+    double forward = 0.0;
+    double years = 0.0;
+    double atm_vol = std::numeric_limits<double>::quiet_NaN();
+    double skew = 0.0;                  // d vol / d ln(K / F) at the money
+    double curvature = 0.0;             // Half of d2 vol / d ln(K / F)^2
+    size_t points = 0;                  // Options with an observed volatility
+    size_t options = 0;
+};
+
+struct OptionChainStats {
+    std::string index_name;             // e.g. btc_usd
+    double index_price = 0.0;
+    int64_t index_timestamp = 0;
+    size_t options = 0;
+    size_t priced = 0;                  // Options with a volatility at the last repricing
+    size_t expiries = 0;
+    uint64_t reprices = 0;
+    int64_t last_reprice_ns = 0;        // Duration of the last repricing
+};
+
+/**
+ * @class DeribitVolSmile
+ * @brief Implied volatility of one expiry as a quadratic in log strike, refit
+ *        incrementally
+ *
+ * Every option of the expiry is a point at x = ln(strike) holding its latest
+ * observed volatility. The fit is least squares of vol = a + b k + c k^2 with
+ * k = x - ln(F), and it is kept as the sums of its normal equations:
+ * replacing one observation subtracts the old point and adds the new one, and
+ * refit() solves a 3x3 system, so neither depends on the number of strikes.
+ * The centre only moves when the forward has drifted more than 1% from it,
+ * which rebuilds the sums (sticky strike in between). They are also rebuilt
+ * every few thousand updates to shed rounding drift. With fewer than three
+ * distinct strikes the fit drops to a line or a constant. Outside the
+ * observed strikes the smile is flat, and it never goes below 1%.
+ *
+ * Not thread-safe; DeribitOptionBook guards it.
+ */
+class DeribitVolSmile {
+public:
+    DeribitVolSmile();
+
+    // A new point; its id is the number of points before it
+    uint32_t addPoint(double log_strike);
+
+    // Replaces the point's observation; ignored unless volatility is positive
+    void observe(uint32_t point, double volatility);
+
+    // Recentres on forward if it has drifted, and solves again if anything changed
+    void refit(double forward);
+
+    double volAt(double log_strike) const;      // NaN without observations
+    size_t points() const { return observed; }
+    void snapshot(double forward, SmileSnapshot& out) const;
+
+private:
+    struct Point {
+        double x;
+        double vol;
+        bool observed;
+    };
+
+    void accumulate(const Point& point, double sign);
+    void rebuild();
+    void solve();
+
+    static constexpr double RECENTER = 0.01;
+    static constexpr size_t REBUILD_EVERY = 4096;
+
+    std::vector<Point> points_by_id;
+    double center;
+    bool has_center;
+    double sums[5];         // Sum of k^0 .. k^4 over observed points
+    double vol_sums[3];     // Sum of vol * k^0 .. k^2
+    double coefficients[3];
+    double x_min;
+    double x_max;
+    size_t observed;
+    size_t updates;         // Since the last rebuild
+    bool dirty;
+};
+
+/**
+ * @class DeribitOptionBook
+ * @brief Greeks of whole option chains, repriced on every index tick, over
+ *        per-expiry volatility smiles
+ *
+ * Options are grouped into chains by their index (BTC-27DEC24-60000-C and
+ * every other BTC option belong to btc_usd; SOL_USDC options to sol_usdc),
+ * and within a chain by expiry. Strike, expiry and type come from the
+ * instrument name, so a replay needs no instrument metadata. Option tickers
+ * give each option's mark_iv and each expiry's forward (underlying_price,
+ * kept as a ratio to the index); option trades give the iv they printed at,
+ * or one implied from their price. Both land in the expiry's DeribitVolSmile.
+ *
+ * Every deribit_price_index.* tick moves each expiry's forward with the
+ * index, refits the smiles that changed and prices the whole chain in one
+ * DeribitOptionPricer::price() call over its parallel arrays; a chain of a
+ * thousand options takes tens of microseconds. Time to expiry runs on
+ * exchange timestamps, so a replay reproduces the live greeks. Options
+ * without any volatility yet are left unpriced.
+ *
+ * Updates come from several io threads when a market data pool is enabled,
+ * so access takes a mutex, like DeribitTradeAggregator.
+ */
+class DeribitOptionBook {
+public:
+    DeribitOptionBook();
+    ~DeribitOptionBook();
+
+    // Update side (io threads, or a replay); anything but options is ignored
+    void onTicker(const TickerEvent& ticker);
+    void onTrade(const TradeEvent& trade);
+    void onIndex(std::string_view index_name, double price, int64_t timestamp_ms);
+
+    // Prices the chain again at its latest index price; false before it has one
+    bool reprice(std::string_view index_name);
+
+    // Query side (any thread)
+    bool greeks(std::string_view instrument_name, OptionGreeks& out) const;
+
+    // Every option of the chain, by expiry, strike and then calls first
+    size_t chain(std::string_view index_name, std::vector<OptionGreeks>& out) const;
+    size_t smiles(std::string_view index_name, std::vector<SmileSnapshot>& out) const;
+    size_t chains(std::vector<OptionChainStats>& out) const;
+    void clear();
+
+private:
+    struct Expiry;
+    struct Chain;
+
+    struct Slot {
+        uint32_t chain;
+        uint32_t option;
+    };
+    static constexpr uint32_t NOT_AN_OPTION = DeribitKeyIndex::NO_KEY;
+
+    const Slot* slotFor(std::string_view instrument_name);
+    Chain* chainFor(std::string_view index_name, bool create);
+    const Chain* findChain(std::string_view index_name) const;
+    void observeMarket(Chain& chain, double index_price, int64_t timestamp_ms);
+    bool repriceLocked(Chain& chain);
+    void fill(const Chain& chain, uint32_t option, OptionGreeks& out) const;
+
+    DeribitKeyIndex names;
+    std::vector<Slot> slots;                    // Indexed by names
+    DeribitKeyIndex index_names;
+    std::vector<std::unique_ptr<Chain>> chains_by_id;
+    mutable std::mutex mutex;
+};
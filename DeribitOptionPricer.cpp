@@ -0,0 +1,397 @@
+#include "DeribitOptionPricer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const size_t LANES = DeribitOptionPricer::LANES;
+typedef double Lanes __attribute__((vector_size(LANES * sizeof(double))));
+typedef int64_t LaneMask __attribute__((vector_size(LANES * sizeof(int64_t))));
+
+const double INV_SQRT_2PI = 0.3989422804014327;
+const double INV_SQRT2 = 0.7071067811865476;
+const double SQRT2 = 1.4142135623730951;
+const double SQRT_2PI = 2.5066282746310002;
+const double LOG2E = 1.4426950408889634;
+const double LN2 = 0.6931471805599453;
+const double LN2_HI = 6.93147180369123816490e-01;   // LN2 split so n * LN2_HI is exact
+const double LN2_LO = 1.90821492927058770002e-10;
+const double ROUND = 6755399441055744.0;            // 1.5 * 2^52
+const double DAYS_PER_YEAR = 365.0;
+const double VOLATILITY_TOLERANCE = 1e-10;
+const int MAX_ITERATIONS = 64;
+// Below this fraction of the price, time value is rounding and says nothing about volatility
+const double TIME_VALUE_RESOLUTION = 1e-11;
+
+// Padding for the unused lanes of a partial block: an at-the-money option that prices cleanly
+const double PAD_FORWARD = 1.0;
+const double PAD_YEARS = 1.0;
+const double PAD_VOLATILITY = 0.5;
+const double PAD_PRICE = 0.2;
+
+// By reference: returning a vector type by value warns about its ABI
+inline void splat(Lanes& lanes, double value) {
+    for (size_t l = 0; l < LANES; ++l) {
+        lanes[l] = value;
+    }
+}
+
+// The first count values, then fill
+inline void loadLanes(Lanes& lanes, const double* values, size_t count, double fill) {
+    if (count == LANES) {
+        std::memcpy(&lanes, values, sizeof(lanes));
+        return;
+    }
+    splat(lanes, fill);
+    std::memcpy(&lanes, values, count * sizeof(double));
+}
+
+inline void storeLanes(double* values, const Lanes& lanes, size_t count) {
+    if (values != nullptr) {
+        std::memcpy(values, &lanes, count * sizeof(double));
+    }
+}
+
+inline void sqrtLanes(Lanes& out, const Lanes& x) {
+    for (size_t l = 0; l < LANES; ++l) {
+        out[l] = std::sqrt(x[l] > 0.0 ? x[l] : 0.0);
+    }
+}
+
+// e^x: x = n ln2 + r with |r| <= ln2 / 2, e^r from its Taylor series to r^11
+// (error below 1e-15), and 2^n put straight into the exponent bits
+inline void expLanes(Lanes& out, const Lanes& in) {
+    Lanes low, high;
+    splat(low, -708.0);
+    splat(high, 708.0);
+    Lanes x = in < low ? low : in;
+    x = x > high ? high : x;
+
+    // Adding 1.5 * 2^52 rounds to an integer, which then sits in the low
+    // mantissa bits; SSE2 and AVX2 have no packed double to int64 conversion
+    Lanes shifted = x * LOG2E + ROUND;
+    Lanes n = shifted - ROUND;
+    Lanes r = x - n * LN2_HI - n * LN2_LO;
+
+    Lanes p = r * (1.0 / 39916800.0) + 1.0 / 3628800.0;
+    p = p * r + 1.0 / 362880.0;
+    p = p * r + 1.0 / 40320.0;
+    p = p * r + 1.0 / 5040.0;
+    p = p * r + 1.0 / 720.0;
+    p = p * r + 1.0 / 120.0;
+    p = p * r + 1.0 / 24.0;
+    p = p * r + 1.0 / 6.0;
+    p = p * r + 0.5;
+    p = p * r + 1.0;
+    p = p * r + 1.0;
+
+    LaneMask n_bits, round_bits;
+    Lanes round;
+    splat(round, ROUND);
+    std::memcpy(&n_bits, &shifted, sizeof(n_bits));
+    std::memcpy(&round_bits, &round, sizeof(round_bits));
+    LaneMask bits = (n_bits - round_bits + 1023) << 52;
+    Lanes scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    out = p * scale;
+}
+
+// ln x for positive, normal x: x = m 2^e with m in [sqrt(2)/2, sqrt(2)), and
+// ln m = 2 atanh((m - 1) / (m + 1)) from its series to the 21st power
+inline void logLanes(Lanes& out, const Lanes& x) {
+    LaneMask bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    // The biased exponent, as a double by the same 2^52 trick as expLanes()
+    LaneMask exponent_bits = ((bits >> 52) & 0x7ff) | 0x4330000000000000LL;
+    Lanes e;
+    std::memcpy(&e, &exponent_bits, sizeof(e));
+    e -= 4503599627370496.0 + 1023.0;
+    LaneMask mantissa_bits = (bits & 0x000fffffffffffffLL) | 0x3ff0000000000000LL;
+    Lanes m;
+    std::memcpy(&m, &mantissa_bits, sizeof(m));
+
+    LaneMask large = m > SQRT2;
+    Lanes half = m * 0.5;
+    Lanes e_up = e + 1.0;
+    m = large ? half : m;
+    e = large ? e_up : e;
+
+    Lanes s = (m - 1.0) / (m + 1.0);
+    Lanes s2 = s * s;
+    Lanes p = s2 * (1.0 / 21.0) + 1.0 / 19.0;
+    p = p * s2 + 1.0 / 17.0;
+    p = p * s2 + 1.0 / 15.0;
+    p = p * s2 + 1.0 / 13.0;
+    p = p * s2 + 1.0 / 11.0;
+    p = p * s2 + 1.0 / 9.0;
+    p = p * s2 + 1.0 / 7.0;
+    p = p * s2 + 1.0 / 5.0;
+    p = p * s2 + 1.0 / 3.0;
+    p = p * s2 + 1.0;
+    out = e * LN2 + 2.0 * s * p;
+}
+
+// N(d) and N(-d). The tail N(-|d|) comes from erfc (Numerical Recipes' erfcc,
+// relative error below 1.2e-7), so small probabilities stay accurate.
+inline void normalLanes(const Lanes& d, Lanes& below, Lanes& above) {
+    Lanes negated = -d;
+    Lanes z = (d < 0.0 ? negated : d) * INV_SQRT2;
+    Lanes t = 1.0 / (1.0 + 0.5 * z);
+
+    Lanes q = t * 0.17087277 - 0.82215223;
+    q = q * t + 1.48851587;
+    q = q * t - 1.13520398;
+    q = q * t + 0.27886807;
+    q = q * t - 0.18628806;
+    q = q * t + 0.09678418;
+    q = q * t + 0.37409196;
+    q = q * t + 1.00002368;
+    Lanes e;
+    expLanes(e, -z * z - 1.26551223 + t * q);
+
+    Lanes tail = 0.5 * t * e;
+    Lanes rest = 1.0 - tail;
+    LaneMask negative = d < 0.0;
+    below = negative ? tail : rest;
+    above = negative ? rest : tail;
+}
+
+struct BlackLanes {
+    Lanes otm;          // Value of the out-of-the-money side: the call if strike >= forward
+    Lanes n_d1;         // N(d1)
+    Lanes n_minus_d1;   // N(-d1)
+    Lanes density;      // Standard normal density at d1
+};
+
+// sqrt_t and sigma must be positive in every lane
+inline void blackLanes(const Lanes& forward, const Lanes& strike, const Lanes& log_moneyness,
+                       const Lanes& sqrt_t, const Lanes& sigma, BlackLanes& out) {
+    Lanes deviation = sigma * sqrt_t;
+    Lanes d1 = log_moneyness / deviation + 0.5 * deviation;
+    Lanes d2 = d1 - deviation;
+    Lanes n_d2, n_minus_d2;
+    normalLanes(d1, out.n_d1, out.n_minus_d1);
+    normalLanes(d2, n_d2, n_minus_d2);
+
+    Lanes call = forward * out.n_d1 - strike * n_d2;
+    Lanes put = strike * n_minus_d2 - forward * out.n_minus_d1;
+    Lanes otm = strike >= forward ? call : put;
+    Lanes zero = {};
+    out.otm = otm > zero ? otm : zero;
+
+    expLanes(out.density, -0.5 * d1 * d1);
+    out.density *= INV_SQRT_2PI;
+}
+
+// Scalar Black-76 on the out-of-the-money side, with vega per unit of volatility
+double otmValue(double forward, double strike, double sqrt_t, double sigma, double& vega) {
+    double deviation = sigma * sqrt_t;
+    double d1 = std::log(forward / strike) / deviation + 0.5 * deviation;
+    double d2 = d1 - deviation;
+    vega = forward * INV_SQRT_2PI * std::exp(-0.5 * d1 * d1) * sqrt_t;
+    double value = strike >= forward
+                 ? forward * 0.5 * std::erfc(-d1 * INV_SQRT2) - strike * 0.5 * std::erfc(-d2 * INV_SQRT2)
+                 : strike * 0.5 * std::erfc(d2 * INV_SQRT2) - forward * 0.5 * std::erfc(d1 * INV_SQRT2);
+    return std::max(value, 0.0);
+}
+
+}  // namespace
+
+void DeribitOptionPricer::price(const OptionBatch& batch) {
+    Lanes zero = {}, one, minus_one;
+    splat(one, 1.0);
+    splat(minus_one, -1.0);
+
+    for (size_t i = 0; i < batch.count; i += LANES) {
+        size_t count = std::min(LANES, batch.count - i);
+        Lanes forward, strike, years, sigma, is_call;
+        loadLanes(forward, batch.forward + i, count, PAD_FORWARD);
+        loadLanes(strike, batch.strike + i, count, PAD_FORWARD);
+        loadLanes(years, batch.years + i, count, PAD_YEARS);
+        loadLanes(sigma, batch.volatility + i, count, PAD_VOLATILITY);
+        loadLanes(is_call, batch.is_call + i, count, 1.0);
+
+        // Expired or zero-volatility options are worth their intrinsic value;
+        // a NaN volatility stays live and comes out as NaN
+        LaneMask live = (years > 0.0) & ~(sigma <= 0.0);
+        Lanes sqrt_t;
+        sqrtLanes(sqrt_t, years);
+        sqrt_t = live ? sqrt_t : one;
+        Lanes live_sigma = live ? sigma : one;
+
+        Lanes log_moneyness;
+        logLanes(log_moneyness, forward / strike);
+        BlackLanes black;
+        blackLanes(forward, strike, log_moneyness, sqrt_t, live_sigma, black);
+
+        LaneMask call = is_call > 0.5;
+        Lanes call_intrinsic = forward - strike;
+        Lanes put_intrinsic = strike - forward;
+        call_intrinsic = call_intrinsic > zero ? call_intrinsic : zero;
+        put_intrinsic = put_intrinsic > zero ? put_intrinsic : zero;
+        Lanes intrinsic = call ? call_intrinsic : put_intrinsic;
+        Lanes time_value = live ? black.otm : zero;
+        storeLanes(batch.price + i, time_value + intrinsic, count);
+
+        if (batch.delta != nullptr) {
+            Lanes live_delta = call ? black.n_d1 : -black.n_minus_d1;
+            Lanes expired_delta = call ? (forward > strike ? one : zero) : (forward < strike ? minus_one : zero);
+            storeLanes(batch.delta + i, live ? live_delta : expired_delta, count);
+        }
+        Lanes scaled_density = forward * black.density;
+        if (batch.gamma != nullptr) {
+            Lanes gamma = black.density / (forward * live_sigma * sqrt_t);
+            storeLanes(batch.gamma + i, live ? gamma : zero, count);
+        }
+        if (batch.vega != nullptr) {
+            Lanes vega = scaled_density * sqrt_t * 0.01;
+            storeLanes(batch.vega + i, live ? vega : zero, count);
+        }
+        if (batch.theta != nullptr) {
+            Lanes theta = -scaled_density * live_sigma / (2.0 * sqrt_t) * (1.0 / DAYS_PER_YEAR);
+            storeLanes(batch.theta + i, live ? theta : zero, count);
+        }
+    }
+}
+
+void DeribitOptionPricer::impliedVols(const OptionBatch& batch, const double* prices, double* out) {
+    Lanes zero = {}, one, nan;
+    splat(one, 1.0);
+    splat(nan, std::numeric_limits<double>::quiet_NaN());
+
+    for (size_t i = 0; i < batch.count; i += LANES) {
+        size_t count = std::min(LANES, batch.count - i);
+        Lanes forward, strike, years, is_call, price;
+        loadLanes(forward, batch.forward + i, count, PAD_FORWARD);
+        loadLanes(strike, batch.strike + i, count, PAD_FORWARD);
+        loadLanes(years, batch.years + i, count, PAD_YEARS);
+        loadLanes(is_call, batch.is_call + i, count, 1.0);
+        loadLanes(price, prices + i, count, PAD_PRICE);
+
+        // Solve for the time value on the out-of-the-money side
+        LaneMask call = is_call > 0.5;
+        Lanes call_intrinsic = forward - strike;
+        Lanes put_intrinsic = strike - forward;
+        call_intrinsic = call_intrinsic > zero ? call_intrinsic : zero;
+        put_intrinsic = put_intrinsic > zero ? put_intrinsic : zero;
+        Lanes target = price - (call ? call_intrinsic : put_intrinsic);
+        Lanes bound = call ? forward : strike;
+        LaneMask valid = (years > 0.0) & (target > price * TIME_VALUE_RESOLUTION) & (price < bound);
+
+        // Invalid lanes solve the padding option instead, then come out as NaN
+        Lanes pad_price;
+        splat(pad_price, PAD_PRICE);
+        forward = valid ? forward : one;
+        strike = valid ? strike : one;
+        target = valid ? target : pad_price;
+        Lanes sqrt_t;
+        sqrtLanes(sqrt_t, years);
+        sqrt_t = valid ? sqrt_t : one;
+
+        Lanes log_moneyness, log_target;
+        logLanes(log_moneyness, forward / strike);
+        logLanes(log_target, target);
+
+        // Start at the inflection point sqrt(2 |ln(F/K)| / T), where vega peaks;
+        // near the money use the at-the-money approximation
+        // price = F sigma sqrt(T) / sqrt(2 pi) instead
+        Lanes inflection;
+        sqrtLanes(inflection, 2.0 * (log_moneyness < 0.0 ? -log_moneyness : log_moneyness));
+        inflection /= sqrt_t;
+        Lanes at_the_money = SQRT_2PI * target / (forward * sqrt_t);
+        Lanes sigma = inflection > at_the_money ? inflection : at_the_money;
+        Lanes low, high;
+        splat(low, MIN_VOLATILITY);
+        splat(high, MAX_VOLATILITY);
+        sigma = sigma < low ? low : sigma;
+        sigma = sigma > high ? high : sigma;
+
+        for (int iteration = 0; iteration < MAX_ITERATIONS; ++iteration) {
+            BlackLanes black;
+            blackLanes(forward, strike, log_moneyness, sqrt_t, sigma, black);
+            Lanes error = black.otm - target;
+            LaneMask above = error > 0.0;
+            high = above ? sigma : high;
+            low = above ? low : sigma;
+
+            // Newton's step on ln(price), which far from the money is close to
+            // linear in volatility where the price itself is not
+            Lanes log_otm;
+            logLanes(log_otm, black.otm);
+            Lanes newton = sigma - (log_otm - log_target) * black.otm / (forward * black.density * sqrt_t);
+            Lanes bisection = 0.5 * (low + high);
+            LaneMask bracketed = (newton >= low) & (newton <= high) & (black.otm > 0.0);
+            Lanes next = bracketed ? newton : bisection;
+            Lanes change = next - sigma;
+            sigma = next;
+
+            bool converged = true;
+            for (size_t l = 0; l < LANES; ++l) {
+                converged &= std::fabs(change[l]) <= VOLATILITY_TOLERANCE;
+            }
+            if (converged) {
+                break;
+            }
+        }
+        storeLanes(out + i, valid ? sigma : nan, count);
+    }
+}
+
+OptionValue DeribitOptionPricer::priceOne(double forward, double strike, double years, double volatility, bool call) {
+    OptionValue value;
+    double intrinsic = call ? std::max(forward - strike, 0.0) : std::max(strike - forward, 0.0);
+    if (!(years > 0.0) || volatility <= 0.0) {
+        value.price = intrinsic;
+        value.delta = call ? (forward > strike ? 1.0 : 0.0) : (forward < strike ? -1.0 : 0.0);
+        return value;
+    }
+
+    double sqrt_t = std::sqrt(years);
+    double deviation = volatility * sqrt_t;
+    double d1 = std::log(forward / strike) / deviation + 0.5 * deviation;
+    double density = INV_SQRT_2PI * std::exp(-0.5 * d1 * d1);
+    double vega;
+    value.price = otmValue(forward, strike, sqrt_t, volatility, vega) + intrinsic;
+    value.delta = call ? 0.5 * std::erfc(-d1 * INV_SQRT2) : -0.5 * std::erfc(d1 * INV_SQRT2);
+    value.gamma = density / (forward * deviation);
+    value.vega = vega * 0.01;
+    value.theta = -forward * density * volatility / (2.0 * sqrt_t) / DAYS_PER_YEAR;
+    return value;
+}
+
+double DeribitOptionPricer::impliedVol(double forward, double strike, double years, double price, bool call) {
+    double target = price - (call ? std::max(forward - strike, 0.0) : std::max(strike - forward, 0.0));
+    if (!(years > 0.0) || !(target > price * TIME_VALUE_RESOLUTION) || !(price < (call ? forward : strike))) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    double sqrt_t = std::sqrt(years);
+    double inflection = std::sqrt(2.0 * std::fabs(std::log(forward / strike))) / sqrt_t;
+    double sigma = std::max(inflection, SQRT_2PI * target / (forward * sqrt_t));
+    double low = MIN_VOLATILITY;
+    double high = MAX_VOLATILITY;
+    sigma = std::min(std::max(sigma, low), high);
+
+    for (int iteration = 0; iteration < MAX_ITERATIONS; ++iteration) {
+        double vega;
+        double value = otmValue(forward, strike, sqrt_t, sigma, vega);
+        if (value > target) {
+            high = sigma;
+        } else {
+            low = sigma;
+        }
+        double next = sigma - std::log(value / target) * value / vega;
+        if (!(next >= low && next <= high) || !(value > 0.0)) {
+            next = 0.5 * (low + high);
+        }
+        bool converged = std::fabs(next - sigma) <= VOLATILITY_TOLERANCE;
+        sigma = next;
+        if (converged) {
+            break;
+        }
+    }
+    return sigma;
+}
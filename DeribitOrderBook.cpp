@@ -0,0 +1,313 @@
+#include "DeribitOrderBook.hpp"
+#include <algorithm>
+#include <chrono>
+#include "DeribitLogger.hpp"
+
+namespace {
+
+int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+// Constructor: pre-size both sides so a normal book never reallocates.
+DeribitOrderBook::DeribitOrderBook(const std::string& instrument_name, size_t reserve_levels)
+    : instrument_name(instrument_name),
+      last_change_id(0),
+      last_timestamp(0),
+      synced(false) {
+    bids.reserve(reserve_levels);
+    asks.reserve(reserve_levels);
+}
+
+void DeribitOrderBook::clear() {
+    bids.clear();
+    asks.clear();
+    last_change_id = 0;
+    last_timestamp = 0;
+    synced = false;
+}
+
+bool DeribitOrderBook::apply(const BookUpdate& update) {
+    if (update.is_snapshot) {
+        bids.clear();
+        asks.clear();
+    } else if (!synced || update.prev_change_id != last_change_id) {
+        synced = false;
+        return false;
+    }
+
+    for (const auto& level : update.levels) {
+        applyLevel(level);
+    }
+
+    last_change_id = update.change_id;
+    last_timestamp = update.timestamp;
+    synced = true;
+    return true;
+}
+
+void DeribitOrderBook::applyLevel(const BookLevelUpdate& level) {
+    bool is_bid = level.side == BookSide::Bid;
+    std::vector<PriceLevel>& levels = is_bid ? bids : asks;
+
+    if (level.action == BookAction::Delete || level.amount <= 0.0) {
+        erase(levels, is_bid, level.price);
+    } else {
+        upsert(levels, is_bid, level.price, level.amount);
+    }
+}
+
+// Finds the slot for price in a side sorted ascending (bids) or descending (asks).
+static std::vector<PriceLevel>::iterator findLevel(std::vector<PriceLevel>& levels,
+                                                   bool ascending, double price) {
+    if (ascending) {
+        return std::lower_bound(levels.begin(), levels.end(), price,
+            [](const PriceLevel& l, double p) { return l.price < p; });
+    }
+    return std::lower_bound(levels.begin(), levels.end(), price,
+        [](const PriceLevel& l, double p) { return l.price > p; });
+}
+
+void DeribitOrderBook::upsert(std::vector<PriceLevel>& levels, bool ascending,
+                              double price, double amount) {
+    // Fast path: the top of book is the back of the array
+    if (!levels.empty() && levels.back().price == price) {
+        levels.back().amount = amount;
+        return;
+    }
+
+    auto it = findLevel(levels, ascending, price);
+    if (it != levels.end() && it->price == price) {
+        it->amount = amount;
+    } else {
+        levels.insert(it, PriceLevel{price, amount});
+    }
+}
+
+void DeribitOrderBook::erase(std::vector<PriceLevel>& levels, bool ascending, double price) {
+    if (!levels.empty() && levels.back().price == price) {
+        levels.pop_back();
+        return;
+    }
+
+    auto it = findLevel(levels, ascending, price);
+    if (it != levels.end() && it->price == price) {
+        levels.erase(it);
+    }
+}
+
+size_t DeribitOrderBook::top(BookSide side, PriceLevel* out, size_t n) const {
+    const std::vector<PriceLevel>& levels = side == BookSide::Bid ? bids : asks;
+    size_t count = std::min(n, levels.size());
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = levels[levels.size() - 1 - i];
+    }
+    return count;
+}
+
+DeribitBookManager::DeribitBookManager()
+    : gaps_detected(0), resyncs_completed(0), snapshot_requests(0) {
+}
+
+DeribitBookManager::BookState& DeribitBookManager::stateFor(std::string_view instrument_name) {
+    lookup_key.assign(instrument_name.data(), instrument_name.size());
+    auto it = books.find(lookup_key);
+    if (it == books.end()) {
+        BookState state;
+        state.book.reset(new DeribitOrderBook(lookup_key));
+        state.awaiting_snapshot = false;
+        resetRequest(state);
+        it = books.emplace(lookup_key, std::move(state)).first;
+    }
+    return it->second;
+}
+
+const DeribitOrderBook* DeribitBookManager::find(const std::string& instrument_name) const {
+    auto it = books.find(instrument_name);
+    return it == books.end() ? nullptr : it->second.book.get();
+}
+
+void DeribitBookManager::invalidateAll() {
+    for (auto& entry : books) {
+        entry.second.book->markOutOfSync();
+        entry.second.pending.clear();
+        entry.second.awaiting_snapshot = false;
+        resetRequest(entry.second);         // Requests on the old connection are lost
+    }
+}
+
+void DeribitBookManager::resetRequest(BookState& state) {
+    state.request_in_flight = false;
+    state.failed_requests = 0;
+    state.retry_at_ns = 0;
+}
+
+// Marks the book as awaiting a snapshot and sends a request unless one is out
+// or the backoff of a failed one has not passed; the next update tries again.
+void DeribitBookManager::requestSnapshot(BookState& state) {
+    state.awaiting_snapshot = true;
+    if (state.request_in_flight || (state.retry_at_ns != 0 && steadyNs() < state.retry_at_ns)) {
+        return;
+    }
+    ++snapshot_requests;
+    if (!snapshot_requester || !snapshot_requester(state.book->instrumentName())) {
+        retryLater(state);
+        return;
+    }
+    state.request_in_flight = true;
+}
+
+void DeribitBookManager::retryLater(BookState& state) {
+    state.request_in_flight = false;
+    uint32_t doublings = std::min<uint32_t>(state.failed_requests, 16);
+    ++state.failed_requests;
+    int64_t delay_ms = std::min(SNAPSHOT_RETRY_MIN_MS << doublings, SNAPSHOT_RETRY_MAX_MS);
+    state.retry_at_ns = steadyNs() + delay_ms * 1000000;
+    LOG_ERROR("Unable to get order book snapshot for ", state.book->instrumentName(), "; retrying in ",
+              delay_ms, " ms");
+}
+
+void DeribitBookManager::onSnapshotFailed(const std::string& instrument_name) {
+    auto it = books.find(instrument_name);
+    if (it != books.end() && it->second.awaiting_snapshot && it->second.request_in_flight) {
+        retryLater(it->second);
+    }
+}
+
+DeribitOrderBook* DeribitBookManager::applyUpdate(std::string_view instrument_name,
+                                                  const BookUpdate& update) {
+    BookState& state = stateFor(instrument_name);
+    DeribitOrderBook& book = *state.book;
+
+    // A subscription snapshot supersedes anything we were waiting for
+    if (update.is_snapshot) {
+        state.pending.clear();
+        state.awaiting_snapshot = false;
+        resetRequest(state);
+        book.apply(update);
+        return &book;
+    }
+
+    if (state.awaiting_snapshot) {
+        if (state.pending.size() >= MAX_PENDING_UPDATES) {
+            // Snapshot is taking too long; start over with a fresh one
+            state.pending.clear();
+            state.request_in_flight = false;
+        }
+        state.pending.push_back(update);
+        requestSnapshot(state);             // A retry, once the backoff has passed
+        return &book;
+    }
+
+    if (!book.apply(update)) {
+        ++gaps_detected;
+        LOG_WARN("Order book gap on ", instrument_name, ": expected prev_change_id ",
+                 book.lastChangeId(), ", got ", update.prev_change_id, ". Resyncing...");
+        state.pending.clear();
+        state.pending.push_back(update);
+        requestSnapshot(state);
+    }
+    return &book;
+}
+
+void DeribitBookManager::replayPending(BookState& state) {
+    DeribitOrderBook& book = *state.book;
+    size_t i = 0;
+
+    // Drop updates already contained in the snapshot
+    while (i < state.pending.size() && state.pending[i].change_id <= book.lastChangeId()) {
+        ++i;
+    }
+
+    for (; i < state.pending.size(); ++i) {
+        if (!book.apply(state.pending[i])) {
+            // Snapshot does not chain onto the buffered stream; try again
+            ++gaps_detected;
+            state.pending.erase(state.pending.begin(), state.pending.begin() + i);
+            state.request_in_flight = false;
+            requestSnapshot(state);
+            return;
+        }
+    }
+    state.pending.clear();
+}
+
+DeribitOrderBook* DeribitBookManager::onBookMessage(const json& data) {
+    if (!parseBookUpdate(data, scratch)) {
+        return nullptr;
+    }
+    return applyUpdate(data["instrument_name"].get<std::string>(), scratch);
+}
+
+DeribitOrderBook* DeribitBookManager::onSnapshotResponse(const json& result) {
+    if (!result.contains("instrument_name")) {
+        return nullptr;
+    }
+
+    std::string instrument_name = result["instrument_name"].get<std::string>();
+    auto it = books.find(instrument_name);
+    if (it == books.end() || !it->second.awaiting_snapshot) {
+        return nullptr;                 // Stale or unsolicited snapshot
+    }
+
+    if (!parseBookUpdate(result, scratch)) {
+        return nullptr;
+    }
+    scratch.is_snapshot = true;
+
+    BookState& state = it->second;
+    state.awaiting_snapshot = false;
+    resetRequest(state);
+    state.book->apply(scratch);
+    ++resyncs_completed;
+    replayPending(state);
+    return state.book.get();
+}
+
+// Converts book.* data or a get_order_book result into a BookUpdate.
+// Raw/incremental channels send [action, price, amount] entries, while grouped
+// channels and get_order_book send [price, amount] and always carry a full book.
+bool DeribitBookManager::parseBookUpdate(const json& data, BookUpdate& out) {
+    out.clear();
+    if (!data.contains("instrument_name") || !data.contains("change_id")) {
+        return false;
+    }
+
+    out.change_id = data["change_id"].get<int64_t>();
+    if (data.contains("timestamp")) {
+        out.timestamp = data["timestamp"].get<int64_t>();
+    }
+    if (data.contains("prev_change_id")) {
+        out.prev_change_id = data["prev_change_id"].get<int64_t>();
+    }
+    out.is_snapshot = !data.contains("type") || data["type"] == "snapshot";
+
+    const BookSide sides[] = { BookSide::Bid, BookSide::Ask };
+    const char* keys[] = { "bids", "asks" };
+    for (int s = 0; s < 2; ++s) {
+        if (!data.contains(keys[s])) {
+            continue;
+        }
+        for (const auto& entry : data[keys[s]]) {
+            BookLevelUpdate level;
+            level.side = sides[s];
+            if (entry.size() == 3) {
+                const std::string& action = entry[0].get_ref<const std::string&>();
+                level.action = action == "new" ? BookAction::New
+                             : action == "delete" ? BookAction::Delete
+                             : BookAction::Change;
+                level.price = entry[1].get<double>();
+                level.amount = entry[2].get<double>();
+            } else {
+                level.action = BookAction::New;
+                level.price = entry[0].get<double>();
+                level.amount = entry[1].get<double>();
+            }
+            out.levels.push_back(level);
+        }
+    }
+    return true;
+}
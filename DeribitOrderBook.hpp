@@ -0,0 +1,175 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+
+enum class BookSide : uint8_t { Bid, Ask };
+enum class BookAction : uint8_t { New, Change, Delete };
+
+// A single aggregated price level
+struct PriceLevel {
+    double price;
+    double amount;
+};
+
+// One entry of a book.* notification: ["new"|"change"|"delete", price, amount]
+struct BookLevelUpdate {
+    BookSide side;
+    BookAction action;
+    double price;
+    double amount;
+};
+
+// A decoded book.* notification (or get_order_book snapshot)
+struct BookUpdate {
+    int64_t timestamp = 0;
+    int64_t change_id = 0;
+    int64_t prev_change_id = 0;     // 0 when the message carries no prev_change_id
+    bool is_snapshot = false;       // Replace the whole book instead of applying deltas
+    std::vector<BookLevelUpdate> levels;
+
+    void clear() {
+        timestamp = change_id = prev_change_id = 0;
+        is_snapshot = false;
+        levels.clear();                 // Keeps capacity so decoding does not reallocate
+    }
+};
+
+/**
+ * @class DeribitOrderBook
+ * @brief Local L2 book for a single instrument
+ *
+ * Each side is a flat, sorted array of price levels with the best level at the
+ * back: bids ascending, asks descending. Best bid/ask and the N-th level from
+ * the top are O(1) reads, and updates near the top of the book (where almost
+ * all of the traffic lands) only move a handful of levels.
+ */
+class DeribitOrderBook {
+public:
+    explicit DeribitOrderBook(const std::string& instrument_name, size_t reserve_levels = 1024);
+
+    /**
+     * @brief Applies a snapshot or incremental update
+     * @return false if the update does not chain onto the last change_id
+     *         (the book is left untouched and marked out of sync)
+     */
+    bool apply(const BookUpdate& update);
+
+    void clear();
+
+    const std::string& instrumentName() const { return instrument_name; }
+    int64_t lastChangeId() const { return last_change_id; }
+    int64_t lastTimestamp() const { return last_timestamp; }
+    bool isSynced() const { return synced; }
+    void markOutOfSync() { synced = false; }
+
+    size_t bidDepth() const { return bids.size(); }
+    size_t askDepth() const { return asks.size(); }
+
+    // Level i counted from the top of the book (0 = best). Caller checks depth.
+    const PriceLevel& bid(size_t i) const { return bids[bids.size() - 1 - i]; }
+    const PriceLevel& ask(size_t i) const { return asks[asks.size() - 1 - i]; }
+
+    // Best levels, or nullptr when that side is empty
+    const PriceLevel* bestBid() const { return bids.empty() ? nullptr : &bids.back(); }
+    const PriceLevel* bestAsk() const { return asks.empty() ? nullptr : &asks.back(); }
+
+    /**
+     * @brief Copies up to n levels from the top of one side
+     * @return Number of levels written to out
+     */
+    size_t top(BookSide side, PriceLevel* out, size_t n) const;
+
+private:
+    void applyLevel(const BookLevelUpdate& level);
+    static void upsert(std::vector<PriceLevel>& levels, bool ascending, double price, double amount);
+    static void erase(std::vector<PriceLevel>& levels, bool ascending, double price);
+
+    std::string instrument_name;
+    std::vector<PriceLevel> bids;   // Ascending by price, best bid at back
+    std::vector<PriceLevel> asks;   // Descending by price, best ask at back
+    int64_t last_change_id;
+    int64_t last_timestamp;
+    bool synced;
+};
+
+/**
+ * @class DeribitBookManager
+ * @brief Owns one DeribitOrderBook per instrument and keeps them consistent
+ *
+ * Every incremental update is checked against the previous change_id. On a gap
+ * the book is marked out of sync, later updates are buffered, and a
+ * public/get_order_book snapshot is requested through the snapshot requester.
+ * When the snapshot arrives, buffered updates newer than it are replayed.
+ * Only one request is out per instrument; one that cannot be sent or fails
+ * is retried on a later update after an exponential backoff, and the book
+ * keeps buffering meanwhile.
+ */
+class DeribitBookManager {
+public:
+    typedef std::function<bool(const std::string& instrument_name)> SnapshotRequester;
+
+    DeribitBookManager();
+
+    void setSnapshotRequester(SnapshotRequester requester) { snapshot_requester = requester; }
+
+    // Entry points for book.* notification data and get_order_book results
+    DeribitOrderBook* onBookMessage(const json& data);
+    DeribitOrderBook* onSnapshotResponse(const json& result);
+    // An error reply or timeout for a requested snapshot
+    void onSnapshotFailed(const std::string& instrument_name);
+
+    // Applies an already decoded update; returns the book it was applied to
+    DeribitOrderBook* applyUpdate(std::string_view instrument_name, const BookUpdate& update);
+
+    // Returns nullptr if no data has been received for the instrument
+    const DeribitOrderBook* find(const std::string& instrument_name) const;
+
+    // Marks every book out of sync, e.g. after the connection dropped; each
+    // resyncs from its subscription snapshot or, failing that, a requested one
+    void invalidateAll();
+
+    uint64_t gapCount() const { return gaps_detected; }
+    uint64_t resyncCount() const { return resyncs_completed; }
+    uint64_t snapshotRequestCount() const { return snapshot_requests; }
+
+    // Maximum number of updates buffered per instrument while awaiting a snapshot
+    static const size_t MAX_PENDING_UPDATES = 4096;
+    // Backoff after a failed snapshot request, doubling up to the maximum
+    static const int64_t SNAPSHOT_RETRY_MIN_MS = 100;
+    static const int64_t SNAPSHOT_RETRY_MAX_MS = 5000;
+
+private:
+    struct BookState {
+        std::unique_ptr<DeribitOrderBook> book;
+        std::vector<BookUpdate> pending;    // Updates received while out of sync
+        bool awaiting_snapshot;             // Out of sync; updates are buffered
+        bool request_in_flight;             // A snapshot request is out
+        uint32_t failed_requests;           // In a row, for the backoff
+        int64_t retry_at_ns;                // Steady clock; no request before this
+    };
+
+    BookState& stateFor(std::string_view instrument_name);
+    void requestSnapshot(BookState& state);
+    void retryLater(BookState& state);
+    static void resetRequest(BookState& state);
+    void replayPending(BookState& state);
+
+    static bool parseBookUpdate(const json& data, BookUpdate& out);
+
+    std::unordered_map<std::string, BookState> books;
+    SnapshotRequester snapshot_requester;
+    BookUpdate scratch;                 // Reused for json conversion
+    std::string lookup_key;             // Reused so lookups by view do not allocate
+    uint64_t gaps_detected;
+    uint64_t resyncs_completed;
+    uint64_t snapshot_requests;
+};
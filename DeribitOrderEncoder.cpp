@@ -0,0 +1,228 @@
+#include "DeribitOrderEncoder.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Pre-rendered frame fragments. Every frame starts with the envelope, the id,
+// then the method and the opening of params.
+const char FRAME_PREFIX[] = "{\"jsonrpc\":\"2.0\",\"id\":";
+const char FRAME_SUFFIX[] = "}}";
+
+const std::string_view BUY_METHOD = ",\"method\":\"private/buy\",\"params\":{";
+const std::string_view SELL_METHOD = ",\"method\":\"private/sell\",\"params\":{";
+const std::string_view EDIT_METHOD = ",\"method\":\"private/edit\",\"params\":{";
+const std::string_view CANCEL_METHOD = ",\"method\":\"private/cancel\",\"params\":{";
+
+// Longest fixed text of any frame: prefix, method, every optional key and suffix
+const size_t MAX_FIXED_SIZE = 256;
+
+// Digits needed for a uint64 and for a shortest round-trip double
+const size_t MAX_UINT_CHARS = 20;
+const size_t MAX_DOUBLE_CHARS = 32;
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+// Powers of ten used by the fixed-point fast path; all exactly representable
+const double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8 };
+const int MAX_FAST_DECIMALS = 8;
+const double MAX_EXACT_INTEGER = 9007199254740992.0;    // 2^53
+
+}  // namespace
+
+const char* DeribitOrderEncoder::timeInForceName(TimeInForce tif) {
+    switch (tif) {
+        case TimeInForce::GoodTilCancelled: return "good_til_cancelled";
+        case TimeInForce::GoodTilDay: return "good_til_day";
+        case TimeInForce::FillOrKill: return "fill_or_kill";
+        case TimeInForce::ImmediateOrCancel: return "immediate_or_cancel";
+        default: return "";
+    }
+}
+
+std::string_view DeribitOrderEncoder::encodeOrder(uint64_t id, OrderSide side,
+                                                  const OrderParams& params) {
+    size_t bound = MAX_FIXED_SIZE + MAX_UINT_CHARS + 2 * MAX_DOUBLE_CHARS
+                 + escapedBound(params.instrument_name) + escapedBound(params.type)
+                 + escapedBound(params.label);
+    if (bound > BUFFER_SIZE) {
+        return std::string_view();
+    }
+
+    begin(id, side == OrderSide::Buy ? BUY_METHOD : SELL_METHOD);
+    appendLiteral("\"instrument_name\":");
+    appendString(params.instrument_name);
+    appendLiteral(",\"amount\":");
+    appendDouble(params.amount);
+    appendLiteral(",\"type\":");
+    appendString(params.type);
+
+    if (!std::isnan(params.price)) {
+        appendLiteral(",\"price\":");
+        appendDouble(params.price);
+    }
+    if (params.post_only) {
+        appendLiteral(",\"post_only\":true");
+    }
+    if (params.reduce_only) {
+        appendLiteral(",\"reduce_only\":true");
+    }
+    if (params.time_in_force != TimeInForce::Default) {
+        appendLiteral(",\"time_in_force\":\"");
+        const char* name = timeInForceName(params.time_in_force);
+        appendRaw(name, std::strlen(name));
+        appendLiteral("\"");
+    }
+    if (!params.label.empty()) {
+        appendLiteral(",\"label\":");
+        appendString(params.label);
+    }
+    return finish();
+}
+
+std::string_view DeribitOrderEncoder::encodeEdit(uint64_t id, std::string_view order_id,
+                                                 double amount, double price,
+                                                 std::string_view advanced) {
+    size_t bound = MAX_FIXED_SIZE + MAX_UINT_CHARS + 2 * MAX_DOUBLE_CHARS
+                 + escapedBound(order_id) + escapedBound(advanced);
+    if (bound > BUFFER_SIZE) {
+        return std::string_view();
+    }
+
+    begin(id, EDIT_METHOD);
+    appendLiteral("\"order_id\":");
+    appendString(order_id);
+    appendLiteral(",\"amount\":");
+    appendDouble(amount);
+    appendLiteral(",\"price\":");
+    appendDouble(price);
+    if (!advanced.empty()) {
+        appendLiteral(",\"advanced\":");
+        appendString(advanced);
+    }
+    return finish();
+}
+
+std::string_view DeribitOrderEncoder::encodeCancel(uint64_t id, std::string_view order_id) {
+    if (MAX_FIXED_SIZE + MAX_UINT_CHARS + escapedBound(order_id) > BUFFER_SIZE) {
+        return std::string_view();
+    }
+
+    begin(id, CANCEL_METHOD);
+    appendLiteral("\"order_id\":");
+    appendString(order_id);
+    return finish();
+}
+
+void DeribitOrderEncoder::begin(uint64_t id, std::string_view method_fragment) {
+    pos = buffer;
+    appendLiteral(FRAME_PREFIX);
+    appendUint(id);
+    appendRaw(method_fragment.data(), method_fragment.size());
+}
+
+std::string_view DeribitOrderEncoder::finish() {
+    appendLiteral(FRAME_SUFFIX);
+    return std::string_view(buffer, static_cast<size_t>(pos - buffer));
+}
+
+// Callers check the worst-case frame size up front, so appends never bounds-check.
+void DeribitOrderEncoder::appendRaw(const char* data, size_t length) {
+    std::memcpy(pos, data, length);
+    pos += length;
+}
+
+void DeribitOrderEncoder::appendUint(uint64_t value) {
+    pos = std::to_chars(pos, buffer + BUFFER_SIZE, value).ptr;
+}
+
+// Prices and amounts almost always have a few decimals, so first try to write
+// value as an integer mantissa m with k implied decimals. m / 10^k is correctly
+// rounded, so if it equals value the text parses back to exactly value.
+// Anything else goes through the general shortest round-trip formatter.
+void DeribitOrderEncoder::appendDouble(double value) {
+    if (!std::isfinite(value)) {
+        appendLiteral("null");          // Matches nlohmann::json for NaN/inf
+        return;
+    }
+
+    double magnitude = std::fabs(value);
+    for (int k = 0; k <= MAX_FAST_DECIMALS; ++k) {
+        double scaled = magnitude * POW10[k];
+        if (scaled >= MAX_EXACT_INTEGER) {
+            break;
+        }
+        if (scaled != std::floor(scaled)) {
+            continue;
+        }
+
+        uint64_t mantissa = static_cast<uint64_t>(scaled);
+        if (static_cast<double>(mantissa) / POW10[k] != magnitude) {
+            continue;
+        }
+
+        if (value < 0) {
+            *pos++ = '-';
+        }
+        if (k == 0) {
+            appendUint(mantissa);
+            return;
+        }
+
+        // Render the digits, then split off the k fractional ones
+        char digits[MAX_UINT_CHARS];
+        char* end = std::to_chars(digits, digits + sizeof(digits), mantissa).ptr;
+        int length = static_cast<int>(end - digits);
+        if (length <= k) {
+            *pos++ = '0';
+            *pos++ = '.';
+            for (int i = length; i < k; ++i) {
+                *pos++ = '0';
+            }
+            appendRaw(digits, static_cast<size_t>(length));
+        } else {
+            appendRaw(digits, static_cast<size_t>(length - k));
+            *pos++ = '.';
+            appendRaw(digits + length - k, static_cast<size_t>(k));
+        }
+        return;
+    }
+
+    pos = std::to_chars(pos, buffer + BUFFER_SIZE, value).ptr;
+}
+
+void DeribitOrderEncoder::appendString(std::string_view value) {
+    *pos++ = '"';
+    const char* run = value.data();
+    const char* end = value.data() + value.size();
+    for (const char* p = run; p != end; ++p) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        // Flush the clean run, then write the escape sequence
+        appendRaw(run, static_cast<size_t>(p - run));
+        run = p + 1;
+        *pos++ = '\\';
+        switch (c) {
+            case '"': *pos++ = '"'; break;
+            case '\\': *pos++ = '\\'; break;
+            case '\n': *pos++ = 'n'; break;
+            case '\r': *pos++ = 'r'; break;
+            case '\t': *pos++ = 't'; break;
+            case '\b': *pos++ = 'b'; break;
+            case '\f': *pos++ = 'f'; break;
+            default:
+                *pos++ = 'u';
+                *pos++ = '0';
+                *pos++ = '0';
+                *pos++ = HEX_DIGITS[c >> 4];
+                *pos++ = HEX_DIGITS[c & 0xF];
+                break;
+        }
+    }
+    appendRaw(run, static_cast<size_t>(end - run));
+    *pos++ = '"';
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+enum class OrderSide : uint8_t { Buy, Sell };
+
+// Deribit order_state values
+enum class OrderState : uint8_t { Open, Filled, Rejected, Cancelled, Untriggered, Unknown };
+
+enum class TimeInForce : uint8_t {
+    Default,                // Omitted from the request; the exchange uses good_til_cancelled
+    GoodTilCancelled,
+    GoodTilDay,
+    FillOrKill,
+    ImmediateOrCancel
+};
+
+/**
+ * @struct OrderParams
+ * @brief Parameters of a private/buy or private/sell request
+ *
+ * String fields are views so building the request never copies them; they
+ * only need to stay valid until the encode call returns.
+ */
+struct OrderParams {
+    std::string_view instrument_name;
+    double amount = 0.0;
+    std::string_view type = "market";                       // market, limit, stop_limit, ...
+    double price = std::numeric_limits<double>::quiet_NaN(); // NaN means "not set" (market orders)
+    bool post_only = false;
+    bool reduce_only = false;
+    TimeInForce time_in_force = TimeInForce::Default;
+    std::string_view label;
+};
+
+/**
+ * @class DeribitOrderEncoder
+ * @brief Writes order-entry JSON-RPC frames into a reusable fixed buffer
+ *
+ * Each frame is assembled from pre-rendered literal fragments, numbers are
+ * formatted with std::to_chars (shortest round-trip form, the same text
+ * nlohmann::json produces), and strings are escaped in place. Nothing is
+ * allocated. The returned view points into the encoder's buffer and is valid
+ * until the next encode call, so use one encoder per sending thread.
+ */
+class DeribitOrderEncoder {
+public:
+    static const size_t BUFFER_SIZE = 1024;
+
+    DeribitOrderEncoder() : pos(buffer) {}
+
+    // Each method returns an empty view if the frame would not fit in the buffer
+    std::string_view encodeOrder(uint64_t id, OrderSide side, const OrderParams& params);
+    std::string_view encodeEdit(uint64_t id, std::string_view order_id, double amount,
+                                double price, std::string_view advanced = std::string_view());
+    std::string_view encodeCancel(uint64_t id, std::string_view order_id);
+
+    static const char* timeInForceName(TimeInForce tif);
+
+private:
+    void begin(uint64_t id, std::string_view method_fragment);
+    std::string_view finish();
+
+    template <size_t N>
+    void appendLiteral(const char (&literal)[N]) { appendRaw(literal, N - 1); }
+    void appendRaw(const char* data, size_t length);
+    void appendUint(uint64_t value);
+    void appendDouble(double value);
+    void appendString(std::string_view value);      // Quoted and JSON-escaped
+
+    // Worst case size of a quoted string after escaping
+    static size_t escapedBound(std::string_view value) { return value.size() * 6 + 2; }
+
+    char buffer[BUFFER_SIZE];
+    char* pos;
+};
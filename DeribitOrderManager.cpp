@@ -0,0 +1,278 @@
+#include "DeribitOrderManager.hpp"
+#include "DeribitLogger.hpp"
+#include <cmath>
+#include <limits>
+
+namespace {
+
+bool isTerminal(OrderState state) {
+    return state == OrderState::Filled || state == OrderState::Cancelled || state == OrderState::Rejected;
+}
+
+double numberOr(const json& order, const char* key, double fallback) {
+    auto it = order.find(key);
+    return it != order.end() && it->is_number() ? it->get<double>() : fallback;
+}
+
+int64_t integerOr(const json& order, const char* key) {
+    auto it = order.find(key);
+    return it != order.end() && it->is_number() ? it->get<int64_t>() : 0;
+}
+
+std::string_view textOr(const json& order, const char* key) {
+    auto it = order.find(key);
+    return it != order.end() && it->is_string() ? std::string_view(it->get_ref<const std::string&>())
+                                                : std::string_view();
+}
+
+}  // namespace
+
+DeribitOrderManager::DeribitOrderManager() : open_count(0), seeded(false) {}
+
+uint32_t DeribitOrderManager::orderIndex(std::string_view order_id) {
+    uint32_t index = order_ids.intern(order_id);
+    if (index == orders.size()) {
+        orders.emplace_back();
+        orders.back().order_id = std::string(order_id);
+    }
+    return index;
+}
+
+void DeribitOrderManager::addMember(DeribitKeyIndex& keys, std::vector<std::vector<uint32_t>>& groups,
+                                    std::string_view key, uint32_t index) {
+    uint32_t group = keys.intern(key);
+    if (group == groups.size()) {
+        groups.emplace_back();
+    }
+    groups[group].push_back(index);
+}
+
+void DeribitOrderManager::setKeys(uint32_t index, std::string_view instrument_name, std::string_view label) {
+    OrderRecord& record = orders[index];
+    if (record.instrument_name.empty() && !instrument_name.empty()) {
+        record.instrument_name = std::string(instrument_name);
+        addMember(instruments, instrument_orders, instrument_name, index);
+    }
+    if (record.label.empty() && !label.empty()) {
+        record.label = std::string(label);
+        addMember(labels, label_orders, label, index);
+    }
+}
+
+void DeribitOrderManager::setState(OrderRecord& record, OrderState state) {
+    if (record.isOpen()) {
+        --open_count;
+    }
+    record.state = state;
+    if (record.isOpen()) {
+        ++open_count;
+    }
+}
+
+void DeribitOrderManager::applyOrder(const OrderEvent& order) {
+    if (order.order_id.empty()) {
+        return;
+    }
+    OrderState state = DeribitMessageDecoder::parseOrderState(order.order_state);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t index = orderIndex(order.order_id);
+    OrderRecord& record = orders[index];
+
+    // Ignore anything older than what we have, and a stale "open" for an order
+    // that already reached a final state in the same update
+    if (order.last_update_timestamp < record.last_update_timestamp ||
+        (order.last_update_timestamp == record.last_update_timestamp && isTerminal(record.state) &&
+         !isTerminal(state))) {
+        return;
+    }
+
+    setKeys(index, order.instrument_name, order.label);
+    record.order_type = std::string(order.order_type);
+    record.direction = order.direction;
+    record.price = order.price;
+    record.amount = order.amount;
+    record.filled_amount = order.filled_amount;
+    record.average_price = order.average_price;
+    record.creation_timestamp = order.creation_timestamp;
+    record.last_update_timestamp = order.last_update_timestamp;
+    record.post_only = order.post_only;
+    record.reduce_only = order.reduce_only;
+    setState(record, state);
+}
+
+// Trades can arrive before the order update that reports them, so a fill may create the record.
+bool DeribitOrderManager::applyFill(const TradeEvent& trade) {
+    if (trade.order_id.empty()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t index = orderIndex(trade.order_id);
+    setKeys(index, trade.instrument_name, std::string_view());
+    OrderRecord& record = orders[index];
+
+    // The same trade is reported by the order response and by user.trades
+    for (const auto& fill : record.fills) {
+        if (fill.trade_id == trade.trade_id) {
+            return false;
+        }
+    }
+    OrderFill fill;
+    fill.trade_id = std::string(trade.trade_id);
+    fill.price = trade.price;
+    fill.amount = trade.amount;
+    fill.timestamp = trade.timestamp;
+    record.fills.push_back(std::move(fill));
+    if (record.state == OrderState::Unknown) {
+        record.direction = trade.direction;
+    }
+    return true;
+}
+
+bool DeribitOrderManager::seed(const json& response) {
+    if (!response.contains("result") || !response["result"].is_array()) {
+        LOG_ERROR("Unable to seed order cache: ", response.dump());
+        return false;
+    }
+
+    // Responses arrive as a DOM; map each order onto the decoder's view type
+    size_t count = 0;
+    for (const auto& order : response["result"]) {
+        OrderEvent event;
+        event.order_id = textOr(order, "order_id");
+        event.instrument_name = textOr(order, "instrument_name");
+        event.label = textOr(order, "label");
+        event.order_state = textOr(order, "order_state");
+        event.order_type = textOr(order, "order_type");
+        event.direction = textOr(order, "direction") == "sell" ? OrderSide::Sell : OrderSide::Buy;
+        event.price = numberOr(order, "price", std::numeric_limits<double>::quiet_NaN());
+        event.amount = numberOr(order, "amount", 0.0);
+        event.filled_amount = numberOr(order, "filled_amount", 0.0);
+        event.average_price = numberOr(order, "average_price", 0.0);
+        event.creation_timestamp = integerOr(order, "creation_timestamp");
+        event.last_update_timestamp = integerOr(order, "last_update_timestamp");
+        event.post_only = order.value("post_only", false);
+        event.reduce_only = order.value("reduce_only", false);
+        applyOrder(event);
+        ++count;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    seeded = true;
+    LOG_INFO("Order cache seeded with ", count, " open orders.");
+    return true;
+}
+
+bool DeribitOrderManager::isSeeded() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return seeded;
+}
+
+bool DeribitOrderManager::getOrder(std::string_view order_id, OrderRecord& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t index = order_ids.find(order_id);
+    if (index == DeribitKeyIndex::NO_KEY) {
+        return false;
+    }
+    out = orders[index];
+    return true;
+}
+
+OrderState DeribitOrderManager::status(std::string_view order_id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t index = order_ids.find(order_id);
+    return index == DeribitKeyIndex::NO_KEY ? OrderState::Unknown : orders[index].state;
+}
+
+double DeribitOrderManager::filledAmount(std::string_view order_id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t index = order_ids.find(order_id);
+    return index == DeribitKeyIndex::NO_KEY ? 0.0 : orders[index].filled_amount;
+}
+
+size_t DeribitOrderManager::openOrders(std::vector<OrderRecord>& out, std::string_view instrument_name) const {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (instrument_name.empty()) {
+        for (const auto& record : orders) {
+            if (record.isOpen()) {
+                out.push_back(record);
+            }
+        }
+        return out.size();
+    }
+
+    uint32_t group = instruments.find(instrument_name);
+    if (group == DeribitKeyIndex::NO_KEY) {
+        return 0;
+    }
+    for (uint32_t index : instrument_orders[group]) {
+        if (orders[index].isOpen()) {
+            out.push_back(orders[index]);
+        }
+    }
+    return out.size();
+}
+
+size_t DeribitOrderManager::ordersWithLabel(std::string_view label, std::vector<OrderRecord>& out) const {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t group = labels.find(label);
+    if (group == DeribitKeyIndex::NO_KEY) {
+        return 0;
+    }
+    for (uint32_t index : label_orders[group]) {
+        out.push_back(orders[index]);
+    }
+    return out.size();
+}
+
+size_t DeribitOrderManager::openOrderCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return open_count;
+}
+
+size_t DeribitOrderManager::orderCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return orders.size();
+}
+
+// Indices are dense, so dropping orders means rebuilding every table.
+void DeribitOrderManager::forgetClosed() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<OrderRecord> kept;
+    for (auto& record : orders) {
+        if (!isTerminal(record.state)) {
+            kept.push_back(std::move(record));
+        }
+    }
+
+    orders.clear();
+    order_ids.clear();
+    labels.clear();
+    label_orders.clear();
+    instruments.clear();
+    instrument_orders.clear();
+    for (auto& record : kept) {
+        uint32_t index = orderIndex(record.order_id);
+        std::string instrument_name = std::move(record.instrument_name);
+        std::string label = std::move(record.label);
+        record.instrument_name.clear();
+        record.label.clear();
+        orders[index] = std::move(record);
+        setKeys(index, instrument_name, label);
+    }
+}
+
+void DeribitOrderManager::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    orders.clear();
+    order_ids.clear();
+    labels.clear();
+    label_orders.clear();
+    instruments.clear();
+    instrument_orders.clear();
+    open_count = 0;
+    seeded = false;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DeribitKeyIndex.hpp"
+#include "DeribitMessageDecoder.hpp"
+#include "DeribitOrderEncoder.hpp"
+
+using json = nlohmann::json;
+
+// One of our trades against an order
+struct OrderFill {
+    std::string trade_id;
+    double price = 0.0;
+    double amount = 0.0;
+    int64_t timestamp = 0;
+};
+
+// Last known state of one order
+struct OrderRecord {
+    std::string order_id;
+    std::string instrument_name;
+    std::string label;
+    std::string order_type;
+    OrderSide direction = OrderSide::Buy;
+    OrderState state = OrderState::Unknown;
+    double price = 0.0;                     // NaN for market orders
+    double amount = 0.0;
+    double filled_amount = 0.0;
+    double average_price = 0.0;
+    int64_t creation_timestamp = 0;
+    int64_t last_update_timestamp = 0;
+    bool post_only = false;
+    bool reduce_only = false;
+    std::vector<OrderFill> fills;
+
+    bool isOpen() const { return state == OrderState::Open || state == OrderState::Untriggered; }
+};
+
+/**
+ * @class DeribitOrderManager
+ * @brief Local cache of our orders and fills
+ *
+ * Seeded once from private/get_open_orders, then kept current from
+ * user.orders.* and user.trades.* notifications and from the responses to
+ * our own order requests. An update is applied only if it is at least as
+ * recent (last_update_timestamp) as what is cached, so the seed, the
+ * notifications and the responses may arrive in any order.
+ *
+ * Orders are interned into dense indices by order id, and grouped by label
+ * and by instrument; all three lookups go through DeribitKeyIndex tables.
+ * Updates run on the io thread; queries may come from any thread and take an
+ * uncontended mutex, so they are local reads rather than exchange round trips.
+ */
+class DeribitOrderManager {
+public:
+    DeribitOrderManager();
+
+    // Update side (io thread)
+    void applyOrder(const OrderEvent& order);
+    bool applyFill(const TradeEvent& trade);     // false if the trade was already recorded
+
+    /**
+     * @brief Applies a private/get_open_orders response
+     * @return false if the response carries no order list
+     */
+    bool seed(const json& response);
+
+    // Query side (any thread)
+    bool isSeeded() const;
+    bool getOrder(std::string_view order_id, OrderRecord& out) const;
+    OrderState status(std::string_view order_id) const;     // Unknown if never seen
+    double filledAmount(std::string_view order_id) const;   // 0 if never seen
+
+    // Copy matching orders into out (cleared first) and return how many
+    size_t openOrders(std::vector<OrderRecord>& out, std::string_view instrument_name = std::string_view()) const;
+    size_t ordersWithLabel(std::string_view label, std::vector<OrderRecord>& out) const;
+
+    size_t openOrderCount() const;
+    size_t orderCount() const;
+
+    // Drops filled, cancelled and rejected orders to bound memory
+    void forgetClosed();
+    void clear();
+
+private:
+    // Returns the index of order_id, creating an empty record on first use
+    uint32_t orderIndex(std::string_view order_id);
+    // Records the instrument and label the first time they are known, and groups the order by them
+    void setKeys(uint32_t index, std::string_view instrument_name, std::string_view label);
+    void setState(OrderRecord& record, OrderState state);
+    static void addMember(DeribitKeyIndex& keys, std::vector<std::vector<uint32_t>>& groups,
+                         std::string_view key, uint32_t index);
+
+    DeribitKeyIndex order_ids;
+    std::vector<OrderRecord> orders;                    // Indexed by order_ids
+    DeribitKeyIndex labels;
+    std::vector<std::vector<uint32_t>> label_orders;    // Indexed by labels
+    DeribitKeyIndex instruments;
+    std::vector<std::vector<uint32_t>> instrument_orders;
+    size_t open_count;
+    bool seeded;
+    mutable std::mutex mutex;
+};
@@ -0,0 +1,364 @@
+#include "DeribitPortfolioRisk.hpp"
+#include "DeribitOptionBook.hpp"
+#include "DeribitOptionPricer.hpp"
+#include "DeribitPositionBook.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+const size_t LANES = 4;
+typedef double Lanes __attribute__((vector_size(LANES * sizeof(double))));
+
+const double MIN_SHOCKED_VOL = 0.01;
+
+// By reference: returning a vector type by value warns about its ABI
+inline void loadLanes(Lanes& lanes, const double* values) {
+    std::memcpy(&lanes, values, sizeof(lanes));
+}
+
+inline double sumLanes(const Lanes& lanes) {
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+double dot(const double* a, const double* b, size_t count) {
+    Lanes sum = {};
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES) {
+        Lanes x, y;
+        loadLanes(x, a + i);
+        loadLanes(y, b + i);
+        sum += x * y;
+    }
+    double total = sumLanes(sum);
+    for (; i < count; ++i) {
+        total += a[i] * b[i];
+    }
+    return total;
+}
+
+// BTC-27DEC24-60000-C and SOL_USDC-27DEC24-150-P; anything else is a future or spot
+bool isOption(const std::string& name) {
+    if (std::count(name.begin(), name.end(), '-') != 3) {
+        return false;
+    }
+    char type = name.back();
+    return type == 'C' || type == 'P';
+}
+
+// BTC for BTC-PERPETUAL, BTC_USDC-PERPETUAL and BTC options
+std::string underlyingOf(const std::string& name) {
+    size_t end = name.find_first_of("-_");
+    return name.substr(0, end);
+}
+
+}  // namespace
+
+struct DeribitPortfolioRisk::Group {
+    std::string currency;
+    double spot = 0.0;
+    size_t positions = 0;
+    size_t unpriced = 0;
+
+    // Futures reduce to sums: linear ones move by size * F * shock, inverse
+    // ones by size * shock
+    double linear_delta = 0.0;          // Sum of size
+    double linear_notional = 0.0;       // Sum of size * F
+    double inverse_delta = 0.0;         // Sum of size / F
+    double inverse_notional = 0.0;      // Sum of size (USD)
+
+    // Options, in parallel
+    std::vector<double> size;
+    std::vector<double> forward;
+    std::vector<double> strike;
+    std::vector<double> years;
+    std::vector<double> volatility;
+    std::vector<double> is_call;
+
+    // Scratch space of evaluate(); one thread works on a group at a time
+    std::vector<double> shocked_forward;
+    std::vector<double> shocked_vol;    // One row per vol shock
+    std::vector<double> price;
+    std::vector<double> delta;
+    std::vector<double> gamma;
+    std::vector<double> vega;
+    std::vector<double> theta;
+    std::vector<double> scenario_price;
+    CurrencyRisk result;
+};
+
+DeribitPortfolioRisk::DeribitPortfolioRisk(const RiskScenarioConfig& config)
+    : config(config),
+      last_evaluation_ns(0),
+      pass(0),
+      busy(0),
+      stopping(false),
+      next_group(0) {}
+
+DeribitPortfolioRisk::~DeribitPortfolioRisk() {
+    stopWorkers();
+}
+
+void DeribitPortfolioRisk::configure(const RiskScenarioConfig& new_config) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopWorkers();
+    config = new_config;
+}
+
+RiskScenarioConfig DeribitPortfolioRisk::getConfig() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return config;
+}
+
+DeribitPortfolioRisk::Group& DeribitPortfolioRisk::groupFor(const std::string& currency) {
+    uint32_t id = currencies.intern(currency);
+    if (id == groups.size()) {
+        groups.push_back(std::make_unique<Group>());
+        groups.back()->currency = currency;
+    }
+    return *groups[id];
+}
+
+size_t DeribitPortfolioRisk::load(const DeribitPositionBook& positions, const DeribitOptionBook& options) {
+    std::vector<PositionSnapshot> snapshots;
+    positions.positions(snapshots);
+
+    clear();
+    size_t loaded = 0;
+    OptionGreeks greeks;
+    for (const auto& snapshot : snapshots) {
+        if (snapshot.size == 0.0) {
+            continue;
+        }
+        RiskPosition position;
+        position.instrument_name = snapshot.instrument_name;
+        position.currency = underlyingOf(snapshot.instrument_name);
+        position.size = snapshot.size;
+        if (isOption(snapshot.instrument_name)) {
+            if (!options.greeks(snapshot.instrument_name, greeks) || greeks.volatility <= 0.0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                Group& group = groupFor(position.currency);
+                ++group.positions;
+                ++group.unpriced;
+                ++loaded;
+                continue;
+            }
+            position.kind = RiskInstrument::Option;
+            position.forward = greeks.forward;
+            position.strike = greeks.strike;
+            position.years = greeks.years;
+            position.volatility = greeks.volatility;
+            position.call = greeks.call;
+        } else {
+            position.kind = snapshot.instrument_name.find('_') == std::string::npos
+                ? RiskInstrument::InverseFuture : RiskInstrument::LinearFuture;
+            position.forward = snapshot.mark_price > 0.0 ? snapshot.mark_price : snapshot.average_price;
+        }
+        if (add(position)) {
+            ++loaded;
+        }
+    }
+    return loaded;
+}
+
+bool DeribitPortfolioRisk::add(const RiskPosition& position) {
+    if (position.size == 0.0 || !(position.forward > 0.0)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    Group& group = groupFor(position.currency);
+    if (group.positions == group.unpriced) {
+        group.spot = position.forward;
+    }
+    ++group.positions;
+    switch (position.kind) {
+        case RiskInstrument::LinearFuture:
+            group.linear_delta += position.size;
+            group.linear_notional += position.size * position.forward;
+            break;
+        case RiskInstrument::InverseFuture:
+            group.inverse_delta += position.size / position.forward;
+            group.inverse_notional += position.size;
+            break;
+        case RiskInstrument::Option:
+            group.size.push_back(position.size);
+            group.forward.push_back(position.forward);
+            group.strike.push_back(position.strike);
+            group.years.push_back(position.years);
+            group.volatility.push_back(position.volatility);
+            group.is_call.push_back(position.call ? 1.0 : 0.0);
+            break;
+    }
+    return true;
+}
+
+void DeribitPortfolioRisk::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    currencies.clear();
+    groups.clear();
+}
+
+size_t DeribitPortfolioRisk::evaluate(std::vector<CurrencyRisk>& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto start = std::chrono::steady_clock::now();
+    runGroups();
+    last_evaluation_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+
+    out.clear();
+    for (const auto& group : groups) {
+        out.push_back(group->result);
+    }
+    return out.size();
+}
+
+void DeribitPortfolioRisk::evaluateGroup(Group& group) {
+    const size_t options = group.size.size();
+    const size_t spot_count = config.spot_shocks.size();
+    const size_t vol_count = config.vol_shocks.size();
+
+    CurrencyRisk& result = group.result;
+    result.currency = group.currency;
+    result.spot = group.spot;
+    result.positions = group.positions;
+    result.options = options;
+    result.unpriced = group.unpriced;
+    result.delta = group.linear_delta + group.inverse_delta;
+    result.delta_usd = group.linear_notional + group.inverse_notional;
+    result.gamma = result.vega = result.theta = 0.0;
+
+    group.price.resize(options);
+    group.delta.resize(options);
+    group.gamma.resize(options);
+    group.vega.resize(options);
+    group.theta.resize(options);
+    group.scenario_price.resize(options);
+    group.shocked_forward.resize(options);
+    group.shocked_vol.resize(options * vol_count);
+
+    OptionBatch batch;
+    batch.count = options;
+    batch.forward = group.forward.data();
+    batch.strike = group.strike.data();
+    batch.years = group.years.data();
+    batch.volatility = group.volatility.data();
+    batch.is_call = group.is_call.data();
+    batch.price = group.price.data();
+    batch.delta = group.delta.data();
+    batch.gamma = group.gamma.data();
+    batch.vega = group.vega.data();
+    batch.theta = group.theta.data();
+    double base_value = 0.0;
+    if (options > 0) {
+        DeribitOptionPricer::price(batch);
+        base_value = dot(group.size.data(), group.price.data(), options);
+        for (size_t i = 0; i < options; ++i) {
+            result.delta_usd += group.size[i] * group.delta[i] * group.forward[i];
+        }
+        result.delta += dot(group.size.data(), group.delta.data(), options);
+        result.gamma = dot(group.size.data(), group.gamma.data(), options);
+        result.vega = dot(group.size.data(), group.vega.data(), options);
+        result.theta = dot(group.size.data(), group.theta.data(), options);
+    }
+
+    // Volatility rows are shared by every spot shock
+    for (size_t v = 0; v < vol_count; ++v) {
+        double* row = &group.shocked_vol[v * options];
+        for (size_t i = 0; i < options; ++i) {
+            row[i] = std::max(group.volatility[i] + config.vol_shocks[v], MIN_SHOCKED_VOL);
+        }
+    }
+
+    result.scenario_pnl.assign(spot_count * vol_count, 0.0);
+    batch.forward = group.shocked_forward.data();
+    batch.price = group.scenario_price.data();
+    batch.delta = batch.gamma = batch.vega = batch.theta = nullptr;
+    for (size_t s = 0; s < spot_count; ++s) {
+        double shock = config.spot_shocks[s];
+        double futures_pnl = (group.linear_notional + group.inverse_notional) * shock;
+        for (size_t i = 0; i < options; ++i) {
+            group.shocked_forward[i] = group.forward[i] * (1.0 + shock);
+        }
+        for (size_t v = 0; v < vol_count; ++v) {
+            double options_pnl = 0.0;
+            if (options > 0) {
+                batch.volatility = &group.shocked_vol[v * options];
+                DeribitOptionPricer::price(batch);
+                options_pnl = dot(group.size.data(), group.scenario_price.data(), options) - base_value;
+            }
+            result.scenario_pnl[s * vol_count + v] = futures_pnl + options_pnl;
+        }
+    }
+    result.worst_pnl = result.scenario_pnl.empty()
+        ? 0.0 : *std::min_element(result.scenario_pnl.begin(), result.scenario_pnl.end());
+}
+
+void DeribitPortfolioRisk::runGroups() {
+    if (groups.size() < 2 || config.threads == 0) {
+        for (auto& group : groups) {
+            evaluateGroup(*group);
+        }
+        return;
+    }
+    if (workers.empty()) {
+        startWorkers();
+    }
+
+    next_group.store(0, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        busy = workers.size();
+        ++pass;
+    }
+    pool_wakeup.notify_all();
+
+    size_t id;
+    while ((id = next_group.fetch_add(1, std::memory_order_relaxed)) < groups.size()) {
+        evaluateGroup(*groups[id]);
+    }
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    pool_done.wait(lock, [this] { return busy == 0; });
+}
+
+void DeribitPortfolioRisk::startWorkers() {
+    stopping = false;
+    for (size_t i = 0; i < config.threads; ++i) {
+        workers.emplace_back(&DeribitPortfolioRisk::workerLoop, this, pass);
+    }
+}
+
+void DeribitPortfolioRisk::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        stopping = true;
+    }
+    pool_wakeup.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+// seen is the pass current when the worker was started, so a pass that
+// begins before the thread runs is not missed
+void DeribitPortfolioRisk::workerLoop(uint64_t seen) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex);
+            pool_wakeup.wait(lock, [&] { return stopping || pass != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = pass;
+        }
+        size_t id;
+        while ((id = next_group.fetch_add(1, std::memory_order_relaxed)) < groups.size()) {
+            evaluateGroup(*groups[id]);
+        }
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        if (--busy == 0) {
+            pool_done.notify_one();
+        }
+    }
+}
@@ -0,0 +1,342 @@
+#include "DeribitPositionBook.hpp"
+#include "DeribitLogger.hpp"
+#include <cctype>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Sizes closer to zero than this are treated as flat
+const double FLAT_SIZE = 1e-9;
+
+// Arrays are padded to a multiple of this; see totals()
+const size_t LANES = 4;
+typedef double Lanes __attribute__((vector_size(LANES * sizeof(double))));
+
+// By reference: returning a vector type by value warns about its ABI
+inline void loadLanes(Lanes& lanes, const double* values) {
+    std::memcpy(&lanes, values, sizeof(lanes));
+}
+
+// PnL of size opened at average and valued at mark
+inline double pnlOf(double size, double average, double mark, bool inverse) {
+    return inverse ? size * (1.0 / average - 1.0 / mark) : size * (mark - average);
+}
+
+std::string lowercase(std::string_view text) {
+    std::string out(text);
+    for (auto& c : out) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return out;
+}
+
+// What an instrument name says about how its PnL is computed:
+//   BTC-PERPETUAL, BTC-27DEC24       inverse, PnL in BTC, index btc_usd
+//   BTC_USDC-PERPETUAL, BTC_USDC     linear, PnL in USDC, index btc_usdc
+//   BTC-27DEC24-60000-C              linear (premium in BTC), PnL in BTC, marked by ticker only
+struct InstrumentTerms {
+    std::string currency;
+    std::string index_name;         // Empty for options
+    bool inverse;
+};
+
+InstrumentTerms classify(std::string_view name) {
+    size_t dash = name.find('-');
+    std::string_view head = name.substr(0, dash);
+    size_t underscore = head.find('_');
+    std::string_view base = head.substr(0, underscore);
+    std::string_view quote = underscore == std::string_view::npos ? std::string_view() : head.substr(underscore + 1);
+
+    size_t dashes = 0;
+    for (char c : name) {
+        dashes += c == '-';
+    }
+    bool option = dashes == 3 && (name.back() == 'C' || name.back() == 'P');
+
+    InstrumentTerms terms;
+    terms.currency = std::string(quote.empty() ? base : quote);
+    terms.inverse = quote.empty() && !option;
+    if (!option) {
+        terms.index_name = lowercase(base) + "_" + (quote.empty() ? std::string("usd") : lowercase(quote));
+    }
+    return terms;
+}
+
+double numberOr(const json& object, const char* key, double fallback) {
+    auto it = object.find(key);
+    return it != object.end() && it->is_number() ? it->get<double>() : fallback;
+}
+
+}  // namespace
+
+DeribitPositionBook::DeribitPositionBook() : instrument_count(0), reconciled(false) {}
+
+uint32_t DeribitPositionBook::instrumentIndex(std::string_view instrument_name) {
+    uint32_t id = instruments.intern(instrument_name);
+    if (id < instrument_count) {
+        return id;
+    }
+
+    InstrumentTerms terms = classify(instrument_name);
+    uint32_t index_id = DeribitKeyIndex::NO_KEY;
+    if (!terms.index_name.empty()) {
+        index_id = indices.intern(terms.index_name);
+        if (index_id == index_price.size()) {
+            index_price.push_back(0.0);
+        }
+    }
+
+    instrument_count = id + 1;
+    if (instrument_count > size.size()) {
+        size_t padded = size.size() + LANES;
+        for (auto* values : { &size, &average_price, &mark_price, &reciprocal_average, &reciprocal_mark,
+                              &inverse, &priced, &realized_pnl, &floating_pnl }) {
+            values->resize(padded, 0.0);
+        }
+    }
+    mark_price[id] = index_id != DeribitKeyIndex::NO_KEY ? index_price[index_id] : 0.0;
+    inverse[id] = terms.inverse ? 1.0 : 0.0;
+    currency.push_back(currencies.intern(terms.currency));
+    index.push_back(index_id);
+    has_mark.push_back(0);
+    refresh(id);
+    return id;
+}
+
+void DeribitPositionBook::refresh(uint32_t id) {
+    bool known = average_price[id] > 0.0 && mark_price[id] > 0.0;
+    priced[id] = known ? 1.0 : 0.0;
+    reciprocal_average[id] = known ? 1.0 / average_price[id] : 0.0;
+    reciprocal_mark[id] = known ? 1.0 / mark_price[id] : 0.0;
+}
+
+double DeribitPositionBook::floatingPnl(uint32_t id) const {
+    return priced[id] != 0.0 ? pnlOf(size[id], average_price[id], mark_price[id], inverse[id] != 0.0) : 0.0;
+}
+
+void DeribitPositionBook::applyFill(const TradeEvent& trade) {
+    if (trade.instrument_name.empty() || trade.amount <= 0.0 || trade.price <= 0.0) {
+        return;
+    }
+    double fill = trade.direction == OrderSide::Buy ? trade.amount : -trade.amount;
+    double price = trade.price;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t id = instrumentIndex(trade.instrument_name);
+    double current = size[id];
+    double average = average_price[id];
+
+    if (current == 0.0 || (current > 0.0) == (fill > 0.0)) {
+        // Adding to the position: inverse contracts average in 1/price
+        double next = current + fill;
+        average_price[id] = inverse[id] != 0.0 ? next / (current / (current == 0.0 ? price : average) + fill / price)
+                                               : (current * average + fill * price) / next;
+        size[id] = next;
+    } else {
+        // Reducing: realize PnL on the closed part; any excess opens the other way at price
+        double closed = std::fabs(fill) < std::fabs(current) ? -fill : current;
+        realized_pnl[id] += pnlOf(closed, average, price, inverse[id] != 0.0);
+        double next = current + fill;
+        if (std::fabs(next) < FLAT_SIZE) {
+            size[id] = 0.0;
+            average_price[id] = 0.0;
+        } else {
+            if ((next > 0.0) != (current > 0.0)) {
+                average_price[id] = price;
+            }
+            size[id] = next;
+        }
+    }
+
+    if (!std::isnan(trade.mark_price) && trade.mark_price > 0.0) {
+        mark_price[id] = trade.mark_price;
+        has_mark[id] = 1;
+    }
+    refresh(id);
+}
+
+// Instruments we have never traded are ignored, so market data costs one lookup.
+void DeribitPositionBook::onMark(std::string_view instrument_name, double mark) {
+    if (std::isnan(mark) || mark <= 0.0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t id = instruments.find(instrument_name);
+    if (id == DeribitKeyIndex::NO_KEY) {
+        return;
+    }
+    mark_price[id] = mark;
+    has_mark[id] = 1;
+    refresh(id);
+}
+
+void DeribitPositionBook::onIndex(std::string_view index_name, double price) {
+    if (std::isnan(price) || price <= 0.0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t index_id = indices.intern(index_name);
+    if (index_id == index_price.size()) {
+        index_price.push_back(0.0);
+    }
+    index_price[index_id] = price;
+    for (uint32_t id = 0; id < instrument_count; ++id) {
+        if (index[id] == index_id && !has_mark[id]) {
+            mark_price[id] = price;
+            refresh(id);
+        }
+    }
+}
+
+bool DeribitPositionBook::reconcile(const json& response) {
+    if (!response.contains("result") || !(response["result"].is_array() || response["result"].is_object())) {
+        LOG_ERROR("Unable to reconcile positions: ", response.dump());
+        return false;
+    }
+    const json& result = response["result"];
+    // get_positions lists every position, so anything it leaves out is flat
+    bool complete = result.is_array();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<uint8_t> reported(instrument_count, 0);
+    size_t drifted = 0;
+    auto apply = [&](const json& position) {
+        if (!position.contains("instrument_name") || !position["instrument_name"].is_string()) {
+            return;
+        }
+        const std::string& name = position["instrument_name"].get_ref<const std::string&>();
+        bool known = instruments.find(name) != DeribitKeyIndex::NO_KEY;
+        uint32_t id = instrumentIndex(name);
+        if (id >= reported.size()) {
+            reported.resize(id + 1, 0);
+        }
+        reported[id] = 1;
+
+        double exchange_size = numberOr(position, "size", 0.0);
+        if (known && std::fabs(exchange_size - size[id]) > FLAT_SIZE) {
+            LOG_WARN("Position drift on ", name, ": local ", size[id], ", exchange ", exchange_size);
+            ++drifted;
+        }
+        size[id] = exchange_size;
+        average_price[id] = numberOr(position, "average_price", 0.0);
+        realized_pnl[id] = numberOr(position, "realized_profit_loss", realized_pnl[id]);
+        double mark = numberOr(position, "mark_price", 0.0);
+        if (mark > 0.0) {
+            mark_price[id] = mark;
+            has_mark[id] = 1;
+        }
+        refresh(id);
+    };
+
+    if (complete) {
+        for (const auto& position : result) {
+            apply(position);
+        }
+        for (uint32_t id = 0; id < reported.size(); ++id) {
+            if (!reported[id] && std::fabs(size[id]) > FLAT_SIZE) {
+                LOG_WARN("Position drift on ", instruments.key(id), ": local ", size[id], ", exchange flat");
+                ++drifted;
+                size[id] = 0.0;
+                average_price[id] = 0.0;
+                refresh(id);
+            }
+        }
+    } else {
+        apply(result);
+    }
+
+    reconciled = true;
+    LOG_INFO("Positions reconciled (", drifted, " drifted).");
+    return true;
+}
+
+bool DeribitPositionBook::isReconciled() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return reconciled;
+}
+
+PositionSnapshot DeribitPositionBook::snapshot(uint32_t id) const {
+    PositionSnapshot out;
+    out.instrument_name = instruments.key(id);
+    out.currency = currencies.key(currency[id]);
+    out.size = size[id];
+    out.average_price = average_price[id];
+    out.mark_price = mark_price[id];
+    out.realized_pnl = realized_pnl[id];
+    out.floating_pnl = floatingPnl(id);
+    return out;
+}
+
+bool DeribitPositionBook::getPosition(std::string_view instrument_name, PositionSnapshot& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t id = instruments.find(instrument_name);
+    if (id == DeribitKeyIndex::NO_KEY) {
+        return false;
+    }
+    out = snapshot(id);
+    return true;
+}
+
+size_t DeribitPositionBook::positions(std::vector<PositionSnapshot>& out) const {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (uint32_t id = 0; id < instrument_count; ++id) {
+        if (size[id] != 0.0 || realized_pnl[id] != 0.0) {
+            out.push_back(snapshot(id));
+        }
+    }
+    return out.size();
+}
+
+size_t DeribitPositionBook::totals(std::vector<CurrencyTotals>& out) const {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Revalue every instrument, padding included, LANES at a time. The inverse
+    // and linear forms are blended by the inverse flag and masked by priced,
+    // so there are no branches and unknown prices contribute zero.
+    const size_t padded = size.size();
+    for (size_t i = 0; i < padded; i += LANES) {
+        Lanes contract, held, known, reciprocal_avg, reciprocal_mk, mark, average;
+        loadLanes(contract, &inverse[i]);
+        loadLanes(held, &size[i]);
+        loadLanes(known, &priced[i]);
+        loadLanes(reciprocal_avg, &reciprocal_average[i]);
+        loadLanes(reciprocal_mk, &reciprocal_mark[i]);
+        loadLanes(mark, &mark_price[i]);
+        loadLanes(average, &average_price[i]);
+        Lanes pnl = known * held * (contract * (reciprocal_avg - reciprocal_mk) + (1.0 - contract) * (mark - average));
+        std::memcpy(&floating_pnl[i], &pnl, sizeof(pnl));
+    }
+
+    currency_totals.assign(currencies.size(), CurrencyTotals());
+    for (size_t i = 0; i < instrument_count; ++i) {
+        CurrencyTotals& sum = currency_totals[currency[i]];
+        sum.realized_pnl += realized_pnl[i];
+        sum.floating_pnl += floating_pnl[i];
+        sum.open_positions += size[i] != 0.0;
+    }
+    for (uint32_t id = 0; id < currency_totals.size(); ++id) {
+        currency_totals[id].currency = currencies.key(id);
+        out.push_back(currency_totals[id]);
+    }
+    return out.size();
+}
+
+void DeribitPositionBook::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    instruments.clear();
+    currencies.clear();
+    indices.clear();
+    instrument_count = 0;
+    for (auto* values : { &size, &average_price, &mark_price, &reciprocal_average, &reciprocal_mark,
+                          &inverse, &priced, &realized_pnl, &floating_pnl }) {
+        values->clear();
+    }
+    currency.clear();
+    index.clear();
+    has_mark.clear();
+    index_price.clear();
+    reconciled = false;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DeribitKeyIndex.hpp"
+#include "DeribitMessageDecoder.hpp"
+
+using json = nlohmann::json;
+
+// One instrument's position
+struct PositionSnapshot {
+    std::string instrument_name;
+    std::string currency;           // Currency PnL is measured in, e.g. BTC or USDC
+    double size = 0.0;              // Signed; USD for inverse futures, base currency otherwise
+    double average_price = 0.0;
+    double mark_price = 0.0;        // 0 until a mark or index price arrives
+    double realized_pnl = 0.0;
+    double floating_pnl = 0.0;
+};
+
+// Sums over every instrument whose PnL is measured in one currency
+struct CurrencyTotals {
+    std::string currency;
+    double realized_pnl = 0.0;
+    double floating_pnl = 0.0;
+    size_t open_positions = 0;
+};
+
+/**
+ * @class DeribitPositionBook
+ * @brief Local positions and PnL, updated on every fill and mark price
+ *
+ * Each fill moves the size and average price of its instrument and realizes
+ * PnL on the part that closes the position; each mark price (ticker.*, or the
+ * mark carried by trades) or index price (deribit_price_index.*, used until
+ * the instrument has a mark of its own) moves the price floating PnL is
+ * measured against. Coin-settled
+ * futures are inverse: PnL = size * (1 / average - 1 / mark), in the base
+ * currency. USDC/USDT-settled instruments and options are linear:
+ * PnL = size * (mark - average).
+ *
+ * Positions are kept as parallel arrays indexed by instrument id and padded
+ * to a whole number of SIMD lanes. Fills and ticks only update the arrays;
+ * floating PnL is computed when asked for, and totals() revalues every
+ * instrument in one pass four lanes at a time. reconcile() overwrites local
+ * state with a private/get_positions response and logs any drift, so it is
+ * only needed occasionally. Updates come from several io threads when a
+ * market data pool is enabled, so access takes a mutex.
+ */
+class DeribitPositionBook {
+public:
+    DeribitPositionBook();
+
+    // Update side (io threads)
+    void applyFill(const TradeEvent& trade);
+    void onMark(std::string_view instrument_name, double mark_price);
+    void onIndex(std::string_view index_name, double price);
+
+    /**
+     * @brief Replaces local positions with a private/get_positions (or
+     *        private/get_position) response
+     * @return false if the response carries no positions
+     */
+    bool reconcile(const json& response);
+
+    // Query side (any thread)
+    bool isReconciled() const;
+    bool getPosition(std::string_view instrument_name, PositionSnapshot& out) const;
+
+    // Copy every instrument with a position or realized PnL into out (cleared first)
+    size_t positions(std::vector<PositionSnapshot>& out) const;
+
+    // Revalues all positions at their current marks and sums them per currency
+    size_t totals(std::vector<CurrencyTotals>& out) const;
+
+    void clear();
+
+private:
+    // Returns the id of instrument_name, classifying it on first use
+    uint32_t instrumentIndex(std::string_view instrument_name);
+    // Refreshes the reciprocals and mask that the totals() pass reads
+    void refresh(uint32_t id);
+    double floatingPnl(uint32_t id) const;
+    PositionSnapshot snapshot(uint32_t id) const;
+
+    DeribitKeyIndex instruments;
+    DeribitKeyIndex currencies;         // PnL currencies
+    DeribitKeyIndex indices;            // Price index names, e.g. btc_usd
+
+    // Per instrument, indexed by instruments; padding entries stay zero
+    size_t instrument_count;
+    std::vector<double> size;
+    std::vector<double> average_price;
+    std::vector<double> mark_price;
+    std::vector<double> reciprocal_average;     // 1 / average_price, for inverse PnL
+    std::vector<double> reciprocal_mark;
+    std::vector<double> inverse;                // 1 for inverse contracts, 0 for linear
+    std::vector<double> priced;                 // 1 once both prices are known, else 0
+    std::vector<double> realized_pnl;
+    mutable std::vector<double> floating_pnl;   // Written by totals()
+    std::vector<uint32_t> currency;
+    std::vector<uint32_t> index;                // Underlying price index; NO_KEY for options
+    std::vector<uint8_t> has_mark;              // A mark price arrived; the index no longer applies
+
+    std::vector<double> index_price;            // Indexed by indices
+    mutable std::vector<CurrencyTotals> currency_totals;    // Scratch for totals()
+    bool reconciled;
+    mutable std::mutex mutex;
+};
@@ -0,0 +1,107 @@
+#include "DeribitReconnect.hpp"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+int64_t millisBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count();
+}
+
+}  // namespace
+
+DeribitBackoff::DeribitBackoff(const ReconnectPolicy& policy)
+    : policy(policy), attempt(0), random(std::random_device()()) {}
+
+int DeribitBackoff::nextDelayMs() {
+    int64_t cap = std::max(1, policy.initial_delay_ms);
+    for (int i = 0; i < attempt && cap < policy.max_delay_ms; ++i) {
+        cap *= 2;
+    }
+    cap = std::min<int64_t>(cap, std::max(1, policy.max_delay_ms));
+    ++attempt;
+    std::uniform_int_distribution<int64_t> jitter(cap / 2, cap);
+    return static_cast<int>(jitter(random));
+}
+
+DeribitTlsSessionCache::~DeribitTlsSessionCache() {
+    clear();
+}
+
+void DeribitTlsSessionCache::save(SSL* ssl) {
+    if (ssl == nullptr) {
+        return;
+    }
+    SSL_SESSION* latest = SSL_get1_session(ssl);
+    if (latest == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (session != nullptr) {
+        SSL_SESSION_free(session);
+    }
+    session = latest;
+}
+
+void DeribitTlsSessionCache::apply(SSL* ssl) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ssl != nullptr && session != nullptr) {
+        SSL_set_session(ssl, session);
+    }
+}
+
+void DeribitTlsSessionCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (session != nullptr) {
+        SSL_SESSION_free(session);
+        session = nullptr;
+    }
+}
+
+void DeribitRecoveryClock::begin(bool private_needed) {
+    // A drop during a recovery continues the same one
+    connected = authenticated = public_done = private_done = false;
+    if (recovering) {
+        return;
+    }
+    recovering = true;
+    needs_private = private_needed;
+    lost_at = std::chrono::steady_clock::now();
+}
+
+void DeribitRecoveryClock::markConnected() {
+    connected = true;
+    connected_at = std::chrono::steady_clock::now();
+}
+
+void DeribitRecoveryClock::markAuthenticated() {
+    authenticated = true;
+    authenticated_at = std::chrono::steady_clock::now();
+}
+
+void DeribitRecoveryClock::markResubscribed(bool private_channels) {
+    (private_channels ? private_done : public_done) = true;
+    resubscribed_at = std::chrono::steady_clock::now();
+}
+
+bool DeribitRecoveryClock::isComplete() const {
+    return recovering && connected && public_done && (private_done || !needs_private);
+}
+
+int64_t DeribitRecoveryClock::finish() {
+    recovering = false;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - lost_at)
+        .count();
+}
+
+std::string DeribitRecoveryClock::summary() const {
+    std::ostringstream out;
+    out << "connect " << millisBetween(lost_at, connected_at) << " ms";
+    TimePoint last = connected_at;
+    if (needs_private && authenticated) {
+        out << ", auth " << millisBetween(connected_at, authenticated_at) << " ms";
+        last = std::max(last, authenticated_at);
+    }
+    out << ", resubscribe " << millisBetween(last, std::max(last, resubscribed_at)) << " ms";
+    return out.str();
+}
@@ -0,0 +1,255 @@
+#include "DeribitRequestScheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Methods Deribit counts against the matching engine bucket
+const char* const MATCHING_ENGINE_METHODS[] = {
+    "private/buy", "private/sell", "private/edit", "private/edit_by_label", "private/cancel",
+    "private/cancel_all", "private/cancel_all_by_currency", "private/cancel_all_by_instrument",
+    "private/cancel_all_by_kind_or_type", "private/cancel_by_label", "private/cancel_quotes",
+    "private/close_position", "private/mass_quote", "private/accept_block_rfq"
+};
+
+const char* const CONTROL_METHODS[] = {
+    "public/auth", "public/exchange_token", "public/fork_token", "private/logout",
+    "public/subscribe", "private/subscribe", "public/unsubscribe", "private/unsubscribe",
+    "public/unsubscribe_all", "private/unsubscribe_all", "public/set_heartbeat", "public/test"
+};
+
+template <size_t N>
+bool listed(const char* method, const char* const (&methods)[N]) {
+    for (const char* candidate : methods) {
+        if (std::strcmp(method, candidate) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+void DeribitRequestScheduler::Bucket::reset(const CreditLimits& new_limits, TimePoint now) {
+    limits = new_limits;
+    credits = limits.max_credits;
+    refilled_at = now;
+}
+
+void DeribitRequestScheduler::Bucket::refill(TimePoint now) {
+    double elapsed_s = std::chrono::duration<double>(now - refilled_at).count();
+    credits = std::min(limits.max_credits, credits + elapsed_s * limits.refill_per_second);
+    refilled_at = now;
+}
+
+DeribitRequestScheduler::DeribitRequestScheduler(const RateLimitConfig& config) : waiting(0) {
+    configure(config);
+}
+
+void DeribitRequestScheduler::configure(const RateLimitConfig& new_config) {
+    std::lock_guard<std::mutex> lock(mutex);
+    config = new_config;
+    auto now = std::chrono::steady_clock::now();
+    matching.reset(config.matching, now);
+    non_matching.reset(config.non_matching, now);
+}
+
+bool DeribitRequestScheduler::enabled() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return config.enabled;
+}
+
+RequestPriority DeribitRequestScheduler::classify(const char* method) {
+    if (listed(method, MATCHING_ENGINE_METHODS)) {
+        return RequestPriority::Order;
+    }
+    return listed(method, CONTROL_METHODS) ? RequestPriority::Control : RequestPriority::Query;
+}
+
+const char* DeribitRequestScheduler::priorityName(RequestPriority priority) {
+    switch (priority) {
+        case RequestPriority::Order: return "order";
+        case RequestPriority::Control: return "control";
+        case RequestPriority::Query: return "query";
+    }
+    return "unknown";
+}
+
+DeribitRequestScheduler::Bucket& DeribitRequestScheduler::bucketFor(RequestPriority priority) {
+    return priority == RequestPriority::Order ? matching : non_matching;
+}
+
+double DeribitRequestScheduler::floorFor(RequestPriority priority) const {
+    return priority == RequestPriority::Query ? config.query_reserve * config.non_matching.max_credits : 0.0;
+}
+
+// Orders wait behind orders; control requests behind control requests; queries behind both of the latter
+bool DeribitRequestScheduler::blocked(RequestPriority priority) const {
+    switch (priority) {
+        case RequestPriority::Order:
+            return !queues[0].empty();
+        case RequestPriority::Control:
+            return !queues[1].empty();
+        case RequestPriority::Query:
+            return !queues[1].empty() || !queues[2].empty();
+    }
+    return false;
+}
+
+bool DeribitRequestScheduler::take(RequestPriority priority, TimePoint now) {
+    Bucket& bucket = bucketFor(priority);
+    bucket.refill(now);
+    if (bucket.credits - bucket.limits.cost < floorFor(priority)) {
+        return false;
+    }
+    bucket.credits -= bucket.limits.cost;
+    return true;
+}
+
+bool DeribitRequestScheduler::admit(RequestPriority priority) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!config.enabled) {
+        ++totals.sent_immediately;
+        return true;
+    }
+    if (blocked(priority) || !take(priority, std::chrono::steady_clock::now())) {
+        return false;
+    }
+    ++totals.sent_immediately;
+    return true;
+}
+
+void DeribitRequestScheduler::charge(RequestPriority priority) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++totals.sent_immediately;
+    if (!config.enabled) {
+        return;
+    }
+    Bucket& bucket = bucketFor(priority);
+    bucket.refill(std::chrono::steady_clock::now());
+    bucket.credits -= bucket.limits.cost;
+}
+
+bool DeribitRequestScheduler::enqueue(QueuedRequest&& request) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (waiting >= config.max_queued) {
+        return false;
+    }
+    queues[static_cast<int>(request.priority)].push_back(std::move(request));
+    ++waiting;
+    ++totals.queued;
+    return true;
+}
+
+uint64_t DeribitRequestScheduler::coalesce(const std::string& key, ResponseCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& request : queues[static_cast<int>(RequestPriority::Query)]) {
+        if (request.coalesce_key != key) {
+            continue;
+        }
+        ResponseCallback first = std::move(request.callback);
+        request.callback = [first, callback](const json& response, int64_t latency_us) {
+            if (first) {
+                first(response, latency_us);
+            }
+            if (callback) {
+                callback(response, latency_us);
+            }
+        };
+        ++totals.coalesced;
+        return request.id;
+    }
+    return 0;
+}
+
+bool DeribitRequestScheduler::next(QueuedRequest& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = std::chrono::steady_clock::now();
+    for (auto& queue : queues) {
+        if (queue.empty() || (config.enabled && !take(queue.front().priority, now))) {
+            continue;
+        }
+        out = std::move(queue.front());
+        queue.pop_front();
+        --waiting;
+        return true;
+    }
+    return false;
+}
+
+int64_t DeribitRequestScheduler::nextReadyMs() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (waiting == 0) {
+        return -1;
+    }
+    if (!config.enabled) {
+        return 0;
+    }
+    auto now = std::chrono::steady_clock::now();
+    double soonest_ms = -1.0;
+    for (int i = 0; i < 3; ++i) {
+        if (queues[i].empty()) {
+            continue;
+        }
+        RequestPriority priority = static_cast<RequestPriority>(i);
+        Bucket& bucket = bucketFor(priority);
+        bucket.refill(now);
+        double missing = floorFor(priority) + bucket.limits.cost - bucket.credits;
+        double ms = missing <= 0.0 ? 0.0 : missing * 1000.0 / std::max(bucket.limits.refill_per_second, 1.0);
+        soonest_ms = soonest_ms < 0.0 ? ms : std::min(soonest_ms, ms);
+    }
+    return static_cast<int64_t>(std::ceil(soonest_ms));
+}
+
+void DeribitRequestScheduler::onThrottled(RequestPriority priority) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Bucket& bucket = bucketFor(priority);
+    bucket.credits = 0.0;
+    bucket.refilled_at = std::chrono::steady_clock::now();
+    ++totals.throttled;
+}
+
+size_t DeribitRequestScheduler::expire(std::chrono::steady_clock::time_point cutoff, std::vector<QueuedRequest>& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t before = out.size();
+    for (auto& queue : queues) {
+        while (!queue.empty() && queue.front().queued_at <= cutoff) {
+            out.push_back(std::move(queue.front()));
+            queue.pop_front();
+            --waiting;
+        }
+    }
+    return out.size() - before;
+}
+
+size_t DeribitRequestScheduler::drain(std::vector<QueuedRequest>& out) {
+    return expire(std::chrono::steady_clock::time_point::max(), out);
+}
+
+size_t DeribitRequestScheduler::drain(RequestPriority priority, std::vector<QueuedRequest>& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::deque<QueuedRequest>& queue = queues[static_cast<int>(priority)];
+    size_t count = queue.size();
+    for (auto& request : queue) {
+        out.push_back(std::move(request));
+    }
+    queue.clear();
+    waiting -= count;
+    return count;
+}
+
+SchedulerStats DeribitRequestScheduler::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = std::chrono::steady_clock::now();
+    Bucket matching_now = matching;
+    Bucket non_matching_now = non_matching;
+    matching_now.refill(now);
+    non_matching_now.refill(now);
+
+    SchedulerStats out = totals;
+    out.waiting = waiting;
+    out.matching_credits = matching_now.credits;
+    out.non_matching_credits = non_matching_now.credits;
+    return out;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "DeribitRequestTable.hpp"
+
+// Which credit bucket a request draws from, and who goes first when credits run short
+enum class RequestPriority : uint8_t {
+    Order,          // Matching engine: buy, sell, edit, cancel and the like
+    Control,        // Authentication and subscriptions
+    Query           // Everything else, e.g. get_order_book, get_position
+};
+
+// One of Deribit's credit buckets
+struct CreditLimits {
+    double max_credits;
+    double refill_per_second;
+    double cost;                    // Credits per request
+};
+
+struct RateLimitConfig {
+    bool enabled = true;
+    CreditLimits matching = {20000, 5000, 1000};        // 20 back to back, then 5 per second
+    CreditLimits non_matching = {50000, 10000, 500};    // 100 back to back, then 20 per second
+    double query_reserve = 0.2;     // Share of the non-matching bucket queries leave to control requests
+    size_t max_queued = 4096;
+};
+
+// A request waiting for credits
+struct QueuedRequest {
+    uint64_t id = 0;
+    const char* method = nullptr;
+    const char* description = nullptr;
+    RequestPriority priority = RequestPriority::Query;
+    std::string payload;
+    std::string coalesce_key;       // Empty if the request may not be merged
+    ResponseCallback callback;
+    std::chrono::steady_clock::time_point queued_at;
+};
+
+struct SchedulerStats {
+    uint64_t sent_immediately = 0;
+    uint64_t queued = 0;
+    uint64_t coalesced = 0;         // Queries answered by an identical waiting one
+    uint64_t throttled = 0;         // too_many_requests replies from the exchange
+    size_t waiting = 0;
+    double matching_credits = 0.0;
+    double non_matching_credits = 0.0;
+};
+
+/**
+ * @class DeribitRequestScheduler
+ * @brief Local model of Deribit's request credits, with a queue per priority
+ *
+ * Deribit charges every request against one of two refilling credit buckets:
+ * matching engine requests (orders, edits, cancels) and everything else. The
+ * scheduler keeps the same buckets, so a request that would be throttled
+ * waits here instead of costing a too_many_requests round trip. Orders wait
+ * only behind other orders; queries wait behind control requests and leave a
+ * reserve of non-matching credits for them, so a burst of book or position
+ * queries cannot hold up re-authentication or a resubscription. A query that
+ * is identical to one still waiting is merged into it.
+ *
+ * Any thread may admit and queue; DeribitAuth sends the queued requests from
+ * its io thread when next() allows. All state is behind one mutex.
+ */
+class DeribitRequestScheduler {
+public:
+    explicit DeribitRequestScheduler(const RateLimitConfig& config = RateLimitConfig());
+
+    // Buckets start full; requests already waiting stay queued
+    void configure(const RateLimitConfig& config);
+    bool enabled() const;
+
+    static RequestPriority classify(const char* method);
+    static const char* priorityName(RequestPriority priority);
+
+    /**
+     * @brief Takes the credits for a request that is about to be sent
+     * @return false if it has to queue: credits are short, or a request it
+     *         must not overtake is already waiting
+     */
+    bool admit(RequestPriority priority);
+
+    // Charges a request sent ahead of everything waiting; the bucket may go below zero
+    void charge(RequestPriority priority);
+
+    bool enqueue(QueuedRequest&& request);      // false if the queue is full
+
+    /**
+     * @brief Merges a query into an identical one that is still waiting
+     * @return The id of the waiting request, or 0 if there is none
+     */
+    uint64_t coalesce(const std::string& key, ResponseCallback callback);
+
+    /**
+     * @brief Takes the next waiting request that credits allow, highest
+     *        priority first, and charges for it
+     * @return false if none can go yet
+     */
+    bool next(QueuedRequest& out);
+
+    // Milliseconds until next() could return a request; -1 if nothing waits
+    int64_t nextReadyMs();
+
+    // Empties the bucket after a too_many_requests reply, so the model cannot run ahead of the exchange
+    void onThrottled(RequestPriority priority);
+
+    // Removes waiting requests queued before cutoff, or all of them
+    size_t expire(std::chrono::steady_clock::time_point cutoff, std::vector<QueuedRequest>& out);
+    size_t drain(std::vector<QueuedRequest>& out);
+    size_t drain(RequestPriority priority, std::vector<QueuedRequest>& out);
+
+    SchedulerStats stats() const;
+
+private:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    struct Bucket {
+        CreditLimits limits;
+        double credits;
+        TimePoint refilled_at;
+
+        void reset(const CreditLimits& limits, TimePoint now);
+        void refill(TimePoint now);
+    };
+
+    Bucket& bucketFor(RequestPriority priority);
+    double floorFor(RequestPriority priority) const;  // Credits a request must leave in the bucket
+    bool blocked(RequestPriority priority) const;
+    bool take(RequestPriority priority, TimePoint now);
+
+    RateLimitConfig config;
+    Bucket matching;
+    Bucket non_matching;
+    std::deque<QueuedRequest> queues[3];            // Indexed by RequestPriority
+    size_t waiting;
+    SchedulerStats totals;
+    mutable std::mutex mutex;
+};
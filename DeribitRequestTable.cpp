@@ -0,0 +1,120 @@
+#include "DeribitRequestTable.hpp"
+
+// Constructor: round the capacity up to a power of two so id & mask is a valid index.
+DeribitRequestTable::DeribitRequestTable(size_t capacity)
+    : count(0), next_id(1) {
+    size_t size = 16;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    slots.resize(size);
+    mask = size - 1;
+}
+
+bool DeribitRequestTable::insert(uint64_t id, const char* method, ResponseCallback callback,
+                                 std::chrono::milliseconds timeout) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Keep one slot free so probe loops always terminate
+    if (count + 1 >= slots.size()) {
+        return false;
+    }
+
+    size_t i = indexFor(id);
+    while (slots[i].id != 0) {
+        i = (i + 1) & mask;
+    }
+
+    PendingRequest& slot = slots[i];
+    slot.id = id;
+    slot.method = method;
+    slot.sent_at = std::chrono::steady_clock::now();
+    slot.deadline = slot.sent_at + timeout;
+    slot.callback = std::move(callback);
+    ++count;
+    return true;
+}
+
+bool DeribitRequestTable::complete(uint64_t id, PendingRequest& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t i = indexFor(id);
+    while (slots[i].id != 0) {
+        if (slots[i].id == id) {
+            out = std::move(slots[i]);
+            removeAt(i);
+            return true;
+        }
+        i = (i + 1) & mask;
+    }
+    return false;
+}
+
+size_t DeribitRequestTable::expire(std::chrono::steady_clock::time_point now,
+                                   std::vector<PendingRequest>& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t expired = 0;
+    size_t i = 0;
+    while (i < slots.size()) {
+        if (slots[i].id != 0 && slots[i].deadline <= now) {
+            out.push_back(std::move(slots[i]));
+            removeAt(i);
+            ++expired;
+            // removeAt may have shifted another entry into slot i; look at it again
+        } else {
+            ++i;
+        }
+    }
+    return expired;
+}
+
+size_t DeribitRequestTable::drain(std::vector<PendingRequest>& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t drained = 0;
+    for (auto& slot : slots) {
+        if (slot.id != 0) {
+            out.push_back(std::move(slot));
+            slot = PendingRequest();
+            ++drained;
+        }
+    }
+    count = 0;
+    return drained;
+}
+
+size_t DeribitRequestTable::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return count;
+}
+
+// Backward-shift deletion: pull later members of the probe chain into the hole
+// so lookups never need tombstones.
+void DeribitRequestTable::removeAt(size_t index) {
+    size_t hole = index;
+    size_t i = (index + 1) & mask;
+    while (slots[i].id != 0) {
+        size_t home = indexFor(slots[i].id);
+        // Move the entry if its home slot is not cyclically within (hole, i]
+        bool movable = hole <= i ? (home <= hole || home > i) : (home <= hole && home > i);
+        if (movable) {
+            slots[hole] = std::move(slots[i]);
+            hole = i;
+        }
+        i = (i + 1) & mask;
+    }
+    slots[hole] = PendingRequest();
+    --count;
+}
+
+json DeribitRequestTable::makeErrorResponse(uint64_t id, const std::string& message) {
+    json j;
+    j["jsonrpc"] = "2.0";
+    j["id"] = id;
+    j["error"] = {
+        {"code", -1},
+        {"message", message}
+    };
+    return j;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+using json = nlohmann::json;
+
+/**
+ * @brief Callback invoked on the io thread when a request completes
+ * @param response The full JSON-RPC reply (contains "result" or "error"). On
+ *                 timeout or disconnect a synthesized "error" reply is passed.
+ * @param latency_us Time from send to completion in microseconds
+ */
+typedef std::function<void(const json& response, int64_t latency_us)> ResponseCallback;
+
+// Book-keeping for a single in-flight JSON-RPC request
+struct PendingRequest {
+    uint64_t id = 0;                                    // 0 marks an empty slot
+    const char* method = nullptr;                       // Static string, e.g. "private/buy"
+    std::chrono::steady_clock::time_point sent_at;
+    std::chrono::steady_clock::time_point deadline;
+    ResponseCallback callback;
+};
+
+/**
+ * @class DeribitRequestTable
+ * @brief Correlates JSON-RPC responses with the requests that produced them
+ *
+ * Request ids come from a monotonically increasing counter. In-flight requests
+ * live in a preallocated, open-addressed table (linear probing, backward-shift
+ * deletion) so registering and completing a request never allocates. Because
+ * ids are sequential, id & mask spreads them perfectly and probes are rare.
+ */
+class DeribitRequestTable {
+public:
+    explicit DeribitRequestTable(size_t capacity = 1024);
+
+    // Returns a fresh request id; never returns 0
+    uint64_t nextId() { return next_id.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief Registers an in-flight request
+     * @return false if the table is full
+     */
+    bool insert(uint64_t id, const char* method, ResponseCallback callback,
+                std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Removes a request once its response has arrived
+     * @param out Receives the stored request
+     * @return false if the id is unknown (already completed or timed out)
+     */
+    bool complete(uint64_t id, PendingRequest& out);
+
+    // Removes every request whose deadline is at or before now
+    size_t expire(std::chrono::steady_clock::time_point now, std::vector<PendingRequest>& out);
+
+    // Removes every request, e.g. when the connection drops
+    size_t drain(std::vector<PendingRequest>& out);
+
+    size_t size() const;
+    size_t capacity() const { return slots.size(); }
+
+    // Builds the error reply handed to callbacks for requests that never got one
+    static json makeErrorResponse(uint64_t id, const std::string& message);
+
+private:
+    size_t indexFor(uint64_t id) const { return static_cast<size_t>(id) & mask; }
+    void removeAt(size_t index);
+
+    std::vector<PendingRequest> slots;
+    size_t mask;
+    size_t count;
+    std::atomic<uint64_t> next_id;
+    mutable std::mutex mutex;       // Requests are sent from the caller's thread, completed on the io thread
+};
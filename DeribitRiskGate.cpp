@@ -0,0 +1,389 @@
+#include "DeribitRiskGate.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+// Closed orders are forgotten once there are this many and they outnumber the open ones
+const size_t FORGET_CLOSED_AFTER = 4096;
+
+void addTo(std::atomic<double>& value, double delta) {
+    double current = value.load(std::memory_order_relaxed);
+    while (!value.compare_exchange_weak(current, current + delta, std::memory_order_relaxed)) {
+    }
+}
+
+bool isOpen(OrderState state) {
+    return state == OrderState::Open || state == OrderState::Untriggered;
+}
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double numberOr(const json& object, const char* key, double fallback) {
+    auto it = object.find(key);
+    return it != object.end() && it->is_number() ? it->get<double>() : fallback;
+}
+
+std::string_view textOr(const json& object, const char* key) {
+    auto it = object.find(key);
+    return it != object.end() && it->is_string() ? std::string_view(it->get_ref<const std::string&>())
+                                                 : std::string_view();
+}
+
+}  // namespace
+
+DeribitRiskGate::DeribitRiskGate(const DeribitInstrumentRegistry& registry, size_t capacity)
+    : registry(registry),
+      capacity(capacity),
+      slots(new InstrumentRisk[capacity]),
+      killed(false),
+      max_open_orders(0),
+      open_orders(0),
+      rate_interval_ns(0),
+      rate_tolerance_ns(0),
+      rate_tat_ns(0),
+      rejected(0),
+      closed_count(0) {}
+
+void DeribitRiskGate::configure(const RiskConfig& config) {
+    auto assign = [&config](InstrumentRisk& risk) {
+        risk.max_order_amount.store(config.defaults.max_order_amount, std::memory_order_relaxed);
+        risk.max_position.store(config.defaults.max_position, std::memory_order_relaxed);
+        risk.max_price_deviation.store(config.defaults.max_price_deviation, std::memory_order_relaxed);
+        risk.max_open_orders.store(config.defaults.max_open_orders, std::memory_order_relaxed);
+    };
+    assign(defaults);
+    for (size_t i = 0; i < capacity; ++i) {
+        assign(slots[i]);
+    }
+
+    max_open_orders.store(config.max_open_orders, std::memory_order_relaxed);
+    int64_t interval = config.max_orders_per_second > 0 ? 1000000000LL / config.max_orders_per_second : 0;
+    rate_tolerance_ns.store(interval * std::max<uint32_t>(config.order_burst, 1), std::memory_order_relaxed);
+    rate_interval_ns.store(interval, std::memory_order_release);
+}
+
+bool DeribitRiskGate::setLimits(InstrumentId instrument, const RiskLimits& limits) {
+    InstrumentRisk* risk = slot(instrument);
+    if (risk == nullptr) {
+        return false;
+    }
+    risk->max_order_amount.store(limits.max_order_amount, std::memory_order_relaxed);
+    risk->max_position.store(limits.max_position, std::memory_order_relaxed);
+    risk->max_price_deviation.store(limits.max_price_deviation, std::memory_order_relaxed);
+    risk->max_open_orders.store(limits.max_open_orders, std::memory_order_relaxed);
+    return true;
+}
+
+RiskCheck DeribitRiskGate::reject(RiskCheck check) const {
+    rejected.fetch_add(1, std::memory_order_relaxed);
+    return check;
+}
+
+// Kill switch, order amount and price band: the checks that reserve nothing
+RiskCheck DeribitRiskGate::checkLimits(InstrumentId instrument, double amount, double price) const {
+    if (killed.load(std::memory_order_acquire)) {
+        return reject(RiskCheck::KillSwitch);
+    }
+    const InstrumentRisk* risk = slot(instrument);
+    const InstrumentRisk& limits = risk != nullptr ? *risk : defaults;
+
+    double max_amount = limits.max_order_amount.load(std::memory_order_relaxed);
+    if (max_amount > 0.0 && amount > max_amount) {
+        return reject(RiskCheck::OrderAmount);
+    }
+    double deviation = limits.max_price_deviation.load(std::memory_order_relaxed);
+    double mark = risk != nullptr ? risk->mark_price.load(std::memory_order_relaxed) : 0.0;
+    if (deviation > 0.0 && mark > 0.0 && !std::isnan(price) && std::fabs(price - mark) > deviation * mark) {
+        return reject(RiskCheck::PriceBand);
+    }
+    return RiskCheck::Passed;
+}
+
+RiskCheck DeribitRiskGate::check(InstrumentId instrument, OrderSide side, double amount, double price,
+                                 RiskTicket& ticket) {
+    RiskCheck verdict = checkLimits(instrument, amount, price);
+    if (verdict != RiskCheck::Passed) {
+        return verdict;
+    }
+
+    // Reserve first and back out on failure, so racing senders see each other
+    uint32_t max_total = max_open_orders.load(std::memory_order_relaxed);
+    if (open_orders.fetch_add(1, std::memory_order_relaxed) >= max_total && max_total > 0) {
+        open_orders.fetch_sub(1, std::memory_order_relaxed);
+        return reject(RiskCheck::OpenOrders);
+    }
+    InstrumentRisk* risk = slot(instrument);
+    if (risk != nullptr) {
+        uint32_t max_instrument = risk->max_open_orders.load(std::memory_order_relaxed);
+        if (risk->open_orders.fetch_add(1, std::memory_order_relaxed) >= max_instrument && max_instrument > 0) {
+            risk->open_orders.fetch_sub(1, std::memory_order_relaxed);
+            open_orders.fetch_sub(1, std::memory_order_relaxed);
+            return reject(RiskCheck::InstrumentOpenOrders);
+        }
+        if (!reserveAmount(*risk, side, amount)) {
+            risk->open_orders.fetch_sub(1, std::memory_order_relaxed);
+            open_orders.fetch_sub(1, std::memory_order_relaxed);
+            return reject(RiskCheck::Position);
+        }
+    }
+
+    ticket.instrument = instrument;
+    ticket.side = side;
+    ticket.amount = risk != nullptr ? amount : 0.0;
+
+    // Last, so a rejected order does not use up the rate
+    if (!takeRateToken()) {
+        release(ticket);
+        return reject(RiskCheck::OrderRate);
+    }
+    return RiskCheck::Passed;
+}
+
+// The order is already counted, so an edit takes no open order slot or rate
+// token; an increase is reserved against max_position like a new order, and
+// the reservation is released with the reply, which carries the new amount.
+// A decrease is left to the reply too, so exposure is never undercounted.
+RiskCheck DeribitRiskGate::checkEdit(std::string_view order_id, InstrumentId instrument, double amount,
+                                     double price, RiskTicket& ticket) {
+    OrderSide side = OrderSide::Buy;
+    double added = 0.0;
+    {
+        std::lock_guard<std::mutex> lock(orders_mutex);
+        uint32_t index = order_ids.find(order_id);
+        if (index != DeribitKeyIndex::NO_KEY && !orders[index].closed) {
+            instrument = orders[index].instrument;
+            side = orders[index].side;
+            added = std::max(0.0, amount - orders[index].amount);
+        }
+    }
+
+    RiskCheck verdict = checkLimits(instrument, amount, price);
+    if (verdict != RiskCheck::Passed) {
+        return verdict;
+    }
+    InstrumentRisk* risk = slot(instrument);
+    if (risk != nullptr && added > 0.0 && !reserveAmount(*risk, side, added)) {
+        return reject(RiskCheck::Position);
+    }
+
+    ticket.instrument = instrument;
+    ticket.side = side;
+    ticket.amount = risk != nullptr ? added : 0.0;
+    ticket.edit = true;
+    return RiskCheck::Passed;
+}
+
+// A buy may take position + open buys up to max_position, a sell may take
+// open sells - position down to -max_position
+bool DeribitRiskGate::reserveAmount(InstrumentRisk& risk, OrderSide side, double amount) {
+    double max_position = risk.max_position.load(std::memory_order_relaxed);
+    std::atomic<double>& open = side == OrderSide::Buy ? risk.open_buy : risk.open_sell;
+    double current = open.load(std::memory_order_relaxed);
+    do {
+        double position = risk.position.load(std::memory_order_relaxed);
+        double reach = side == OrderSide::Buy ? position + current + amount : current + amount - position;
+        if (max_position > 0.0 && reach > max_position) {
+            return false;
+        }
+    } while (!open.compare_exchange_weak(current, current + amount, std::memory_order_relaxed));
+    return true;
+}
+
+bool DeribitRiskGate::takeRateToken() {
+    int64_t interval = rate_interval_ns.load(std::memory_order_acquire);
+    if (interval == 0) {
+        return true;
+    }
+    int64_t tolerance = rate_tolerance_ns.load(std::memory_order_relaxed);
+    int64_t now = nowNs();
+    int64_t tat = rate_tat_ns.load(std::memory_order_relaxed);
+    int64_t next;
+    do {
+        next = std::max(tat, now) + interval;
+        if (next - now > tolerance) {
+            return false;
+        }
+    } while (!rate_tat_ns.compare_exchange_weak(tat, next, std::memory_order_relaxed));
+    return true;
+}
+
+void DeribitRiskGate::release(const RiskTicket& ticket) {
+    addOpenAmount(ticket.instrument, ticket.side, -ticket.amount);
+    if (!ticket.edit) {
+        addOpenOrder(ticket.instrument, -1);
+    }
+}
+
+void DeribitRiskGate::addOpenAmount(InstrumentId instrument, OrderSide side, double delta) {
+    InstrumentRisk* risk = slot(instrument);
+    if (risk != nullptr && delta != 0.0) {
+        addTo(side == OrderSide::Buy ? risk->open_buy : risk->open_sell, delta);
+    }
+}
+
+void DeribitRiskGate::addOpenOrder(InstrumentId instrument, int delta) {
+    open_orders.fetch_add(static_cast<uint32_t>(delta), std::memory_order_relaxed);
+    InstrumentRisk* risk = slot(instrument);
+    if (risk != nullptr) {
+        risk->open_orders.fetch_add(static_cast<uint32_t>(delta), std::memory_order_relaxed);
+    }
+}
+
+void DeribitRiskGate::onResponse(const RiskTicket& ticket, const json& response) {
+    auto result = response.find("result");
+    if (result == response.end() || !result->is_object()) {
+        release(ticket);
+        return;
+    }
+    auto order_it = result->find("order");
+    const json& order = order_it != result->end() ? *order_it : *result;
+    std::string_view order_id = textOr(order, "order_id");
+    if (order_id.empty()) {
+        release(ticket);
+        return;
+    }
+    // An edited order is already tracked: apply its new state, then drop the increase held for it
+    apply(order_id, textOr(order, "instrument_name"),
+          textOr(order, "direction") == "sell" ? OrderSide::Sell : OrderSide::Buy,
+          DeribitMessageDecoder::parseOrderState(textOr(order, "order_state")),
+          numberOr(order, "amount", 0.0), numberOr(order, "filled_amount", 0.0),
+          static_cast<int64_t>(numberOr(order, "last_update_timestamp", 0.0)), ticket.edit ? nullptr : &ticket);
+    if (ticket.edit) {
+        release(ticket);
+    }
+}
+
+void DeribitRiskGate::onOrder(const OrderEvent& order) {
+    apply(order.order_id, order.instrument_name, order.direction,
+          DeribitMessageDecoder::parseOrderState(order.order_state), order.amount, order.filled_amount,
+          order.last_update_timestamp, nullptr);
+}
+
+// The response to our request and the notifications for an order may arrive
+// in any order; whichever comes first counts the order, a ticket arriving
+// after that is released, and only the newest state moves the open amount.
+void DeribitRiskGate::apply(std::string_view order_id, std::string_view instrument_name, OrderSide side,
+                            OrderState state, double amount, double filled_amount, int64_t timestamp,
+                            const RiskTicket* ticket) {
+    std::lock_guard<std::mutex> lock(orders_mutex);
+    uint32_t index = order_ids.intern(order_id);
+    if (index == orders.size()) {
+        orders.emplace_back();
+        orders.back().instrument = ticket != nullptr ? ticket->instrument : registry.find(instrument_name);
+        orders.back().side = ticket != nullptr ? ticket->side : side;
+    }
+    TrackedOrder& tracked = orders[index];
+
+    if (ticket != nullptr) {
+        if (tracked.counted || tracked.closed) {
+            release(*ticket);
+        } else {
+            tracked.reserved = ticket->amount;
+            tracked.counted = true;
+        }
+    }
+    if (tracked.closed || state == OrderState::Unknown || timestamp < tracked.last_update_timestamp) {
+        return;
+    }
+    tracked.last_update_timestamp = timestamp;
+    tracked.amount = amount;
+
+    bool open = isOpen(state);
+    double remaining = open ? std::max(0.0, amount - filled_amount) : 0.0;
+    addOpenAmount(tracked.instrument, tracked.side, remaining - tracked.reserved);
+    tracked.reserved = remaining;
+    if (open != tracked.counted) {
+        addOpenOrder(tracked.instrument, open ? 1 : -1);
+        tracked.counted = open;
+    }
+    if (!open) {
+        tracked.closed = true;
+        if (++closed_count >= FORGET_CLOSED_AFTER && closed_count * 2 > orders.size()) {
+            forgetClosed();
+        }
+    }
+}
+
+void DeribitRiskGate::forgetClosed() {
+    std::vector<std::string> kept_ids;
+    std::vector<TrackedOrder> kept;
+    for (uint32_t index = 0; index < orders.size(); ++index) {
+        if (!orders[index].closed) {
+            kept_ids.push_back(order_ids.key(index));
+            kept.push_back(orders[index]);
+        }
+    }
+    order_ids.clear();
+    for (const auto& order_id : kept_ids) {
+        order_ids.intern(order_id);
+    }
+    orders.swap(kept);
+    closed_count = 0;
+}
+
+void DeribitRiskGate::onFill(const TradeEvent& trade) {
+    InstrumentRisk* risk = slot(registry.find(trade.instrument_name));
+    if (risk != nullptr) {
+        addTo(risk->position, trade.direction == OrderSide::Buy ? trade.amount : -trade.amount);
+    }
+}
+
+void DeribitRiskGate::onMark(std::string_view instrument_name, double mark_price) {
+    if (std::isnan(mark_price) || mark_price <= 0.0) {
+        return;
+    }
+    InstrumentRisk* risk = slot(registry.find(instrument_name));
+    if (risk != nullptr) {
+        risk->mark_price.store(mark_price, std::memory_order_relaxed);
+    }
+}
+
+bool DeribitRiskGate::reconcile(const json& response) {
+    auto result = response.find("result");
+    if (result == response.end() || !result->is_array()) {
+        return false;
+    }
+    // get_positions lists every position, so anything it leaves out is flat
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i].position.store(0.0, std::memory_order_relaxed);
+    }
+    for (const auto& entry : *result) {
+        InstrumentRisk* risk = slot(registry.find(textOr(entry, "instrument_name")));
+        if (risk != nullptr) {
+            risk->position.store(numberOr(entry, "size", 0.0), std::memory_order_relaxed);
+        }
+    }
+    return true;
+}
+
+double DeribitRiskGate::position(InstrumentId instrument) const {
+    const InstrumentRisk* risk = slot(instrument);
+    return risk != nullptr ? risk->position.load(std::memory_order_relaxed) : 0.0;
+}
+
+double DeribitRiskGate::openAmount(InstrumentId instrument, OrderSide side) const {
+    const InstrumentRisk* risk = slot(instrument);
+    if (risk == nullptr) {
+        return 0.0;
+    }
+    return (side == OrderSide::Buy ? risk->open_buy : risk->open_sell).load(std::memory_order_relaxed);
+}
+
+const char* DeribitRiskGate::describe(RiskCheck check) {
+    switch (check) {
+        case RiskCheck::Passed: return "passed";
+        case RiskCheck::KillSwitch: return "kill switch engaged";
+        case RiskCheck::OrderAmount: return "order amount above the limit";
+        case RiskCheck::PriceBand: return "price too far from the mark";
+        case RiskCheck::Position: return "position limit would be exceeded";
+        case RiskCheck::OpenOrders: return "too many open orders";
+        case RiskCheck::InstrumentOpenOrders: return "too many open orders on the instrument";
+        case RiskCheck::OrderRate: return "order rate limit";
+    }
+    return "unknown";
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+#include "DeribitInstrumentRegistry.hpp"
+#include "DeribitKeyIndex.hpp"
+#include "DeribitMessageDecoder.hpp"
+#include "DeribitOrderEncoder.hpp"
+
+using json = nlohmann::json;
+
+// Limits of one instrument, in its own amount units (USD for inverse futures,
+// the base currency otherwise); 0 leaves a limit off
+struct RiskLimits {
+    double max_order_amount = 0.0;      // Largest single order (fat finger)
+    double max_position = 0.0;          // Largest |position| the open orders of one side could reach
+    double max_price_deviation = 0.0;   // Largest distance of a limit price from the mark, as a fraction
+    uint32_t max_open_orders = 0;
+};
+
+// Account-wide limits
+struct RiskConfig {
+    RiskLimits defaults;                // Every instrument starts with these
+    uint32_t max_open_orders = 0;       // Across all instruments; 0 for no limit
+    uint32_t max_orders_per_second = 0; // 0 for no limit
+    uint32_t order_burst = 10;          // Orders that may go back to back within the rate
+};
+
+enum class RiskCheck : uint8_t {
+    Passed,
+    KillSwitch,
+    OrderAmount,
+    PriceBand,
+    Position,
+    OpenOrders,
+    InstrumentOpenOrders,
+    OrderRate
+};
+
+// What a passed check reserved; handed back through onResponse() or release()
+struct RiskTicket {
+    InstrumentId instrument = INVALID_INSTRUMENT;
+    OrderSide side = OrderSide::Buy;
+    double amount = 0.0;
+    bool edit = false;                  // Reserves only the amount an edit adds, not an order slot
+};
+
+/**
+ * @class DeribitRiskGate
+ * @brief Pre-trade limit checks on the order send path
+ *
+ * Limits and exposure live in one cache-line slot per instrument, indexed by
+ * the DeribitInstrumentRegistry id, so a check is a handful of atomic loads
+ * and compare-and-swaps with no lock and no allocation. A passed check
+ * reserves its amount and an open order slot up front, so concurrent senders
+ * cannot overshoot a limit together; the reservation becomes the order's open
+ * amount when the exchange answers, or is released if it rejects the order.
+ * Order notifications and fills then keep open amounts, open order counts and
+ * positions current, and reconcile() realigns positions with the exchange.
+ * Orders placed elsewhere count as soon as a notification reports them.
+ *
+ * Instruments the registry does not know (or beyond the slot capacity) are
+ * checked against the default order amount and the account-wide limits only.
+ * The order rate is a generic cell rate limiter: one atomic theoretical
+ * arrival time allows order_burst orders back to back and then one every
+ * 1 / max_orders_per_second.
+ *
+ * The kill switch fails every check until it is released; DeribitAuth pairs
+ * it with a mass cancel.
+ */
+class DeribitRiskGate {
+public:
+    static const size_t DEFAULT_CAPACITY = 8192;
+
+    explicit DeribitRiskGate(const DeribitInstrumentRegistry& registry, size_t capacity = DEFAULT_CAPACITY);
+
+    // Replaces every limit, resetting per-instrument limits to config.defaults; exposure is kept
+    void configure(const RiskConfig& config);
+    bool setLimits(InstrumentId instrument, const RiskLimits& limits);    // false beyond capacity
+
+    // Order path (any thread)
+    RiskCheck check(InstrumentId instrument, OrderSide side, double amount, double price, RiskTicket& ticket);
+    // An edit reserves what it adds to the order's amount; instrument is used when the order is not tracked
+    RiskCheck checkEdit(std::string_view order_id, InstrumentId instrument, double amount, double price,
+                        RiskTicket& ticket);
+    void release(const RiskTicket& ticket);     // The request was never sent
+
+    void engageKillSwitch() { killed.store(true, std::memory_order_release); }
+    void releaseKillSwitch() { killed.store(false, std::memory_order_release); }
+    bool killSwitchEngaged() const { return killed.load(std::memory_order_acquire); }
+
+    // Update side (io threads)
+    void onResponse(const RiskTicket& ticket, const json& response);   // Reply to a checked order
+    void onOrder(const OrderEvent& order);
+    void onFill(const TradeEvent& trade);
+    void onMark(std::string_view instrument_name, double mark_price);
+    bool reconcile(const json& response);       // private/get_positions response
+
+    // Query side (any thread)
+    double position(InstrumentId instrument) const;
+    double openAmount(InstrumentId instrument, OrderSide side) const;
+    uint32_t openOrders() const { return open_orders.load(std::memory_order_relaxed); }
+    uint64_t rejections() const { return rejected.load(std::memory_order_relaxed); }
+    static const char* describe(RiskCheck check);
+
+private:
+    // One instrument's limits and exposure
+    struct alignas(64) InstrumentRisk {
+        std::atomic<double> max_order_amount{0.0};
+        std::atomic<double> max_position{0.0};
+        std::atomic<double> max_price_deviation{0.0};
+        std::atomic<uint32_t> max_open_orders{0};
+        std::atomic<uint32_t> open_orders{0};
+        std::atomic<double> open_buy{0.0};
+        std::atomic<double> open_sell{0.0};
+        std::atomic<double> position{0.0};
+        std::atomic<double> mark_price{0.0};
+    };
+
+    // Exposure of an order known to the exchange
+    struct TrackedOrder {
+        InstrumentId instrument = INVALID_INSTRUMENT;
+        OrderSide side = OrderSide::Buy;
+        double reserved = 0.0;          // Open amount counted in the instrument's exposure
+        double amount = 0.0;            // Order amount in the newest state
+        int64_t last_update_timestamp = -1;
+        bool counted = false;           // Counted in the open order totals
+        bool closed = false;
+    };
+
+    InstrumentRisk* slot(InstrumentId instrument) const {
+        return instrument < capacity ? &slots[instrument] : nullptr;
+    }
+    RiskCheck reject(RiskCheck check) const;
+    RiskCheck checkLimits(InstrumentId instrument, double amount, double price) const;
+    bool takeRateToken();
+    bool reserveAmount(InstrumentRisk& risk, OrderSide side, double amount);
+    void addOpenAmount(InstrumentId instrument, OrderSide side, double delta);
+    void addOpenOrder(InstrumentId instrument, int delta);
+    void apply(std::string_view order_id, std::string_view instrument_name, OrderSide side, OrderState state,
+               double amount, double filled_amount, int64_t timestamp, const RiskTicket* ticket);
+    void forgetClosed();
+
+    const DeribitInstrumentRegistry& registry;
+    size_t capacity;
+    std::unique_ptr<InstrumentRisk[]> slots;
+    InstrumentRisk defaults;                    // Limits for instruments without a slot
+
+    std::atomic<bool> killed;
+    std::atomic<uint32_t> max_open_orders;
+    std::atomic<uint32_t> open_orders;
+    std::atomic<int64_t> rate_interval_ns;      // 0 when the rate is unlimited
+    std::atomic<int64_t> rate_tolerance_ns;
+    std::atomic<int64_t> rate_tat_ns;           // Theoretical arrival time of the next order
+    mutable std::atomic<uint64_t> rejected;
+
+    // Orders by id; updated on the io threads
+    DeribitKeyIndex order_ids;
+    std::vector<TrackedOrder> orders;
+    size_t closed_count;
+    std::mutex orders_mutex;
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+/**
+ * @class DeribitSpscRing
+ * @brief Bounded single-producer/single-consumer ring buffer
+ *
+ * Exactly one thread may write and one (other) thread may read. Indices are
+ * free-running counters; each side caches the other's index and only reloads
+ * it (an acquire load of a line owned by the other core) when the cached
+ * value says the ring looks full or empty. Producer and consumer indices sit
+ * on separate cache lines so the two threads do not false-share.
+ *
+ * Besides tryPush()/tryPop(), slots can be written and read in place in
+ * batches: writeSlot(i) for i < writeAvailable() followed by commitWrite(n),
+ * and readSlot(i) for i < readAvailable() followed by commitRead(n). A batch
+ * becomes visible to the other side atomically.
+ */
+template <typename T>
+class DeribitSpscRing {
+public:
+    // capacity is rounded up to a power of two
+    explicit DeribitSpscRing(size_t capacity)
+        : write_index(0), cached_read_index(0), read_index(0), cached_write_index(0) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots.reset(new T[size]);
+        mask = size - 1;
+    }
+
+    DeribitSpscRing(const DeribitSpscRing&) = delete;
+    DeribitSpscRing& operator=(const DeribitSpscRing&) = delete;
+
+    size_t capacity() const { return mask + 1; }
+
+    // Producer side
+    size_t writeAvailable() {
+        size_t free_slots = capacity() - (write_index.load(std::memory_order_relaxed) - cached_read_index);
+        if (free_slots == 0) {
+            cached_read_index = read_index.load(std::memory_order_acquire);
+            free_slots = capacity() - (write_index.load(std::memory_order_relaxed) - cached_read_index);
+        }
+        return free_slots;
+    }
+
+    // Refreshes the consumer index before answering; use when a batch needs n slots
+    bool canWrite(size_t n) {
+        if (capacity() - (write_index.load(std::memory_order_relaxed) - cached_read_index) >= n) {
+            return true;
+        }
+        cached_read_index = read_index.load(std::memory_order_acquire);
+        return capacity() - (write_index.load(std::memory_order_relaxed) - cached_read_index) >= n;
+    }
+
+    T& writeSlot(size_t i) { return slots[(write_index.load(std::memory_order_relaxed) + i) & mask]; }
+
+    void commitWrite(size_t n) {
+        write_index.store(write_index.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    bool tryPush(const T& value) {
+        if (writeAvailable() == 0) {
+            return false;
+        }
+        writeSlot(0) = value;
+        commitWrite(1);
+        return true;
+    }
+
+    // Consumer side
+    size_t readAvailable() {
+        size_t used = cached_write_index - read_index.load(std::memory_order_relaxed);
+        if (used == 0) {
+            cached_write_index = write_index.load(std::memory_order_acquire);
+            used = cached_write_index - read_index.load(std::memory_order_relaxed);
+        }
+        return used;
+    }
+
+    const T& readSlot(size_t i) const { return slots[(read_index.load(std::memory_order_relaxed) + i) & mask]; }
+    T& readSlot(size_t i) { return slots[(read_index.load(std::memory_order_relaxed) + i) & mask]; }
+
+    void commitRead(size_t n) {
+        read_index.store(read_index.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    bool tryPop(T& out) {
+        if (readAvailable() == 0) {
+            return false;
+        }
+        out = std::move(readSlot(0));
+        commitRead(1);
+        return true;
+    }
+
+    // Safe from any thread; only a snapshot
+    bool empty() const {
+        return read_index.load(std::memory_order_acquire) == write_index.load(std::memory_order_acquire);
+    }
+
+    size_t size() const {
+        return write_index.load(std::memory_order_acquire) - read_index.load(std::memory_order_acquire);
+    }
+
+private:
+    static const size_t CACHE_LINE = 64;
+
+    std::unique_ptr<T[]> slots;
+    size_t mask;
+
+    alignas(CACHE_LINE) std::atomic<size_t> write_index;     // Written by the producer
+    size_t cached_read_index;                                // Producer's copy of read_index
+
+    alignas(CACHE_LINE) std::atomic<size_t> read_index;      // Written by the consumer
+    size_t cached_write_index;                               // Consumer's copy of write_index
+
+    char padding[CACHE_LINE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+};
@@ -1,423 +1,886 @@
 #include "DeribitSubscription.hpp"
-#include <iostream>
+#include "DeribitLogger.hpp"
+#include <cmath>
+#include <limits>
+#include <memory>
 
 DeribitSubscription::DeribitSubscription(
     websocketpp::client<websocketpp::config::asio_tls_client>& ws_client,
     websocketpp::connection_hdl& conn_hdl,
-    bool& auth_status)
-    : ws_client(ws_client), connection_hdl(conn_hdl), authenticated(auth_status) {
+    const std::atomic<bool>& auth_status,
+    DeribitRequestTable& requests,
+    DeribitLatencyStats& latency_stats)
+    : ws_client(ws_client), connection_hdl(conn_hdl), authenticated(auth_status), requests(requests),
+      latency_stats(latency_stats) {
+    order_books.setSnapshotRequester(
+        [this](const std::string& instrument_name) { return requestBookSnapshot(instrument_name); });
 }
 
-bool DeribitSubscription::subscribePublic(const std::vector<std::string>& channels) {
-    json j;
-    j["jsonrpc"] = "2.0";
-    j["method"] = "public/subscribe";
-    j["id"] = 42;
-    j["params"] = {
-        {"channels", channels}
-    };
+namespace {
 
-    std::cout << "Subscribing to channels: ";
+// Channels that need an authenticated session (private/subscribe)
+bool isPrivateChannel(std::string_view channel) {
+    return channel.compare(0, 5, "user.") == 0 || channel.compare(0, 10, "block_rfq.") == 0;
+}
+
+}  // namespace
+
+bool DeribitSubscription::subscribePublic(const std::vector<std::string>& channels) {
+    std::string names;
     for (const auto& channel : channels) {
-        std::cout << channel << " ";
+        names += channel;
+        names += ' ';
     }
-    std::cout << std::endl;
+    LOG_INFO("Subscribing to channels: ", names);
 
-    return sendSubscriptionMessage(j);
+    return sendSubscriptionMessage("public/subscribe", {{"channels", channels}},
+        [this](const json& response, int64_t) { handleSubscriptionResponse(response); });
 }
 
 bool DeribitSubscription::subscribePrivate(const std::vector<std::string>& channels) {
     if (!authenticated) {
-        std::cerr << "Not authenticated. Please authenticate first." << std::endl;
+        LOG_ERROR("Not authenticated. Please authenticate first.");
         return false;
     }
 
-    json j;
-    j["jsonrpc"] = "2.0";
-    j["method"] = "private/subscribe";
-    j["id"] = 42;
-    j["params"] = {
-        {"channels", channels}
-    };
-
-    return sendSubscriptionMessage(j);
+    return sendSubscriptionMessage("private/subscribe", {{"channels", channels}},
+        [this](const json& response, int64_t) { handleSubscriptionResponse(response); });
 }
 
+// Private channels can only be removed with private/unsubscribe
 bool DeribitSubscription::unsubscribe(const std::vector<std::string>& channels) {
-    json j;
-    j["jsonrpc"] = "2.0";
-    j["method"] = "public/unsubscribe";
-    j["id"] = 42; // Since we are using a single channel, we can use the same ID 
-    j["params"] = {
-        {"channels", channels}
-    };
+    std::vector<std::string> public_channels;
+    std::vector<std::string> private_channels;
+    for (const auto& channel : channels) {
+        (isPrivateChannel(channel) ? private_channels : public_channels).push_back(channel);
+    }
+    bool ok = true;
+    if (!public_channels.empty()) {
+        ok = sendSubscriptionMessage("public/unsubscribe", {{"channels", public_channels}},
+            [this](const json& response, int64_t) { handleUnsubscribeResponse(response); }) && ok;
+    }
+    if (!private_channels.empty()) {
+        ok = unsubscribePrivate(private_channels) && ok;
+    }
+    return ok;
+}
+
+bool DeribitSubscription::unsubscribePrivate(const std::vector<std::string>& channels) {
+    if (!authenticated) {
+        LOG_ERROR("Not authenticated. Please authenticate first.");
+        return false;
+    }
 
-    return sendSubscriptionMessage(j);
+    return sendSubscriptionMessage("private/unsubscribe", {{"channels", channels}},
+        [this](const json& response, int64_t) { handleUnsubscribeResponse(response); });
 }
 
-bool DeribitSubscription::sendSubscriptionMessage(const json& j) {
+bool DeribitSubscription::sendSubscriptionMessage(const char* method, const json& params,
+                                                  ResponseCallback callback) {
+    if (request_sender) {
+        return request_sender(method, params, std::move(callback));
+    }
+
+    uint64_t id = requests.nextId();
+
+    json j;
+    j["jsonrpc"] = "2.0";
+    j["id"] = id;
+    j["method"] = method;
+    j["params"] = params;
+
     std::string payload = j.dump();
-    std::cout << "Sending subscription request: " << payload << std::endl;
+    LOG_INFO("Sending subscription request: ", payload);
+
+    if (!requests.insert(id, method, std::move(callback),
+                         std::chrono::milliseconds(REQUEST_TIMEOUT_MS))) {
+        LOG_ERROR("Too many requests in flight; dropping ", method, " request.");
+        return false;
+    }
+
+    websocketpp::connection_hdl hdl;
+    if (connection_mutex != nullptr) {
+        std::lock_guard<std::mutex> lock(*connection_mutex);
+        hdl = connection_hdl;
+    } else {
+        hdl = connection_hdl;
+    }
 
     websocketpp::lib::error_code ec;
-    ws_client.send(connection_hdl, payload, websocketpp::frame::opcode::text, ec);
+    ws_client.send(hdl, payload, websocketpp::frame::opcode::text, ec);
 
     if (ec) {
-        std::cerr << "Error sending subscription request: " << ec.message() << std::endl;
+        LOG_ERROR("Error sending subscription request: ", ec.message());
+        PendingRequest unused;
+        requests.complete(id, unused);
         return false;
     }
 
     return true;
 }
 
-void DeribitSubscription::handleSubscriptionMessage(const json& message) {
+// Subscribe confirmations list the channels that are now active.
+bool DeribitSubscription::handleSubscriptionResponse(const json& response) {
+    if (!response.contains("result") || response["result"].is_null()) {
+        LOG_ERROR("Subscription failed or returned null result");
+        return false;
+    }
+
+    const json& result = response["result"];
+    LOG_INFO("Subscription confirmed for channels: ", result.dump());
+    if (result.is_array()) {
+        for (const auto& channel : result) {
+            channel_registry.setSubscribed(
+                internChannel(channel.get_ref<const std::string&>()), true);
+            if (!resume_channels.empty()) {
+                resume_channels.erase(channel.get_ref<const std::string&>());
+            }
+        }
+    }
+    return true;
+}
+
+void DeribitSubscription::onDisconnected() {
+    for (ChannelId id = 0; id < channel_registry.size(); ++id) {
+        if (channel_registry.isSubscribed(id)) {
+            resume_channels.insert(channel_registry.name(id));
+            channel_registry.setSubscribed(id, false);
+        }
+    }
+    order_books.invalidateAll();
+}
+
+size_t DeribitSubscription::resubscribe(bool private_channels, std::function<void()> done) {
+    std::vector<std::vector<std::string>> batches;
+    size_t count = 0;
+    for (const auto& channel : resume_channels) {
+        if (isPrivateChannel(channel) != private_channels) {
+            continue;
+        }
+        if (batches.empty() || batches.back().size() == RESUBSCRIBE_BATCH) {
+            batches.emplace_back();
+        }
+        batches.back().push_back(channel);
+        ++count;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    LOG_INFO("Resubscribing to ", count, (private_channels ? " private" : " public"), " channels in ",
+             batches.size(), " requests");
+
+    // Failed batches stay in resume_channels for the next attempt
+    auto outstanding = std::make_shared<size_t>(batches.size());
+    auto finish = [outstanding, done]() {
+        if (--*outstanding == 0 && done) {
+            done();
+        }
+    };
+    for (auto& batch : batches) {
+        bool sent = sendSubscriptionMessage(private_channels ? "private/subscribe" : "public/subscribe",
+                                            {{"channels", batch}},
+                                            [this, finish](const json& response, int64_t) {
+                                                handleSubscriptionResponse(response);
+                                                finish();
+                                            });
+        if (!sent) {
+            finish();
+        }
+    }
+    return count;
+}
+
+void DeribitSubscription::handleUnsubscribeResponse(const json& response) {
+    if (!response.contains("result") || !response["result"].is_array()) {
+        LOG_ERROR("Unsubscribe failed or returned no channels");
+        return;
+    }
+
+    LOG_INFO("Unsubscribed from channels: ", response["result"].dump());
+    for (const auto& channel : response["result"]) {
+        ChannelId id = channel_registry.find(channel.get_ref<const std::string&>());
+        if (id != INVALID_CHANNEL) {
+            channel_registry.setSubscribed(id, false);
+        }
+        // A dropped channel is not restored on reconnect
+        if (!resume_channels.empty()) {
+            resume_channels.erase(channel.get_ref<const std::string&>());
+        }
+    }
+}
+
+// Fetch a full-depth snapshot to resync a book after a change_id gap.
+bool DeribitSubscription::requestBookSnapshot(const std::string& instrument_name) {
+    json params = {
+        {"instrument_name", instrument_name},
+        {"depth", 10000}
+    };
+
+    return sendSubscriptionMessage("public/get_order_book", params,
+        [this, instrument_name](const json& response, int64_t) {
+            handleBookSnapshot(instrument_name, response);
+        });
+}
+
+void DeribitSubscription::handleBookSnapshot(const std::string& instrument_name, const json& response) {
+    if (!response.contains("result")) {
+        order_books.onSnapshotFailed(instrument_name);
+        return;
+    }
+
     try {
-        std::cout << "Raw message: " << message.dump(2) << std::endl;
-        // Check if this is a subscription confirmation
-        if (message.contains("result")) {
-            if (message["result"].is_null()) {
-                std::cerr << "Subscription failed or returned null result" << std::endl;
-                return;
+        const DeribitOrderBook* book = order_books.onSnapshotResponse(response["result"]);
+        if (book != nullptr) {
+            LOG_INFO("Order book resynced for ", book->instrumentName(), " at change ID ",
+                     book->lastChangeId());
+            received_ns = EventRecord::now();
+            publishBookTop(*book);
+            printTopOfBook(*book);
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("Error handling order book snapshot: ", e.what());
+    }
+}
+
+namespace {
+
+// Best level of one side, copied by value so it can be logged asynchronously
+struct TopLevel {
+    bool present;
+    double amount;
+    double price;
+};
+
+TopLevel topLevel(const PriceLevel* level) {
+    return level != nullptr ? TopLevel{ true, level->amount, level->price } : TopLevel{ false, 0.0, 0.0 };
+}
+
+std::ostream& operator<<(std::ostream& out, const TopLevel& level) {
+    if (!level.present) {
+        return out << "-";
+    }
+    return out << level.amount << " @ " << level.price;
+}
+
+}  // namespace
+
+void DeribitSubscription::printTopOfBook(const DeribitOrderBook& book) const {
+    LOG_INFO("Book ", book.instrumentName(),
+             " [", book.lastChangeId(), (book.isSynced() ? "" : ", resyncing"), "] ",
+             "Bid: ", topLevel(book.bestBid()), " | Ask: ", topLevel(book.bestAsk()),
+             " (depth ", book.bidDepth(), "/", book.askDepth(), ")");
+}
+
+ChannelId DeribitSubscription::internChannel(std::string_view name) {
+    ChannelId id = channel_registry.intern(name);
+    if (id >= channel_states.size()) {
+        channel_states.resize(id + 1);
+        ChannelState& state = channel_states[id];
+        state.exchange_latency = latency_stats.histogram(LatencyKind::ExchangeToReceive, name);
+        state.handler_latency = latency_stats.histogram(LatencyKind::ReceiveToHandled, name);
+    }
+    return id;
+}
+
+bool DeribitSubscription::queueHandler(const std::string& channel, bool accepted,
+                                       std::function<void(ChannelState&)> install) {
+    if (!accepted) {
+        LOG_ERROR("Cannot register handler: unexpected channel type for ", channel);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(handlers_mutex);
+        pending_handlers.push_back(PendingHandler{ channel, std::move(install) });
+    }
+    handlers_pending.store(true, std::memory_order_release);
+    return true;
+}
+
+// Runs on the notification thread, so interning never races with dispatch
+void DeribitSubscription::installPendingHandlers() {
+    if (!handlers_pending.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::vector<PendingHandler> installing;
+    {
+        std::lock_guard<std::mutex> lock(handlers_mutex);
+        installing.swap(pending_handlers);
+        handlers_pending.store(false, std::memory_order_relaxed);
+    }
+    for (auto& pending : installing) {
+        pending.install(channel_states[internChannel(pending.channel)]);
+    }
+}
+
+bool DeribitSubscription::onBook(const std::string& channel, BookHandler handler) {
+    return queueHandler(channel, DeribitChannelRegistry::classify(channel) == ChannelKind::Book,
+                        [handler](ChannelState& state) { state.book = handler; });
+}
+
+// Public trades and our own trades (user.trades.*) share the trade layout.
+bool DeribitSubscription::onTrades(const std::string& channel, TradeHandler handler) {
+    ChannelKind kind = DeribitChannelRegistry::classify(channel);
+    return queueHandler(channel, kind == ChannelKind::Trades || kind == ChannelKind::UserTrades,
+                        [handler](ChannelState& state) { state.trades = handler; });
+}
+
+bool DeribitSubscription::onTicker(const std::string& channel, TickerHandler handler) {
+    return queueHandler(channel, DeribitChannelRegistry::classify(channel) == ChannelKind::Ticker,
+                        [handler](ChannelState& state) { state.ticker = handler; });
+}
+
+bool DeribitSubscription::onOrders(const std::string& channel, OrderHandler handler) {
+    return queueHandler(channel, DeribitChannelRegistry::classify(channel) == ChannelKind::UserOrders,
+                        [handler](ChannelState& state) { state.orders = handler; });
+}
+
+bool DeribitSubscription::onData(const std::string& channel, DataHandler handler) {
+    switch (DeribitChannelRegistry::classify(channel)) {
+        case ChannelKind::Book:
+        case ChannelKind::Trades:
+        case ChannelKind::Ticker:
+        case ChannelKind::UserOrders:
+            LOG_ERROR("Cannot register data handler for ", channel,
+                      ": use the typed handler for this channel");
+            return false;
+        default:
+            return queueHandler(channel, true, [handler](ChannelState& state) { state.data = handler; });
+    }
+}
+
+void DeribitSubscription::handleSubscriptionPayload(std::string_view payload,
+                                                    const MessageEnvelope& envelope,
+                                                    std::chrono::steady_clock::time_point received_at,
+                                                    int64_t received_wall_us) {
+    int64_t received_us = received_wall_us != 0 ? received_wall_us :
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    received_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(received_at.time_since_epoch()).count();
+    try {
+        installPendingHandlers();
+        ChannelId id = internChannel(envelope.channel);
+        if (channel_registry.kind(id) == ChannelKind::UserTrades && event_bus != nullptr &&
+            event_bus->wants(EventType::Fill)) {
+            publishFills(envelope.data);
+        }
+        if (!dispatchTyped(id, envelope.data, received_us)) {
+            // Channels without a typed decoder (and data the decoders reject) use the DOM path
+            json message = json::parse(payload);
+            dispatchJson(id, message["params"]["data"], received_us);
+        }
+
+        LatencyHistogram* handler_latency = channel_states[id].handler_latency;
+        if (handler_latency != nullptr) {
+            handler_latency->record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - received_at).count());
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("Error handling subscription message: ", e.what());
+    }
+}
+
+// Exchange timestamps have millisecond resolution. Without a clock estimate the
+// figure includes any offset between our clock and the exchange's.
+void DeribitSubscription::recordExchangeLatency(const ChannelState& state, int64_t exchange_ms,
+                                                int64_t received_us) const {
+    if (state.exchange_latency == nullptr || exchange_ms <= 0) {
+        return;
+    }
+    int64_t exchange_us = exchange_ms * 1000;
+    int64_t one_way_us = exchange_clock != nullptr && exchange_clock->hasEstimate()
+                       ? exchange_clock->oneWayUs(exchange_us, received_us)
+                       : received_us - exchange_us;
+    state.exchange_latency->record(one_way_us * 1000);
+}
+
+// Returns false if the channel has no typed decoder or its data failed to decode.
+bool DeribitSubscription::dispatchTyped(ChannelId id, std::string_view data, int64_t received_us) {
+    const ChannelState& handlers = channel_states[id];
+
+    switch (channel_registry.kind(id)) {
+        case ChannelKind::Book: {
+            std::string_view instrument_name;
+            if (!DeribitMessageDecoder::decodeBook(data, instrument_name, book_update)) {
+                return false;
             }
-            
-            std::cout << "Subscription confirmed for channels: ";
-            if (message["result"].is_array()) {
-                for (const auto& channel : message["result"]) {
-                    std::cout << channel << " ";
-                    active_subscriptions.push_back(channel);
-                }
+            recordExchangeLatency(handlers, book_update.timestamp, received_us);
+            const DeribitOrderBook* book = order_books.applyUpdate(instrument_name, book_update);
+            publishBookTop(*book);
+            if (handlers.book) {
+                handlers.book(*book);
             } else {
-                std::cout << message["result"].dump();
+                printTopOfBook(*book);
             }
-            std::cout << std::endl;
-            return;
+            return true;
         }
-
-        // Handle subscription updates
-        if (message.contains("method") && message["method"] == "subscription") {
-            auto params = message["params"];
-            std::string channel = params["channel"].get<std::string>();
-            std::cout << "\nReceived update for channel: " << channel << std::endl;
-            
-            if (channel == "announcements") {
-                auto data = params["data"];
-                std::cout << "=== Announcement ===" << std::endl;
-                std::cout << "Title: " << data["title"].get<std::string>() << std::endl;
-                std::cout << "Body: " << data["body"].get<std::string>() << std::endl;
-                std::cout << "Important: " << (data["important"].get<bool>() ? "Yes" : "No") << std::endl;
-                std::cout << "Action: " << data["action"].get<std::string>() << std::endl;
-                std::cout << "Publication Time: " << data["publication_timestamp"].get<long>() << std::endl;
-                std::cout << "=================" << std::endl;
+        case ChannelKind::Trades:
+            if (!DeribitMessageDecoder::decodeTrades(data, trade_events)) {
+                return false;
             }
-            else if (channel.find("block_rfq.maker.") != std::string::npos) {
-                auto data = params["data"];
-                std::cout << "=== Block RFQ ===" << std::endl;
-                std::cout << "Block RFQ ID: " << data["block_rfq_id"] << std::endl;
-                std::cout << "State: " << data["state"] << std::endl;
-                std::cout << "Role: " << data["role"] << std::endl;
-                std::cout << "Amount: " << data["amount"] << std::endl;
-                std::cout << "Taker Rating: " << data["taker_rating"] << std::endl;
-                std::cout << "Creation Time: " << data["creation_timestamp"] << std::endl;
-                std::cout << "Expiration Time: " << data["expiration_timestamp"] << std::endl;
-                std::cout << "Combo ID: " << data["combo_id"] << std::endl;
-
-                if (data.contains("legs")) {
-                    std::cout << "\nLegs:" << std::endl;
-                    for (const auto& leg : data["legs"]) {
-                        std::cout << "  Instrument: " << leg["instrument_name"] << std::endl;
-                        std::cout << "  Direction: " << leg["direction"] << std::endl;
-                        std::cout << "  Ratio: " << leg["ratio"] << std::endl;
-                    }
-                }
-                std::cout << "=====================" << std::endl;
+            if (!trade_events.empty()) {
+                recordExchangeLatency(handlers, trade_events.back().timestamp, received_us);
             }
-            else if (channel.find("block_rfq.maker.quotes") != std::string::npos) {
-                auto data = params["data"];
-                for (const auto& quote : data) {
-                    std::cout << "=== Block RFQ Quote ===" << std::endl;
-                    std::cout << "Block RFQ Quote ID: " << quote["block_rfq_quote_id"] << std::endl;
-                    std::cout << "Block RFQ ID: " << quote["block_rfq_id"] << std::endl;
-                    std::cout << "Direction: " << quote["direction"] << std::endl;
-                    std::cout << "Amount: " << quote["amount"] << std::endl;
-                    std::cout << "Price: " << quote["price"] << std::endl;
-                    std::cout << "State: " << quote["quote_state"] << std::endl;
-                    
-                    if (quote.contains("legs")) {
-                        std::cout << "\nLegs:" << std::endl;
-                        for (const auto& leg : quote["legs"]) {
-                            std::cout << "  Instrument: " << leg["instrument_name"] << std::endl;
-                            std::cout << "  Direction: " << leg["direction"] << std::endl;
-                            std::cout << "  Amount: " << leg["ratio"] << std::endl;
-                            std::cout << "  Price: " << leg["price"] << std::endl;
-                        }
-                    }
-                    
-                    std::cout << "Creation Time: " << quote["creation_timestamp"] << std::endl;
-                    std::cout << "Last Update: " << quote["last_update_timestamp"] << std::endl;
-                    
-                    if (quote.contains("label")) {
-                        std::cout << "Label: " << quote["label"] << std::endl;
-                    }
-                    
-                    std::cout << "Filled Amount: " << quote["filled_amount"] << std::endl;
-                    std::cout << "Is Replaced: " << quote["replaced"].get<bool>() << std::endl;
-                    std::cout << "=====================" << std::endl;
-                }
+            if (!trade_events.empty()) {
+                publishMark(trade_events.back().instrument_name, trade_events.back().mark_price);
             }
-            else if (channel.find("user.trades.") != std::string::npos) {
-                auto data = params["data"];
-                for (const auto& trade : data) {
-                    std::cout << "\n=== User Trade ===" << std::endl;
-                    std::cout << "Trade ID: " << trade["trade_id"] << std::endl;
-                    std::cout << "Instrument: " << trade["instrument_name"] << std::endl;
-                    std::cout << "Direction: " << trade["direction"] << std::endl;
-                    std::cout << "Amount: " << trade["amount"] << std::endl;
-                    std::cout << "Price: " << trade["price"] << std::endl;
-                    std::cout << "Mark Price: " << trade["mark_price"] << std::endl;
-                    std::cout << "Index Price: " << trade["index_price"] << std::endl;
-                    std::cout << "State: " << trade["state"] << std::endl;
-                    std::cout << "Order Type: " << trade["order_type"] << std::endl;
-                    std::cout << "Fee: " << trade["fee"] << " " << trade["fee_currency"] << std::endl;
-                    std::cout << "Timestamp: " << trade["timestamp"] << std::endl;
-                    std::cout << "===================" << std::endl;
+            for (const auto& trade : trade_events) {
+                publishTrade(trade);
+                if (trade_aggregator != nullptr) {
+                    trade_aggregator->onTrade(trade);
                 }
-            }
-                        // Add handler for trades channel
-        else if (channel.find("trades.") != std::string::npos) {
-            auto data = params["data"];
-            for (const auto& trade : data) {
-                std::cout << "\n=== Trade ===" << std::endl;
-                std::cout << "Instrument: " << trade["instrument_name"] << std::endl;
-                std::cout << "Trade ID: " << trade["trade_id"] << std::endl;
-                std::cout << "Trade Sequence: " << trade["trade_seq"] << std::endl;
-                std::cout << "Direction: " << trade["direction"] << std::endl;
-                std::cout << "Amount: " << trade["amount"] << std::endl;
-                std::cout << "Price: " << trade["price"] << std::endl;
-                 std::cout << "Mark Price: " << trade["mark_price"] << std::endl;
-                std::cout << "Index Price: " << trade["index_price"] << std::endl;
-                std::cout << "Timestamp: " << trade["timestamp"] << std::endl;
-                
-                // Optional IV field for options
-                if (trade.contains("iv")) {
-                    std::cout << "Implied Volatility: " << trade["iv"] << "%" << std::endl;
+                if (option_book != nullptr) {
+                    option_book->onTrade(trade);
                 }
-                
-                std::cout << "Tick Direction: " << trade["tick_direction"] << std::endl;
-                std::cout << "==================" << std::endl;
-            }
-        }
-        else if (channel.find("block_rfq.taker.") != std::string::npos) {
-            auto data = params["data"];
-            std::cout << "\n=== Block RFQ Taker Update ===" << std::endl;
-            std::cout << "Block RFQ ID: " << data["block_rfq_id"] << std::endl;
-            std::cout << "State: " << data["state"] << std::endl;
-            std::cout << "Role: " << data["role"] << std::endl;
-            std::cout << "Amount: " << data["amount"] << std::endl;
-            std::cout << "Min Trade Amount: " << data["min_trade_amount"] << std::endl;
-            std::cout << "Taker Rating: " << data["taker_rating"] << std::endl;
-            std::cout << "Creation Time: " << data["creation_timestamp"] << std::endl;
-            std::cout << "Expiration Time: " << data["expiration_timestamp"] << std::endl;
-            
-            if (data.contains("makers") && !data["makers"].empty()) {
-                std::cout << "\nMakers:" << std::endl;
-                for (const auto& maker : data["makers"]) {
-                    std::cout << "  " << maker << std::endl;
+                if (handlers.trades) {
+                    handlers.trades(trade);
+                } else {
+                    printTrade(trade);
                 }
             }
-
-            if (data.contains("legs") && !data["legs"].empty()) {
-                std::cout << "\nLegs:" << std::endl;
-                for (const auto& leg : data["legs"]) {
-                    std::cout << "  Instrument: " << leg["instrument_name"] << std::endl;
-                    std::cout << "  Direction: " << leg["direction"] << std::endl;
-                    std::cout << "  Ratio: " << leg["ratio"] << std::endl;
-                }
+            return true;
+        case ChannelKind::UserTrades:
+            // Without a trades handler these are printed from the JSON path
+            if (!handlers.trades || !DeribitMessageDecoder::decodeTrades(data, trade_events)) {
+                return false;
             }
-
-            // Handle bids if present
-            if (data.contains("bids") && !data["bids"].empty()) {
-                std::cout << "\nBids:" << std::endl;
-                for (const auto& bid : data["bids"]) {
-                    std::cout << "  Price: " << bid["price"] << std::endl;
-                    std::cout << "  Amount: " << bid["amount"] << std::endl;
-                    std::cout << "  Execution: " << bid["execution_instruction"] << std::endl;
-                    std::cout << "  Last Update: " << bid["last_update_timestamp"] << std::endl;
-                    if (bid.contains("makers")) {
-                        std::cout << "  Makers: ";
-                        for (const auto& maker : bid["makers"]) {
-                            std::cout << maker << " ";
-                        }
-                        std::cout << std::endl;
-                    }
-                }
+            if (!trade_events.empty()) {
+                recordExchangeLatency(handlers, trade_events.back().timestamp, received_us);
             }
-
-            // Handle asks if present
-            if (data.contains("asks") && !data["asks"].empty()) {
-                std::cout << "\nAsks:" << std::endl;
-                for (const auto& ask : data["asks"]) {
-                    std::cout << "  Price: " << ask["price"] << std::endl;
-                    std::cout << "  Amount: " << ask["amount"] << std::endl;
-                    std::cout << "  Execution: " << ask["execution_instruction"] << std::endl;
-                    std::cout << "  Last Update: " << ask["last_update_timestamp"] << std::endl;
-                    if (ask.contains("makers")) {
-                        std::cout << "  Makers: ";
-                        for (const auto& maker : ask["makers"]) {
-                            std::cout << maker << " ";
-                        }
-                        std::cout << std::endl;
-                    }
-                }
+            for (const auto& trade : trade_events) {
+                handlers.trades(trade);
             }
-
-            if (data.contains("label")) {
-                std::cout << "\nLabel: " << data["label"] << std::endl;
+            return true;
+        case ChannelKind::Ticker: {
+            TickerEvent ticker;
+            if (!DeribitMessageDecoder::decodeTicker(data, ticker)) {
+                return false;
             }
-            
-            std::cout << "Disclosed: " << (data["disclosed"].get<bool>() ? "Yes" : "No") << std::endl;
-            
-            if (data.contains("combo_id") && !data["combo_id"].is_null()) {
-                std::cout << "Combo ID: " << data["combo_id"] << std::endl;
+            recordExchangeLatency(handlers, ticker.timestamp, received_us);
+            publishMark(ticker.instrument_name, ticker.mark_price);
+            publishTicker(ticker);
+            if (option_book != nullptr) {
+                option_book->onTicker(ticker);
             }
-            
-            std::cout << "=============================" << std::endl;
-        }
-
-        else if (channel.find("block_rfq.taker.") != std::string::npos) {
-            auto data = params["data"];
-            std::cout << "\n=== Block RFQ Taker Update ===" << std::endl;
-            std::cout << "Block RFQ ID: " << data["block_rfq_id"] << std::endl;
-            std::cout << "State: " << data["state"] << std::endl;
-            std::cout << "Role: " << data["role"] << std::endl;
-            std::cout << "Amount: " << data["amount"] << std::endl;
-            std::cout << "Min Trade Amount: " << data["min_trade_amount"] << std::endl;
-            std::cout << "Taker Rating: " << data["taker_rating"] << std::endl;
-            std::cout << "Creation Time: " << data["creation_timestamp"] << std::endl;
-            std::cout << "Expiration Time: " << data["expiration_timestamp"] << std::endl;
-            
-            // Handle makers array
-            if (data.contains("makers") && !data["makers"].empty()) {
-                std::cout << "\nMakers:" << std::endl;
-                for (const auto& maker : data["makers"]) {
-                    std::cout << "  " << maker << std::endl;
-                }
+            if (handlers.ticker) {
+                handlers.ticker(ticker);
+            } else {
+                printTicker(ticker);
             }
-        
-            // Handle legs array
-            if (data.contains("legs") && !data["legs"].empty()) {
-                std::cout << "\nLegs:" << std::endl;
-                for (const auto& leg : data["legs"]) {
-                    std::cout << "  Instrument: " << leg["instrument_name"] << std::endl;
-                    std::cout << "  Direction: " << leg["direction"] << std::endl;
-                    std::cout << "  Ratio: " << leg["ratio"] << std::endl;
-                }
+            return true;
+        }
+        case ChannelKind::UserOrders:
+            if (!DeribitMessageDecoder::decodeOrders(data, order_events)) {
+                return false;
             }
-        
-            // Handle bids array
-            if (data.contains("bids") && !data["bids"].empty()) {
-                std::cout << "\nBids:" << std::endl;
-                for (const auto& bid : data["bids"]) {
-                    std::cout << "  Price: " << bid["price"] << std::endl;
-                    std::cout << "  Amount: " << bid["amount"] << std::endl;
-                    std::cout << "  Execution: " << bid["execution_instruction"] << std::endl;
-                    std::cout << "  Last Update: " << bid["last_update_timestamp"] << std::endl;
-                    if (bid.contains("makers")) {
-                        std::cout << "  Makers: ";
-                        for (const auto& maker : bid["makers"]) {
-                            std::cout << maker << " ";
-                        }
-                        std::cout << std::endl;
-                    }
-                }
+            if (!order_events.empty()) {
+                recordExchangeLatency(handlers, order_events.back().last_update_timestamp, received_us);
             }
-        
-            // Handle asks array (if present)
-            if (data.contains("asks") && !data["asks"].empty()) {
-                std::cout << "\nAsks:" << std::endl;
-                for (const auto& ask : data["asks"]) {
-                    std::cout << "  Price: " << ask["price"] << std::endl;
-                    std::cout << "  Amount: " << ask["amount"] << std::endl;
-                    std::cout << "  Execution: " << ask["execution_instruction"] << std::endl;
-                    std::cout << "  Last Update: " << ask["last_update_timestamp"] << std::endl;
-                    if (ask.contains("makers")) {
-                        std::cout << "  Makers: ";
-                        for (const auto& maker : ask["makers"]) {
-                            std::cout << maker << " ";
-                        }
-                        std::cout << std::endl;
-                    }
+            for (const auto& order : order_events) {
+                if (handlers.orders) {
+                    handlers.orders(order);
+                } else {
+                    printOrder(order);
                 }
             }
-        
-            std::cout << "Disclosed: " << (data["disclosed"].get<bool>() ? "Yes" : "No") << std::endl;
-            
-            if (data.contains("label")) {
-                std::cout << "\nLabel: " << data["label"] << std::endl;
-            }
-            
-            if (data.contains("combo_id") && !data["combo_id"].is_null()) {
-                std::cout << "Combo ID: " << data["combo_id"] << std::endl;
-            }
-            
-            std::cout << "=============================" << std::endl;
-        }
+            return true;
+        default:
+            return false;
+    }
+}
 
-        else if (channel.find("book.") != std::string::npos) {
-            auto data = params["data"];
-            std::cout << "\n=== Order Book Update for " << data["instrument_name"] << " ===" << std::endl;
-            std::cout << "Type: " << data["type"] << std::endl;
-            std::cout << "Timestamp: " << data["timestamp"] << std::endl;
-            std::cout << "Change ID: " << data["change_id"] << std::endl;
-            
-            if (data.contains("prev_change_id")) {
-                std::cout << "Previous Change ID: " << data["prev_change_id"] << std::endl;
-            }
+void DeribitSubscription::dispatchJson(ChannelId id, const json& data, int64_t received_us) {
+    ChannelKind kind = channel_registry.kind(id);
+    const ChannelState& state = channel_states[id];
 
-            // Print bids
-            if (data.contains("bids") && !data["bids"].empty()) {
-                std::cout << "\nBids:" << std::endl;
-                for (const auto& bid : data["bids"]) {
-                    std::cout << "  Action: " << std::setw(6) << std::left << bid[0] 
-                            << " Price: " << std::setw(10) << bid[1] 
-                            << " Amount: " << bid[2] << std::endl;
-                }
+    if (data.is_object() && data.contains("timestamp") && data["timestamp"].is_number()) {
+        recordExchangeLatency(state, data["timestamp"].get<int64_t>(), received_us);
+    }
+
+    // Book data that the typed decoder rejected still has to reach the book manager
+    if (kind == ChannelKind::Book) {
+        const DeribitOrderBook* book = order_books.onBookMessage(data);
+        if (book != nullptr) {
+            publishBookTop(*book);
+            if (state.book) {
+                state.book(*book);
+            } else {
+                printTopOfBook(*book);
             }
+        }
+        return;
+    }
 
-            // Print asks
-            if (data.contains("asks") && !data["asks"].empty()) {
-                std::cout << "\nAsks:" << std::endl;
-                for (const auto& ask : data["asks"]) {
-                    std::cout << "  Action: " << std::setw(6) << std::left << ask[0] 
-                            << " Price: " << std::setw(10) << ask[1] 
-                            << " Amount: " << ask[2] << std::endl;
+    // Trades that reach the JSON path (handleSubscriptionMessage) still count towards the tape
+    if (kind == ChannelKind::Trades && (trade_aggregator != nullptr || option_book != nullptr) && data.is_array()) {
+        std::string text = data.dump();
+        if (DeribitMessageDecoder::decodeTrades(text, trade_events)) {
+            for (const auto& trade : trade_events) {
+                if (trade_aggregator != nullptr) {
+                    trade_aggregator->onTrade(trade);
+                }
+                if (option_book != nullptr) {
+                    option_book->onTrade(trade);
                 }
             }
-            
-            std::cout << "=============================" << std::endl;
-        } 
-
-        else if (channel.find("instrument.state.") != std::string::npos) {
-            auto data = params["data"];
-            std::cout << "\n=== Instrument State Update ===" << std::endl;
-            std::cout << "Instrument: " << data["instrument_name"] << std::endl;
-            std::cout << "State: " << data["state"] << std::endl;
-            std::cout << "Timestamp: " << data["timestamp"] << std::endl;
-            std::cout << "=============================" << std::endl;
         }
-        else if (channel.find("deribit_price_index.") != std::string::npos) {
-            auto data = params["data"];
-            std::cout << "\n=== Deribit Price Index Update ===" << std::endl;
-            std::cout << "Index Name: " << data["index_name"] << std::endl;
-            std::cout << "Price: " << std::fixed << std::setprecision(2) 
-                     << data["price"] << " USD" << std::endl;
-            std::cout << "Timestamp: " << data["timestamp"] << std::endl;
-            std::cout << "=============================" << std::endl;
+    }
+
+    if (kind == ChannelKind::PriceIndex && data.is_object() &&
+        data.contains("index_name") && data.contains("price") && data["price"].is_number()) {
+        std::string index_name = data["index_name"].get<std::string>();
+        double price = data["price"].get<double>();
+        if (position_book != nullptr) {
+            position_book->onIndex(index_name, price);
         }
+        if (option_book != nullptr) {
+            option_book->onIndex(index_name, price, data.value("timestamp", int64_t(0)));
+        }
+    }
+
+    if (block_rfq_book != nullptr) {
+        switch (kind) {
+            case ChannelKind::BlockRfqMaker: block_rfq_book->onMakerRfq(data, received_ns); break;
+            case ChannelKind::BlockRfqMakerQuotes: block_rfq_book->onMakerQuotes(data, received_ns); break;
+            case ChannelKind::BlockRfqTaker: block_rfq_book->onTakerRfq(data, received_ns); break;
+            default: break;
+        }
+    }
 
+    if (state.data) {
+        state.data(data);
+        return;
+    }
+
+    LOG_INFO("\nReceived update for channel: ", channel_registry.name(id));
+    switch (kind) {
+        case ChannelKind::Announcements: printAnnouncement(data); break;
+        case ChannelKind::BlockRfqMaker: printBlockRfqMaker(data); break;
+        case ChannelKind::BlockRfqMakerQuotes: printBlockRfqQuotes(data); break;
+        case ChannelKind::BlockRfqTaker: printBlockRfqTaker(data); break;
+        case ChannelKind::UserTrades: printUserTrades(data); break;
+        case ChannelKind::InstrumentState: printInstrumentState(data); break;
+        case ChannelKind::PriceIndex: printPriceIndex(data); break;
+        default:
+            LOG_INFO("Raw data: ", data.dump(2));
+            break;
+    }
+}
 
+void DeribitSubscription::publishBookTop(const DeribitOrderBook& book) {
+    if (event_bus == nullptr || !event_bus->wants(EventType::BookUpdate)) {
+        return;
+    }
+    EventRecord event;
+    event.type = EventType::BookUpdate;
+    event.source = event_source;
+    event.received_ns = received_ns;
+    event.instrument.assign(book.instrumentName());
+
+    const PriceLevel* bid = book.bestBid();
+    const PriceLevel* ask = book.bestAsk();
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    event.book.best_bid_price = bid != nullptr ? bid->price : nan;
+    event.book.best_bid_amount = bid != nullptr ? bid->amount : 0.0;
+    event.book.best_ask_price = ask != nullptr ? ask->price : nan;
+    event.book.best_ask_amount = ask != nullptr ? ask->amount : 0.0;
+    event.book.change_id = book.lastChangeId();
+    event.book.exchange_timestamp = book.lastTimestamp();
+    event.book.synced = book.isSynced();
+    event_bus->publish(event);
+}
 
+// Mark prices move floating PnL and the risk gate's price bands
+void DeribitSubscription::publishMark(std::string_view instrument_name, double mark_price) {
+    if (position_book != nullptr) {
+        position_book->onMark(instrument_name, mark_price);
+    }
+    if (risk_gate != nullptr) {
+        risk_gate->onMark(instrument_name, mark_price);
+    }
+}
+
+void DeribitSubscription::publishTrade(const TradeEvent& trade) {
+    if (event_bus == nullptr || !event_bus->wants(EventType::Trade)) {
+        return;
+    }
+    EventRecord event;
+    event.type = EventType::Trade;
+    event.source = event_source;
+    event.received_ns = received_ns;
+    event.instrument.assign(trade.instrument_name);
+    event.trade.price = trade.price;
+    event.trade.amount = trade.amount;
+    event.trade.trade_seq = trade.trade_seq;
+    event.trade.exchange_timestamp = trade.timestamp;
+    event.trade.direction = trade.direction;
+    event_bus->publish(event);
+}
+
+void DeribitSubscription::publishTicker(const TickerEvent& ticker) {
+    if (event_bus == nullptr || !event_bus->wants(EventType::Ticker)) {
+        return;
+    }
+    EventRecord event;
+    event.type = EventType::Ticker;
+    event.source = event_source;
+    event.received_ns = received_ns;
+    event.instrument.assign(ticker.instrument_name);
+    event.ticker.best_bid_price = ticker.best_bid_price;
+    event.ticker.best_bid_amount = ticker.best_bid_amount;
+    event.ticker.best_ask_price = ticker.best_ask_price;
+    event.ticker.best_ask_amount = ticker.best_ask_amount;
+    event.ticker.last_price = ticker.last_price;
+    event.ticker.mark_price = ticker.mark_price;
+    event.ticker.index_price = ticker.index_price;
+    event.ticker.mark_iv = ticker.mark_iv;
+    event.ticker.exchange_timestamp = ticker.timestamp;
+    event_bus->publish(event);
+}
+
+// Fills are decoded separately from any user.trades.* handler, which may be a JSON one.
+void DeribitSubscription::publishFills(std::string_view data) {
+    if (!DeribitMessageDecoder::decodeTrades(data, fill_events)) {
+        return;
+    }
+    for (const auto& trade : fill_events) {
+        EventRecord event;
+        event.type = EventType::Fill;
+        event.source = event_source;
+        event.received_ns = received_ns;
+        event.instrument.assign(trade.instrument_name);
+        event.fill.order_id.assign(trade.order_id);
+        event.fill.price = trade.price;
+        event.fill.amount = trade.amount;
+        event.fill.exchange_timestamp = trade.timestamp;
+        event.fill.direction = trade.direction;
+        event_bus->publish(event);
+    }
+}
+
+// Each block is logged as one record so it stays together in the output.
+void DeribitSubscription::printTrade(const TradeEvent& trade) const {
+    const char* direction = trade.direction == OrderSide::Buy ? "buy" : "sell";
+    if (std::isnan(trade.iv)) {
+        LOG_INFO("\n=== Trade ===",
+                 "\nInstrument: ", trade.instrument_name,
+                 "\nTrade ID: ", trade.trade_id,
+                 "\nTrade Sequence: ", trade.trade_seq,
+                 "\nDirection: ", direction,
+                 "\nAmount: ", trade.amount,
+                 "\nPrice: ", trade.price,
+                 "\nMark Price: ", trade.mark_price,
+                 "\nIndex Price: ", trade.index_price,
+                 "\nTimestamp: ", trade.timestamp,
+                 "\nTick Direction: ", trade.tick_direction,
+                 "\n==================");
+    } else {
+        // Options carry implied volatility
+        LOG_INFO("\n=== Trade ===",
+                 "\nInstrument: ", trade.instrument_name,
+                 "\nTrade ID: ", trade.trade_id,
+                 "\nTrade Sequence: ", trade.trade_seq,
+                 "\nDirection: ", direction,
+                 "\nAmount: ", trade.amount,
+                 "\nPrice: ", trade.price,
+                 "\nMark Price: ", trade.mark_price,
+                 "\nIndex Price: ", trade.index_price,
+                 "\nTimestamp: ", trade.timestamp,
+                 "\nImplied Volatility: ", trade.iv, "%",
+                 "\nTick Direction: ", trade.tick_direction,
+                 "\n==================");
+    }
+}
+
+void DeribitSubscription::printTicker(const TickerEvent& ticker) const {
+    LOG_INFO("Ticker ", ticker.instrument_name, " Bid: ", ticker.best_bid_amount, " @ ",
+             ticker.best_bid_price, " | Ask: ", ticker.best_ask_amount, " @ ",
+             ticker.best_ask_price, " | Mark: ", ticker.mark_price, " | Index: ",
+             ticker.index_price);
+}
+
+void DeribitSubscription::printOrder(const OrderEvent& order) const {
+    LOG_INFO("\n=== Order Update ===",
+             "\nOrder ID: ", order.order_id,
+             "\nInstrument: ", order.instrument_name,
+             "\nDirection: ", (order.direction == OrderSide::Buy ? "buy" : "sell"),
+             "\nType: ", order.order_type,
+             "\nAmount: ", order.amount,
+             "\nFilled Amount: ", order.filled_amount,
+             "\nPrice: ", order.price,
+             "\nState: ", order.order_state,
+             (order.label.empty() ? "" : "\nLabel: "), order.label,
+             "\n===================");
+}
+
+void DeribitSubscription::handleSubscriptionMessage(const json& message) {
+    try {
+        if (message.contains("method") && message["method"] == "subscription") {
+            const json& params = message["params"];
+            int64_t received_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            installPendingHandlers();
+            ChannelId id = internChannel(params["channel"].get_ref<const std::string&>());
+            dispatchJson(id, params["data"], received_us);
         }
     } catch (const std::exception& e) {
-        std::cerr << "Error handling subscription message: " << e.what() << std::endl;
+        LOG_ERROR("Error handling subscription message: ", e.what());
+    }
+}
+
+void DeribitSubscription::printAnnouncement(const json& data) const {
+    LOG_INFO("=== Announcement ===");
+    LOG_INFO("Title: ", data["title"].get<std::string>());
+    LOG_INFO("Body: ", data["body"].get<std::string>());
+    LOG_INFO("Important: ", (data["important"].get<bool>() ? "Yes" : "No"));
+    LOG_INFO("Action: ", data["action"].get<std::string>());
+    LOG_INFO("Publication Time: ", data["publication_timestamp"].get<long>());
+    LOG_INFO("=================");
+}
+
+void DeribitSubscription::printBlockRfqMaker(const json& data) const {
+    LOG_INFO("=== Block RFQ ===");
+    LOG_INFO("Block RFQ ID: ", data["block_rfq_id"]);
+    LOG_INFO("State: ", data["state"]);
+    LOG_INFO("Role: ", data["role"]);
+    LOG_INFO("Amount: ", data["amount"]);
+    LOG_INFO("Taker Rating: ", data["taker_rating"]);
+    LOG_INFO("Creation Time: ", data["creation_timestamp"]);
+    LOG_INFO("Expiration Time: ", data["expiration_timestamp"]);
+    LOG_INFO("Combo ID: ", data["combo_id"]);
+
+    if (data.contains("legs")) {
+        LOG_INFO("\nLegs:");
+        for (const auto& leg : data["legs"]) {
+            LOG_INFO("  Instrument: ", leg["instrument_name"]);
+            LOG_INFO("  Direction: ", leg["direction"]);
+            LOG_INFO("  Ratio: ", leg["ratio"]);
+        }
+    }
+    LOG_INFO("=====================");
+}
+
+void DeribitSubscription::printBlockRfqQuotes(const json& data) const {
+    for (const auto& quote : data) {
+        LOG_INFO("=== Block RFQ Quote ===");
+        LOG_INFO("Block RFQ Quote ID: ", quote["block_rfq_quote_id"]);
+        LOG_INFO("Block RFQ ID: ", quote["block_rfq_id"]);
+        LOG_INFO("Direction: ", quote["direction"]);
+        LOG_INFO("Amount: ", quote["amount"]);
+        LOG_INFO("Price: ", quote["price"]);
+        LOG_INFO("State: ", quote["quote_state"]);
+
+        if (quote.contains("legs")) {
+            LOG_INFO("\nLegs:");
+            for (const auto& leg : quote["legs"]) {
+                LOG_INFO("  Instrument: ", leg["instrument_name"]);
+                LOG_INFO("  Direction: ", leg["direction"]);
+                LOG_INFO("  Amount: ", leg["ratio"]);
+                LOG_INFO("  Price: ", leg["price"]);
+            }
+        }
+
+        LOG_INFO("Creation Time: ", quote["creation_timestamp"]);
+        LOG_INFO("Last Update: ", quote["last_update_timestamp"]);
+
+        if (quote.contains("label")) {
+            LOG_INFO("Label: ", quote["label"]);
+        }
+
+        LOG_INFO("Filled Amount: ", quote["filled_amount"]);
+        LOG_INFO("Is Replaced: ", quote["replaced"].get<bool>());
+        LOG_INFO("=====================");
+    }
+}
+
+void DeribitSubscription::printBlockRfqTaker(const json& data) const {
+    LOG_INFO("\n=== Block RFQ Taker Update ===");
+    LOG_INFO("Block RFQ ID: ", data["block_rfq_id"]);
+    LOG_INFO("State: ", data["state"]);
+    LOG_INFO("Role: ", data["role"]);
+    LOG_INFO("Amount: ", data["amount"]);
+    LOG_INFO("Min Trade Amount: ", data["min_trade_amount"]);
+    LOG_INFO("Taker Rating: ", data["taker_rating"]);
+    LOG_INFO("Creation Time: ", data["creation_timestamp"]);
+    LOG_INFO("Expiration Time: ", data["expiration_timestamp"]);
+
+    if (data.contains("makers") && !data["makers"].empty()) {
+        LOG_INFO("\nMakers:");
+        for (const auto& maker : data["makers"]) {
+            LOG_INFO("  ", maker);
+        }
+    }
+
+    if (data.contains("legs") && !data["legs"].empty()) {
+        LOG_INFO("\nLegs:");
+        for (const auto& leg : data["legs"]) {
+            LOG_INFO("  Instrument: ", leg["instrument_name"]);
+            LOG_INFO("  Direction: ", leg["direction"]);
+            LOG_INFO("  Ratio: ", leg["ratio"]);
+        }
+    }
+
+    // Bids and asks carry the same fields
+    const char* sides[] = { "bids", "asks" };
+    const char* titles[] = { "\nBids:", "\nAsks:" };
+    for (int s = 0; s < 2; ++s) {
+        if (!data.contains(sides[s]) || data[sides[s]].empty()) {
+            continue;
+        }
+        LOG_INFO(titles[s]);
+        for (const auto& quote : data[sides[s]]) {
+            LOG_INFO("  Price: ", quote["price"]);
+            LOG_INFO("  Amount: ", quote["amount"]);
+            LOG_INFO("  Execution: ", quote["execution_instruction"]);
+            LOG_INFO("  Last Update: ", quote["last_update_timestamp"]);
+            if (quote.contains("makers")) {
+                LOG_INFO("  Makers: ", quote["makers"].dump());
+            }
+        }
+    }
+
+    if (data.contains("label")) {
+        LOG_INFO("\nLabel: ", data["label"]);
+    }
+
+    LOG_INFO("Disclosed: ", (data["disclosed"].get<bool>() ? "Yes" : "No"));
+
+    if (data.contains("combo_id") && !data["combo_id"].is_null()) {
+        LOG_INFO("Combo ID: ", data["combo_id"]);
     }
-}
\ No newline at end of file
+
+    LOG_INFO("=============================");
+}
+
+void DeribitSubscription::printUserTrades(const json& data) const {
+    for (const auto& trade : data) {
+        LOG_INFO("\n=== User Trade ===");
+        LOG_INFO("Trade ID: ", trade["trade_id"]);
+        LOG_INFO("Instrument: ", trade["instrument_name"]);
+        LOG_INFO("Direction: ", trade["direction"]);
+        LOG_INFO("Amount: ", trade["amount"]);
+        LOG_INFO("Price: ", trade["price"]);
+        LOG_INFO("Mark Price: ", trade["mark_price"]);
+        LOG_INFO("Index Price: ", trade["index_price"]);
+        LOG_INFO("State: ", trade["state"]);
+        LOG_INFO("Order Type: ", trade["order_type"]);
+        LOG_INFO("Fee: ", trade["fee"], " ", trade["fee_currency"]);
+        LOG_INFO("Timestamp: ", trade["timestamp"]);
+        LOG_INFO("===================");
+    }
+}
+
+void DeribitSubscription::printInstrumentState(const json& data) const {
+    LOG_INFO("\n=== Instrument State Update ===");
+    LOG_INFO("Instrument: ", data["instrument_name"]);
+    LOG_INFO("State: ", data["state"]);
+    LOG_INFO("Timestamp: ", data["timestamp"]);
+    LOG_INFO("=============================");
+}
+
+void DeribitSubscription::printPriceIndex(const json& data) const {
+    LOG_INFO("\n=== Deribit Price Index Update ===");
+    LOG_INFO("Index Name: ", data["index_name"]);
+    LOG_INFO("Price: ", LogFixed{ data["price"].get<double>(), 2 }, " USD");
+    LOG_INFO("Timestamp: ", data["timestamp"]);
+    LOG_INFO("=============================");
+}
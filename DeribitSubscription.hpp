@@ -3,33 +3,239 @@
 #include <websocketpp/client.hpp>
 #include <websocketpp/config/asio_client.hpp>
 #include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
 #include <string>
 #include <vector>
+#include "DeribitChannelRegistry.hpp"
+#include "DeribitEventBus.hpp"
+#include "DeribitHeartbeat.hpp"
+#include "DeribitLatencyStats.hpp"
+#include "DeribitOrderBook.hpp"
+#include "DeribitPositionBook.hpp"
+#include "DeribitRiskGate.hpp"
+#include "DeribitTradeAggregator.hpp"
+#include "DeribitOptionBook.hpp"
+#include "DeribitBlockRfq.hpp"
+#include "DeribitRequestTable.hpp"
+#include "DeribitMessageDecoder.hpp"
 
 using json = nlohmann::json;
 
 class DeribitSubscription {
 public:
+    // Per-channel callbacks. A registered callback replaces the default console
+    // output for its channel; order books are maintained either way.
+    typedef std::function<void(const DeribitOrderBook& book)> BookHandler;
+    typedef std::function<void(const TradeEvent& trade)> TradeHandler;
+    typedef std::function<void(const TickerEvent& ticker)> TickerHandler;
+    typedef std::function<void(const OrderEvent& order)> OrderHandler;
+    typedef std::function<void(const json& data)> DataHandler;  // Channels without a typed decoder
+
     // Constructor takes references to websocket client and connection handle
     DeribitSubscription(
         websocketpp::client<websocketpp::config::asio_tls_client>& ws_client,
         websocketpp::connection_hdl& conn_hdl,
-        bool& auth_status);
+        const std::atomic<bool>& auth_status,
+        DeribitRequestTable& requests,
+        DeribitLatencyStats& latency_stats);
 
     // Subscription methods
     bool subscribePublic(const std::vector<std::string>& channels);
     bool subscribePrivate(const std::vector<std::string>& channels);
+    // Sends user.* and block_rfq.* channels with private/unsubscribe, the rest with public/unsubscribe
     bool unsubscribe(const std::vector<std::string>& channels);
+    bool unsubscribePrivate(const std::vector<std::string>& channels);
+
+    /**
+     * @brief Registers a callback for one channel
+     *
+     * The channel does not have to be subscribed yet. Registration fails if the
+     * handler type does not match the channel, e.g. onTrades("book.BTC-PERPETUAL.raw", ...).
+     * Safe from any thread: the handler is queued and installed by the thread
+     * that handles notifications, before it dispatches the next one.
+     * @param channel Full channel name, e.g. "book.BTC-PERPETUAL.100ms"
+     * @return true if the handler was registered
+     */
+    bool onBook(const std::string& channel, BookHandler handler);
+    bool onTrades(const std::string& channel, TradeHandler handler);
+    bool onTicker(const std::string& channel, TickerHandler handler);
+    bool onOrders(const std::string& channel, OrderHandler handler);
+    bool onData(const std::string& channel, DataHandler handler);
 
-    // Helper method to handle subscription responses
+    // Helper method to handle subscription notifications
     void handleSubscriptionMessage(const json& message);
 
+    /**
+     * @brief Handles a raw subscription notification
+     *
+     * The channel is resolved to its interned id and dispatched on its kind.
+     * book.*, trades.*, ticker.* and user.orders.* data, and user.trades.* data
+     * with a trades handler, is decoded straight into typed structs; other
+     * channels are parsed into JSON. Exchange-to-receive
+     * and receive-to-handled latencies are recorded per channel.
+     * @param payload The complete message text
+     * @param envelope The result of DeribitMessageDecoder::decodeEnvelope(payload)
+     * @param received_at When the message was taken off the socket
+     * @param received_wall_us Wall-clock receive time for exchange latency;
+     *                         0 uses the current time (replays pass the recorded one)
+     */
+    void handleSubscriptionPayload(std::string_view payload, const MessageEnvelope& envelope,
+                                   std::chrono::steady_clock::time_point received_at,
+                                   int64_t received_wall_us = 0);
+
+    /**
+     * @brief Publishes book tops, trades and user.trades.* fills to an event bus
+     *
+     * Events are published on the thread that handles notifications (the
+     * connection's io thread), in addition to the per-channel handlers.
+     * @param source Stamped on every event, e.g. ORDER_CONNECTION_SOURCE
+     */
+    void setEventBus(DeribitEventBus* bus, uint8_t source) {
+        event_bus = bus;
+        event_source = source;
+    }
+
+    // Guards reads of the connection handle when the owner may replace it on reconnect
+    void setConnectionMutex(std::mutex* mutex) { connection_mutex = mutex; }
+
+    /**
+     * @brief Remembers every subscribed channel for resubscribe() and marks
+     *        every order book out of sync; call when the connection drops
+     */
+    void onDisconnected();
+
+    /**
+     * @brief Re-sends the subscriptions lost with the connection, in batches
+     *
+     * Channels stay remembered until a subscription response confirms them,
+     * so a drop during resubscription loses nothing.
+     * @param private_channels user.* and block_rfq.* channels (private/subscribe,
+     *                         needs authentication) or the rest (public/subscribe)
+     * @param done Runs on the io thread once every batch is answered; not
+     *             called if there was nothing to resubscribe
+     * @return Number of channels sent
+     */
+    size_t resubscribe(bool private_channels, std::function<void()> done);
+
+    // Feeds mark prices (ticker.*, trades.*) and index prices (deribit_price_index.*) to positions
+    void setPositionBook(DeribitPositionBook* book) { position_book = book; }
+
+    /**
+     * @brief Routes subscription and snapshot requests through the owner's
+     *        send path instead of writing to the socket directly
+     *
+     * DeribitAuth uses it to put them behind its rate limiter.
+     */
+    typedef std::function<bool(const char* method, const json& params, ResponseCallback callback)> RequestSender;
+    void setRequestSender(RequestSender sender) { request_sender = std::move(sender); }
+
+    // Feeds mark prices (ticker.*, trades.*) to the risk gate's price bands
+    void setRiskGate(DeribitRiskGate* gate) { risk_gate = gate; }
+
+    // Feeds every trades.* trade to aggregator's bars and rolling statistics
+    void setTradeAggregator(DeribitTradeAggregator* aggregator) { trade_aggregator = aggregator; }
+
+    // Feeds option tickers and trades (volatilities, forwards) and index ticks (repricing) to book
+    void setOptionBook(DeribitOptionBook* book) { option_book = book; }
+
+    // Feeds block_rfq.* RFQs and quotes to book; its best quote handler runs on this thread
+    void setBlockRfqBook(DeribitBlockRfqBook* book) { block_rfq_book = book; }
+
+    // Takes the exchange clock offset out of exchange->recv latencies once clock has an estimate
+    void setClock(const DeribitClockEstimator* clock) { exchange_clock = clock; }
+
+    // Local order books maintained from book.* subscriptions
+    const DeribitBookManager& getOrderBooks() const { return order_books; }
+
+    // Channel ids, kinds and subscription state
+    const DeribitChannelRegistry& getChannels() const { return channel_registry; }
+
 private:
-    std::vector<std::string> active_subscriptions;
+    static const int REQUEST_TIMEOUT_MS = 10000;
+    static const size_t RESUBSCRIBE_BATCH = 100;     // Channels per request when resubscribing
+
+    // Callbacks and latency series of one channel; indexed by ChannelId. Kept in a
+    // deque so a callback that registers another channel does not move its own state.
+    struct ChannelState {
+        BookHandler book;
+        TradeHandler trades;
+        TickerHandler ticker;
+        OrderHandler orders;
+        DataHandler data;
+        LatencyHistogram* exchange_latency = nullptr;   // Exchange timestamp -> receive
+        LatencyHistogram* handler_latency = nullptr;    // Receive -> handler done
+    };
+
+    // A handler waiting to be installed on the notification thread
+    struct PendingHandler {
+        std::string channel;
+        std::function<void(ChannelState&)> install;
+    };
+
+    ChannelId internChannel(std::string_view name);
+    bool queueHandler(const std::string& channel, bool accepted, std::function<void(ChannelState&)> install);
+    void installPendingHandlers();
+    bool dispatchTyped(ChannelId id, std::string_view data, int64_t received_us);
+    void dispatchJson(ChannelId id, const json& data, int64_t received_us);
+    void recordExchangeLatency(const ChannelState& state, int64_t exchange_ms, int64_t received_us) const;
+
     bool handleSubscriptionResponse(const json& response);
-    bool sendSubscriptionMessage(const json& msg);
+    void handleUnsubscribeResponse(const json& response);
+    bool sendSubscriptionMessage(const char* method, const json& params, ResponseCallback callback);
+    bool requestBookSnapshot(const std::string& instrument_name);
+    void handleBookSnapshot(const std::string& instrument_name, const json& response);
+    void publishBookTop(const DeribitOrderBook& book);
+    void publishTrade(const TradeEvent& trade);
+    void publishTicker(const TickerEvent& ticker);
+    void publishMark(std::string_view instrument_name, double mark_price);
+    void publishFills(std::string_view data);
+    void printTopOfBook(const DeribitOrderBook& book) const;
+    void printTrade(const TradeEvent& trade) const;
+    void printTicker(const TickerEvent& ticker) const;
+    void printOrder(const OrderEvent& order) const;
+    void printAnnouncement(const json& data) const;
+    void printBlockRfqMaker(const json& data) const;
+    void printBlockRfqQuotes(const json& data) const;
+    void printBlockRfqTaker(const json& data) const;
+    void printUserTrades(const json& data) const;
+    void printInstrumentState(const json& data) const;
+    void printPriceIndex(const json& data) const;
+
+    // Scratch space reused by the typed decoders
+    BookUpdate book_update;
+    std::vector<TradeEvent> trade_events;
+    std::vector<OrderEvent> order_events;
+    std::vector<TradeEvent> fill_events;
+    int64_t received_ns = 0;                        // Receive time of the message being dispatched
+
+    DeribitBookManager order_books;
+    DeribitChannelRegistry channel_registry;
+    std::deque<ChannelState> channel_states;
+    std::set<std::string> resume_channels;          // Lost with the connection, not yet resubscribed
+
+    // Registrations from other threads; the registry and channel states are only touched on the notification thread
+    std::mutex handlers_mutex;
+    std::vector<PendingHandler> pending_handlers;
+    std::atomic<bool> handlers_pending{false};
 
     websocketpp::client<websocketpp::config::asio_tls_client>& ws_client;
     websocketpp::connection_hdl& connection_hdl;
-    bool& authenticated;
+    std::mutex* connection_mutex = nullptr;
+    const std::atomic<bool>& authenticated;
+    DeribitRequestTable& requests;
+    DeribitLatencyStats& latency_stats;
+    DeribitEventBus* event_bus = nullptr;
+    uint8_t event_source = ORDER_CONNECTION_SOURCE;
+    DeribitPositionBook* position_book = nullptr;
+    DeribitRiskGate* risk_gate = nullptr;
+    DeribitTradeAggregator* trade_aggregator = nullptr;
+    DeribitOptionBook* option_book = nullptr;
+    DeribitBlockRfqBook* block_rfq_book = nullptr;
+    const DeribitClockEstimator* exchange_clock = nullptr;
+    RequestSender request_sender;
 };
\ No newline at end of file
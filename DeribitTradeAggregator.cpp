@@ -0,0 +1,358 @@
+#include "DeribitTradeAggregator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const size_t LANES = 4;
+typedef double Lanes __attribute__((vector_size(LANES * sizeof(double))));
+
+// By reference: returning a vector type by value warns about its ABI
+inline void loadLanes(Lanes& lanes, const double* values) {
+    std::memcpy(&lanes, values, sizeof(lanes));
+}
+
+inline double sumLanes(const Lanes& lanes) {
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+const size_t INITIAL_TAPE = 256;
+const double YEAR_MS = 365.25 * 24 * 3600 * 1000;
+
+size_t roundUpPow2(size_t value) {
+    size_t out = 1;
+    while (out < value) {
+        out <<= 1;
+    }
+    return out;
+}
+
+int64_t floorTo(int64_t value, int64_t step) {
+    int64_t rem = value % step;
+    return value - (rem < 0 ? rem + step : rem);
+}
+
+struct Sums {
+    double amount = 0.0;
+    double signed_amount = 0.0;
+    double notional = 0.0;
+    double squared_return = 0.0;
+};
+
+}  // namespace
+
+// Ring buffer of trades as parallel arrays. Trades are numbered from 0 in
+// arrival order; trade n lives at index n & mask while it is among the last
+// capacity() trades. The arrays start small and double up to tape_capacity.
+struct DeribitTradeAggregator::Tape {
+    std::vector<int64_t> timestamp;
+    std::vector<double> amount;
+    std::vector<double> signed_amount;      // + for taker buys, - for taker sells
+    std::vector<double> notional;           // price * amount
+    std::vector<double> squared_return;     // log(price / previous price)^2
+    size_t mask = 0;
+    uint64_t head = 0;                      // Number of the next trade
+
+    size_t capacity() const { return timestamp.size(); }
+    uint64_t oldest() const { return head > capacity() ? head - capacity() : 0; }
+    int64_t timeOf(uint64_t n) const { return timestamp[n & mask]; }
+
+    void resize(size_t new_capacity) {
+        Tape grown;
+        grown.timestamp.resize(new_capacity);
+        grown.amount.resize(new_capacity);
+        grown.signed_amount.resize(new_capacity);
+        grown.notional.resize(new_capacity);
+        grown.squared_return.resize(new_capacity);
+        grown.mask = new_capacity - 1;
+        grown.head = head;
+        for (uint64_t n = oldest(); n < head; ++n) {
+            size_t from = n & mask;
+            size_t to = n & grown.mask;
+            grown.timestamp[to] = timestamp[from];
+            grown.amount[to] = amount[from];
+            grown.signed_amount[to] = signed_amount[from];
+            grown.notional[to] = notional[from];
+            grown.squared_return[to] = squared_return[from];
+        }
+        *this = std::move(grown);
+    }
+
+    // First trade in [from, head) later than cutoff; timestamps never decrease
+    uint64_t firstAfter(uint64_t from, int64_t cutoff) const {
+        uint64_t lo = from;
+        uint64_t hi = head;
+        while (lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (timeOf(mid) <= cutoff) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    // Adds up the contiguous array range [begin, end), LANES at a time
+    void sumRange(size_t begin, size_t end, Sums& sums) const {
+        Lanes lane_amount = {}, lane_signed = {}, lane_notional = {}, lane_squared = {};
+        size_t i = begin;
+        for (; i + LANES <= end; i += LANES) {
+            Lanes values;
+            loadLanes(values, &amount[i]);
+            lane_amount += values;
+            loadLanes(values, &signed_amount[i]);
+            lane_signed += values;
+            loadLanes(values, &notional[i]);
+            lane_notional += values;
+            loadLanes(values, &squared_return[i]);
+            lane_squared += values;
+        }
+        sums.amount += sumLanes(lane_amount);
+        sums.signed_amount += sumLanes(lane_signed);
+        sums.notional += sumLanes(lane_notional);
+        sums.squared_return += sumLanes(lane_squared);
+        for (; i < end; ++i) {
+            sums.amount += amount[i];
+            sums.signed_amount += signed_amount[i];
+            sums.notional += notional[i];
+            sums.squared_return += squared_return[i];
+        }
+    }
+
+    // Trades [first, last) lie in at most two contiguous ranges of the arrays
+    Sums sum(uint64_t first, uint64_t last) const {
+        Sums sums;
+        if (first >= last) {
+            return sums;
+        }
+        size_t begin = first & mask;
+        size_t count = static_cast<size_t>(last - first);
+        size_t head_part = std::min(count, capacity() - begin);
+        sumRange(begin, begin + head_part, sums);
+        sumRange(0, count - head_part, sums);
+        return sums;
+    }
+};
+
+struct DeribitTradeAggregator::BarSeries {
+    std::vector<TradeBar> history;          // Ring of completed bars once it reaches bar_history
+    uint64_t completed = 0;
+    TradeBar open;
+    double open_notional = 0.0;
+    bool has_open = false;
+};
+
+struct DeribitTradeAggregator::InstrumentTrades {
+    Tape tape;
+    std::vector<uint64_t> window_start;     // Oldest trade in each configured window
+    std::vector<BarSeries> series;          // Parallel to config.bars
+    int64_t last_seq = 0;
+    int64_t last_timestamp = 0;
+    double last_price = 0.0;
+};
+
+DeribitTradeAggregator::DeribitTradeAggregator(const TradeAggregatorConfig& config) : trade_count(0) {
+    configure(config);
+}
+
+DeribitTradeAggregator::~DeribitTradeAggregator() = default;
+
+void DeribitTradeAggregator::configure(const TradeAggregatorConfig& new_config) {
+    std::lock_guard<std::mutex> lock(mutex);
+    config = new_config;
+    config.bar_history = std::max<size_t>(config.bar_history, 1);
+    config.tape_capacity = roundUpPow2(std::max(config.tape_capacity, LANES));
+    names.clear();
+    by_id.clear();
+    trade_count = 0;
+}
+
+void DeribitTradeAggregator::onTrade(const TradeEvent& trade) {
+    if (!(trade.amount > 0.0) || !(trade.price > 0.0)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t id = names.intern(trade.instrument_name);
+    if (id == by_id.size()) {
+        by_id.emplace_back(new InstrumentTrades());
+        by_id.back()->window_start.assign(config.windows_ms.size(), 0);
+        by_id.back()->series.resize(config.bars.size());
+    }
+    InstrumentTrades& instrument = *by_id[id];
+    if (trade.trade_seq != 0 && trade.trade_seq <= instrument.last_seq) {
+        return;
+    }
+    instrument.last_seq = trade.trade_seq;
+    append(instrument, trade);
+    addToBars(instrument, trade);
+    ++trade_count;
+}
+
+void DeribitTradeAggregator::append(InstrumentTrades& instrument, const TradeEvent& trade) {
+    Tape& tape = instrument.tape;
+    if (tape.head >= tape.capacity() && tape.capacity() < config.tape_capacity) {
+        tape.resize(tape.capacity() == 0 ? std::min(INITIAL_TAPE, config.tape_capacity) : tape.capacity() * 2);
+    }
+
+    // Exchange timestamps of one instrument should not go backwards; if they do, hold them level
+    int64_t timestamp = std::max(trade.timestamp, instrument.last_timestamp);
+    double log_return = instrument.last_price > 0.0 ? std::log(trade.price / instrument.last_price) : 0.0;
+    size_t slot = tape.head & tape.mask;
+    tape.timestamp[slot] = timestamp;
+    tape.amount[slot] = trade.amount;
+    tape.signed_amount[slot] = trade.direction == OrderSide::Buy ? trade.amount : -trade.amount;
+    tape.notional[slot] = trade.price * trade.amount;
+    tape.squared_return[slot] = log_return * log_return;
+    ++tape.head;
+    instrument.last_timestamp = timestamp;
+    instrument.last_price = trade.price;
+
+    // Each window start only moves forward, so this is O(1) amortized per window
+    uint64_t oldest = tape.oldest();
+    for (size_t w = 0; w < config.windows_ms.size(); ++w) {
+        uint64_t& start = instrument.window_start[w];
+        start = std::max(start, oldest);
+        int64_t cutoff = timestamp - config.windows_ms[w];
+        while (start < tape.head && tape.timeOf(start) <= cutoff) {
+            ++start;
+        }
+    }
+}
+
+void DeribitTradeAggregator::addToBars(InstrumentTrades& instrument, const TradeEvent& trade) {
+    auto complete = [this](BarSeries& series) {
+        TradeBar& bar = series.open;
+        bar.vwap = bar.volume > 0.0 ? series.open_notional / bar.volume : bar.close;
+        if (series.history.size() < config.bar_history) {
+            series.history.push_back(bar);
+        } else {
+            series.history[series.completed % config.bar_history] = bar;
+        }
+        ++series.completed;
+        series.has_open = false;
+    };
+
+    int64_t timestamp = instrument.last_timestamp;
+    for (size_t i = 0; i < config.bars.size(); ++i) {
+        const BarSpec& spec = config.bars[i];
+        BarSeries& series = instrument.series[i];
+        int64_t interval_ms = std::max<int64_t>(1, static_cast<int64_t>(spec.size));
+        if (series.has_open && spec.kind == BarKind::Time && timestamp >= series.open.open_time + interval_ms) {
+            complete(series);
+        }
+
+        TradeBar& bar = series.open;
+        if (!series.has_open) {
+            bar = TradeBar();
+            bar.open_time = spec.kind == BarKind::Time ? floorTo(timestamp, interval_ms) : timestamp;
+            bar.open = bar.high = bar.low = trade.price;
+            series.open_notional = 0.0;
+            series.has_open = true;
+        }
+        bar.close_time = timestamp;
+        bar.high = std::max(bar.high, trade.price);
+        bar.low = std::min(bar.low, trade.price);
+        bar.close = trade.price;
+        bar.volume += trade.amount;
+        bar.buy_volume += trade.direction == OrderSide::Buy ? trade.amount : 0.0;
+        ++bar.trades;
+        series.open_notional += trade.price * trade.amount;
+
+        if (spec.kind == BarKind::Volume && bar.volume >= spec.size) {
+            complete(series);
+        }
+    }
+}
+
+DeribitTradeAggregator::InstrumentTrades* DeribitTradeAggregator::find(std::string_view instrument_name) const {
+    uint32_t id = names.find(instrument_name);
+    return id == DeribitKeyIndex::NO_KEY ? nullptr : by_id[id].get();
+}
+
+bool DeribitTradeAggregator::windowStats(std::string_view instrument_name, std::vector<TradeWindowStats>& out,
+                                         int64_t as_of_ms) const {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    const InstrumentTrades* instrument = find(instrument_name);
+    if (instrument == nullptr) {
+        return false;
+    }
+    const Tape& tape = instrument->tape;
+    int64_t end_ms = std::max(as_of_ms, instrument->last_timestamp);
+    uint64_t oldest = tape.oldest();
+
+    for (size_t w = 0; w < config.windows_ms.size(); ++w) {
+        TradeWindowStats stats;
+        stats.window_ms = config.windows_ms[w];
+        int64_t cutoff = end_ms - stats.window_ms;
+        uint64_t first = std::max(instrument->window_start[w], oldest);
+        if (end_ms > instrument->last_timestamp) {
+            first = tape.firstAfter(first, cutoff);
+        }
+        stats.truncated = first == oldest && oldest > 0 && tape.timeOf(oldest) > cutoff;
+
+        Sums sums = tape.sum(first, tape.head);
+        stats.trades = static_cast<uint32_t>(tape.head - first);
+        stats.volume = sums.amount;
+        if (sums.amount > 0.0) {
+            stats.vwap = sums.notional / sums.amount;
+            stats.imbalance = sums.signed_amount / sums.amount;
+        }
+        if (stats.window_ms > 0) {
+            stats.realized_vol = std::sqrt(sums.squared_return * YEAR_MS / stats.window_ms);
+        }
+        out.push_back(stats);
+    }
+    return true;
+}
+
+size_t DeribitTradeAggregator::bars(std::string_view instrument_name, size_t series, size_t max_bars,
+                                    std::vector<TradeBar>& out) const {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    const InstrumentTrades* instrument = find(instrument_name);
+    if (instrument == nullptr || series >= instrument->series.size()) {
+        return 0;
+    }
+    const BarSeries& bars_of = instrument->series[series];
+    size_t count = std::min(max_bars, bars_of.history.size());
+    for (uint64_t n = bars_of.completed - count; n < bars_of.completed; ++n) {
+        out.push_back(bars_of.history[n % config.bar_history]);
+    }
+    return out.size();
+}
+
+bool DeribitTradeAggregator::openBar(std::string_view instrument_name, size_t series, TradeBar& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const InstrumentTrades* instrument = find(instrument_name);
+    if (instrument == nullptr || series >= instrument->series.size() || !instrument->series[series].has_open) {
+        return false;
+    }
+    const BarSeries& bars_of = instrument->series[series];
+    out = bars_of.open;
+    out.vwap = out.volume > 0.0 ? bars_of.open_notional / out.volume : out.close;
+    return true;
+}
+
+size_t DeribitTradeAggregator::instruments(std::vector<std::string>& out) const {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (uint32_t id = 0; id < names.size(); ++id) {
+        out.push_back(names.key(id));
+    }
+    return out.size();
+}
+
+uint64_t DeribitTradeAggregator::tradeCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return trade_count;
+}
+
+void DeribitTradeAggregator::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    names.clear();
+    by_id.clear();
+    trade_count = 0;
+}
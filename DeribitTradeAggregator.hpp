@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DeribitKeyIndex.hpp"
+#include "DeribitMessageDecoder.hpp"
+
+enum class BarKind : uint8_t {
+    Time,           // Closes when a trade falls past the end of its interval
+    Volume          // Closes once its amount reaches the bar size
+};
+
+struct BarSpec {
+    BarKind kind;
+    double size;    // Milliseconds for time bars, amount for volume bars
+};
+
+struct TradeAggregatorConfig {
+    std::vector<BarSpec> bars = {{BarKind::Time, 1000}, {BarKind::Time, 60000}};
+    std::vector<int64_t> windows_ms = {1000, 10000, 60000};    // Rolling statistics
+    size_t bar_history = 1024;      // Completed bars kept per series and instrument
+    size_t tape_capacity = 16384;   // Trades kept per instrument; bounds what a window can cover
+};
+
+// One OHLCV bar; times are exchange milliseconds
+struct TradeBar {
+    int64_t open_time = 0;          // Interval start for time bars, first trade for volume bars
+    int64_t close_time = 0;         // Last trade
+    double open = 0.0;
+    double high = 0.0;
+    double low = 0.0;
+    double close = 0.0;
+    double volume = 0.0;
+    double buy_volume = 0.0;        // Taker buys; the rest of volume is taker sells
+    double vwap = 0.0;
+    uint32_t trades = 0;
+};
+
+// Statistics of the trades in one rolling window
+struct TradeWindowStats {
+    int64_t window_ms = 0;
+    uint32_t trades = 0;
+    double volume = 0.0;
+    double vwap = 0.0;              // 0 without trades
+    double imbalance = 0.0;         // (buy - sell) / (buy + sell) volume, in [-1, 1]
+    double realized_vol = 0.0;      // Annualized, from log returns between consecutive trades
+    bool truncated = false;         // The tape ran out: only the latest tape_capacity trades count
+};
+
+/**
+ * @class DeribitTradeAggregator
+ * @brief Bars and rolling statistics of the public trade tape, per instrument
+ *
+ * Every trade from a trades.* channel is appended to its instrument's tape,
+ * a ring buffer stored as parallel arrays (timestamp, amount, signed amount,
+ * notional, squared log return), and added to the open bar of every
+ * configured series. A time bar covers [k * size, (k + 1) * size) in exchange
+ * time, so intervals without trades produce no bar; a volume bar takes whole
+ * trades, so its volume can overshoot the bar size by the last trade. Each
+ * rolling window keeps the position of its oldest trade and moves it forward
+ * as trades arrive, so an update costs O(1) amortized. Window queries sum the
+ * covered part of the tape four lanes at a time.
+ *
+ * Everything is keyed by exchange timestamps and trade_seq, never the local
+ * clock, so a replayed capture produces the same bars as the live feed did.
+ * Trades at or below the last trade_seq of their instrument (a resubscription
+ * repeating recent trades) are ignored.
+ *
+ * Trades arrive from several io threads when a market data pool is enabled,
+ * so access takes a mutex, like DeribitPositionBook.
+ */
+class DeribitTradeAggregator {
+public:
+    explicit DeribitTradeAggregator(const TradeAggregatorConfig& config = TradeAggregatorConfig());
+    ~DeribitTradeAggregator();
+
+    // Replaces the configuration and drops everything aggregated so far
+    void configure(const TradeAggregatorConfig& config);
+    const TradeAggregatorConfig& getConfig() const { return config; }
+
+    // Update side (io threads, or a replay)
+    void onTrade(const TradeEvent& trade);
+
+    /**
+     * @brief Statistics over every configured window, in config order
+     * @param as_of_ms Exchange time the windows end at; 0 (or anything before
+     *                 the latest trade) ends them at the latest trade
+     * @return false if the instrument has no trades
+     */
+    bool windowStats(std::string_view instrument_name, std::vector<TradeWindowStats>& out,
+                     int64_t as_of_ms = 0) const;
+
+    /**
+     * @brief The latest completed bars of config.bars[series], oldest first
+     * @return Number of bars copied, at most max_bars and bar_history
+     */
+    size_t bars(std::string_view instrument_name, size_t series, size_t max_bars, std::vector<TradeBar>& out) const;
+
+    // The bar of config.bars[series] still being built; false if there is none
+    bool openBar(std::string_view instrument_name, size_t series, TradeBar& out) const;
+
+    size_t instruments(std::vector<std::string>& out) const;
+    uint64_t tradeCount() const;
+    void clear();
+
+private:
+    struct Tape;
+    struct BarSeries;
+    struct InstrumentTrades;
+
+    InstrumentTrades* find(std::string_view instrument_name) const;
+    void append(InstrumentTrades& instrument, const TradeEvent& trade);
+    void addToBars(InstrumentTrades& instrument, const TradeEvent& trade);
+
+    TradeAggregatorConfig config;
+    DeribitKeyIndex names;
+    std::vector<std::unique_ptr<InstrumentTrades>> by_id;      // Indexed by names
+    uint64_t trade_count;
+    mutable std::mutex mutex;
+};
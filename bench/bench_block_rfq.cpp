@@ -0,0 +1,128 @@
+// Block RFQ benchmark: time from a block_rfq.* notification reaching
+// DeribitBlockRfqBook to its best quote handler running, and the cost of
+// one maker quote update on an RFQ quoted by many makers.
+//
+// The feed is synthetic: RFQS open RFQs, each quoted on both sides by MAKERS
+// makers who keep repricing.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -I. -I/path/to/nlohmann_json
+//       bench/bench_block_rfq.cpp DeribitBlockRfq.cpp -o bench_block_rfq
+// Run:
+//   ./bench_block_rfq
+
+#include "DeribitBlockRfq.hpp"
+#include "DeribitEventBus.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int RFQS = 64;
+const int MAKERS = 32;
+const int UPDATES = 200000;
+const int64_t START_MS = 1790000000000;
+
+struct Result {
+    double mean_ns;
+    double p50_ns;
+    double p99_ns;
+};
+
+Result summarize(std::vector<double>& samples) {
+    double total = 0;
+    for (double s : samples) total += s;
+    std::sort(samples.begin(), samples.end());
+    return Result{ total / samples.size(),
+                   samples[samples.size() / 2],
+                   samples[samples.size() * 99 / 100] };
+}
+
+json makeRfq(int id) {
+    return {
+        {"block_rfq_id", id},
+        {"state", "open"},
+        {"role", "maker"},
+        {"amount", 100},
+        {"creation_timestamp", START_MS},
+        {"expiration_timestamp", START_MS + 300000},
+        {"legs", json::array({
+            {{"instrument_name", "BTC-27DEC26-60000-C"}, {"direction", "buy"}, {"ratio", 1}},
+            {{"instrument_name", "BTC-27DEC26-70000-C"}, {"direction", "sell"}, {"ratio", 1}}
+        })}
+    };
+}
+
+json makeQuote(int rfq, int maker, bool bid, double price, int64_t timestamp) {
+    return {
+        {"block_rfq_quote_id", (rfq * MAKERS + maker) * 2 + (bid ? 0 : 1) + 1},
+        {"block_rfq_id", rfq},
+        {"direction", bid ? "buy" : "sell"},
+        {"price", price},
+        {"amount", 100},
+        {"quote_state", "open"},
+        {"creation_timestamp", START_MS},
+        {"last_update_timestamp", timestamp},
+        {"execution_instruction", "any_part_of"}
+    };
+}
+
+}  // namespace
+
+int main() {
+    DeribitBlockRfqBook book;
+    std::vector<double> handler_ns;
+    handler_ns.reserve(UPDATES);
+    book.setBestQuoteHandler([&](const BlockRfqBest& best) {
+        if (best.received_ns != 0) {
+            handler_ns.push_back(static_cast<double>(EventRecord::now() - best.received_ns));
+        }
+    });
+
+    for (int rfq = 1; rfq <= RFQS; ++rfq) {
+        book.onMakerRfq(makeRfq(rfq), 0);
+        json quotes = json::array();
+        for (int maker = 0; maker < MAKERS; ++maker) {
+            quotes.push_back(makeQuote(rfq, maker, true, 0.0100 - 0.0001 * maker, START_MS));
+            quotes.push_back(makeQuote(rfq, maker, false, 0.0110 + 0.0001 * maker, START_MS));
+        }
+        book.onMakerQuotes(quotes, 0);
+    }
+    handler_ns.clear();
+
+    // Pre-built notifications, so only the book is timed
+    std::vector<json> feed;
+    feed.reserve(UPDATES);
+    for (int i = 0; i < UPDATES; ++i) {
+        int rfq = 1 + i % RFQS;
+        int maker = (i * 7) % MAKERS;
+        bool bid = (i & 1) == 0;
+        double offset = 0.0001 * ((i * 13) % 40);
+        double price = bid ? 0.0070 + offset : 0.0145 - offset;
+        feed.push_back(json::array({ makeQuote(rfq, maker, bid, price, START_MS + i) }));
+    }
+
+    std::vector<double> update_ns;
+    update_ns.reserve(UPDATES);
+    for (const auto& notification : feed) {
+        int64_t received = EventRecord::now();
+        book.onMakerQuotes(notification, received);
+        update_ns.push_back(static_cast<double>(EventRecord::now() - received));
+    }
+
+    BlockRfqStats stats = book.stats();
+    Result update = summarize(update_ns);
+    std::printf("%d RFQs x %d makers x 2 sides, %zu live quotes\n\n", RFQS, MAKERS, stats.quotes);
+    std::printf("%-32s mean %8.0f ns   p50 %8.0f ns   p99 %8.0f ns\n", "maker quote update (decode+book)",
+                update.mean_ns, update.p50_ns, update.p99_ns);
+    if (!handler_ns.empty()) {
+        Result handler = summarize(handler_ns);
+        std::printf("%-32s mean %8.0f ns   p50 %8.0f ns   p99 %8.0f ns   (%zu best changes)\n",
+                    "receive -> best quote handler", handler.mean_ns, handler.p50_ns, handler.p99_ns,
+                    handler_ns.size());
+    }
+    return 0;
+}
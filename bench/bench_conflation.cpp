@@ -0,0 +1,160 @@
+// Conflation benchmark: how stale the state seen by a slow consumer gets
+// when it reads book updates through a DeribitEventQueue versus a
+// DeribitConflatedView.
+//
+// One producer publishes BookUpdate events round-robin over --instruments
+// instruments every --interval-ns; the consumer spends --work-ns on each event
+// it reads, more than the producer leaves it. The report gives the age of
+// each event when read (publish -> pop), how many were read, and how many
+// the queue dropped or the view conflated.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -I. bench/bench_conflation.cpp DeribitEventBus.cpp DeribitLatencyStats.cpp
+//       DeribitLogger.cpp -pthread -o bench_conflation
+// Run:
+//   ./bench_conflation [--events 500000] [--instruments 64] [--interval-ns 500] [--work-ns 2000]
+
+#include "DeribitEventBus.hpp"
+#include "DeribitLatencyStats.hpp"
+#include "DeribitLogger.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const size_t QUEUE_CAPACITY = 4096;
+
+struct Options {
+    int events = 500000;
+    int instruments = 64;
+    int64_t interval_ns = 500;
+    int64_t work_ns = 2000;
+};
+
+void spinFor(int64_t ns) {
+    int64_t until = EventRecord::now() + ns;
+    while (EventRecord::now() < until) {
+    }
+}
+
+void publishAll(const Options& options, DeribitEventBus& bus) {
+    std::vector<std::string> names;
+    for (int i = 0; i < options.instruments; ++i) {
+        names.push_back("BTC-INSTRUMENT-" + std::to_string(i));
+    }
+    EventRecord event;
+    std::memset(&event, 0, sizeof(event));
+    event.type = EventType::BookUpdate;
+    event.book.synced = true;
+
+    int64_t next = EventRecord::now();
+    for (int i = 0; i < options.events; ++i) {
+        next += options.interval_ns;
+        while (EventRecord::now() < next) {
+        }
+        event.instrument.assign(names[i % options.instruments]);
+        event.book.change_id = i;
+        event.book.best_bid_price = 60000.0 + i % 100;
+        event.book.best_ask_price = event.book.best_bid_price + 0.5;
+        event.received_ns = EventRecord::now();
+        bus.publish(event);
+    }
+}
+
+void report(const char* name, const LatencyHistogram& age_ns, uint64_t read, uint64_t lost, const char* lost_as) {
+    std::fprintf(stderr, "%-15s read %8llu  %s %8llu   age p50 %9lld  p99 %10lld  max %10lld ns\n", name,
+                 static_cast<unsigned long long>(read), lost_as, static_cast<unsigned long long>(lost),
+                 static_cast<long long>(age_ns.percentile(0.50)),
+                 static_cast<long long>(age_ns.percentile(0.99)),
+                 static_cast<long long>(age_ns.max()));
+}
+
+void runQueue(const Options& options) {
+    auto queue = std::make_shared<DeribitEventQueue>(QUEUE_CAPACITY, QueueProducers::Single, WaitStrategy::Yield,
+                                                     eventBit(EventType::BookUpdate));
+    DeribitEventBus bus;
+    bus.attach(queue);
+
+    LatencyHistogram age_ns;
+    uint64_t read = 0;
+    std::atomic<bool> done(false);
+    std::thread consumer([&]() {
+        EventRecord event;
+        while (!done.load(std::memory_order_acquire) || queue->size() != 0) {
+            if (queue->pop(event, std::chrono::milliseconds(10))) {
+                age_ns.record(EventRecord::now() - event.published_ns);
+                ++read;
+                spinFor(options.work_ns);
+            }
+        }
+    });
+    publishAll(options, bus);
+    done.store(true, std::memory_order_release);
+    consumer.join();
+    report("queue", age_ns, read, queue->droppedCount(), "dropped");
+}
+
+void runView(const Options& options) {
+    auto view = std::make_shared<DeribitConflatedView>(options.instruments);
+    DeribitEventBus bus;
+    bus.attach(view);
+
+    LatencyHistogram age_ns;
+    std::atomic<bool> done(false);
+    std::thread consumer([&]() {
+        EventRecord event;
+        while (!done.load(std::memory_order_acquire) || view->stats().pending != 0) {
+            if (view->pop(event, std::chrono::milliseconds(10))) {
+                age_ns.record(EventRecord::now() - event.published_ns);
+                spinFor(options.work_ns);
+            }
+        }
+    });
+    publishAll(options, bus);
+    done.store(true, std::memory_order_release);
+    consumer.join();
+    ConflationStats stats = view->stats();
+    report("conflated view", age_ns, stats.delivered, stats.conflated, "conflated");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--events") {
+            options.events = std::atoi(argv[i + 1]);
+        } else if (arg == "--instruments") {
+            options.instruments = std::atoi(argv[i + 1]);
+        } else if (arg == "--interval-ns") {
+            options.interval_ns = std::atoll(argv[i + 1]);
+        } else if (arg == "--work-ns") {
+            options.work_ns = std::atoll(argv[i + 1]);
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return 1;
+        }
+    }
+    if (options.instruments < 1) {
+        options.instruments = 1;
+    }
+    if (std::getenv("DERIBIT_LOG_LEVEL") == nullptr) {
+        DeribitLogger::setLevel(LogLevel::Warn);
+    }
+
+    std::fprintf(stderr, "%d book updates over %d instruments, one every %lld ns; consumer takes %lld ns each\n",
+                 options.events, options.instruments, static_cast<long long>(options.interval_ns),
+                 static_cast<long long>(options.work_ns));
+    runQueue(options);
+    runView(options);
+    DeribitLogger::instance().flush();
+    return 0;
+}
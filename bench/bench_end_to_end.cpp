@@ -0,0 +1,287 @@
+// End-to-end load benchmark: DeribitAuth against a local DeribitMockServer
+// over TLS on the loopback interface.
+//
+// Streams synthetic book.* and trades.* traffic at the requested rates and
+// reports the sustained rate the client actually handled, then sends market
+// orders one at a time while the stream keeps running and reports their
+// round-trip percentiles (placeOrder call -> response callback). With
+// --shards N the stream goes to a DeribitMarketDataPool of N connections and
+// the order connection carries only order traffic.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -I. -I/path/to/websocketpp -I/path/to/nlohmann_json
+//       bench/bench_end_to_end.cpp DeribitMockServer.cpp DeribitAuth.cpp DeribitSubscription.cpp
+//       DeribitOrderBook.cpp DeribitRequestTable.cpp DeribitOrderEncoder.cpp DeribitMessageDecoder.cpp
+//       DeribitChannelRegistry.cpp DeribitLogger.cpp DeribitLatencyStats.cpp DeribitJournal.cpp
+//       DeribitMarketDataPool.cpp DeribitEventBus.cpp DeribitKeyIndex.cpp DeribitOrderManager.cpp
+//       DeribitPositionBook.cpp DeribitInstrumentRegistry.cpp DeribitReconnect.cpp DeribitRiskGate.cpp
+//       DeribitRequestScheduler.cpp DeribitHeartbeat.cpp DeribitTradeAggregator.cpp DeribitOptionBook.cpp
+//       DeribitOptionPricer.cpp DeribitPortfolioRisk.cpp DeribitBlockRfq.cpp DeribitAsync.cpp
+//       -lssl -lcrypto -pthread -o bench_end_to_end
+// Run:
+//   ./bench_end_to_end [--port 18443] [--book-rate 20000] [--trade-rate 2000]
+//                      [--instruments 2] [--seconds 5] [--orders 2000] [--shards 0] [--drops 0]
+//       --drops N then has the server drop every connection N times and
+//       reports how long the client takes to get book updates flowing again
+//   ./bench_end_to_end --serve [--port 18443] [--book-rate 10] [--trade-rate 5]
+//       Runs only the mock server until stdin closes, e.g. for
+//       ./deribit_auth --uri wss://127.0.0.1:18443/ws/api/v2
+
+#include "DeribitAuth.hpp"
+#include "DeribitLatencyStats.hpp"
+#include "DeribitLogger.hpp"
+#include "DeribitMockServer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const char* const INSTRUMENTS[] = {
+    "BTC-PERPETUAL", "ETH-PERPETUAL", "SOL-PERPETUAL", "XRP-PERPETUAL",
+    "ADA-PERPETUAL", "DOGE-PERPETUAL", "AVAX-PERPETUAL", "BNB-PERPETUAL"
+};
+const int MAX_INSTRUMENTS = sizeof(INSTRUMENTS) / sizeof(INSTRUMENTS[0]);
+
+struct Options {
+    MockServerConfig server;
+    bool serve_only = false;
+    int instruments = 2;
+    double seconds = 5.0;
+    int orders = 2000;
+    size_t shards = 0;
+    int drops = 0;
+};
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    options.server.port = 18443;
+    options.server.book_rate = 20000.0;
+    options.server.trade_rate = 2000.0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--serve") {
+            options.serve_only = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return false;
+        }
+        const char* value = argv[++i];
+        if (arg == "--port") {
+            options.server.port = static_cast<uint16_t>(std::atoi(value));
+        } else if (arg == "--book-rate") {
+            options.server.book_rate = std::atof(value);
+        } else if (arg == "--trade-rate") {
+            options.server.trade_rate = std::atof(value);
+        } else if (arg == "--instruments") {
+            options.instruments = std::max(1, std::min(MAX_INSTRUMENTS, std::atoi(value)));
+        } else if (arg == "--seconds") {
+            options.seconds = std::atof(value);
+        } else if (arg == "--orders") {
+            options.orders = std::atoi(value);
+        } else if (arg == "--shards") {
+            options.shards = static_cast<size_t>(std::max(0, std::atoi(value)));
+        } else if (arg == "--drops") {
+            options.drops = std::max(0, std::atoi(value));
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// Waits for one outstanding response at a time
+class ResponseGate {
+public:
+    void open() {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        condition.notify_one();
+    }
+
+    bool wait(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex);
+        bool opened = condition.wait_for(lock, timeout, [this]() { return done; });
+        done = false;
+        return opened;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool done = false;
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+    if (std::getenv("DERIBIT_LOG_LEVEL") == nullptr) {
+        DeribitLogger::setLevel(LogLevel::Warn);
+    }
+
+    DeribitMockServer server(options.server);
+    if (!server.start()) {
+        return 1;
+    }
+
+    if (options.serve_only) {
+        std::fprintf(stderr, "Mock server listening on %s (close stdin to stop)\n", server.uri().c_str());
+        std::string line;
+        while (std::getline(std::cin, line)) {
+        }
+        server.stop();
+        return 0;
+    }
+
+    DeribitAuth auth("bench", "bench");
+    // The mock server does not throttle, and orders go out back to back
+    RateLimitConfig unlimited;
+    unlimited.enabled = false;
+    auth.setRateLimits(unlimited);
+    if (options.shards > 0) {
+        MarketDataPoolConfig pool_config;
+        pool_config.shards = options.shards;
+        auth.enableMarketDataPool(pool_config);
+    }
+    auto connect_started = Clock::now();
+    if (!auth.connect(server.uri())) {
+        DeribitLogger::instance().flush();
+        std::fprintf(stderr, "Unable to connect to the mock server\n");
+        return 1;
+    }
+    auto connected_at = Clock::now();
+    if (!auth.authenticate()) {
+        DeribitLogger::instance().flush();
+        std::fprintf(stderr, "Unable to authenticate with the mock server\n");
+        return 1;
+    }
+    double connect_ms = std::chrono::duration<double, std::milli>(connected_at - connect_started).count();
+    double auth_ms = std::chrono::duration<double, std::milli>(Clock::now() - connected_at).count();
+
+    // Count what the client handles; handlers replace the console output
+    std::atomic<uint64_t> book_messages(0);
+    std::atomic<uint64_t> trade_messages(0);
+    DeribitMarketDataPool* pool = auth.getMarketDataPool();
+    std::vector<std::string> channels;
+    for (int i = 0; i < options.instruments; ++i) {
+        std::string book_channel = std::string("book.") + INSTRUMENTS[i] + ".raw";
+        std::string trade_channel = std::string("trades.") + INSTRUMENTS[i] + ".raw";
+        DeribitSubscription& subscriptions = pool ? pool->shard(pool->shardFor(book_channel))
+                                                  : auth.getSubscriptionHandler();
+        subscriptions.onBook(book_channel, [&](const DeribitOrderBook&) {
+            book_messages.fetch_add(1, std::memory_order_relaxed);
+        });
+        subscriptions.onTrades(trade_channel, [&](const TradeEvent&) {
+            trade_messages.fetch_add(1, std::memory_order_relaxed);
+        });
+        channels.push_back(book_channel);
+        channels.push_back(trade_channel);
+    }
+    auth.subscribePublic(channels);
+
+    // Let the stream reach a steady state before measuring
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    uint64_t sent_before = server.notificationsSent();
+    uint64_t handled_before = book_messages.load() + trade_messages.load();
+    auto started = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+    double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+    uint64_t sent = server.notificationsSent() - sent_before;
+    uint64_t handled = book_messages.load() + trade_messages.load() - handled_before;
+
+    // Order round trips while the stream keeps running
+    LatencyHistogram round_trips;
+    ResponseGate gate;
+    int failed = 0;
+    int timed_out = 0;
+    for (int i = 0; i < options.orders; ++i) {
+        OrderParams params;
+        params.instrument_name = INSTRUMENTS[i % options.instruments];
+        params.amount = 10.0;
+        params.type = "market";
+
+        // Alternate sides so the mock position stays flat
+        auto sent_at = Clock::now();
+        bool ok = auth.placeOrder(i % 2 == 0 ? OrderSide::Buy : OrderSide::Sell, params,
+            [&, sent_at](const json& response, int64_t) {
+                round_trips.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    Clock::now() - sent_at).count());
+                if (!response.contains("result")) {
+                    ++failed;
+                }
+                gate.open();
+            });
+        if (!ok) {
+            ++failed;
+            continue;
+        }
+        if (!gate.wait(std::chrono::milliseconds(5000))) {
+            ++timed_out;
+            break;
+        }
+    }
+
+    // Reconnects: from the drop until book updates flow again
+    LatencyHistogram recoveries;
+    int unrecovered = 0;
+    for (int i = 0; i < options.drops; ++i) {
+        auto dropped_at = Clock::now();
+        auto deadline = dropped_at + std::chrono::seconds(10);
+        server.dropConnections();
+        while (auth.isConnected() && Clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        uint64_t books_before = book_messages.load();
+        while (book_messages.load() == books_before && Clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        if (book_messages.load() == books_before) {
+            ++unrecovered;
+            continue;
+        }
+        recoveries.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - dropped_at).count());
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    DeribitLogger::instance().flush();
+    std::fprintf(stderr, "Market data: %.0f msgs/s sent, %.0f msgs/s handled over %.1f s "
+                 "(%d book + %d trades channels, %zu market data connections)\n",
+                 sent / elapsed, handled / elapsed, elapsed, options.instruments, options.instruments,
+                 pool ? pool->shardCount() : static_cast<size_t>(0));
+    std::fprintf(stderr, "Startup: connect %.2f ms, authenticate %.2f ms\n", connect_ms, auth_ms);
+    std::fprintf(stderr, "Orders: %llu round trips, %d failed, %d timed out\n",
+                 static_cast<unsigned long long>(round_trips.count()), failed, timed_out);
+    std::fprintf(stderr, "Order round trip (us): mean %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+                 round_trips.mean() / 1000.0, round_trips.percentile(0.50) / 1000.0,
+                 round_trips.percentile(0.90) / 1000.0, round_trips.percentile(0.99) / 1000.0,
+                 round_trips.percentile(0.999) / 1000.0, round_trips.max() / 1000.0);
+    if (options.drops > 0) {
+        std::fprintf(stderr, "Drop to first book update (ms): %llu recovered, %d not within 10 s, "
+                     "p50 %.1f  max %.1f\n",
+                     static_cast<unsigned long long>(recoveries.count()), unrecovered,
+                     recoveries.percentile(0.50) / 1e6, recoveries.max() / 1e6);
+    }
+    std::fprintf(stderr, "%s\n", auth.getLatencyStats().report().c_str());
+
+    server.stop();
+    return 0;
+}
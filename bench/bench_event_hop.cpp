@@ -0,0 +1,165 @@
+// Event handoff benchmark: latency of one EventRecord hop from a publishing
+// (io) thread to a consumer thread through DeribitEventBus and
+// DeribitEventQueue, for each wait strategy, with one producer (SPSC ring)
+// and with two (MPSC ring, as with a market data pool).
+//
+// Each producer publishes an event every --interval-ns; the consumer records
+// the time from publish to pop. A final unpaced run reports throughput.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -I. bench/bench_event_hop.cpp DeribitEventBus.cpp DeribitLatencyStats.cpp
+//       DeribitLogger.cpp -pthread -o bench_event_hop
+// Run:
+//   ./bench_event_hop [--events 200000] [--interval-ns 2000] [--cpus 2,4,6]
+//       --cpus pins the consumer to the first CPU and producers to the rest
+
+#include "DeribitEventBus.hpp"
+#include "DeribitLatencyStats.hpp"
+#include "DeribitLogger.hpp"
+#include <pthread.h>
+#include <sched.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const size_t QUEUE_CAPACITY = 4096;
+
+struct Options {
+    int events = 200000;                // Per producer
+    int64_t interval_ns = 2000;
+    std::vector<int> cpus;
+};
+
+void pinTo(const std::vector<int>& cpus, size_t index) {
+    if (index >= cpus.size()) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[index], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+const char* strategyName(WaitStrategy wait) {
+    switch (wait) {
+        case WaitStrategy::BusySpin: return "busy-spin";
+        case WaitStrategy::Yield: return "yield";
+        case WaitStrategy::Blocking: return "blocking";
+    }
+    return "?";
+}
+
+// Runs producers publishing `events` each (paced when interval_ns > 0) and one consumer
+void runHop(const Options& options, WaitStrategy wait, int producers, int64_t interval_ns) {
+    auto queue = std::make_shared<DeribitEventQueue>(
+        QUEUE_CAPACITY, producers > 1 ? QueueProducers::Multiple : QueueProducers::Single, wait);
+    DeribitEventBus bus;
+    bus.setProducerCount(producers);
+    bus.attach(queue);
+
+    uint64_t expected = static_cast<uint64_t>(options.events) * producers;
+    LatencyHistogram hop_ns;
+    uint64_t received = 0;
+    auto started = std::chrono::steady_clock::now();
+
+    std::thread consumer([&]() {
+        pinTo(options.cpus, 0);
+        EventRecord event;
+        while (received + queue->droppedCount() < expected) {
+            if (queue->pop(event, std::chrono::milliseconds(100))) {
+                hop_ns.record(EventRecord::now() - event.published_ns);
+                ++received;
+            }
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            pinTo(options.cpus, 1 + p);
+            EventRecord event;
+            std::memset(&event, 0, sizeof(event));
+            event.type = EventType::Trade;
+            event.source = static_cast<uint8_t>(p);
+            event.instrument.assign("BTC-PERPETUAL");
+            event.trade.price = 60000.0;
+            event.trade.amount = 10.0;
+
+            int64_t next = EventRecord::now();
+            for (int i = 0; i < options.events; ++i) {
+                if (interval_ns > 0) {
+                    next += interval_ns;
+                    while (EventRecord::now() < next) {
+                    }
+                }
+                event.trade.trade_seq = i;
+                event.received_ns = EventRecord::now();
+                bus.publish(event);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    consumer.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::fprintf(stderr, "%-9s %d producer%s %-7s  p50 %6lld  p90 %6lld  p99 %7lld  p99.9 %8lld  max %9lld ns",
+                 strategyName(wait), producers, producers > 1 ? "s" : " ",
+                 interval_ns > 0 ? "paced" : "burst",
+                 static_cast<long long>(hop_ns.percentile(0.50)),
+                 static_cast<long long>(hop_ns.percentile(0.90)),
+                 static_cast<long long>(hop_ns.percentile(0.99)),
+                 static_cast<long long>(hop_ns.percentile(0.999)),
+                 static_cast<long long>(hop_ns.max()));
+    if (interval_ns == 0) {
+        std::fprintf(stderr, "  %.1f M events/s", received / elapsed / 1e6);
+    }
+    std::fprintf(stderr, "  dropped %llu\n", static_cast<unsigned long long>(queue->droppedCount()));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--events") {
+            options.events = std::atoi(argv[i + 1]);
+        } else if (arg == "--interval-ns") {
+            options.interval_ns = std::atoll(argv[i + 1]);
+        } else if (arg == "--cpus") {
+            for (const char* p = argv[i + 1]; *p != '\0';) {
+                char* end;
+                options.cpus.push_back(static_cast<int>(std::strtol(p, &end, 10)));
+                p = *end == ',' ? end + 1 : end + std::strlen(end);
+            }
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return 1;
+        }
+    }
+    if (std::getenv("DERIBIT_LOG_LEVEL") == nullptr) {
+        DeribitLogger::setLevel(LogLevel::Warn);
+    }
+
+    std::fprintf(stderr, "EventRecord: %zu bytes, queue capacity %zu\n", sizeof(EventRecord), QUEUE_CAPACITY);
+    const WaitStrategy strategies[] = { WaitStrategy::BusySpin, WaitStrategy::Yield, WaitStrategy::Blocking };
+    for (WaitStrategy wait : strategies) {
+        for (int producers = 1; producers <= 2; ++producers) {
+            runHop(options, wait, producers, options.interval_ns);
+        }
+    }
+    for (int producers = 1; producers <= 2; ++producers) {
+        runHop(options, WaitStrategy::BusySpin, producers, 0);
+    }
+    DeribitLogger::instance().flush();
+    return 0;
+}
@@ -0,0 +1,179 @@
+// Journal benchmark: cost of recording a frame with DeribitJournalWriter, and
+// replay throughput of a journal through DeribitSubscription (decode, book
+// update, trade aggregation and dispatch, exactly as live messages are handled).
+//
+// Without a journal argument, writes a synthetic book/trades stream to a
+// temporary journal first and replays that.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -I. -I/path/to/websocketpp -I/path/to/nlohmann_json
+//       bench/bench_journal.cpp DeribitJournal.cpp DeribitAuth.cpp DeribitSubscription.cpp
+//       DeribitOrderBook.cpp DeribitRequestTable.cpp DeribitOrderEncoder.cpp DeribitMessageDecoder.cpp
+//       DeribitChannelRegistry.cpp DeribitLogger.cpp DeribitLatencyStats.cpp DeribitMarketDataPool.cpp
+//       DeribitEventBus.cpp DeribitKeyIndex.cpp DeribitOrderManager.cpp DeribitPositionBook.cpp
+//       DeribitInstrumentRegistry.cpp DeribitReconnect.cpp DeribitRiskGate.cpp DeribitRequestScheduler.cpp
+//       DeribitHeartbeat.cpp DeribitTradeAggregator.cpp DeribitOptionBook.cpp DeribitOptionPricer.cpp
+//       DeribitPortfolioRisk.cpp DeribitBlockRfq.cpp DeribitAsync.cpp -lssl -lcrypto -pthread -o bench_journal
+// Run:
+//   ./bench_journal                       synthetic journal in /tmp
+//   ./bench_journal <prefix> [--recorded] replay a journal recorded with
+//                                         ./deribit_auth --record <prefix>
+
+#include "DeribitAuth.hpp"
+#include "DeribitJournal.hpp"
+#include "DeribitLatencyStats.hpp"
+#include "DeribitLogger.hpp"
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const int SYNTHETIC_FRAMES = 500000;
+const size_t SYNTHETIC_SEGMENT_BYTES = 16 << 20;
+
+int64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// One book snapshot followed by single-level changes, with a trade every tenth frame
+std::vector<std::string> makeFrames(int count, int64_t timestamp_ms) {
+    std::mt19937 rng(7);
+    std::vector<std::string> frames;
+    frames.reserve(count);
+    char buffer[512];
+
+    std::string snapshot = "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":"
+        "\"book.BTC-PERPETUAL.raw\",\"data\":{\"type\":\"snapshot\",\"timestamp\":%lld,"
+        "\"instrument_name\":\"BTC-PERPETUAL\",\"change_id\":1,\"bids\":[";
+    std::snprintf(buffer, sizeof(buffer), snapshot.c_str(), static_cast<long long>(timestamp_ms));
+    snapshot = buffer;
+    for (int i = 0; i < 20; ++i) {
+        std::snprintf(buffer, sizeof(buffer), "%s[\"new\",%.1f,%d]", i ? "," : "", 59999.5 - i * 0.5, 10 + i);
+        snapshot += buffer;
+    }
+    snapshot += "],\"asks\":[";
+    for (int i = 0; i < 20; ++i) {
+        std::snprintf(buffer, sizeof(buffer), "%s[\"new\",%.1f,%d]", i ? "," : "", 60000.0 + i * 0.5, 10 + i);
+        snapshot += buffer;
+    }
+    snapshot += "]}}}";
+    frames.push_back(snapshot);
+
+    int64_t change_id = 1;
+    for (int i = 1; i < count; ++i) {
+        if (i % 10 == 0) {
+            std::snprintf(buffer, sizeof(buffer),
+                "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":"
+                "\"trades.BTC-PERPETUAL.raw\",\"data\":[{\"trade_seq\":%d,\"trade_id\":\"%d\","
+                "\"timestamp\":%lld,\"tick_direction\":0,\"price\":60000.0,"
+                "\"mark_price\":60000.1,\"index_price\":60000.2,\"instrument_name\":\"BTC-PERPETUAL\","
+                "\"direction\":\"buy\",\"amount\":10.0}]}}", i, i, static_cast<long long>(timestamp_ms));
+            frames.push_back(buffer);
+        } else {
+            bool bid = rng() & 1;
+            int level = static_cast<int>(rng() % 20);
+            std::snprintf(buffer, sizeof(buffer), "[[\"change\",%.1f,%d]]",
+                          bid ? 59999.5 - level * 0.5 : 60000.0 + level * 0.5,
+                          10 + static_cast<int>(rng() % 90));
+            std::string levels = bid ? std::string("\"bids\":") + buffer + ",\"asks\":[]"
+                                     : std::string("\"bids\":[],\"asks\":") + buffer;
+            std::snprintf(buffer, sizeof(buffer),
+                "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":"
+                "\"book.BTC-PERPETUAL.raw\",\"data\":{\"type\":\"change\",\"timestamp\":%lld,"
+                "\"prev_change_id\":%lld,\"instrument_name\":\"BTC-PERPETUAL\",\"change_id\":%lld,%s}}}",
+                static_cast<long long>(timestamp_ms), static_cast<long long>(change_id),
+                static_cast<long long>(change_id + 1), levels.c_str());
+            frames.push_back(buffer);
+            ++change_id;
+        }
+    }
+    return frames;
+}
+
+std::string writeSyntheticJournal() {
+    std::string prefix = "/tmp/bench_journal_" + std::to_string(::getpid());
+    std::vector<std::string> frames = makeFrames(SYNTHETIC_FRAMES, wallClockNs() / 1000000);
+
+    DeribitJournalWriter writer;
+    if (!writer.open(prefix, SYNTHETIC_SEGMENT_BYTES)) {
+        return std::string();
+    }
+
+    LatencyHistogram append_ns;
+    size_t bytes = 0;
+    auto started = Clock::now();
+    for (const std::string& frame : frames) {
+        auto t0 = Clock::now();
+        writer.append(JournalRecordType::Frame, wallClockNs(), frame);
+        append_ns.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count());
+        bytes += frame.size();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+    writer.close();
+
+    std::fprintf(stderr, "Record: %llu frames, %.1f MB in %.3f s (%.0f MB/s)\n",
+                 static_cast<unsigned long long>(writer.recordCount()), bytes / 1e6, elapsed,
+                 bytes / 1e6 / elapsed);
+    std::fprintf(stderr, "Append (ns, incl. clock read): p50 %lld  p99 %lld  p99.9 %lld  max %lld\n",
+                 static_cast<long long>(append_ns.percentile(0.50)),
+                 static_cast<long long>(append_ns.percentile(0.99)),
+                 static_cast<long long>(append_ns.percentile(0.999)),
+                 static_cast<long long>(append_ns.max()));
+    return prefix;
+}
+
+void removeJournal(const std::string& prefix) {
+    for (uint64_t index = 0; ::unlink(DeribitJournalWriter::segmentPath(prefix, index).c_str()) == 0; ++index) {
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (std::getenv("DERIBIT_LOG_LEVEL") == nullptr) {
+        DeribitLogger::setLevel(LogLevel::Warn);
+    }
+
+    bool synthetic = argc < 2;
+    std::string prefix = synthetic ? writeSyntheticJournal() : argv[1];
+    ReplaySpeed speed = argc > 2 && std::strcmp(argv[2], "--recorded") == 0
+                      ? ReplaySpeed::Recorded : ReplaySpeed::Maximum;
+    if (prefix.empty()) {
+        return 1;
+    }
+
+    // Never connected: replay only drives the subscription handler
+    DeribitAuth auth("replay", "replay");
+    DeribitJournalReader reader;
+    if (!reader.open(prefix)) {
+        DeribitLogger::instance().flush();
+        return 1;
+    }
+
+    auto started = Clock::now();
+    size_t dispatched = reader.replay(auth.getSubscriptionHandler(), speed);
+    double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+
+    DeribitLogger::instance().flush();
+    std::fprintf(stderr, "Replay: %zu notifications in %.3f s (%.0f msgs/s)\n",
+                 dispatched, elapsed, dispatched / elapsed);
+    std::vector<std::string> instruments;
+    std::fprintf(stderr, "Trade tape: %llu trades aggregated over %zu instruments\n",
+                 static_cast<unsigned long long>(auth.getTradeAggregator().tradeCount()),
+                 auth.getTradeAggregator().instruments(instruments));
+    std::fprintf(stderr, "%s\n", auth.getLatencyStats().report().c_str());
+
+    if (synthetic) {
+        removeJournal(prefix);
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+// Microbenchmark: caller-side cost of logging a top-of-book line through
+// DeribitLogger versus std::cout << ... << std::endl.
+//
+// The synchronous numbers depend heavily on where stdout goes; run it once on a
+// terminal and once redirected to a file to see both ends.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -pthread -I. bench/bench_logger.cpp DeribitLogger.cpp -o bench_logger
+// Run:
+//   ./bench_logger            (results are printed to stderr)
+
+#include "DeribitLogger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const int ROUNDS = 20;
+// Stays below the ring size so the logger measures enqueue cost, not drops
+const int LINES_PER_ROUND = 2000;
+
+struct Result {
+    double p50_ns;
+    double p99_ns;
+    double max_ns;
+};
+
+template <typename Fn>
+Result measure(Fn fn, bool flush_between_rounds) {
+    std::vector<double> samples;
+    samples.reserve(ROUNDS * LINES_PER_ROUND);
+
+    for (int round = 0; round < ROUNDS; ++round) {
+        for (int i = 0; i < LINES_PER_ROUND; ++i) {
+            auto t0 = Clock::now();
+            fn(round * LINES_PER_ROUND + i);
+            samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - t0).count());
+        }
+        if (flush_between_rounds) {
+            DeribitLogger::instance().flush();
+        }
+    }
+
+    std::sort(samples.begin(), samples.end());
+    return Result{ samples[samples.size() / 2], samples[samples.size() * 99 / 100], samples.back() };
+}
+
+void report(const char* name, const Result& r) {
+    std::fprintf(stderr, "%-18s p50 %8.0f ns   p99 %8.0f ns   max %9.0f ns\n",
+                 name, r.p50_ns, r.p99_ns, r.max_ns);
+}
+
+}  // namespace
+
+int main() {
+    const std::string instrument = "BTC-PERPETUAL";
+
+    Result sync = measure([&](int i) {
+        std::cout << "Book " << instrument << " [" << i << "] Bid: " << 12.5 << " @ " << 67000.5
+                  << " | Ask: " << 3.0 << " @ " << 67001.0 << " (depth 812/790)" << std::endl;
+    }, false);
+
+    Result async = measure([&](int i) {
+        LOG_INFO("Book ", instrument, " [", i, "] Bid: ", 12.5, " @ ", 67000.5,
+                 " | Ask: ", 3.0, " @ ", 67001.0, " (depth 812/790)");
+    }, true);
+
+    DeribitLogger::instance().flush();
+    report("cout + endl", sync);
+    report("DeribitLogger", async);
+    return 0;
+}
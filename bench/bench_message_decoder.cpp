@@ -0,0 +1,204 @@
+// Replay benchmark: decode throughput and per-message latency of
+// DeribitMessageDecoder versus the json::parse DOM path it replaced.
+//
+// Replays a capture of raw WebSocket messages (one JSON message per line) if a
+// file is given, otherwise a synthetic mix of book, trades and ticker traffic.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -I. -I/path/to/nlohmann_json
+//       bench/bench_message_decoder.cpp DeribitMessageDecoder.cpp -o bench_message_decoder
+// Run:
+//   ./bench_message_decoder [capture.jsonl]
+
+#include "DeribitMessageDecoder.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const int PASSES = 5;
+const size_t SYNTHETIC_MESSAGES = 20000;
+
+volatile double sink;
+
+std::string bookMessage(std::mt19937& rng, int64_t change_id, int levels) {
+    std::string msg = "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{"
+                      "\"channel\":\"book.BTC-PERPETUAL.raw\",\"data\":{"
+                      "\"type\":\"change\",\"timestamp\":1733912345678,"
+                      "\"prev_change_id\":" + std::to_string(change_id - 1) +
+                      ",\"instrument_name\":\"BTC-PERPETUAL\",\"change_id\":" +
+                      std::to_string(change_id);
+    const char* actions[] = { "new", "change", "delete" };
+    for (int side = 0; side < 2; ++side) {
+        msg += side == 0 ? ",\"bids\":[" : ",\"asks\":[";
+        for (int i = 0; i < levels; ++i) {
+            double price = (side == 0 ? 67000.0 - i * 0.5 : 67000.5 + i * 0.5);
+            msg += (i ? "," : "");
+            msg += "[\"" + std::string(actions[rng() % 3]) + "\"," + std::to_string(price) +
+                   "," + std::to_string(static_cast<double>(rng() % 100000) / 10.0) + "]";
+        }
+        msg += "]";
+    }
+    return msg + "}}}";
+}
+
+std::string tradesMessage(std::mt19937& rng, int count) {
+    std::string msg = "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{"
+                      "\"channel\":\"trades.BTC-PERPETUAL.raw\",\"data\":[";
+    for (int i = 0; i < count; ++i) {
+        msg += (i ? "," : "");
+        msg += "{\"trade_seq\":" + std::to_string(rng() % 1000000) +
+               ",\"trade_id\":\"" + std::to_string(rng()) + "\",\"timestamp\":1733912345678"
+               ",\"tick_direction\":0,\"price\":67012.5,\"mark_price\":67010.12,"
+               "\"instrument_name\":\"BTC-PERPETUAL\",\"index_price\":67001.3,"
+               "\"direction\":\"buy\",\"amount\":" + std::to_string(rng() % 5000) + ".0}";
+    }
+    return msg + "]}}";
+}
+
+std::string tickerMessage() {
+    return "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{"
+           "\"channel\":\"ticker.BTC-PERPETUAL.raw\",\"data\":{\"timestamp\":1733912345678,"
+           "\"stats\":{\"volume_usd\":123456789.0,\"volume\":1843.2,\"price_change\":1.2,"
+           "\"low\":65000.0,\"high\":67500.0},\"state\":\"open\",\"settlement_price\":66800.0,"
+           "\"open_interest\":987654321,\"min_price\":66000.0,\"max_price\":68000.0,"
+           "\"mark_price\":67010.12,\"last_price\":67012.5,\"interest_value\":0.0,"
+           "\"instrument_name\":\"BTC-PERPETUAL\",\"index_price\":67001.3,"
+           "\"funding_8h\":0.0001,\"estimated_delivery_price\":67001.3,"
+           "\"current_funding\":0.00002,\"best_bid_price\":67012.0,\"best_bid_amount\":1000.0,"
+           "\"best_ask_price\":67012.5,\"best_ask_amount\":2500.0}}}";
+}
+
+std::vector<std::string> syntheticCapture() {
+    std::mt19937 rng(42);
+    std::vector<std::string> messages;
+    messages.reserve(SYNTHETIC_MESSAGES);
+    int64_t change_id = 1000000;
+    for (size_t i = 0; i < SYNTHETIC_MESSAGES; ++i) {
+        switch (i % 10) {
+            case 7: messages.push_back(tradesMessage(rng, 1 + rng() % 4)); break;
+            case 9: messages.push_back(tickerMessage()); break;
+            default: messages.push_back(bookMessage(rng, ++change_id, 1 + rng() % 12)); break;
+        }
+    }
+    return messages;
+}
+
+// Previous path: full DOM, params/data copied out, then fields extracted
+double decodeWithDom(const std::string& payload) {
+    auto j = json::parse(payload);
+    double checksum = 0;
+    if (!(j.contains("method") && j["method"] == "subscription")) {
+        return checksum;
+    }
+    auto params = j["params"];
+    std::string channel = params["channel"].get<std::string>();
+    auto data = params["data"];
+    if (channel.compare(0, 5, "book.") == 0) {
+        checksum += data["change_id"].get<double>();
+        for (const char* side : { "bids", "asks" }) {
+            for (const auto& level : data[side]) {
+                checksum += level[1].get<double>() + level[2].get<double>();
+            }
+        }
+    } else if (channel.compare(0, 7, "trades.") == 0) {
+        for (const auto& trade : data) {
+            checksum += trade["price"].get<double>() + trade["amount"].get<double>();
+        }
+    } else if (channel.compare(0, 7, "ticker.") == 0) {
+        checksum += data["best_bid_price"].get<double>() + data["best_ask_price"].get<double>();
+    }
+    return checksum;
+}
+
+struct DecoderState {
+    BookUpdate book;
+    std::vector<TradeEvent> trades;
+};
+
+double decodeWithDecoder(const std::string& payload, DecoderState& state) {
+    MessageEnvelope envelope;
+    double checksum = 0;
+    if (!DeribitMessageDecoder::decodeEnvelope(payload, envelope) || envelope.method != "subscription") {
+        return checksum;
+    }
+    std::string_view channel = envelope.channel;
+    if (channel.compare(0, 5, "book.") == 0) {
+        std::string_view instrument;
+        DeribitMessageDecoder::decodeBook(envelope.data, instrument, state.book);
+        checksum += static_cast<double>(state.book.change_id);
+        for (const auto& level : state.book.levels) {
+            checksum += level.price + level.amount;
+        }
+    } else if (channel.compare(0, 7, "trades.") == 0) {
+        DeribitMessageDecoder::decodeTrades(envelope.data, state.trades);
+        for (const auto& trade : state.trades) {
+            checksum += trade.price + trade.amount;
+        }
+    } else if (channel.compare(0, 7, "ticker.") == 0) {
+        TickerEvent ticker;
+        DeribitMessageDecoder::decodeTicker(envelope.data, ticker);
+        checksum += ticker.best_bid_price + ticker.best_ask_price;
+    }
+    return checksum;
+}
+
+template <typename Fn>
+void replay(const char* name, const std::vector<std::string>& messages, Fn decode) {
+    std::vector<double> samples;
+    samples.reserve(messages.size() * PASSES);
+    double checksum = 0;
+
+    auto start = Clock::now();
+    for (int pass = 0; pass < PASSES; ++pass) {
+        for (const auto& message : messages) {
+            auto t0 = Clock::now();
+            checksum += decode(message);
+            samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - t0).count());
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    sink = checksum;
+
+    std::sort(samples.begin(), samples.end());
+    std::printf("%-10s %10.0f msgs/s   p50 %7.0f ns   p99 %7.0f ns   max %8.0f ns   (checksum %.6g)\n",
+                name, samples.size() / seconds,
+                samples[samples.size() / 2], samples[samples.size() * 99 / 100],
+                samples.back(), checksum);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::vector<std::string> messages;
+    if (argc > 1) {
+        std::ifstream in(argv[1]);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty()) messages.push_back(line);
+        }
+        std::printf("Replaying %zu messages from %s\n", messages.size(), argv[1]);
+    } else {
+        messages = syntheticCapture();
+        std::printf("Replaying %zu synthetic messages (80%% book, 10%% trades, 10%% ticker)\n",
+                    messages.size());
+    }
+    if (messages.empty()) {
+        std::printf("No messages to replay.\n");
+        return 1;
+    }
+
+    DecoderState state;
+    replay("dom", messages, [](const std::string& m) { return decodeWithDom(m); });
+    replay("decoder", messages, [&](const std::string& m) { return decodeWithDecoder(m, state); });
+    return 0;
+}
@@ -0,0 +1,173 @@
+// Options benchmark: time to reprice a whole BTC-sized option chain on one
+// index tick through DeribitOptionBook, and the batch pricing and implied
+// volatility kernels of DeribitOptionPricer against their scalar versions.
+//
+// The chain is synthetic: 12 expiries of 80 strikes each, calls and puts,
+// with mark volatilities on a skewed smile.
+//
+// Build (from the repository root; add -march=native for the AVX2/AVX-512 kernels):
+//   g++ -std=c++17 -O2 -I. -I/path/to/nlohmann_json
+//       bench/bench_options.cpp DeribitOptionBook.cpp DeribitOptionPricer.cpp DeribitKeyIndex.cpp
+//       -o bench_options
+// Run:
+//   ./bench_options
+
+#include "DeribitOptionBook.hpp"
+#include "DeribitOptionPricer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const int TICKS = 5000;
+const int KERNEL_RUNS = 500;
+const int64_t START_MS = 1790000000000;         // 2026-09-21
+const double INDEX = 60000.0;
+
+const char* EXPIRIES[] = {"22SEP26", "23SEP26", "24SEP26", "25SEP26", "2OCT26", "9OCT26",
+                          "30OCT26", "27NOV26", "25DEC26", "26MAR27", "25JUN27", "24SEP27"};
+const int STRIKES = 80;
+
+volatile double sink;
+
+struct Result {
+    double mean_us;
+    double p50_us;
+    double p99_us;
+};
+
+Result summarize(std::vector<double>& samples) {
+    double total = 0;
+    for (double s : samples) total += s;
+    std::sort(samples.begin(), samples.end());
+    return Result{ total / samples.size(),
+                   samples[samples.size() / 2],
+                   samples[samples.size() * 99 / 100] };
+}
+
+void report(const char* name, size_t options, const Result& r) {
+    std::printf("%-30s mean %8.1f us   p50 %8.1f us   p99 %8.1f us   (%.1f ns/option)\n",
+                name, r.mean_us, r.p50_us, r.p99_us, r.p50_us * 1000.0 / options);
+}
+
+template <typename Fn>
+Result measure(int runs, Fn fn) {
+    std::vector<double> samples;
+    samples.reserve(runs);
+    for (int i = 0; i < runs; ++i) {
+        auto start = Clock::now();
+        fn(i);
+        samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+    return summarize(samples);
+}
+
+}  // namespace
+
+int main() {
+    // Mark volatilities of every option, as option tickers would bring them
+    DeribitOptionBook book;
+    for (const char* expiry : EXPIRIES) {
+        for (int s = 0; s < STRIKES; ++s) {
+            double strike = 30000.0 + 1000.0 * s;
+            double k = std::log(strike / INDEX);
+            double vol = 0.55 - 0.08 * k + 0.35 * k * k;
+            for (const char* type : {"C", "P"}) {
+                std::string name = std::string("BTC-") + expiry + "-" + std::to_string(static_cast<int>(strike)) + "-" + type;
+                TickerEvent ticker;
+                ticker.instrument_name = name;
+                ticker.timestamp = START_MS;
+                ticker.mark_iv = vol * 100.0;
+                ticker.index_price = INDEX;
+                ticker.underlying_price = INDEX * 1.002;
+                book.onTicker(ticker);
+            }
+        }
+    }
+    book.onIndex("btc_usd", INDEX, START_MS);
+
+    std::vector<OptionGreeks> chain;
+    size_t options = book.chain("btc_usd", chain);
+    std::vector<SmileSnapshot> smiles;
+    book.smiles("btc_usd", smiles);
+    std::printf("Chain: %zu options over %zu expiries, %zu-lane kernel\n", options, smiles.size(),
+                DeribitOptionPricer::LANES);
+    std::printf("Front smile: ATM vol %.4f, skew %.4f, curvature %.4f (fitted to 0.55, -0.08, 0.35)\n\n",
+                smiles.front().atm_vol, smiles.front().skew, smiles.front().curvature);
+
+    // One index tick: forwards move, smiles refit, the whole chain is priced
+    std::vector<double> samples;
+    samples.reserve(TICKS);
+    for (int i = 0; i < TICKS; ++i) {
+        double index = INDEX * (1.0 + 0.0005 * std::sin(i * 0.1));
+        auto start = Clock::now();
+        book.onIndex("btc_usd", index, START_MS + i * 100);
+        samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+    report("index tick, whole chain", options, summarize(samples));
+
+    // The kernels on the same chain
+    std::vector<double> forward, strike, years, vol, is_call;
+    for (const auto& option : chain) {
+        forward.push_back(option.forward);
+        strike.push_back(option.strike);
+        years.push_back(option.years);
+        vol.push_back(option.volatility);
+        is_call.push_back(option.call ? 1.0 : 0.0);
+    }
+    std::vector<double> price(options), delta(options), gamma(options), vega(options), theta(options), implied(options);
+    OptionBatch batch;
+    batch.count = options;
+    batch.forward = forward.data();
+    batch.strike = strike.data();
+    batch.years = years.data();
+    batch.volatility = vol.data();
+    batch.is_call = is_call.data();
+    batch.price = price.data();
+    batch.delta = delta.data();
+    batch.gamma = gamma.data();
+    batch.vega = vega.data();
+    batch.theta = theta.data();
+
+    report("price(), batch", options, measure(KERNEL_RUNS, [&](int) {
+        DeribitOptionPricer::price(batch);
+    }));
+    report("priceOne(), scalar", options, measure(KERNEL_RUNS, [&](int) {
+        double total = 0;
+        for (size_t i = 0; i < options; ++i) {
+            total += DeribitOptionPricer::priceOne(forward[i], strike[i], years[i], vol[i], is_call[i] > 0.5).price;
+        }
+        sink = total;
+    }));
+    report("impliedVols(), batch", options, measure(KERNEL_RUNS / 10, [&](int) {
+        DeribitOptionPricer::impliedVols(batch, price.data(), implied.data());
+    }));
+    report("impliedVol(), scalar", options, measure(KERNEL_RUNS / 10, [&](int) {
+        double total = 0;
+        for (size_t i = 0; i < options; ++i) {
+            total += DeribitOptionPricer::impliedVol(forward[i], strike[i], years[i], price[i], is_call[i] > 0.5);
+        }
+        sink = total;
+    }));
+
+    // Accuracy: batch against scalar, and the round trip through implied volatility
+    double price_error = 0, vol_error = 0;
+    size_t inverted = 0;
+    for (size_t i = 0; i < options; ++i) {
+        OptionValue value = DeribitOptionPricer::priceOne(forward[i], strike[i], years[i], vol[i], is_call[i] > 0.5);
+        price_error = std::max(price_error, std::fabs(price[i] - value.price) / std::max(value.price, 1e-9));
+        if (!std::isnan(implied[i])) {
+            vol_error = std::max(vol_error, std::fabs(implied[i] - vol[i]));
+            ++inverted;
+        }
+    }
+    std::printf("\nMax relative price difference, batch vs scalar: %.2e\n", price_error);
+    std::printf("Max implied volatility error: %.2e over %zu options\n", vol_error, inverted);
+    return 0;
+}
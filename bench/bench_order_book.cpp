@@ -0,0 +1,161 @@
+// Order book benchmark: the cost of applying one incremental update through
+// DeribitBookManager, and how the manager behaves while it cannot get a
+// snapshot after a gap.
+//
+// The feed is synthetic: a book of DEPTH levels a side, then UPDATES deltas
+// that mostly change or replace levels near the top. For the outage, a gap is
+// injected and the snapshot requester refuses for OUTAGE_MS while deltas keep
+// arriving every DELTA_INTERVAL_US; the report gives how many requests went
+// out in that time (one per backoff step, not one per delta) and how long the
+// resync took once a snapshot arrived.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -I. -I/path/to/nlohmann_json bench/bench_order_book.cpp DeribitOrderBook.cpp
+//       DeribitLogger.cpp -pthread -o bench_order_book
+// Run:
+//   ./bench_order_book
+
+#include "DeribitOrderBook.hpp"
+#include "DeribitLogger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const char* INSTRUMENT = "BTC-PERPETUAL";
+const int DEPTH = 500;
+const int UPDATES = 500000;
+const double MID = 60000.0;
+const double TICK = 0.5;
+const int OUTAGE_MS = 2000;
+const int DELTA_INTERVAL_US = 1000;
+
+struct Result {
+    double mean_ns;
+    double p50_ns;
+    double p99_ns;
+};
+
+Result summarize(std::vector<double>& samples) {
+    double total = 0;
+    for (double s : samples) total += s;
+    std::sort(samples.begin(), samples.end());
+    return Result{ total / samples.size(),
+                   samples[samples.size() / 2],
+                   samples[samples.size() * 99 / 100] };
+}
+
+BookUpdate makeSnapshot(int64_t change_id) {
+    BookUpdate update;
+    update.change_id = change_id;
+    update.is_snapshot = true;
+    for (int i = 0; i < DEPTH; ++i) {
+        update.levels.push_back({ BookSide::Bid, BookAction::New, MID - TICK * (i + 1), 1000.0 + i });
+        update.levels.push_back({ BookSide::Ask, BookAction::New, MID + TICK * (i + 1), 1000.0 + i });
+    }
+    return update;
+}
+
+// Mostly amount changes in the top 20 levels, with some levels removed and re-added
+BookUpdate makeDelta(int i) {
+    BookUpdate update;
+    update.change_id = i + 1;
+    update.prev_change_id = i;
+    BookSide side = (i & 1) == 0 ? BookSide::Bid : BookSide::Ask;
+    double offset = TICK * (1 + (i * 7) % 20);
+    double price = side == BookSide::Bid ? MID - offset : MID + offset;
+    BookAction action = i % 10 == 0 ? BookAction::Delete : (i % 10 == 1 ? BookAction::New : BookAction::Change);
+    update.levels.push_back({ side, action, price, action == BookAction::Delete ? 0.0 : 500.0 + i % 1000 });
+    return update;
+}
+
+void benchApply() {
+    DeribitBookManager books;
+    books.applyUpdate(INSTRUMENT, makeSnapshot(0));
+
+    std::vector<BookUpdate> feed;
+    feed.reserve(UPDATES);
+    for (int i = 0; i < UPDATES; ++i) {
+        feed.push_back(makeDelta(i));
+    }
+
+    std::vector<double> samples;
+    samples.reserve(UPDATES);
+    for (const auto& update : feed) {
+        auto start = Clock::now();
+        books.applyUpdate(INSTRUMENT, update);
+        samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+    Result result = summarize(samples);
+    std::printf("%-28s mean %8.0f ns   p50 %8.0f ns   p99 %8.0f ns   (%d levels a side, %llu gaps)\n",
+                "in-sync delta", result.mean_ns, result.p50_ns, result.p99_ns, DEPTH,
+                static_cast<unsigned long long>(books.gapCount()));
+}
+
+void benchOutage() {
+    DeribitBookManager books;
+    bool refusing = true;
+    books.setSnapshotRequester([&](const std::string&) { return !refusing; });
+    books.applyUpdate(INSTRUMENT, makeSnapshot(0));
+
+    // Skip change 1, then keep streaming while every request is refused
+    int change = 1;
+    auto outage_end = Clock::now() + std::chrono::milliseconds(OUTAGE_MS);
+    int deltas = 0;
+    while (Clock::now() < outage_end) {
+        ++change;
+        books.applyUpdate(INSTRUMENT, makeDelta(change));
+        ++deltas;
+        std::this_thread::sleep_for(std::chrono::microseconds(DELTA_INTERVAL_US));
+    }
+    uint64_t refused = books.snapshotRequestCount();
+
+    // Requests go through again; the next delta past the backoff sends one
+    refusing = false;
+    while (books.snapshotRequestCount() == refused) {
+        ++change;
+        books.applyUpdate(INSTRUMENT, makeDelta(change));
+        std::this_thread::sleep_for(std::chrono::microseconds(DELTA_INTERVAL_US));
+    }
+
+    // The reply: a snapshot a few changes back, so buffered deltas are replayed onto it
+    json snapshot = {
+        {"instrument_name", INSTRUMENT},
+        {"change_id", change - 100},
+        {"timestamp", 0},
+        {"bids", json::array()},
+        {"asks", json::array()}
+    };
+    for (int i = 0; i < DEPTH; ++i) {
+        snapshot["bids"].push_back({ MID - TICK * (i + 1), 1000.0 + i });
+        snapshot["asks"].push_back({ MID + TICK * (i + 1), 1000.0 + i });
+    }
+    auto start = Clock::now();
+    const DeribitOrderBook* book = books.onSnapshotResponse(snapshot);
+    double resync_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+    std::printf("%-28s %d deltas over %d ms, %llu snapshot requests refused\n", "snapshot outage", deltas,
+                OUTAGE_MS, static_cast<unsigned long long>(refused));
+    std::printf("%-28s %.0f us (snapshot + buffered replay), synced %s at change %lld\n", "resync",
+                resync_us, book != nullptr && book->isSynced() ? "yes" : "no",
+                static_cast<long long>(book != nullptr ? book->lastChangeId() : 0));
+}
+
+}  // namespace
+
+int main() {
+    if (std::getenv("DERIBIT_LOG_LEVEL") == nullptr) {
+        DeribitLogger::setLevel(LogLevel::Off);
+    }
+    benchApply();
+    benchOutage();
+    DeribitLogger::instance().flush();
+    return 0;
+}
@@ -0,0 +1,132 @@
+// Microbenchmark: tick-to-send encode time of DeribitOrderEncoder versus the
+// nlohmann::json DOM + dump() path it replaced.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -I. -I/path/to/nlohmann_json
+//       bench/bench_order_encoder.cpp DeribitOrderEncoder.cpp -o bench_order_encoder
+
+#include "DeribitOrderEncoder.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const int BATCHES = 2000;
+const int BATCH_SIZE = 1000;
+
+// Keeps the compiler from discarding the encoded frames
+volatile size_t sink;
+
+struct Result {
+    double mean_ns;
+    double p50_ns;
+    double p99_ns;
+};
+
+// Times BATCH_SIZE calls per sample and reports per-call statistics.
+template <typename Fn>
+Result measure(Fn fn) {
+    std::vector<double> samples;
+    samples.reserve(BATCHES);
+    uint64_t id = 1;
+
+    for (int b = 0; b < BATCHES; ++b) {
+        auto start = Clock::now();
+        for (int i = 0; i < BATCH_SIZE; ++i) {
+            sink = fn(id++);
+        }
+        auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        samples.push_back(elapsed / BATCH_SIZE);
+    }
+
+    double total = 0;
+    for (double s : samples) total += s;
+    std::sort(samples.begin(), samples.end());
+    return Result{ total / samples.size(),
+                   samples[samples.size() / 2],
+                   samples[samples.size() * 99 / 100] };
+}
+
+void report(const char* name, const Result& r) {
+    std::printf("%-28s mean %8.1f ns   p50 %8.1f ns   p99 %8.1f ns\n",
+                name, r.mean_ns, r.p50_ns, r.p99_ns);
+}
+
+}  // namespace
+
+int main() {
+    DeribitOrderEncoder encoder;
+
+    OrderParams limit;
+    limit.instrument_name = "BTC-PERPETUAL";
+    limit.amount = 150;
+    limit.type = "limit";
+    limit.price = 67123.5;
+    limit.post_only = true;
+    limit.time_in_force = TimeInForce::GoodTilCancelled;
+    limit.label = "mm-quote-7";
+
+    // Sanity check: the encoder must produce the same document as nlohmann::json
+    std::string_view frame = encoder.encodeOrder(5275, OrderSide::Buy, limit);
+    json expected = {
+        {"jsonrpc", "2.0"}, {"id", 5275}, {"method", "private/buy"},
+        {"params", {{"instrument_name", "BTC-PERPETUAL"}, {"amount", 150.0}, {"type", "limit"},
+                    {"price", 67123.5}, {"post_only", true},
+                    {"time_in_force", "good_til_cancelled"}, {"label", "mm-quote-7"}}}
+    };
+    if (json::parse(frame) != expected) {
+        std::printf("Encoded frame does not match expected document:\n%.*s\n",
+                    static_cast<int>(frame.size()), frame.data());
+        return 1;
+    }
+    std::printf("Sample frame: %.*s\n\n", static_cast<int>(frame.size()), frame.data());
+
+    report("encoder private/buy limit", measure([&](uint64_t id) {
+        return encoder.encodeOrder(id, OrderSide::Buy, limit).size();
+    }));
+
+    OrderParams market;
+    market.instrument_name = "ETH-PERPETUAL";
+    market.amount = 10;
+    report("encoder private/sell market", measure([&](uint64_t id) {
+        return encoder.encodeOrder(id, OrderSide::Sell, market).size();
+    }));
+
+    report("encoder private/edit", measure([&](uint64_t id) {
+        return encoder.encodeEdit(id, "ETH-349223", 12, 3456.25).size();
+    }));
+
+    report("encoder private/cancel", measure([&](uint64_t id) {
+        return encoder.encodeCancel(id, "ETH-349223").size();
+    }));
+
+    // Baseline: the DOM + dump() path previously used by placeBuyOrder
+    std::string instrument = "BTC-PERPETUAL";
+    std::string label = "mm-quote-7";
+    report("nlohmann private/buy limit", measure([&](uint64_t id) {
+        json j;
+        j["jsonrpc"] = "2.0";
+        j["id"] = id;
+        j["method"] = "private/buy";
+        j["params"] = {
+            {"instrument_name", instrument},
+            {"amount", 150.0},
+            {"type", "limit"},
+            {"price", 67123.5},
+            {"post_only", true},
+            {"time_in_force", "good_til_cancelled"}
+        };
+        j["params"]["label"] = label;
+        std::string payload = j.dump();
+        return payload.size();
+    }));
+
+    return 0;
+}
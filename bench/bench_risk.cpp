@@ -0,0 +1,108 @@
+// Portfolio risk benchmark: net greeks and the default 10 x 10 spot x vol
+// scenario grid of a nine-currency book through DeribitPortfolioRisk, on the
+// calling thread alone and with the worker pool.
+//
+// The book is synthetic: per currency an inverse perpetual, a linear
+// perpetual and OPTIONS options spread over expiries and strikes.
+//
+// Build (from the repository root; add -march=native for the AVX2/AVX-512 kernels):
+//   g++ -std=c++17 -O2 -I. bench/bench_risk.cpp DeribitPortfolioRisk.cpp DeribitOptionPricer.cpp
+//       DeribitOptionBook.cpp DeribitPositionBook.cpp DeribitKeyIndex.cpp DeribitMessageDecoder.cpp
+//       DeribitLogger.cpp -pthread -o bench_risk
+// Run:
+//   ./bench_risk [options per currency]
+
+#include "DeribitPortfolioRisk.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const int RUNS = 500;
+const char* CURRENCIES[] = {"BTC", "ETH", "SOL", "XRP", "BNB", "PAXG", "ADA", "DOGE", "AVAX"};
+const double SPOTS[] = {60000.0, 2500.0, 150.0, 0.6, 550.0, 2400.0, 0.4, 0.12, 30.0};
+
+struct Result {
+    double mean_us;
+    double p50_us;
+    double p99_us;
+};
+
+Result measure(DeribitPortfolioRisk& risk, std::vector<CurrencyRisk>& out) {
+    std::vector<double> samples;
+    samples.reserve(RUNS);
+    double total = 0;
+    for (int i = 0; i < RUNS; ++i) {
+        auto start = Clock::now();
+        risk.evaluate(out);
+        samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        total += samples.back();
+    }
+    std::sort(samples.begin(), samples.end());
+    return Result{ total / RUNS, samples[RUNS / 2], samples[RUNS * 99 / 100] };
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t options = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+
+    DeribitPortfolioRisk risk;
+    for (size_t c = 0; c < 9; ++c) {
+        double spot = SPOTS[c];
+        RiskPosition perpetual;
+        perpetual.currency = CURRENCIES[c];
+        perpetual.instrument_name = perpetual.currency + "-PERPETUAL";
+        perpetual.kind = RiskInstrument::InverseFuture;
+        perpetual.size = -50000.0;
+        perpetual.forward = spot;
+        risk.add(perpetual);
+        perpetual.instrument_name = perpetual.currency + "_USDC-PERPETUAL";
+        perpetual.kind = RiskInstrument::LinearFuture;
+        perpetual.size = 3.0 * 60000.0 / spot;
+        risk.add(perpetual);
+
+        for (size_t i = 0; i < options; ++i) {
+            RiskPosition option;
+            option.currency = CURRENCIES[c];
+            option.kind = RiskInstrument::Option;
+            option.years = (1 + i % 12) * 30.0 / 365.0;
+            option.strike = spot * (0.6 + 0.8 * ((i / 12) % 17) / 16.0);
+            option.forward = spot * (1.0 + 0.01 * option.years);
+            double k = std::log(option.strike / option.forward);
+            option.volatility = 0.55 - 0.08 * k + 0.35 * k * k;
+            option.call = i % 2 == 0;
+            option.size = ((i * 7) % 11 - 5.0) * 60000.0 / spot;
+            risk.add(option);
+        }
+    }
+
+    std::vector<CurrencyRisk> out;
+    RiskScenarioConfig config = risk.getConfig();
+    size_t threads = config.threads;
+    config.threads = 0;
+    risk.configure(config);
+    Result single = measure(risk, out);
+    config.threads = threads;
+    risk.configure(config);
+    Result pooled = measure(risk, out);
+
+    size_t scenarios = config.spot_shocks.size() * config.vol_shocks.size();
+    std::printf("Book: 9 currencies x (2 perpetuals + %zu options), %zu scenarios each\n\n", options, scenarios);
+    std::printf("%-26s mean %8.1f us   p50 %8.1f us   p99 %8.1f us\n", "evaluate(), caller only",
+                single.mean_us, single.p50_us, single.p99_us);
+    std::printf("%-26s mean %8.1f us   p50 %8.1f us   p99 %8.1f us   (%zu workers)\n", "evaluate(), worker pool",
+                pooled.mean_us, pooled.p50_us, pooled.p99_us, threads);
+
+    const CurrencyRisk& btc = out.front();
+    std::printf("\n%s: delta %.3f (%.0f USD), gamma %.3g, vega %.0f, theta %.0f, worst scenario %.0f USD\n",
+                btc.currency.c_str(), btc.delta, btc.delta_usd, btc.gamma, btc.vega, btc.theta, btc.worst_pnl);
+    return 0;
+}
@@ -1,12 +1,17 @@
 // Standard includes and DeribitAuth header
 #include "DeribitAuth.hpp"
+#include "DeribitLogger.hpp"
 #include <iostream>
+#include <fstream>
+#include <atomic>
 #include <thread>
 #include <chrono>
 #include <vector>
 #include <iomanip>
 #include <algorithm>
 #include <cctype>
+#include <cstdlib>
+#include <cstring>
 
 // UI Color definitions
 #define RESET   "\033[0m"
@@ -44,11 +49,19 @@ void printWelcomeMessage() {
               << GREEN << std::setw(15) << std::left << "  buy" << RESET << " - Place a new market buy order\n"
               << GREEN << std::setw(15) << std::left << "  cancel" << RESET << " - Cancel an existing order\n"
               << GREEN << std::setw(15) << std::left << "  edit" << RESET << " - Modify an existing order\n"
+              << GREEN << std::setw(15) << std::left << "  kill" << RESET << " - Block new orders and cancel all\n"
+              << GREEN << std::setw(15) << std::left << "  resume" << RESET << " - Accept orders again after kill\n"
               << GREEN << std::setw(15) << std::left << "  orderbook" << RESET << " - View market orderbook\n"
               << GREEN << std::setw(15) << std::left << "  position" << RESET << " - Check your positions\n"
               << GREEN << std::setw(15) << std::left << "  orders" << RESET << " - List your open orders\n"
+              << GREEN << std::setw(15) << std::left << "  pnl" << RESET << " - Show local positions and P/L\n"
+              << GREEN << std::setw(15) << std::left << "  tape" << RESET << " - Show trade bars and rolling stats\n"
+              << GREEN << std::setw(15) << std::left << "  options" << RESET << " - Show option greeks and vol smiles\n"
+              << GREEN << std::setw(15) << std::left << "  risk" << RESET << " - Show portfolio greeks and scenario PnL\n"
+              << GREEN << std::setw(15) << std::left << "  rfq" << RESET << " - Show open block RFQs and best quotes\n"
               << GREEN << std::setw(15) << std::left << "  subscribe" << RESET << " - Subscribe to market data\n"
               << GREEN << std::setw(15) << std::left << "  unsubscribe" << RESET << " - Unsubscribe from data\n"
+              << GREEN << std::setw(15) << std::left << "  latency" << RESET << " - Show latency percentiles\n"
               << GREEN << std::setw(15) << std::left << "  help" << RESET << " - Show this menu\n"
               << GREEN << std::setw(15) << std::left << "  exit" << RESET << " - Exit the program\n"
               << BLUE << "\n════════════════════════════════════\n" << RESET;
@@ -65,6 +78,213 @@ void printSupportedCurrencies() {
     std::cout << "}" << std::endl;
 }
 
+// Prints open orders from the local order cache, without a request
+void printOpenOrders(const DeribitOrderManager& orders) {
+    std::vector<OrderRecord> open;
+    if (orders.openOrders(open) == 0) {
+        std::cout << "No open orders found." << std::endl;
+        return;
+    }
+
+    std::cout << "\n=== Open Orders (local) ===" << std::endl;
+    for (const auto& order : open) {
+        std::cout << "Order ID: " << order.order_id
+                  << "\nInstrument: " << order.instrument_name
+                  << "\nType: " << order.order_type
+                  << "\nDirection: " << (order.direction == OrderSide::Buy ? "buy" : "sell")
+                  << "\nAmount: " << order.amount
+                  << "\nFilled Amount: " << order.filled_amount
+                  << "\nPrice: " << order.price
+                  << "\nFills: " << order.fills.size()
+                  << "\nLast Update: " << order.last_update_timestamp << std::endl;
+        if (!order.label.empty()) {
+            std::cout << "Label: " << order.label << std::endl;
+        }
+        std::cout << "---------------------" << std::endl;
+    }
+}
+
+// Prints one position from the local position book
+void printPosition(const PositionSnapshot& position) {
+    std::cout << "\nPosition Details for " << position.instrument_name << " (local):"
+              << "\nSize: " << position.size
+              << "\nAverage Price: " << position.average_price
+              << "\nMark Price: " << position.mark_price
+              << "\nFloating P/L: " << position.floating_pnl << " " << position.currency
+              << "\nRealized P/L: " << position.realized_pnl << " " << position.currency << std::endl;
+}
+
+// Prints every local position and the PnL totals per currency
+void printPnl(const DeribitPositionBook& book) {
+    std::vector<PositionSnapshot> positions;
+    if (book.positions(positions) == 0) {
+        std::cout << "No positions." << std::endl;
+        return;
+    }
+    for (const auto& position : positions) {
+        printPosition(position);
+    }
+
+    std::vector<CurrencyTotals> totals;
+    book.totals(totals);
+    std::cout << "\n=== P/L by Currency ===" << std::endl;
+    for (const auto& total : totals) {
+        std::cout << total.currency << ": floating " << total.floating_pnl
+                  << ", realized " << total.realized_pnl
+                  << ", open positions " << total.open_positions << std::endl;
+    }
+}
+
+// Prints net greeks and the spot x vol scenario grid of every currency held
+void printRisk(DeribitAuth* auth) {
+    std::vector<CurrencyRisk> risks;
+    if (auth->evaluateRisk(risks) == 0) {
+        std::cout << "No positions." << std::endl;
+        return;
+    }
+    RiskScenarioConfig config = auth->getPortfolioRisk().getConfig();
+    for (const auto& risk : risks) {
+        std::cout << "\n=== Risk in " << risk.currency << " ===" << std::endl
+                  << risk.positions << " positions (" << risk.options << " options";
+        if (risk.unpriced > 0) {
+            std::cout << ", " << risk.unpriced << " unpriced";
+        }
+        std::cout << ")" << std::endl
+                  << "Delta " << risk.delta << " " << risk.currency << " (" << risk.delta_usd << " USD)"
+                  << ", gamma " << risk.gamma << ", vega " << risk.vega << ", theta " << risk.theta << std::endl
+                  << "Scenario PnL (USD), spot shock by vol shock:" << std::endl << std::setw(8) << "";
+        for (double vol : config.vol_shocks) {
+            std::cout << std::setw(11) << std::right << vol * 100.0;
+        }
+        std::cout << std::endl;
+        for (size_t s = 0; s < config.spot_shocks.size(); ++s) {
+            std::cout << std::setw(7) << std::right << config.spot_shocks[s] * 100.0 << "%";
+            for (size_t v = 0; v < config.vol_shocks.size(); ++v) {
+                std::cout << std::setw(11) << std::right
+                          << static_cast<long long>(risk.scenario_pnl[s * config.vol_shocks.size() + v]);
+            }
+            std::cout << std::endl;
+        }
+        std::cout << std::left << "Worst case " << risk.worst_pnl << " USD" << std::endl;
+    }
+    std::cout << "\nEvaluated in " << auth->getPortfolioRisk().lastEvaluationNs() / 1000.0 << " us" << std::endl;
+}
+
+// Prints every open block RFQ with its best bid and ask across makers
+void printBlockRfqs(const DeribitBlockRfqBook& book) {
+    std::vector<BlockRfq> rfqs;
+    BlockRfqStats stats = book.stats();
+    if (book.rfqs(rfqs) == 0) {
+        std::cout << "No open block RFQs (subscribe to block_rfq.taker.<currency> or block_rfq.maker.<currency>)."
+                  << std::endl;
+    }
+    for (const auto& rfq : rfqs) {
+        BlockRfqBest best;
+        book.best(rfq.block_rfq_id, best);
+        std::cout << "\n=== Block RFQ " << rfq.block_rfq_id << " (" << rfq.role << ", " << rfq.state << ") ===" << std::endl
+                  << "Amount " << rfq.amount << ", expires " << rfq.expiration_timestamp << std::endl;
+        for (const auto& leg : rfq.legs) {
+            std::cout << "  " << (leg.direction == OrderSide::Buy ? "buy  " : "sell ") << leg.ratio
+                      << " x " << leg.instrument_name << std::endl;
+        }
+        std::cout << "Best bid " << best.bid_price << " x " << best.bid_amount << " (" << best.bids << " quotes)"
+                  << ", best ask " << best.ask_price << " x " << best.ask_amount << " (" << best.asks << " quotes)"
+                  << std::endl;
+    }
+    std::cout << "\n" << stats.quotes << " live quotes; " << stats.best_changes << " best quote changes, "
+              << stats.quotes_closed << " quotes closed (mean lifetime " << stats.mean_quote_lifetime_ms << " ms)"
+              << std::endl;
+}
+
+// Prints the rolling window statistics and latest bars of one instrument's trade tape
+void printTape(const DeribitTradeAggregator& aggregator, const std::string& instrument) {
+    std::vector<TradeWindowStats> windows;
+    if (!aggregator.windowStats(instrument, windows)) {
+        std::cout << "No trades aggregated for " << instrument
+                  << " (subscribe to trades." << instrument << ".raw first)." << std::endl;
+        return;
+    }
+
+    std::cout << "\n=== Trade Tape: " << instrument << " ===" << std::endl;
+    for (const auto& window : windows) {
+        std::cout << "Last " << window.window_ms / 1000.0 << " s: " << window.trades << " trades"
+                  << ", volume " << window.volume
+                  << ", VWAP " << window.vwap
+                  << ", imbalance " << window.imbalance
+                  << ", realized vol " << window.realized_vol
+                  << (window.truncated ? " (truncated)" : "") << std::endl;
+    }
+
+    const std::vector<BarSpec>& specs = aggregator.getConfig().bars;
+    std::vector<TradeBar> bars;
+    for (size_t series = 0; series < specs.size(); ++series) {
+        std::cout << "\n" << (specs[series].kind == BarKind::Time ? "Time bars, " : "Volume bars, ")
+                  << specs[series].size << (specs[series].kind == BarKind::Time ? " ms" : "") << ":" << std::endl;
+        aggregator.bars(instrument, series, 5, bars);
+        size_t completed = bars.size();
+        TradeBar open;
+        if (aggregator.openBar(instrument, series, open)) {
+            bars.push_back(open);
+        }
+        for (size_t i = 0; i < bars.size(); ++i) {
+            const TradeBar& bar = bars[i];
+            std::cout << "  " << bar.open_time << "  O " << bar.open << "  H " << bar.high
+                      << "  L " << bar.low << "  C " << bar.close << "  V " << bar.volume
+                      << "  VWAP " << bar.vwap << "  trades " << bar.trades
+                      << (i >= completed ? "  (open)" : "") << std::endl;
+        }
+    }
+}
+
+// Prints one option's greeks, or the smiles of every expiry of an index's chain
+void printOptions(DeribitOptionBook& book, const std::string& name) {
+    if (name.find('-') != std::string::npos) {
+        OptionGreeks option;
+        if (!book.greeks(name, option)) {
+            std::cout << "No greeks for " << name << " (subscribe to its ticker and its index first)." << std::endl;
+            return;
+        }
+        std::cout << "\n=== " << option.instrument_name << " ===" << std::endl
+                  << "Forward " << option.forward << ", " << option.years * 365.0 << " days to expiry" << std::endl
+                  << "Vol " << option.volatility * 100.0 << "% (market " << option.market_iv * 100.0 << "%)" << std::endl
+                  << "Price " << option.price << " (" << option.price / option.forward << " coin)" << std::endl
+                  << "Delta " << option.delta << ", gamma " << option.gamma << ", vega " << option.vega
+                  << ", theta " << option.theta << std::endl;
+        return;
+    }
+
+    // BTC and btc_usd name the same chain
+    std::string index_name;
+    for (char c : name) {
+        index_name += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    if (index_name.find('_') == std::string::npos) {
+        index_name += "_usd";
+    }
+    book.reprice(index_name);
+    std::vector<OptionChainStats> chains;
+    book.chains(chains);
+    for (const auto& chain : chains) {
+        if (chain.index_name != index_name) {
+            continue;
+        }
+        std::cout << "\n=== Options on " << chain.index_name << " ===" << std::endl
+                  << chain.options << " options over " << chain.expiries << " expiries, " << chain.priced
+                  << " priced at index " << chain.index_price << "; last repricing took "
+                  << chain.last_reprice_ns / 1000.0 << " us" << std::endl;
+        std::vector<SmileSnapshot> smiles;
+        book.smiles(index_name, smiles);
+        for (const auto& smile : smiles) {
+            std::cout << "  " << smile.expiration_timestamp << "  " << smile.years * 365.0 << " days"
+                      << "  F " << smile.forward << "  ATM vol " << smile.atm_vol * 100.0 << "%"
+                      << "  skew " << smile.skew << "  curvature " << smile.curvature
+                      << "  (" << smile.points << "/" << smile.options << " observed)" << std::endl;
+        }
+        return;
+    }
+    std::cout << "No options seen on " << index_name << " (subscribe to option tickers first)." << std::endl;
+}
+
 /**
  * Authentication Check
  * @param auth Pointer to DeribitAuth instance
@@ -78,17 +298,471 @@ bool checkAuth(DeribitAuth* auth) {
     return true;
 }
 
-int main() {
+/**
+ * Client Settings
+ * Taken from the command line and applied to every DeribitAuth the CLI creates
+ */
+struct ClientSettings {
+    // Endpoint: --uri <uri>, then DERIBIT_WS_URI, then the Deribit test network
+    std::string uri = DeribitAuth::DEFAULT_URI;
+    // --record <prefix> journals every inbound message for later replay
+    std::string record_prefix;
+    // --shards <n> moves public market data onto n extra connections;
+    // --cpus <a,b,...> pins the order connection to a and the shards to the rest
+    size_t shards = 0;
+    std::vector<int> cpus;
+    // --instrument-cache <path> keeps instrument metadata across restarts
+    std::string instrument_cache = "deribit_instruments.snapshot";
+    // Dropped connections are re-established; --standby keeps a second one
+    // ready to take over, --no-reconnect turns reconnection off
+    ReconnectPolicy reconnect;
+    // Pre-trade limits: --max-order <amount>, --max-position <amount>,
+    // --price-band <fraction>, --max-open-orders <n>, --order-rate <per second>
+    RiskConfig risk;
+    // Requests are paced by Deribit's credit limits; --no-rate-limit sends
+    // everything at once (e.g. against the mock server)
+    RateLimitConfig rate_limits;
+    // Every connection is kept alive and probed; --stall-timeout <ms> sets how long
+    // a silent connection is trusted, --no-heartbeat turns probing off
+    HeartbeatConfig heartbeat;
+};
+
+/**
+ * Client Startup
+ * Creates a client with the settings, connects, authenticates and starts
+ * order and position tracking. The client is returned even if a step fails.
+ */
+DeribitAuth* startClient(const ClientSettings& settings, const std::string& client_id,
+                         const std::string& client_secret, bool& ok) {
+    ok = false;
+    DeribitAuth* auth = new DeribitAuth(client_id, client_secret);
+    if (!settings.record_prefix.empty() && !auth->startRecording(settings.record_prefix)) {
+        std::cerr << RED << "Recording disabled: unable to open " << settings.record_prefix << RESET << std::endl;
+    }
+    if (!settings.cpus.empty()) {
+        auth->setIoThreadCpu(settings.cpus.front());
+    }
+    auth->setReconnectPolicy(settings.reconnect);
+    auth->getRiskGate().configure(settings.risk);
+    auth->setRateLimits(settings.rate_limits);
+    auth->setHeartbeat(settings.heartbeat);
+    if (settings.shards > 0) {
+        MarketDataPoolConfig pool_config;
+        pool_config.shards = settings.shards;
+        pool_config.reconnect = settings.reconnect;
+        pool_config.heartbeat = settings.heartbeat;
+        if (settings.cpus.size() > 1) {
+            pool_config.cpus.assign(settings.cpus.begin() + 1, settings.cpus.end());
+        }
+        auth->enableMarketDataPool(pool_config);
+    }
+
+    // Attempt connection and authentication
+    std::cout << "Attempting to connect to " << settings.uri << "..." << std::endl;
+
+    if (!auth->connect(settings.uri)) {
+        std::cerr << RED << "Failed to connect to Deribit." << RESET << std::endl;
+        return auth;
+    }
+    auth->loadInstruments(SUPPORTED_CURRENCIES, settings.instrument_cache);
+
+    std::cout << "Attempting to authenticate..." << std::endl;
+    if (!auth->authenticate()) {
+        std::cerr << RED << "Authentication failed." << RESET << std::endl;
+        return auth;
+    }
+    std::cout << GREEN << "Authentication successful!" << RESET << std::endl;
+    std::cout << "Access token: " << auth->getAccessToken() << std::endl;
+    if (!auth->startPositionTracking()) {
+        std::cerr << RED << "Order and position tracking could not be started." << RESET << std::endl;
+    }
+    ok = true;
+    return auth;
+}
+
+/**
+ * Script Mode
+ * --script <file> (or - for stdin) runs one command per line without prompts:
+ *
+ *   auth [client_id client_secret]     defaults to DERIBIT_CLIENT_ID / DERIBIT_CLIENT_SECRET
+ *   buy|sell <instrument> <amount> [market|limit] [price] [label]
+ *   edit <order_id> <amount> <price>
+ *   cancel <order_id>
+ *   subscribe|unsubscribe <channel>...  user.* and block_rfq.* channels are private
+ *   sleep <ms>
+ *   wait [ms]                          until every reply is in (default 10000)
+ *   repeat <n> ... end                 runs the enclosed lines n times; may nest
+ *   pnl | orders | risk | rfq | latency | kill | resume | exit
+ *
+ * Text after # is a comment. Requests go out through the asynchronous API
+ * and are not waited for, so the script runs at the rate the client accepts
+ * them; a latency and throughput summary is printed at the end.
+ */
+struct ScriptRun {
+    const ClientSettings* settings = nullptr;
+    DeribitAuth* auth = nullptr;
+    std::vector<DeribitPending> outstanding;
+    LatencyHistogram round_trips;                       // Request sent -> reply, replies only
+    std::atomic<uint64_t> succeeded{0};
+    std::atomic<uint64_t> rejected{0};                  // Error replies, timeouts included
+    uint64_t refused = 0;                               // Never sent: local checks, not connected
+    uint64_t requests = 0;
+    uint64_t commands = 0;
+    std::chrono::steady_clock::time_point first_sent;
+    std::atomic<int64_t> last_reply_ns{0};              // Steady clock
+    bool stop = false;
+    bool failed = false;
+};
+
+std::vector<std::string> splitWords(const std::string& line) {
+    std::vector<std::string> words;
+    std::string text = line.substr(0, line.find('#'));
+    size_t start = 0;
+    while ((start = text.find_first_not_of(" \t\r", start)) != std::string::npos) {
+        size_t end = text.find_first_of(" \t\r", start);
+        words.push_back(text.substr(start, end == std::string::npos ? std::string::npos : end - start));
+        start = end;
+    }
+    return words;
+}
+
+int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Records the outcome of one asynchronous request sent at sent_at when its reply arrives
+void trackRequest(ScriptRun& run, std::chrono::steady_clock::time_point sent_at, DeribitPending pending) {
+    if (pending.ready() && pending.get().local) {
+        ++run.refused;
+        return;
+    }
+    if (run.requests++ == 0) {
+        run.first_sent = sent_at;
+    }
+    ScriptRun* state = &run;
+    pending.then([state, sent_at](const json& response, int64_t) {
+        int64_t now = steadyNs();
+        state->round_trips.record(now - std::chrono::duration_cast<std::chrono::nanoseconds>(
+            sent_at.time_since_epoch()).count());
+        (response.contains("result") ? state->succeeded : state->rejected).fetch_add(1, std::memory_order_relaxed);
+        int64_t last = state->last_reply_ns.load(std::memory_order_relaxed);
+        while (last < now && !state->last_reply_ns.compare_exchange_weak(last, now, std::memory_order_relaxed)) {
+        }
+    });
+    run.outstanding.push_back(pending);
+}
+
+// Waits for every outstanding reply; false if some were still missing at the deadline
+bool waitForReplies(ScriptRun& run, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (const auto& pending : run.outstanding) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+        if (!pending.waitFor(std::max(remaining, std::chrono::milliseconds(0)))) {
+            return false;
+        }
+    }
+    run.outstanding.clear();
+    return true;
+}
+
+bool scriptNeedsAuth(ScriptRun& run, size_t line_number) {
+    if (run.auth == nullptr) {
+        std::cerr << RED << "Line " << line_number << ": run 'auth' first." << RESET << std::endl;
+        run.failed = true;
+        run.stop = true;
+        return false;
+    }
+    return true;
+}
+
+// Runs lines [begin, end)
+void runScriptLines(ScriptRun& run, const std::vector<std::vector<std::string>>& lines, size_t begin, size_t end) {
+    for (size_t i = begin; i < end && !run.stop; ++i) {
+        const std::vector<std::string>& words = lines[i];
+        if (words.empty()) {
+            continue;
+        }
+        std::string command = words[0];
+        std::transform(command.begin(), command.end(), command.begin(), ::tolower);
+        size_t line_number = i + 1;
+        ++run.commands;
+
+        if (command == "repeat") {
+            // Find the matching end, counting nested repeats
+            size_t depth = 1;
+            size_t close = i + 1;
+            for (; close < end; ++close) {
+                if (lines[close].empty()) continue;
+                std::string word = lines[close][0];
+                std::transform(word.begin(), word.end(), word.begin(), ::tolower);
+                depth += word == "repeat" ? 1 : word == "end" ? -1 : 0;
+                if (depth == 0) break;
+            }
+            if (close >= end || words.size() < 2) {
+                std::cerr << RED << "Line " << line_number << ": expected 'repeat <n>' ... 'end'." << RESET << std::endl;
+                run.failed = true;
+                run.stop = true;
+                return;
+            }
+            long count = std::strtol(words[1].c_str(), nullptr, 10);
+            for (long n = 0; n < count && !run.stop; ++n) {
+                runScriptLines(run, lines, i + 1, close);
+            }
+            i = close;
+        }
+        else if (command == "end") {
+            std::cerr << RED << "Line " << line_number << ": 'end' without 'repeat'." << RESET << std::endl;
+            run.failed = true;
+            run.stop = true;
+        }
+        else if (command == "sleep") {
+            long ms = words.size() > 1 ? std::strtol(words[1].c_str(), nullptr, 10) : 1000;
+            std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        }
+        else if (command == "wait") {
+            long ms = words.size() > 1 ? std::strtol(words[1].c_str(), nullptr, 10) : 10000;
+            if (!waitForReplies(run, std::chrono::milliseconds(ms))) {
+                std::cerr << YELLOW << "Line " << line_number << ": replies still outstanding after " << ms
+                          << " ms." << RESET << std::endl;
+            }
+        }
+        else if (command == "auth") {
+            const char* env_id = std::getenv("DERIBIT_CLIENT_ID");
+            const char* env_secret = std::getenv("DERIBIT_CLIENT_SECRET");
+            std::string client_id = words.size() > 2 ? words[1] : (env_id ? env_id : "");
+            std::string client_secret = words.size() > 2 ? words[2] : (env_secret ? env_secret : "");
+            if (run.auth != nullptr) {
+                waitForReplies(run, std::chrono::milliseconds(10000));
+                delete run.auth;
+            }
+            bool ok;
+            run.auth = startClient(*run.settings, client_id, client_secret, ok);
+            if (!ok) {
+                run.failed = true;
+                run.stop = true;
+            }
+        }
+        else if (command == "buy" || command == "sell") {
+            if (!scriptNeedsAuth(run, line_number)) return;
+            if (words.size() < 3) {
+                std::cerr << RED << "Line " << line_number << ": expected '" << command
+                          << " <instrument> <amount> [type] [price] [label]'." << RESET << std::endl;
+                ++run.refused;
+                continue;
+            }
+            OrderParams params;
+            params.instrument_name = words[1];
+            params.amount = std::strtod(words[2].c_str(), nullptr);
+            params.type = words.size() > 3 ? words[3] : "market";
+            if (words.size() > 4) {
+                params.price = std::strtod(words[4].c_str(), nullptr);
+            }
+            if (words.size() > 5) {
+                params.label = words[5];
+            }
+            auto sent_at = std::chrono::steady_clock::now();
+            trackRequest(run, sent_at, command == "buy" ? run.auth->buy(params) : run.auth->sell(params));
+        }
+        else if (command == "edit") {
+            if (!scriptNeedsAuth(run, line_number)) return;
+            if (words.size() < 4) {
+                std::cerr << RED << "Line " << line_number << ": expected 'edit <order_id> <amount> <price>'."
+                          << RESET << std::endl;
+                ++run.refused;
+                continue;
+            }
+            auto sent_at = std::chrono::steady_clock::now();
+            trackRequest(run, sent_at, run.auth->edit(words[1], std::strtod(words[2].c_str(), nullptr),
+                                                      std::strtod(words[3].c_str(), nullptr)));
+        }
+        else if (command == "cancel") {
+            if (!scriptNeedsAuth(run, line_number)) return;
+            if (words.size() < 2) {
+                std::cerr << RED << "Line " << line_number << ": expected 'cancel <order_id>'." << RESET << std::endl;
+                ++run.refused;
+                continue;
+            }
+            auto sent_at = std::chrono::steady_clock::now();
+            trackRequest(run, sent_at, run.auth->cancel(words[1]));
+        }
+        else if (command == "subscribe" || command == "unsubscribe") {
+            if (!scriptNeedsAuth(run, line_number)) return;
+            std::vector<std::string> public_channels;
+            std::vector<std::string> private_channels;
+            for (size_t w = 1; w < words.size(); ++w) {
+                bool is_private = words[w].rfind("user.", 0) == 0 || words[w].rfind("block_rfq.", 0) == 0;
+                (is_private ? private_channels : public_channels).push_back(words[w]);
+            }
+            if (command == "unsubscribe") {
+                if (!public_channels.empty()) run.auth->unsubscribe(public_channels);
+                if (!private_channels.empty()) run.auth->getSubscriptionHandler().unsubscribePrivate(private_channels);
+            } else {
+                if (!public_channels.empty()) run.auth->subscribePublic(public_channels);
+                if (!private_channels.empty()) run.auth->getSubscriptionHandler().subscribePrivate(private_channels);
+            }
+        }
+        else if (command == "pnl") {
+            if (!scriptNeedsAuth(run, line_number)) return;
+            printPnl(run.auth->getPositionBook());
+        }
+        else if (command == "orders") {
+            if (!scriptNeedsAuth(run, line_number)) return;
+            printOpenOrders(run.auth->getOrderManager());
+        }
+        else if (command == "risk") {
+            if (!scriptNeedsAuth(run, line_number)) return;
+            if (run.auth->isTrackingPositions()) {
+                printRisk(run.auth);
+            }
+        }
+        else if (command == "rfq") {
+            if (!scriptNeedsAuth(run, line_number)) return;
+            printBlockRfqs(run.auth->getBlockRfqBook());
+        }
+        else if (command == "latency") {
+            if (!scriptNeedsAuth(run, line_number)) return;
+            run.auth->printLatencyReport();
+        }
+        else if (command == "kill") {
+            if (!scriptNeedsAuth(run, line_number)) return;
+            run.auth->killSwitch();
+        }
+        else if (command == "resume") {
+            if (!scriptNeedsAuth(run, line_number)) return;
+            run.auth->resumeTrading();
+        }
+        else if (command == "exit") {
+            run.stop = true;
+        }
+        else {
+            std::cerr << RED << "Line " << line_number << ": unknown command '" << words[0] << "'." << RESET
+                      << std::endl;
+            run.failed = true;
+            run.stop = true;
+        }
+    }
+}
+
+int runScript(const ClientSettings& settings, const std::string& path) {
+    std::ifstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file) {
+            std::cerr << RED << "Unable to open script " << path << RESET << std::endl;
+            return 1;
+        }
+    }
+    std::istream& in = path == "-" ? std::cin : file;
+    std::vector<std::vector<std::string>> lines;
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(splitWords(line));
+    }
+
+    ScriptRun run;
+    run.settings = &settings;
+    auto started = std::chrono::steady_clock::now();
+    runScriptLines(run, lines, 0, lines.size());
+    bool complete = waitForReplies(run, std::chrono::milliseconds(10000));
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    uint64_t replies = run.round_trips.count();
+    std::cout << "\n=== Script Summary ===" << std::endl
+              << "Commands run: " << run.commands << " in " << std::fixed << std::setprecision(3) << elapsed
+              << " s" << std::endl
+              << "Requests: " << run.requests << " sent, " << run.succeeded.load() << " succeeded, "
+              << run.rejected.load() << " rejected or timed out, " << run.refused << " refused locally"
+              << (complete ? "" : ", some still unanswered") << std::endl;
+    if (replies > 0) {
+        double window = std::chrono::duration<double>(std::chrono::nanoseconds(
+            run.last_reply_ns.load() - std::chrono::duration_cast<std::chrono::nanoseconds>(
+                run.first_sent.time_since_epoch()).count())).count();
+        std::cout << "Throughput: " << std::setprecision(1) << (window > 0 ? replies / window : 0.0)
+                  << " replies/s (first request to last reply)" << std::endl
+                  << "Round trip (us): mean " << run.round_trips.mean() / 1000.0
+                  << "  p50 " << run.round_trips.percentile(0.50) / 1000.0
+                  << "  p90 " << run.round_trips.percentile(0.90) / 1000.0
+                  << "  p99 " << run.round_trips.percentile(0.99) / 1000.0
+                  << "  max " << run.round_trips.max() / 1000.0 << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    if (run.auth != nullptr) {
+        run.auth->printLatencyReport();
+        DeribitLogger::instance().flush();
+        delete run.auth;
+    }
+    DeribitLogger::instance().flush();
+    return run.failed ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
     // Initialize system state
     std::string client_id, client_secret;
     DeribitAuth* auth = nullptr;
 
+    ClientSettings settings;
+    if (const char* env_uri = std::getenv("DERIBIT_WS_URI")) {
+        settings.uri = env_uri;
+    }
+    // --script <file> (or - for stdin) runs commands without prompts; see runScript()
+    std::string script;
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (std::string(argv[i]) == "--standby") {
+            settings.reconnect.warm_standby = true;
+        } else if (std::string(argv[i]) == "--no-reconnect") {
+            settings.reconnect.enabled = false;
+        } else if (std::string(argv[i]) == "--no-rate-limit") {
+            settings.rate_limits.enabled = false;
+        } else if (std::string(argv[i]) == "--no-heartbeat") {
+            settings.heartbeat.enabled = false;
+        } else if (!has_value) {
+            break;
+        } else if (std::string(argv[i]) == "--script") {
+            script = argv[++i];
+        } else if (std::string(argv[i]) == "--uri") {
+            settings.uri = argv[++i];
+        } else if (std::string(argv[i]) == "--record") {
+            settings.record_prefix = argv[++i];
+        } else if (std::string(argv[i]) == "--shards") {
+            settings.shards = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::string(argv[i]) == "--instrument-cache") {
+            settings.instrument_cache = argv[++i];
+        } else if (std::string(argv[i]) == "--max-order") {
+            settings.risk.defaults.max_order_amount = std::strtod(argv[++i], nullptr);
+        } else if (std::string(argv[i]) == "--max-position") {
+            settings.risk.defaults.max_position = std::strtod(argv[++i], nullptr);
+        } else if (std::string(argv[i]) == "--price-band") {
+            settings.risk.defaults.max_price_deviation = std::strtod(argv[++i], nullptr);
+        } else if (std::string(argv[i]) == "--max-open-orders") {
+            settings.risk.max_open_orders = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::string(argv[i]) == "--order-rate") {
+            settings.risk.max_orders_per_second = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::string(argv[i]) == "--stall-timeout") {
+            settings.heartbeat.stall_timeout_ms = static_cast<int>(std::strtol(argv[++i], nullptr, 10));
+        } else if (std::string(argv[i]) == "--cpus") {
+            for (const char* p = argv[++i]; *p != '\0';) {
+                char* end;
+                settings.cpus.push_back(static_cast<int>(std::strtol(p, &end, 10)));
+                p = *end == ',' ? end + 1 : end + std::strlen(end);
+            }
+        }
+    }
+
+    if (!script.empty()) {
+        return runScript(settings, script);
+    }
+
     // Setup initial UI state
     printWelcomeMessage();
     printSupportedCurrencies();
 
     // Main Command Processing Loop
     while (true) {
+        // Let queued log output reach the terminal before prompting
+        DeribitLogger::instance().flush();
         std::cout << YELLOW << "\n➤ " << RESET;
         std::string command;
         std::getline(std::cin, command);
@@ -126,28 +800,15 @@ int main() {
 
             // Cleanup and initialize auth
             if (auth != nullptr) delete auth;
-            auth = new DeribitAuth(client_id, client_secret);
-
-            // Attempt connection and authentication
-            std::cout << "Attempting to connect to Deribit..." << std::endl;
-
-            if (!auth->connect()) {
-                std::cerr << RED << "Failed to connect to Deribit." << RESET << std::endl;
-                continue;
-            }
-
-            std::cout << "Attempting to authenticate..." << std::endl;
-            if (auth->authenticate()) {
-                std::cout << GREEN << "Authentication successful!" << RESET << std::endl;
-                std::cout << "Access token: " << auth->getAccessToken() << std::endl;
-            } else {
-                std::cerr << RED << "Authentication failed." << RESET << std::endl;
-            }
+            bool ok;
+            auth = startClient(settings, client_id, client_secret, ok);
         }
         else if (command == "exit") {
             std::cout << GREEN << "\nThank you for using Deribit Trading Management System.\n"
                       << "Cleaning up and exiting...\n" << RESET;
             if (auth != nullptr) {
+                auth->printLatencyReport();
+                DeribitLogger::instance().flush();
                 delete auth;
             }
             break;
@@ -230,18 +891,72 @@ int main() {
             std::string instrument;
             std::cout << "Enter instrument name (e.g., BTC-PERPETUAL): ";
             std::getline(std::cin, instrument);
-            if (auth->getPosition(instrument)) {
+            // Served from the local position book once it has been reconciled
+            PositionSnapshot position;
+            if (auth->isTrackingPositions() && auth->getPositionBook().isReconciled() &&
+                auth->getPositionBook().getPosition(instrument, position)) {
+                printPosition(position);
+            } else if (auth->getPosition(instrument)) {
                 std::cout << GREEN << "Get position request sent." << RESET << std::endl;
             }
         }
+        else if (command == "pnl") {
+            if (!checkAuth(auth)) continue;
+            printPnl(auth->getPositionBook());
+        }
+        else if (command == "tape") {
+            if (!checkAuth(auth)) continue;
+            std::string instrument;
+            std::cout << "Enter instrument name (e.g., BTC-PERPETUAL): ";
+            std::getline(std::cin, instrument);
+            printTape(auth->getTradeAggregator(), instrument);
+        }
+        else if (command == "options") {
+            if (!checkAuth(auth)) continue;
+            std::string name;
+            std::cout << "Enter an index (e.g., btc_usd) or option (e.g., BTC-27DEC24-60000-C): ";
+            std::getline(std::cin, name);
+            printOptions(auth->getOptionBook(), name);
+        }
+        else if (command == "rfq") {
+            if (!checkAuth(auth)) continue;
+            printBlockRfqs(auth->getBlockRfqBook());
+        }
+        else if (command == "risk") {
+            if (!checkAuth(auth)) continue;
+            if (!auth->isTrackingPositions()) {
+                std::cout << "Position tracking is not running." << std::endl;
+                continue;
+            }
+            printRisk(auth);
+        }
         else if (command == "orders") {
             std::cout << BLUE << "\n=== Open Orders Request ===" << RESET << std::endl;
             if (!checkAuth(auth)) continue;
 
-            if (auth->getOpenOrders()) {
+            // Served from the local order cache once it is seeded
+            const DeribitOrderManager& orders = auth->getOrderManager();
+            if (auth->isTrackingOrders() && orders.isSeeded()) {
+                printOpenOrders(orders);
+            } else if (auth->getOpenOrders()) {
                 std::cout << GREEN << "Get open orders request sent." << RESET << std::endl;
             }
         }
+        else if (command == "kill") {
+            if (!checkAuth(auth)) continue;
+            if (auth->killSwitch()) {
+                std::cout << RED << "Kill switch engaged; cancel all request sent." << RESET << std::endl;
+            }
+        }
+        else if (command == "resume") {
+            if (!checkAuth(auth)) continue;
+            auth->resumeTrading();
+            std::cout << GREEN << "Orders are accepted again." << RESET << std::endl;
+        }
+        else if (command == "latency") {
+            if (!checkAuth(auth)) continue;
+            auth->printLatencyReport();
+        }
         
         // Subscription Commands
         else if (command == "subscribe") {
@@ -293,7 +1008,7 @@ int main() {
             // Process subscription
             auto& subscription = auth->getSubscriptionHandler();
             if (channel_type == "public") {
-                if (subscription.subscribePublic(channels)) {
+                if (auth->subscribePublic(channels)) {
                     std::cout << GREEN << "Public subscription request sent for channels: " << RESET;
                     for (const auto& ch : channels) std::cout << ch << " ";
                     std::cout << std::endl;
@@ -319,8 +1034,7 @@ int main() {
                 channels.push_back(channel);
             }
 
-            auto& subscription = auth->getSubscriptionHandler();
-            if (subscription.unsubscribe(channels)) {
+            if (auth->unsubscribe(channels)) {
                 std::cout << GREEN << "Unsubscribe request sent." << RESET << std::endl;
             }
         }
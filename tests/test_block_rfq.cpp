@@ -0,0 +1,108 @@
+// Block RFQ book test: maker quotes without a price must not enter the book,
+// and a quote that changes side must move between the heaps without being
+// counted as closed.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -I. -I/path/to/nlohmann_json
+//       tests/test_block_rfq.cpp DeribitBlockRfq.cpp -o test_block_rfq
+// Run:
+//   ./test_block_rfq            (exit status 0 on success)
+
+#include "DeribitBlockRfq.hpp"
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+const int64_t START_MS = 1790000000000;
+const int RFQ_ID = 7;
+
+int failures = 0;
+
+void expect(bool condition, const char* what) {
+    std::fprintf(stderr, "%s: %s\n", condition ? "ok  " : "FAIL", what);
+    if (!condition) {
+        ++failures;
+    }
+}
+
+json makeRfq() {
+    return {
+        {"block_rfq_id", RFQ_ID},
+        {"state", "open"},
+        {"role", "maker"},
+        {"amount", 100},
+        {"creation_timestamp", START_MS},
+        {"expiration_timestamp", START_MS + 300000},
+        {"legs", json::array({
+            {{"instrument_name", "BTC-27DEC26-60000-C"}, {"direction", "buy"}, {"ratio", 1}}
+        })}
+    };
+}
+
+json makeQuote(int quote_id, bool bid, double price, int64_t timestamp) {
+    return {
+        {"block_rfq_quote_id", quote_id},
+        {"block_rfq_id", RFQ_ID},
+        {"direction", bid ? "buy" : "sell"},
+        {"price", price},
+        {"amount", 100},
+        {"quote_state", "open"},
+        {"creation_timestamp", START_MS},
+        {"last_update_timestamp", timestamp},
+        {"execution_instruction", "any_part_of"}
+    };
+}
+
+void testUnpricedQuote() {
+    DeribitBlockRfqBook book;
+    book.onMakerRfq(makeRfq(), 0);
+    book.onMakerQuotes(json::array({ makeQuote(1, true, 0.0100, START_MS + 1) }), 0);
+
+    // An open quote that carries no price, on a new id and on the live one
+    json unpriced = makeQuote(2, true, 0.0, START_MS + 2);
+    unpriced.erase("price");
+    json repriced = makeQuote(1, true, 0.0, START_MS + 3);
+    repriced.erase("price");
+    book.onMakerQuotes(json::array({ unpriced, repriced }), 0);
+
+    BlockRfqBest best;
+    expect(book.best(RFQ_ID, best), "the RFQ is in the book");
+    expect(best.bids == 1 && best.bid_price == 0.0100, "the unpriced quotes left the best bid alone");
+    expect(best.asks == 0 && std::isnan(best.ask_price), "no ask appeared");
+    expect(book.stats().quotes == 1, "only the priced quote is live");
+}
+
+void testSideChange() {
+    DeribitBlockRfqBook book;
+    book.onMakerRfq(makeRfq(), 0);
+    book.onMakerQuotes(json::array({
+        makeQuote(1, true, 0.0100, START_MS + 1),
+        makeQuote(2, true, 0.0090, START_MS + 1)
+    }), 0);
+    book.onMakerQuotes(json::array({ makeQuote(1, false, 0.0120, START_MS + 2) }), 0);
+
+    BlockRfqBest best;
+    book.best(RFQ_ID, best);
+    expect(best.bids == 1 && best.bid_price == 0.0090, "the quote left the bids");
+    expect(best.asks == 1 && best.ask_price == 0.0120, "the quote joined the asks");
+    BlockRfqStats stats = book.stats();
+    expect(stats.quotes == 2, "both quotes are still live");
+    expect(stats.quotes_closed == 0 && stats.mean_quote_lifetime_ms == 0.0, "the side change closed nothing");
+
+    // It is still the same quote: closing it by id removes the ask
+    json closed = makeQuote(1, false, 0.0120, START_MS + 3);
+    closed["quote_state"] = "cancelled";
+    book.onMakerQuotes(json::array({ closed }), 0);
+    book.best(RFQ_ID, best);
+    expect(best.asks == 0 && book.stats().quotes_closed == 1, "the moved quote closes by its id");
+}
+
+}  // namespace
+
+int main() {
+    testUnpricedQuote();
+    testSideChange();
+    std::fprintf(stderr, "%s\n", failures == 0 ? "PASSED" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+// Kill switch test: orders that passed the risk gate but are still waiting
+// for matching engine credits must never reach the exchange once the kill
+// switch is engaged, and private/cancel_all must not wait behind them.
+//
+// DeribitAuth runs against a local DeribitMockServer with a matching bucket
+// that admits one order and then refills once every 1000 s, so every later
+// order queues. The kill switch is engaged with ORDERS_QUEUED orders waiting.
+//
+// Build (from the repository root):
+//   g++ -std=c++17 -O2 -I. -I/path/to/websocketpp -I/path/to/nlohmann_json
+//       tests/test_kill_switch.cpp DeribitMockServer.cpp DeribitAuth.cpp DeribitSubscription.cpp
+//       DeribitOrderBook.cpp DeribitRequestTable.cpp DeribitOrderEncoder.cpp DeribitMessageDecoder.cpp
+//       DeribitChannelRegistry.cpp DeribitLogger.cpp DeribitLatencyStats.cpp DeribitJournal.cpp
+//       DeribitMarketDataPool.cpp DeribitEventBus.cpp DeribitKeyIndex.cpp DeribitOrderManager.cpp
+//       DeribitPositionBook.cpp DeribitInstrumentRegistry.cpp DeribitReconnect.cpp DeribitRiskGate.cpp
+//       DeribitRequestScheduler.cpp DeribitHeartbeat.cpp DeribitTradeAggregator.cpp DeribitOptionBook.cpp
+//       DeribitOptionPricer.cpp DeribitPortfolioRisk.cpp DeribitBlockRfq.cpp DeribitAsync.cpp
+//       -lssl -lcrypto -pthread -o test_kill_switch
+// Run:
+//   ./test_kill_switch          (exit status 0 on success)
+
+#include "DeribitAuth.hpp"
+#include "DeribitLogger.hpp"
+#include "DeribitMockServer.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace {
+
+const int ORDERS_QUEUED = 5;
+
+int failures = 0;
+
+void expect(bool condition, const char* what) {
+    std::fprintf(stderr, "%s: %s\n", condition ? "ok  " : "FAIL", what);
+    if (!condition) {
+        ++failures;
+    }
+}
+
+}  // namespace
+
+int main() {
+    if (std::getenv("DERIBIT_LOG_LEVEL") == nullptr) {
+        DeribitLogger::setLevel(LogLevel::Warn);
+    }
+
+    MockServerConfig server_config;
+    server_config.port = 18444;
+    DeribitMockServer server(server_config);
+    if (!server.start()) {
+        std::fprintf(stderr, "Unable to start the mock server\n");
+        return 1;
+    }
+
+    DeribitAuth auth("test", "test");
+    RateLimitConfig limits;
+    limits.matching = {1000, 1, 1000};      // One order, then one every 1000 s
+    auth.setRateLimits(limits);
+    if (!auth.connect(server.uri()) || !auth.authenticate()) {
+        std::fprintf(stderr, "Unable to connect to the mock server\n");
+        server.stop();
+        return 1;
+    }
+
+    OrderParams params;
+    params.instrument_name = "BTC-PERPETUAL";
+    params.amount = 10.0;
+    params.type = "limit";
+    params.price = 1000.0;                  // Far from the touch, so it rests
+
+    std::atomic<int> refused(0);
+    ResponseCallback on_reply = [&](const json& response, int64_t) {
+        if (response.contains("error")) {
+            ++refused;
+        }
+    };
+    expect(auth.placeOrder(OrderSide::Buy, params, on_reply), "first order admitted");
+    for (int i = 0; i < ORDERS_QUEUED; ++i) {
+        auth.placeOrder(OrderSide::Buy, params, on_reply);
+    }
+    expect(auth.getSchedulerStats().waiting == ORDERS_QUEUED, "later orders wait for credits");
+
+    std::atomic<bool> cancelled(false);
+    auto killed_at = std::chrono::steady_clock::now();
+    std::atomic<int64_t> cancel_ms(-1);
+    auth.killSwitch([&](const json& response, int64_t) {
+        cancel_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - killed_at).count();
+        cancelled = response.contains("result");
+    });
+
+    // Long enough for any order that slipped through to reach the server
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+
+    expect(server.requestsHandled("private/buy") == 1, "no queued order was transmitted");
+    expect(refused.load() == ORDERS_QUEUED, "every queued order completed with an error");
+    expect(auth.getSchedulerStats().waiting == 0, "nothing left in the order queue");
+    expect(server.requestsHandled("private/cancel_all") == 1, "cancel_all was sent");
+    expect(cancelled.load() && cancel_ms.load() >= 0 && cancel_ms.load() < 1000,
+           "cancel_all answered without waiting for credits");
+    // Only the transmitted order still holds an open order slot
+    expect(auth.getRiskGate().openOrders() == 1, "queued orders released their risk reservations");
+
+    server.stop();
+    DeribitLogger::instance().flush();
+    std::fprintf(stderr, "%s\n", failures == 0 ? "PASSED" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}